@@ -17,7 +17,6 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
-#include <gui/graphics/color.h>
 #include <sys/common.h>
 #include <sys/io.h>
 #include <assert.h>
@@ -26,20 +25,6 @@
 
 #include "image.h"
 
-void VESABMPainter::paintPixel(gpos_t x,gpos_t y,uint32_t col) {
-	gui::Color color(col);
-	if(!color.isTransparent()) {
-		uint8_t bytes[4];
-		bytes[0] = color.getRed();
-		bytes[1] = color.getGreen();
-		bytes[2] = color.getBlue();
-		bytes[3] = color.getAlpha();
-		size_t bpp = _scr->mode->bitsPerPixel / 8;
-		uint8_t *pos = _scr->frmbuf + ((_y + y) * _scr->mode->width + x + _x) * bpp;
-		_setPixel(*_scr->mode,pos,bytes);
-	}
-}
-
 void VESAImage::paint(VESAScreen *scr,gpos_t x,gpos_t y) {
 	gsize_t width,height;
 	_img->getSize(&width,&height);
@@ -50,6 +35,8 @@ void VESAImage::paint(VESAScreen *scr,gpos_t x,gpos_t y) {
 	if((gsize_t)y + height > scr->mode->height)
 		height = scr->mode->height - y;
 
-	_painter->reset(scr,x,y);
-	_img->paint(0,0,width,height);
+	size_t bpp = scr->mode->bitsPerPixel / 8;
+	size_t pitch = scr->mode->width * bpp;
+	_img->prepare(img::PixelFormat(*scr->mode));
+	_img->paint(scr->frmbuf + y * pitch + x * bpp,pitch,0,0,width,height);
 }
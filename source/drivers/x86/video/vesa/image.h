@@ -19,34 +19,15 @@
 
 #pragma once
 
-#include <img/bitmapimage.h>
+#include <img/image.h>
 #include <sys/common.h>
-#include <vbe/vbe.h>
 
 #include "vesascreen.h"
 
-class VESABMPainter : public img::Painter {
-public:
-	void reset(VESAScreen *scr,gpos_t x,gpos_t y) {
-		_scr = scr;
-		_setPixel = vbe_getPixelFunc(*_scr->mode);
-		_x = x;
-		_y = y;
-	}
-
-	virtual void paintPixel(gpos_t x,gpos_t y,uint32_t col);
-
-private:
-	gpos_t _x;
-	gpos_t _y;
-	VESAScreen *_scr;
-	fSetPixel _setPixel;
-};
-
 class VESAImage {
 public:
 	explicit VESAImage(const std::string &filename)
-		: _painter(new VESABMPainter()), _img(img::Image::loadImage(_painter,filename)) {
+		: _img(img::Image::loadImage(filename)) {
 	}
 
 	void getSize(gsize_t *width,gsize_t *height) {
@@ -56,6 +37,5 @@ public:
 	void paint(VESAScreen *scr,gpos_t x,gpos_t y);
 
 private:
-	std::shared_ptr<VESABMPainter> _painter;
 	std::shared_ptr<img::Image> _img;
 };
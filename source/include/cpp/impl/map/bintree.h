@@ -29,7 +29,8 @@
 #include <stddef.h>
 #include <utility>
 
-// Note: algorithms are based on http://en.wikipedia.org/wiki/Binary_search_tree
+// Note: algorithms are based on http://en.wikipedia.org/wiki/Red%E2%80%93black_tree and
+// "Introduction to Algorithms", Cormen et al., chapter 13
 
 namespace std {
 	template<class Key,class T,class Cmp>
@@ -41,7 +42,9 @@ namespace std {
 
 	/**
 	 * A binary search tree with sorted keys (defined by the compare-object). This is used for
-	 * the map-implementation.
+	 * the map-implementation. The tree is kept balanced as a red-black tree, so that insert,
+	 * find and erase are O(log n) in the worst case. Additionally, all nodes are linked in
+	 * ascending order to make iteration cheap. The root is the right child of _head.
 	 */
 	template<class Key,class T,class Cmp = less<Key> >
 	class bintree {
@@ -227,15 +230,17 @@ namespace std {
 		 */
 		iterator insert(iterator pos,const Key& k,const T& v,bool replace = true) {
 			bintree_node<Key,T,Cmp>* node = pos.node();
-			// head and foot are not allowed
-			if(node == &_head || node == &_foot)
-				node = _head.right();
-			else {
-				// while the parent is less than k, move upwards
-				while(node->parent() && _cmp(k,node->parent()->key()))
-					node = node->parent();
+			// if k belongs directly in front of <pos>, one of the two neighbors has a free slot
+			if(node != &_head && (node == &_foot || _cmp(k,node->key()))) {
+				bintree_node<Key,T,Cmp>* prev = node->prev();
+				if(prev == &_head || _cmp(prev->key(),k)) {
+					if(node != &_foot && !node->left())
+						return link(node,true,k,v);
+					if(prev != &_head && !prev->right())
+						return link(prev,false,k,v);
+				}
 			}
-			return do_insert(node,k,v,replace);
+			return do_insert(_head.right(),k,v,replace);
 		}
 
 		/**
@@ -250,10 +255,10 @@ namespace std {
 				// less?
 				if(_cmp(k,node->key()))
 					node = node->left();
-				else if(k == node->key())
-					return iterator(node);
-				else
+				else if(_cmp(node->key(),k))
 					node = node->right();
+				else
+					return iterator(node);
 			}
 			// not found
 			return end();
@@ -271,21 +276,19 @@ namespace std {
 		 */
 		iterator lower_bound(const key_type &x) {
 			bintree_node<Key,T,Cmp>* node = _head.right();
+			bintree_node<Key,T,Cmp>* res = &_foot;
 			while(node != nullptr) {
-				if(_cmp(x,node->key())) {
-					if(!node->left() || !_cmp(x,node->left()->key()))
-						return iterator(node);
+				if(!_cmp(node->key(),x)) {
+					res = node;
 					node = node->left();
 				}
-				else if(x == node->key())
-					return iterator(node);
 				else
 					node = node->right();
 			}
-			return end();
+			return iterator(res);
 		}
 		const_iterator lower_bound(const key_type &x) const {
-			iterator it = lower_bound(x);
+			iterator it = const_cast<bintree*>(this)->lower_bound(x);
 			return const_iterator(it.node());
 		}
 		/**
@@ -296,21 +299,19 @@ namespace std {
 		 */
 		iterator upper_bound(const key_type &x) {
 			bintree_node<Key,T,Cmp>* node = _head.right();
+			bintree_node<Key,T,Cmp>* res = &_foot;
 			while(node != nullptr) {
 				if(_cmp(x,node->key())) {
-					if(!node->left() || !_cmp(x,node->left()->key()))
-						return iterator(node);
+					res = node;
 					node = node->left();
 				}
-				else if(x == node->key())
-					return iterator(node->next());
 				else
 					node = node->right();
 			}
-			return end();
+			return iterator(res);
 		}
 		const_iterator upper_bound(const key_type &x) const {
-			iterator it = upper_bound(x);
+			iterator it = const_cast<bintree*>(this)->upper_bound(x);
 			return const_iterator(it.node());
 		}
 
@@ -321,10 +322,11 @@ namespace std {
 		 * @return true if erased
 		 */
 		bool erase(const Key& k) {
-			// don't even try it when _elCount is 0
-			if(_elCount > 0)
-				return do_erase(_head.right(),k);
-			return false;
+			iterator it = find(k);
+			if(it == end())
+				return false;
+			do_erase(it.node());
+			return true;
 		}
 		/**
 		 * Removes the element at given position
@@ -342,16 +344,10 @@ namespace std {
 		 * @param last the end of the range (exclusive)
 		 */
 		void erase(iterator first,iterator last) {
-			/* note that we have to run to the node each time because deleted nodes might be reused for
-			 * other nodes. that is, we can't simply iterator through the sequence and delete every
-			 * node. doing so might free nodes twice. */
-			difference_type i = distance(begin(),first);
-			difference_type num = distance(first,last);
-			while(num-- > 0) {
-				iterator it = begin();
-				advance(it,i);
-				do_erase(it.node());
-			}
+			// erasing relinks the nodes instead of moving the data around, so that iterators to
+			// the other nodes stay valid
+			while(first != last)
+				erase(first++);
 		}
 		/**
 		 * Removes all elements from the tree
@@ -381,7 +377,7 @@ namespace std {
 		 */
 		iterator do_insert(bintree_node<Key,T,Cmp>* node,const Key& k,const T& v,bool replace) {
 			bool left = false;
-			bintree_node<Key,T,Cmp>* prev = node ? node->parent() : nullptr;
+			bintree_node<Key,T,Cmp>* prev = &_head;
 			while(node != nullptr) {
 				prev = node;
 				// less?
@@ -389,52 +385,115 @@ namespace std {
 					left = true;
 					node = node->left();
 				}
+				else if(_cmp(node->key(),k)) {
+					left = false;
+					node = node->right();
+				}
 				// equal, so just replace the value
-				else if(k == node->key()) {
+				else {
 					if(replace)
 						node->value(v);
 					return iterator(node);
 				}
-				else {
-					left = false;
-					node = node->right();
-				}
 			}
-
-			// node is null, so create a new node
-			node = new bintree_node<Key,T,Cmp>(k,nullptr,nullptr);
+			return link(prev,left,k,v);
+		}
+		/**
+		 * Creates a new node as the <left> or right child of <parent>, which has to be free, and
+		 * rebalances the tree.
+		 *
+		 * @param parent the parent node
+		 * @param left whether to insert it as left child
+		 * @param k the key
+		 * @param v the value
+		 * @return the insert-position
+		 */
+		iterator link(bintree_node<Key,T,Cmp>* parent,bool left,const Key& k,const T& v) {
+			bintree_node<Key,T,Cmp>* node = new bintree_node<Key,T,Cmp>(k,nullptr,nullptr);
 			node->value(v);
-			if(!prev)
-				prev = &_head;
-			node->parent(prev);
+			node->parent(parent);
 
 			// insert into tree
 			if(left)
-				prev->left(node);
+				parent->left(node);
 			else
-				prev->right(node);
+				parent->right(node);
 
 			// insert into sequence
 			// note that its always directly behind or before the found node when we want to keep
 			// the keys in ascending order!
 			if(left) {
-				// insert before prev
-				prev->prev()->next(node);
-				node->prev(prev->prev());
-				prev->prev(node);
-				node->next(prev);
+				// insert before parent
+				parent->prev()->next(node);
+				node->prev(parent->prev());
+				parent->prev(node);
+				node->next(parent);
 			}
 			else {
-				// insert behind prev
-				node->next(prev->next());
-				node->prev(prev);
-				prev->next()->prev(node);
-				prev->next(node);
+				// insert behind parent
+				node->next(parent->next());
+				node->prev(parent);
+				parent->next()->prev(node);
+				parent->next(node);
 			}
 
+			insert_fixup(node);
 			_elCount++;
 			return iterator(node);
 		}
+		/**
+		 * Restores the red-black properties after inserting the red node <n>
+		 *
+		 * @param n the new node
+		 */
+		void insert_fixup(bintree_node<Key,T,Cmp>* n) {
+			while(n->parent() != &_head && n->parent()->red()) {
+				// the parent is red, thus not the root, so that the grandparent exists
+				bintree_node<Key,T,Cmp>* p = n->parent();
+				bintree_node<Key,T,Cmp>* g = p->parent();
+				if(p == g->left()) {
+					bintree_node<Key,T,Cmp>* u = g->right();
+					if(is_red(u)) {
+						p->red(false);
+						u->red(false);
+						g->red(true);
+						n = g;
+					}
+					else {
+						if(n == p->right()) {
+							rotate_left(p);
+							p = n;
+						}
+						p->red(false);
+						g->red(true);
+						rotate_right(g);
+						// p is black now, so we're done
+						break;
+					}
+				}
+				else {
+					bintree_node<Key,T,Cmp>* u = g->left();
+					if(is_red(u)) {
+						p->red(false);
+						u->red(false);
+						g->red(true);
+						n = g;
+					}
+					else {
+						if(n == p->left()) {
+							rotate_right(p);
+							p = n;
+						}
+						p->red(false);
+						g->red(true);
+						rotate_left(g);
+						// p is black now, so we're done
+						break;
+					}
+				}
+			}
+			_head.right()->red(false);
+		}
 		/**
 		 * Finds the node with the minimum key in the subtree of <n>.
 		 *
@@ -447,68 +506,159 @@ namespace std {
 				current = current->left();
 			return current;
 		}
+		static bool is_red(const bintree_node<Key,T,Cmp>* n) {
+			return n && n->red();
+		}
+		/**
+		 * Replaces the child <old> of <parent> with <n>
+		 */
+		void replace_child(bintree_node<Key,T,Cmp>* parent,bintree_node<Key,T,Cmp>* old,
+				bintree_node<Key,T,Cmp>* n) {
+			if(parent == &_head || old == parent->right())
+				parent->right(n);
+			else
+				parent->left(n);
+		}
 		/**
-		 * Replaces <n> with <newnode>. Deletes <n> when done
+		 * Puts <n> at the place of <old> in the tree
+		 */
+		void transplant(bintree_node<Key,T,Cmp>* old,bintree_node<Key,T,Cmp>* n) {
+			replace_child(old->parent(),old,n);
+			if(n)
+				n->parent(old->parent());
+		}
+		void rotate_left(bintree_node<Key,T,Cmp>* x) {
+			bintree_node<Key,T,Cmp>* y = x->right();
+			x->right(y->left());
+			if(y->left())
+				y->left()->parent(x);
+			transplant(x,y);
+			y->left(x);
+			x->parent(y);
+		}
+		void rotate_right(bintree_node<Key,T,Cmp>* x) {
+			bintree_node<Key,T,Cmp>* y = x->left();
+			x->left(y->right());
+			if(y->right())
+				y->right()->parent(x);
+			transplant(x,y);
+			y->right(x);
+			x->parent(y);
+		}
+		/**
+		 * Removes the given node
 		 *
 		 * @param n the node
-		 * @param newnode the new node
 		 */
-		void replace_in_parent(bintree_node<Key,T,Cmp>* n,bintree_node<Key,T,Cmp>* newnode) {
-			bintree_node<Key,T,Cmp>* parent = n->parent();
+		void do_erase(bintree_node<Key,T,Cmp>* n) {
 			// erase out of the sequence
 			n->prev()->next(n->next());
 			n->next()->prev(n->prev());
-			// replace in parent
-			if(parent) {
-				if(n == parent->left())
-					parent->left(newnode);
-				else
-					parent->right(newnode);
+
+			// x takes the place of the removed node, which might have been black
+			bintree_node<Key,T,Cmp>* x;
+			bintree_node<Key,T,Cmp>* xparent;
+			bool black = !n->red();
+			if(!n->left()) {
+				x = n->right();
+				xparent = n->parent();
+				transplant(n,x);
 			}
-			if(newnode)
-				newnode->parent(parent);
-			delete n;
-		}
-		/**
-		 * The recursive erase-method
-		 *
-		 * @param n the current node
-		 * @param k the key to erase
-		 */
-		bool do_erase(bintree_node<Key,T,Cmp>* n,const Key& k) {
-			if(n) {
-				if(_cmp(k,n->key()))
-					return do_erase(n->left(),k);
-				else if(k != n->key())
-					return do_erase(n->right(),k);
+			else if(!n->right()) {
+				x = n->left();
+				xparent = n->parent();
+				transplant(n,x);
+			}
+			else {
+				// move the successor to the place of n
+				bintree_node<Key,T,Cmp>* succ = find_min(n->right());
+				black = !succ->red();
+				x = succ->right();
+				if(succ->parent() == n)
+					xparent = succ;
 				else {
-					do_erase(n);
-					return true;
+					xparent = succ->parent();
+					transplant(succ,x);
+					succ->right(n->right());
+					succ->right()->parent(succ);
 				}
+				transplant(n,succ);
+				succ->left(n->left());
+				succ->left()->parent(succ);
+				succ->red(n->red());
 			}
-			return false;
+
+			if(black)
+				erase_fixup(x,xparent);
+			delete n;
+			_elCount--;
 		}
 		/**
-		 * Removes the given node
+		 * Restores the red-black properties after removing a black node. <x> carries an extra
+		 * black and might be null, therefore its parent is passed as well.
 		 *
-		 * @param n the node
-		 */
-		void do_erase(bintree_node<Key,T,Cmp>* n) {
-			if(n->left() && n->right()) {
-				bintree_node<Key,T,Cmp>* successor = find_min(n->right());
-				n->key(successor->key());
-				n->value(successor->value());
-				replace_in_parent(successor,successor->right());
-			}
-			else if(n->left() || n->right()) {
-				if(n->left())
-					replace_in_parent(n,n->left());
-				else
-					replace_in_parent(n,n->right());
+		 * @param x the node that took the place of the removed one
+		 * @param parent the parent of x
+		 */
+		void erase_fixup(bintree_node<Key,T,Cmp>* x,bintree_node<Key,T,Cmp>* parent) {
+			while(x != _head.right() && !is_red(x)) {
+				if(x == parent->left()) {
+					bintree_node<Key,T,Cmp>* w = parent->right();
+					if(w->red()) {
+						w->red(false);
+						parent->red(true);
+						rotate_left(parent);
+						w = parent->right();
+					}
+					if(!is_red(w->left()) && !is_red(w->right())) {
+						w->red(true);
+						x = parent;
+						parent = x->parent();
+					}
+					else {
+						if(!is_red(w->right())) {
+							w->left()->red(false);
+							w->red(true);
+							rotate_right(w);
+							w = parent->right();
+						}
+						w->red(parent->red());
+						parent->red(false);
+						w->right()->red(false);
+						rotate_left(parent);
+						x = _head.right();
+					}
+				}
+				else {
+					bintree_node<Key,T,Cmp>* w = parent->left();
+					if(w->red()) {
+						w->red(false);
+						parent->red(true);
+						rotate_right(parent);
+						w = parent->left();
+					}
+					if(!is_red(w->left()) && !is_red(w->right())) {
+						w->red(true);
+						x = parent;
+						parent = x->parent();
+					}
+					else {
+						if(!is_red(w->left())) {
+							w->right()->red(false);
+							w->red(true);
+							rotate_left(w);
+							w = parent->left();
+						}
+						w->red(parent->red());
+						parent->red(false);
+						w->left()->red(false);
+						rotate_right(parent);
+						x = _head.right();
+					}
+				}
 			}
-			else
-				replace_in_parent(n,nullptr);
-			_elCount--;
+			if(x)
+				x->red(false);
 		}
 
 	private:
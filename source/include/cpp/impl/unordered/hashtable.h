@@ -0,0 +1,416 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <impl/unordered/hashtableiterator.h>
+#include <bits/c++config.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stddef.h>
+#include <utility>
+
+namespace std {
+	/**
+	 * A hash table with open addressing and linear probing. This is used for the implementation
+	 * of unordered_map and unordered_set. All elements are stored in one array, whose size is a
+	 * power of two, so that a lookup usually touches a single cache line instead of following
+	 * a chain of nodes. The index of a key is computed by Fibonacci hashing, so that weak hash
+	 * functions (like the identity for integers) are still spread over the whole table.
+	 *
+	 * Erased slots become tombstones, which keeps all other iterators valid. Inserting an element
+	 * may rehash the table, though, which invalidates all iterators, pointers and references.
+	 * The slots are raw memory, in which only the used ones hold a constructed Value. Thus, Value
+	 * needs neither a default-constructor nor an assignment-operator (e.g. pair<const Key,T>).
+	 *
+	 * Value is the stored type, KeyOf extracts the key from a Value.
+	 */
+	template<class Value,class Key,class KeyOf,class Hash = hash<Key>,class Eq = equal_to<Key> >
+	class hashtable {
+		friend class hashtable_iterator<Value,Key,KeyOf,Hash,Eq>;
+		friend class const_hashtable_iterator<Value,Key,KeyOf,Hash,Eq>;
+
+		enum {
+			EMPTY,
+			USED,
+			DELETED
+		};
+
+		static const size_t MIN_SIZE	= 8;
+
+	public:
+		typedef Key key_type;
+		typedef Value value_type;
+		typedef Hash hasher;
+		typedef Eq key_equal;
+		typedef Value& reference;
+		typedef const Value& const_reference;
+		typedef hashtable_iterator<Value,Key,KeyOf,Hash,Eq> iterator;
+		typedef const_hashtable_iterator<Value,Key,KeyOf,Hash,Eq> const_iterator;
+		typedef size_t size_type;
+		typedef long difference_type;
+		typedef Value* pointer;
+		typedef const Value* const_pointer;
+
+	public:
+		/**
+		 * Creates an empty table that has room for at least <n> elements without rehashing
+		 *
+		 * @param n the number of elements to reserve space for
+		 * @param hf the hash-function
+		 * @param eq the key-equal-function
+		 */
+		explicit hashtable(size_type n = 0,const Hash& hf = Hash(),const Eq& eq = Eq())
+			: _slots(nullptr), _states(nullptr), _size(0), _count(0), _deleted(0), _shift(0),
+			  _hash(hf), _eq(eq), _keyof() {
+			if(n > 0)
+				rehash(n);
+		}
+		/**
+		 * Copy-constructor
+		 */
+		hashtable(const hashtable& t)
+			: _slots(nullptr), _states(nullptr), _size(0), _count(0), _deleted(0), _shift(0),
+			  _hash(t._hash), _eq(t._eq), _keyof() {
+			copy(t);
+		}
+		/**
+		 * Assignment-operator
+		 */
+		hashtable& operator =(const hashtable& t) {
+			if(&t != this) {
+				release();
+				_hash = t._hash;
+				_eq = t._eq;
+				copy(t);
+			}
+			return *this;
+		}
+		/**
+		 * Destructor
+		 */
+		~hashtable() {
+			release();
+		}
+
+		/**
+		 * @return the hash-function
+		 */
+		hasher hash_function() const {
+			return _hash;
+		}
+		/**
+		 * @return the key-equal-function
+		 */
+		key_equal key_eq() const {
+			return _eq;
+		}
+
+		/**
+		 * @return the beginning of the table
+		 */
+		iterator begin() {
+			return iterator(this,next_used(0));
+		}
+		const_iterator begin() const {
+			return const_iterator(this,next_used(0));
+		}
+		/**
+		 * @return the end of the table
+		 */
+		iterator end() {
+			return iterator(this,_size);
+		}
+		const_iterator end() const {
+			return const_iterator(this,_size);
+		}
+
+		/**
+		 * @return the number of elements
+		 */
+		size_type size() const {
+			return _count;
+		}
+		/**
+		 * @return true if the table is empty
+		 */
+		bool empty() const {
+			return _count == 0;
+		}
+		/**
+		 * @return the max number of elements
+		 */
+		size_type max_size() const {
+			return numeric_limits<size_type>::max() / (sizeof(Value) + 1);
+		}
+		/**
+		 * @return the number of slots in the table
+		 */
+		size_type bucket_count() const {
+			return _size;
+		}
+		/**
+		 * @return the ratio of elements and slots
+		 */
+		float load_factor() const {
+			return _size == 0 ? 0 : static_cast<float>(_count) / _size;
+		}
+		/**
+		 * @return the max. load factor, after which the table grows
+		 */
+		float max_load_factor() const {
+			return 0.75f;
+		}
+
+		/**
+		 * Searches for the key <k>
+		 *
+		 * @param k the key
+		 * @return the position of the element or end()
+		 */
+		iterator find(const key_type& k) {
+			return iterator(this,lookup(k));
+		}
+		const_iterator find(const key_type& k) const {
+			return const_iterator(this,lookup(k));
+		}
+
+		/**
+		 * Inserts <v>, if its key does not exist yet.
+		 *
+		 * @param v the value
+		 * @return the position of the element with that key and whether it has been inserted
+		 */
+		pair<iterator,bool> insert(const value_type& v) {
+			size_type i = lookup(_keyof(v));
+			if(i != _size)
+				return pair<iterator,bool>(iterator(this,i),false);
+			// tombstones count as used, because they make the probe sequences longer. if we have
+			// to rehash, leave enough room that alternating inserts and erases stay amortized O(1)
+			if((_count + _deleted + 1) * 4 > _size * 3)
+				rehash(_count + 1 + _count / 2);
+			i = place(_keyof(v));
+			new (_slots + i) Value(v);
+			_count++;
+			return pair<iterator,bool>(iterator(this,i),true);
+		}
+
+		/**
+		 * Removes the element at position <it>. All other iterators stay valid.
+		 *
+		 * @param it the position
+		 */
+		void erase(const_iterator it) {
+			remove(it._idx);
+		}
+		/**
+		 * Removes the element with key <k>, if present
+		 *
+		 * @param k the key
+		 * @return the number of removed elements (0 or 1)
+		 */
+		size_type erase(const key_type& k) {
+			size_type i = lookup(k);
+			if(i == _size)
+				return 0;
+			remove(i);
+			return 1;
+		}
+		/**
+		 * Swaps the content of *this with <t>
+		 *
+		 * @param t the other table
+		 */
+		void swap(hashtable& t) {
+			std::swap(_slots,t._slots);
+			std::swap(_states,t._states);
+			std::swap(_size,t._size);
+			std::swap(_count,t._count);
+			std::swap(_deleted,t._deleted);
+			std::swap(_shift,t._shift);
+			std::swap(_hash,t._hash);
+			std::swap(_eq,t._eq);
+		}
+		/**
+		 * Removes all elements. Keeps the allocated slots.
+		 */
+		void clear() {
+			for(size_type i = 0; i < _size; ++i) {
+				if(_states[i] == USED)
+					_slots[i].~Value();
+				_states[i] = EMPTY;
+			}
+			_count = 0;
+			_deleted = 0;
+		}
+
+		/**
+		 * Rebuilds the table so that it has room for at least <n> elements. This drops all
+		 * tombstones and invalidates all iterators.
+		 *
+		 * @param n the number of elements
+		 */
+		void rehash(size_type n) {
+			size_type size = MIN_SIZE;
+			size_type bits = 3;
+			n = max(n,_count);
+			while(size * 3 < n * 4) {
+				size *= 2;
+				bits++;
+			}
+
+			Value *oldslots = _slots;
+			unsigned char *oldstates = _states;
+			size_type oldsize = _size;
+			_slots = alloc_slots(size);
+			_states = new unsigned char[size];
+			fill(_states,_states + size,static_cast<unsigned char>(EMPTY));
+			_size = size;
+			_shift = sizeof(size_t) * 8 - bits;
+			_deleted = 0;
+
+			for(size_type i = 0; i < oldsize; ++i) {
+				if(oldstates[i] == USED) {
+					new (_slots + place(_keyof(oldslots[i]))) Value(move(oldslots[i]));
+					oldslots[i].~Value();
+				}
+			}
+			::operator delete(oldslots);
+			delete[] oldstates;
+		}
+		/**
+		 * Makes sure that <n> elements can be stored without rehashing
+		 *
+		 * @param n the number of elements
+		 */
+		void reserve(size_type n) {
+			if((n + _deleted) * 4 > _size * 3)
+				rehash(n);
+		}
+
+	private:
+		static Value *alloc_slots(size_type n) {
+			return static_cast<Value*>(::operator new(n * sizeof(Value)));
+		}
+		size_type index(const key_type& k) const {
+			const size_t fib = sizeof(size_t) == 8 ? static_cast<size_t>(0x9E3779B97F4A7C15ULL)
+			                                        : static_cast<size_t>(0x9E3779B9U);
+			return (_hash(k) * fib) >> _shift;
+		}
+		size_type next_used(size_type i) const {
+			while(i < _size && _states[i] != USED)
+				i++;
+			return i;
+		}
+		size_type lookup(const key_type& k) const {
+			if(_count == 0)
+				return _size;
+			size_type mask = _size - 1;
+			// the load factor guarantees that there is always an empty slot
+			for(size_type i = index(k); _states[i] != EMPTY; i = (i + 1) & mask) {
+				if(_states[i] == USED && _eq(_keyof(_slots[i]),k))
+					return i;
+			}
+			return _size;
+		}
+		size_type place(const key_type& k) {
+			size_type mask = _size - 1;
+			size_type i = index(k);
+			while(_states[i] == USED)
+				i = (i + 1) & mask;
+			if(_states[i] == DELETED)
+				_deleted--;
+			_states[i] = USED;
+			return i;
+		}
+		void remove(size_type i) {
+			_slots[i].~Value();
+			// if the next slot is empty, no probe sequence continues behind us
+			if(_states[(i + 1) & (_size - 1)] == EMPTY)
+				_states[i] = EMPTY;
+			else {
+				_states[i] = DELETED;
+				_deleted++;
+			}
+			_count--;
+		}
+		void copy(const hashtable& t) {
+			if(t._size > 0) {
+				_slots = alloc_slots(t._size);
+				_states = new unsigned char[t._size];
+				for(size_type i = 0; i < t._size; ++i) {
+					_states[i] = t._states[i];
+					if(t._states[i] == USED)
+						new (_slots + i) Value(t._slots[i]);
+				}
+			}
+			_size = t._size;
+			_count = t._count;
+			_deleted = t._deleted;
+			_shift = t._shift;
+		}
+		void release() {
+			for(size_type i = 0; i < _size; ++i) {
+				if(_states[i] == USED)
+					_slots[i].~Value();
+			}
+			::operator delete(_slots);
+			delete[] _states;
+			_slots = nullptr;
+			_states = nullptr;
+			_size = _count = _deleted = 0;
+		}
+
+	private:
+		Value *_slots;
+		unsigned char *_states;
+		size_type _size;
+		size_type _count;
+		size_type _deleted;
+		size_type _shift;
+		Hash _hash;
+		Eq _eq;
+		KeyOf _keyof;
+	};
+
+	/**
+	 * Two tables are equal if they contain the same elements, regardless of their order
+	 */
+	template<class Value,class Key,class KeyOf,class Hash,class Eq>
+	inline bool operator ==(const hashtable<Value,Key,KeyOf,Hash,Eq>& x,
+	                        const hashtable<Value,Key,KeyOf,Hash,Eq>& y) {
+		if(x.size() != y.size())
+			return false;
+		KeyOf keyof;
+		for(auto it = x.begin(); it != x.end(); ++it) {
+			auto other = y.find(keyof(*it));
+			if(other == y.end() || !(*other == *it))
+				return false;
+		}
+		return true;
+	}
+	template<class Value,class Key,class KeyOf,class Hash,class Eq>
+	inline bool operator !=(const hashtable<Value,Key,KeyOf,Hash,Eq>& x,
+	                        const hashtable<Value,Key,KeyOf,Hash,Eq>& y) {
+		return !(x == y);
+	}
+}
@@ -0,0 +1,117 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <iterator>
+#include <stddef.h>
+
+namespace std {
+	template<class Value,class Key,class KeyOf,class Hash,class Eq>
+	class hashtable;
+	template<class Value,class Key,class KeyOf,class Hash,class Eq>
+	class const_hashtable_iterator;
+
+	template<class Value,class Key,class KeyOf,class Hash,class Eq>
+	class hashtable_iterator : public iterator<forward_iterator_tag,Value> {
+		friend class hashtable<Value,Key,KeyOf,Hash,Eq>;
+		friend class const_hashtable_iterator<Value,Key,KeyOf,Hash,Eq>;
+		typedef hashtable<Value,Key,KeyOf,Hash,Eq> table_type;
+	public:
+		hashtable_iterator()
+			: _table(nullptr), _idx() {
+		}
+		hashtable_iterator(table_type *t,size_t idx)
+			: _table(t), _idx(idx) {
+		}
+		~hashtable_iterator() {
+		}
+
+		Value& operator *() const {
+			return _table->_slots[_idx];
+		}
+		Value* operator ->() const {
+			return &(operator*());
+		}
+		hashtable_iterator& operator ++() {
+			_idx = _table->next_used(_idx + 1);
+			return *this;
+		}
+		hashtable_iterator operator ++(int) {
+			hashtable_iterator tmp(*this);
+			operator++();
+			return tmp;
+		}
+		bool operator ==(const hashtable_iterator& rhs) const {
+			return _idx == rhs._idx && _table == rhs._table;
+		}
+		bool operator !=(const hashtable_iterator& rhs) const {
+			return !operator==(rhs);
+		}
+
+	private:
+		table_type *_table;
+		size_t _idx;
+	};
+
+	// === const-iterator ===
+	template<class Value,class Key,class KeyOf,class Hash,class Eq>
+	class const_hashtable_iterator : public iterator<forward_iterator_tag,Value> {
+		friend class hashtable<Value,Key,KeyOf,Hash,Eq>;
+		typedef hashtable<Value,Key,KeyOf,Hash,Eq> table_type;
+	public:
+		const_hashtable_iterator()
+			: _table(nullptr), _idx() {
+		}
+		const_hashtable_iterator(const table_type *t,size_t idx)
+			: _table(t), _idx(idx) {
+		}
+		const_hashtable_iterator(const hashtable_iterator<Value,Key,KeyOf,Hash,Eq>& it)
+			: _table(it._table), _idx(it._idx) {
+		}
+		~const_hashtable_iterator() {
+		}
+
+		const Value& operator *() const {
+			return _table->_slots[_idx];
+		}
+		const Value* operator ->() const {
+			return &(operator*());
+		}
+		const_hashtable_iterator& operator ++() {
+			_idx = _table->next_used(_idx + 1);
+			return *this;
+		}
+		const_hashtable_iterator operator ++(int) {
+			const_hashtable_iterator tmp(*this);
+			operator++();
+			return tmp;
+		}
+		bool operator ==(const const_hashtable_iterator& rhs) const {
+			return _idx == rhs._idx && _table == rhs._table;
+		}
+		bool operator !=(const const_hashtable_iterator& rhs) const {
+			return !operator==(rhs);
+		}
+
+	private:
+		const table_type *_table;
+		size_t _idx;
+	};
+}
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#pragma once
+
 #include <esc/regex/regex.h>
 
 namespace esc {
@@ -71,6 +73,10 @@ public:
 	explicit CharElement(char c) : Regex::Element(CHAR),_c(c) {
 	}
 
+	char character() const {
+		return _c;
+	}
+
 	virtual bool match(Regex::Result *,Regex::Input &in) const override {
 		char cur = in.peek();
 		char c = _c;
@@ -198,6 +204,16 @@ public:
 		delete _e;
 	}
 
+	const Regex::Element *element() const {
+		return _e;
+	}
+	int min() const {
+		return _min;
+	}
+	int max() const {
+		return _max;
+	}
+
 	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
 		int num = 0;
 		while(_e->match(res,in)) {
@@ -228,6 +244,10 @@ public:
 		delete _list;
 	}
 
+	const ElementList *list() const {
+		return _list;
+	}
+
 	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
 		for(auto &e : *_list) {
 			if(e->match(res,in))
@@ -253,6 +273,10 @@ public:
 		delete _list;
 	}
 
+	const ElementList *list() const {
+		return _list;
+	}
+
 	virtual bool match(Regex::Result *res,Regex::Input &in) const override {
 		if(_list->empty())
 			return in.done();
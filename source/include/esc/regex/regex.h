@@ -20,6 +20,7 @@
 #pragma once
 
 #include <esc/stream/ostream.h>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <ctype.h>
@@ -36,11 +37,17 @@ namespace esc {
  * - repetition: *, + and ?
  * - character classes: [ ] and [^ ]
  * - choices: |
+ *
+ * Patterns are compiled to an NFA, which is executed as a lazily built DFA or, if groups are
+ * requested, simulated directly. Thus, matching takes linear time in the length of the input.
+ * Note that a pattern caches DFA states while it is used and can therefore not be used by
+ * multiple threads at the same time.
  */
 class Regex {
 public:
 	class Result;
 	class Input;
+	class Program;
 
 	static const size_t MAX_GROUP_NESTING		= 16;
 
@@ -189,23 +196,24 @@ public:
 	 */
 	class Pattern {
 	public:
-		explicit Pattern(Element *root,int flags) : _flags(flags),_root(root) {
+		explicit Pattern(Element *root,Program *prog,int flags)
+			: _flags(flags),_root(root),_prog(prog) {
 		}
 		Pattern(const Pattern&) = delete;
 		Pattern &operator=(const Pattern&) = delete;
-		Pattern(Pattern &&p) : _root(p._root) {
+		Pattern(Pattern &&p) : _flags(p._flags),_root(p._root),_prog(p._prog) {
 			p._root = NULL;
+			p._prog = NULL;
 		}
 		Pattern &operator=(Pattern &&p) {
 			if(&p != this) {
-				_root = p._root;
-				p._root = NULL;
+				std::swap(_flags,p._flags);
+				std::swap(_root,p._root);
+				std::swap(_prog,p._prog);
 			}
 			return *this;
 		}
-		virtual ~Pattern() {
-			delete _root;
-		}
+		virtual ~Pattern();
 
 		int flags() const {
 			return _flags;
@@ -213,12 +221,16 @@ public:
 		const Element *root() const {
 			return _root;
 		}
+		const Program *program() const {
+			return _prog;
+		}
 
 		friend esc::OStream &operator<<(esc::OStream &os,const Pattern &p);
 
 	private:
 		int _flags;
 		Element *_root;
+		Program *_prog;
 	};
 
 	/**
@@ -254,6 +266,21 @@ public:
 	 */
 	static Result search(const Pattern &pattern,const std::string &str,uint flags = NONE);
 
+	/**
+	 * Searches for the first line in the buffer [<begin>, <end>) that contains a match of
+	 * <pattern>. Lines are separated by '\n', which is never part of a match. The groups are not
+	 * determined, which makes it considerably faster than search(). This is intended to search
+	 * large buffers like grep does.
+	 *
+	 * @param pattern the pattern
+	 * @param begin the beginning of the buffer
+	 * @param end the end of the buffer
+	 * @param flags the flags to use for the matching
+	 * @return the beginning of the matching line or NULL if there is none
+	 */
+	static const char *searchLine(const Pattern &pattern,const char *begin,const char *end,
+		uint flags = NONE);
+
 	/**
 	 * Compiles <regex> into a pattern and tests whether <regex> matches <str>.
 	 *
@@ -305,9 +332,6 @@ public:
 	 */
 	static std::string replace(const Pattern &pattern,const std::string &str,
 		const std::string &repl,uint flags = NONE);
-
-private:
-	static Regex::Result test(const Pattern &p,const std::string &str,size_t pos,uint flags);
 };
 
 }
@@ -0,0 +1,506 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <esc/vthrow.h>
+#include <sys/common.h>
+#include <sys/sync.h>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace esc {
+
+class ThreadPool;
+
+/**
+ * The base class of everything that can be executed by a ThreadPool. Tasks are not copyable and
+ * can be linked into the pools queues without any allocations.
+ */
+class Task {
+	friend class ThreadPool;
+
+	enum {
+		RUNNING,
+		WAITING,
+		DONE,
+	};
+
+public:
+	/**
+	 * Creates a new task
+	 *
+	 * @param autoDelete whether the pool should delete the task after it has been executed
+	 */
+	explicit Task(bool autoDelete = false)
+		: _state(RUNNING), _autoDelete(autoDelete), _next(), _error() {
+	}
+	virtual ~Task() {
+		delete _error;
+	}
+
+	Task(const Task&) = delete;
+	Task &operator=(const Task&) = delete;
+
+	/**
+	 * Executes the task. Exceptions are caught by the pool and can be retrieved via error().
+	 */
+	virtual void run() = 0;
+
+	/**
+	 * @return true if the task has been executed
+	 */
+	bool finished() const {
+		return _state == DONE;
+	}
+	/**
+	 * @return true if run() has thrown an exception
+	 */
+	bool failed() const {
+		return _error != NULL;
+	}
+	/**
+	 * @return the message of the exception that run() has thrown (only valid if failed())
+	 */
+	const std::string &error() const {
+		return *_error;
+	}
+	/**
+	 * Throws a default_error with the message of the exception that run() has thrown, if any.
+	 */
+	void rethrow() const {
+		if(_error)
+			throw default_error(*_error);
+	}
+
+private:
+	volatile int _state;
+	bool _autoDelete;
+	Task *_next;
+	std::string *_error;
+};
+
+/**
+ * A task that stores the result of a function call.
+ */
+template<class R>
+class ResultTask : public Task {
+public:
+	explicit ResultTask() : Task(), _result() {
+	}
+
+	R result() const {
+		return _result;
+	}
+
+protected:
+	template<class F>
+	void call(F &func) {
+		_result = func();
+	}
+
+private:
+	R _result;
+};
+
+template<>
+class ResultTask<void> : public Task {
+public:
+	explicit ResultTask(bool autoDelete = false) : Task(autoDelete) {
+	}
+
+	void result() const {
+	}
+
+protected:
+	template<class F>
+	void call(F &func) {
+		func();
+	}
+};
+
+/**
+ * Executes a functor and stores its result.
+ */
+template<class F,class R>
+class FuncTask : public ResultTask<R> {
+public:
+	explicit FuncTask(const F &func) : ResultTask<R>(), _func(func) {
+	}
+
+	virtual void run() {
+		this->call(_func);
+	}
+
+private:
+	F _func;
+};
+
+template<class F>
+class FuncTask<F,void> : public ResultTask<void> {
+public:
+	explicit FuncTask(const F &func,bool autoDelete = false)
+		: ResultTask<void>(autoDelete), _func(func) {
+	}
+
+	virtual void run() {
+		call(_func);
+	}
+
+private:
+	F _func;
+};
+
+/**
+ * The result of ThreadPool::async(). The future owns the task; if it is destroyed before the task
+ * has been executed, the destructor waits for it.
+ */
+template<class R>
+class Future {
+	friend class ThreadPool;
+
+	explicit Future(ThreadPool &pool,ResultTask<R> *task) : _pool(&pool), _task(task) {
+	}
+
+public:
+	Future(Future &&f) : _pool(f._pool), _task(f._task) {
+		f._task = NULL;
+	}
+	Future &operator=(Future &&f) {
+		if(&f != this) {
+			release();
+			_pool = f._pool;
+			_task = f._task;
+			f._task = NULL;
+		}
+		return *this;
+	}
+	~Future() {
+		release();
+	}
+
+	Future(const Future&) = delete;
+	Future &operator=(const Future&) = delete;
+
+	/**
+	 * @return true if the result is available
+	 */
+	bool ready() const {
+		return _task->finished();
+	}
+
+	/**
+	 * Waits until the result is available (see ThreadPool::wait).
+	 */
+	void wait();
+
+	/**
+	 * Waits for the result and returns it.
+	 *
+	 * @return the result of the functor
+	 * @throws default_error if the functor has thrown an exception
+	 */
+	R get() {
+		wait();
+		_task->rethrow();
+		return _task->result();
+	}
+
+private:
+	void release();
+
+	ThreadPool *_pool;
+	ResultTask<R> *_task;
+};
+
+/**
+ * A pool of worker threads that execute tasks. Every worker has its own Chase-Lev deque: tasks
+ * that are submitted by a worker are pushed onto its own deque and popped from there in LIFO
+ * order, whereas idle workers steal the oldest tasks from other deques. Tasks that are submitted
+ * by other threads are put into a shared queue. Workers that wait for a task help executing
+ * tasks in the meantime, so that tasks can wait for other tasks without blocking a worker.
+ */
+class ThreadPool {
+	class WorkDeque;
+	struct Worker;
+
+	/* the number of rounds an idle worker looks for work before it blocks */
+	static const int IDLE_SPIN_COUNT	= 64;
+	/* the number of chunks per worker parallel_for and parallel_reduce aim for by default */
+	static const size_t CHUNKS_PER_WORKER	= 8;
+
+	template<class F>
+	class ForTask : public Task {
+	public:
+		explicit ForTask(ThreadPool &pool,size_t begin,size_t end,size_t grain,F &func)
+			: Task(), _sibling(), _pool(pool), _begin(begin), _end(end), _grain(grain),
+			  _func(func) {
+		}
+
+		virtual void run() {
+			ForTask *children = NULL;
+			/* split off the upper halves until our part is small enough */
+			while(_end - _begin > _grain) {
+				size_t mid = _begin + (_end - _begin) / 2;
+				ForTask *child = new ForTask(_pool,mid,_end,_grain,_func);
+				child->_sibling = children;
+				children = child;
+				_pool.submit(child);
+				_end = mid;
+			}
+
+			try {
+				for(size_t i = _begin; i < _end; ++i)
+					_func(i);
+			}
+			catch(...) {
+				_pool.join(children);
+				throw;
+			}
+			_pool.join(children);
+		}
+
+		ForTask *_sibling;
+
+	private:
+		ThreadPool &_pool;
+		size_t _begin;
+		size_t _end;
+		size_t _grain;
+		F &_func;
+	};
+
+	template<class T,class M,class R>
+	class ReduceTask : public Task {
+	public:
+		explicit ReduceTask(ThreadPool &pool,size_t begin,size_t end,size_t grain,
+		                    const T &identity,M &map,R &reduce)
+			: Task(), _sibling(), _result(identity), _pool(pool), _begin(begin), _end(end),
+			  _grain(grain), _map(map), _reduce(reduce) {
+		}
+
+		virtual void run() {
+			ReduceTask *children = NULL;
+			while(_end - _begin > _grain) {
+				size_t mid = _begin + (_end - _begin) / 2;
+				ReduceTask *child = new ReduceTask(_pool,mid,_end,_grain,_result,_map,_reduce);
+				child->_sibling = children;
+				children = child;
+				_pool.submit(child);
+				_end = mid;
+			}
+
+			try {
+				for(size_t i = _begin; i < _end; ++i)
+					_result = _reduce(_result,_map(i));
+				/* the last child covers the range right behind ours, so that we combine the
+				 * results in order and support non-commutative operations as well */
+				for(ReduceTask *c = children; c != NULL; c = c->_sibling) {
+					_pool.wait(c);
+					if(!c->failed())
+						_result = _reduce(_result,c->_result);
+				}
+			}
+			catch(...) {
+				_pool.join(children);
+				throw;
+			}
+			_pool.join(children);
+		}
+
+		ReduceTask *_sibling;
+		T _result;
+
+	private:
+		ThreadPool &_pool;
+		size_t _begin;
+		size_t _end;
+		size_t _grain;
+		M &_map;
+		R &_reduce;
+	};
+
+public:
+	/**
+	 * Creates a new thread pool and starts the worker threads.
+	 *
+	 * @param workers the number of workers (0 = one per CPU)
+	 * @throws default_error if the threads could not be started
+	 */
+	explicit ThreadPool(size_t workers = 0);
+	/**
+	 * Executes all remaining tasks, stops the workers and waits until they are terminated.
+	 */
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool &operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @return the number of worker threads
+	 */
+	size_t workers() const {
+		return _count;
+	}
+
+	/**
+	 * Schedules the given task for execution. The task is not owned by the pool unless it has
+	 * been created with autoDelete = true. Otherwise it has to stay alive until it is finished.
+	 *
+	 * @param task the task
+	 */
+	void submit(Task *task);
+
+	/**
+	 * Waits until the given task has been executed. If the calling thread is a worker of this
+	 * pool, it executes other tasks in the meantime.
+	 *
+	 * @param task the task
+	 */
+	void wait(Task *task);
+
+	/**
+	 * Executes <func> in the background and does not care about its result.
+	 *
+	 * @param func the functor to call
+	 */
+	template<class F>
+	void spawn(const F &func) {
+		submit(new FuncTask<F,void>(func,true));
+	}
+
+	/**
+	 * Executes <func> in the background.
+	 *
+	 * @param func the functor to call
+	 * @return a future for the result of <func>
+	 */
+	template<class F>
+	auto async(const F &func) -> Future<decltype(func())> {
+		typedef decltype(func()) result_type;
+		FuncTask<F,result_type> *task = new FuncTask<F,result_type>(func);
+		submit(task);
+		return Future<result_type>(*this,task);
+	}
+
+	/**
+	 * Calls <func>(i) for all i in [<begin>, <end>). The range is split recursively until the
+	 * parts contain at most <grain> elements; the parts are executed in parallel.
+	 *
+	 * @param begin the first index
+	 * @param end the end index (exclusive)
+	 * @param func the functor to call
+	 * @param grain the maximum number of indices per task (0 = choose automatically)
+	 * @throws default_error if <func> has thrown an exception
+	 */
+	template<class F>
+	void parallel_for(size_t begin,size_t end,F func,size_t grain = 0) {
+		if(begin >= end)
+			return;
+		ForTask<F> root(*this,begin,end,getGrain(end - begin,grain),func);
+		submit(&root);
+		wait(&root);
+		root.rethrow();
+	}
+
+	/**
+	 * Computes <reduce>(...<reduce>(<reduce>(<identity>,<map>(<begin>)),<map>(<begin>+1))...)
+	 * in parallel. Thus, <reduce> has to be associative and <identity> its identity element.
+	 *
+	 * @param begin the first index
+	 * @param end the end index (exclusive)
+	 * @param identity the identity element of <reduce>
+	 * @param map the functor to produce the value for an index
+	 * @param reduce the functor to combine two values
+	 * @param grain the maximum number of indices per task (0 = choose automatically)
+	 * @return the result
+	 * @throws default_error if <map> or <reduce> have thrown an exception
+	 */
+	template<class T,class M,class R>
+	T parallel_reduce(size_t begin,size_t end,const T &identity,M map,R reduce,size_t grain = 0) {
+		if(begin >= end)
+			return identity;
+		ReduceTask<T,M,R> root(*this,begin,end,getGrain(end - begin,grain),identity,map,reduce);
+		submit(&root);
+		wait(&root);
+		root.rethrow();
+		return root._result;
+	}
+
+private:
+	template<class T>
+	void join(T *tasks) {
+		bool failed = false;
+		std::string msg;
+		while(tasks) {
+			T *next = tasks->_sibling;
+			wait(tasks);
+			if(tasks->failed() && !failed) {
+				failed = true;
+				msg = tasks->error();
+			}
+			delete tasks;
+			tasks = next;
+		}
+		if(failed)
+			throw default_error(msg);
+	}
+
+	size_t getGrain(size_t total,size_t grain) const {
+		if(grain == 0)
+			grain = total / (_count * CHUNKS_PER_WORKER);
+		return MAX(grain,1);
+	}
+
+	static int workerLoop(void *arg);
+	void shutdown();
+	Worker *current() const;
+	Task *take(Worker *self);
+	bool hasWork() const;
+	void execute(Task *task);
+	void idle();
+	void notify();
+
+	size_t _count;
+	Worker *_workers;
+	std::mutex _lock;
+	Task *_first;
+	Task *_last;
+	volatile long _queued;
+	volatile long _sleepers;
+	tUserSem _idle;
+	volatile bool _stop;
+};
+
+template<class R>
+inline void Future<R>::wait() {
+	_pool->wait(_task);
+}
+
+template<class R>
+inline void Future<R>::release() {
+	if(_task) {
+		_pool->wait(_task);
+		delete _task;
+		_task = NULL;
+	}
+}
+
+}
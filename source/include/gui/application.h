@@ -39,6 +39,7 @@
 namespace gui {
 	class Window;
 	class Color;
+	class Image;
 
 	/**
 	 * The exception that will be thrown if something goes wrong in Application. For example,
@@ -67,6 +68,7 @@ namespace gui {
 		friend class Window;
 		friend class GraphicsBuffer;
 		friend class Color;
+		friend class Image;
 
 		struct TimeoutFunctor {
 			TimeoutFunctor() : tsc(), functor() {
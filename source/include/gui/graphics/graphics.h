@@ -42,7 +42,6 @@ namespace gui {
 		friend class Control;
 		friend class UIElement;
 		friend class Image;
-		friend class GUIPainter;
 
 	private:
 		static const int OUT_TOP		= 1;
@@ -29,6 +29,7 @@ namespace gui {
 	class Window;
 	class Graphics;
 	class UIElement;
+	class Image;
 
 	/**
 	 * The graphics-buffer holds an array of a specific size and provides access to it. This is
@@ -39,6 +40,7 @@ namespace gui {
 		friend class Window;
 		friend class Graphics;
 		friend class UIElement;
+		friend class Image;
 
 	public:
 		/**
@@ -26,39 +26,14 @@
 #include <memory>
 
 namespace gui {
-	class GUIPainter : public img::Painter {
-	public:
-		void reset(Graphics *g,const Pos &pos) {
-			_g = g;
-			_last = 0;
-			_g->setColor(Color(_last));
-			_pos = pos;
-		}
-
-		virtual void paintPixel(gpos_t x,gpos_t y,uint32_t col) {
-			if(EXPECT_FALSE(col != _last)) {
-				_g->setColor(Color(col));
-				_last = col;
-			}
-			if(!_g->getColor().isTransparent())
-				_g->doSetPixel(x + _pos.x,y + _pos.y);
-		}
-
-	private:
-		Graphics *_g;
-		uint32_t _last;
-		Pos _pos;
-	};
-
 	class Image {
 	public:
 		static std::shared_ptr<Image> loadImage(const std::string& path) {
 			return std::shared_ptr<Image>(
-				new Image(img::Image::loadImage(std::shared_ptr<GUIPainter>(new GUIPainter()),path)));
+				new Image(img::Image::loadImage(path)));
 		}
 
-		explicit Image(img::Image *img)
-			: _painter(std::static_pointer_cast<GUIPainter>(img->getPainter())), _img(img) {
+		explicit Image(img::Image *img) : _img(img) {
 		}
 
 		Size getSize() const {
@@ -70,7 +45,6 @@ namespace gui {
 		void paint(Graphics &g,const Pos &pos);
 
 	private:
-		std::shared_ptr<GUIPainter> _painter;
 		std::shared_ptr<img::Image> _img;
 	};
 }
@@ -84,8 +84,8 @@ public:
 	static const uint8_t SIG[];
 	static const uint32_t TRANSPARENT	= 0x00FF00FF;
 
-	explicit BitmapImage(const std::shared_ptr<Painter> &painter,const std::string &filename)
-		: Image(painter), _fileHeader(nullptr), _infoHeader(nullptr), _colorTable(nullptr), _tableSize(0),
+	explicit BitmapImage(const std::string &filename)
+		: Image(), _fileHeader(nullptr), _infoHeader(nullptr), _colorTable(nullptr), _tableSize(0),
 			_data(nullptr), _dataSize(0) {
 		loadFromFile(filename);
 	}
@@ -103,13 +103,15 @@ public:
 		*width = _infoHeader->width;
 		*height = _infoHeader->height;
 	}
-	virtual void paint(gpos_t x,gpos_t y,gsize_t width,gsize_t height);
+
+protected:
+	virtual void decodeRow(gpos_t y,uint32_t *row) const;
 
 private:
 	void loadFromFile(const std::string &filename);
-	void paintBitfields(gpos_t x,gpos_t y,gsize_t width,gsize_t height);
-	void paintRGB(gpos_t x,gpos_t y,gsize_t width,gsize_t height);
-	uint getShift(uint32_t val);
+	void decodeBitfields(const uint8_t *data,uint32_t *row) const;
+	void decodeRGB(const uint8_t *data,uint32_t *row) const;
+	static uint getShift(uint32_t val);
 
 	FileHeader *_fileHeader;
 	InfoHeader *_infoHeader;
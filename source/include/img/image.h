@@ -19,9 +19,11 @@
 
 #pragma once
 
+#include <esc/proto/screen.h>
 #include <sys/common.h>
 #include <exception>
 #include <memory>
+#include <vector>
 
 namespace img {
 
@@ -39,34 +41,113 @@ private:
 	std::string _str;
 };
 
-class Painter {
-public:
-	virtual ~Painter() {
+/**
+ * Describes the pixel-format of a destination buffer (e.g. the framebuffer or the buffer of a
+ * GUI window). Images are converted into this format once and are afterwards simply copied.
+ */
+struct PixelFormat {
+	explicit PixelFormat()
+		: bytesPerPixel(), redMaskSize(), redFieldPosition(), greenMaskSize(), greenFieldPosition(),
+		  blueMaskSize(), blueFieldPosition() {
+	}
+	explicit PixelFormat(const esc::Screen::Mode &mode)
+		: bytesPerPixel(mode.bitsPerPixel / 8), redMaskSize(mode.redMaskSize),
+		  redFieldPosition(mode.redFieldPosition), greenMaskSize(mode.greenMaskSize),
+		  greenFieldPosition(mode.greenFieldPosition), blueMaskSize(mode.blueMaskSize),
+		  blueFieldPosition(mode.blueFieldPosition) {
 	}
 
-	virtual void paintPixel(gpos_t x,gpos_t y,uint32_t col) = 0;
+	bool operator==(const PixelFormat &f) const {
+		return bytesPerPixel == f.bytesPerPixel &&
+			redMaskSize == f.redMaskSize && redFieldPosition == f.redFieldPosition &&
+			greenMaskSize == f.greenMaskSize && greenFieldPosition == f.greenFieldPosition &&
+			blueMaskSize == f.blueMaskSize && blueFieldPosition == f.blueFieldPosition;
+	}
+	bool operator!=(const PixelFormat &f) const {
+		return !operator==(f);
+	}
+
+	uint8_t bytesPerPixel;
+	uint8_t redMaskSize;
+	uint8_t redFieldPosition;
+	uint8_t greenMaskSize;
+	uint8_t greenFieldPosition;
+	uint8_t blueMaskSize;
+	uint8_t blueFieldPosition;
 };
 
 class Image {
+	/* a run of non-transparent pixels within one row of the cache */
+	struct Span {
+		explicit Span(gpos_t _begin = 0,gsize_t _len = 0) : begin(_begin), len(_len) {
+		}
+
+		gpos_t begin;
+		gsize_t len;
+	};
+
 protected:
-	explicit Image(const std::shared_ptr<Painter> &painter) : _painter(painter) {
+	explicit Image() : _format(), _premultiply(), _cache(), _spans(), _rows() {
 	}
 
 public:
+	/* the color that is used for transparent pixels by decodeRow() */
+	static const uint32_t TRANSPARENT	= 0xFF000000;
+
 	virtual ~Image() {
+		delete[] _cache;
 	}
 
-	static Image *loadImage(const std::shared_ptr<Painter> &painter,const std::string& path);
+	Image(const Image&) = delete;
+	Image &operator=(const Image&) = delete;
 
-	std::shared_ptr<Painter> getPainter() const {
-		return _painter;
-	}
+	static Image *loadImage(const std::string& path);
 
 	virtual void getSize(gsize_t *width,gsize_t *height) const = 0;
-	virtual void paint(gpos_t x,gpos_t y,gsize_t width,gsize_t height) = 0;
+
+	/**
+	 * Converts the image into the given pixel-format and keeps the result, so that subsequent
+	 * calls of paint() only need to copy it. Does nothing if the image has already been
+	 * converted into that format.
+	 *
+	 * @param format the pixel-format of the destination
+	 * @param premultiply whether to multiply the color-components with the alpha-value
+	 */
+	void prepare(const PixelFormat &format,bool premultiply = false);
+
+	/**
+	 * Copies the rectangle <x>,<y>,<width>,<height> of the image into <dst>. Transparent pixels
+	 * are skipped. prepare() has to be called before.
+	 *
+	 * @param dst the destination of the pixel at <x>,<y>
+	 * @param pitch the number of bytes per row in <dst>
+	 * @param x the x-position in the image
+	 * @param y the y-position in the image
+	 * @param width the width of the rectangle
+	 * @param height the height of the rectangle
+	 */
+	void paint(uint8_t *dst,size_t pitch,gpos_t x,gpos_t y,gsize_t width,gsize_t height) const;
 
 protected:
-	std::shared_ptr<Painter> _painter;
+	/**
+	 * Decodes the row <y> of the image into <row>, which has room for the complete width of the
+	 * image. The colors are in the format 0xAARRGGBB, whereas an alpha of 0xFF means transparent.
+	 *
+	 * @param y the row
+	 * @param row the destination
+	 */
+	virtual void decodeRow(gpos_t y,uint32_t *row) const = 0;
+
+private:
+	void convertRow(const uint32_t *src,uint8_t *dst,gsize_t width) const;
+	void addSpans(const uint32_t *src,gsize_t width);
+
+	PixelFormat _format;
+	bool _premultiply;
+	uint8_t *_cache;
+	std::vector<Span> _spans;
+	// _rows[y] is the index of the first span of row y in _spans; _rows[height] is the end
+	std::vector<size_t> _rows;
 };
 
 }
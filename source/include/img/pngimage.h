@@ -84,8 +84,8 @@ public:
 	static const size_t SIG_LEN;
 	static const uint8_t SIG[];
 
-	explicit PNGImage(const std::shared_ptr<Painter> &painter,const std::string &filename)
-		: Image(painter), _header(), _palette(), _paletteSize(), _pixels(), _bpp() {
+	explicit PNGImage(const std::string &filename)
+		: Image(), _header(), _palette(), _paletteSize(), _pixels(), _bpp() {
 		load(filename);
 		applyFilters();
 	}
@@ -98,7 +98,9 @@ public:
 		*width = _header.width;
 		*height = _header.height;
 	}
-	virtual void paint(gpos_t x,gpos_t y,gsize_t width,gsize_t height);
+
+protected:
+	virtual void decodeRow(gpos_t y,uint32_t *row) const;
 
 private:
 	void load(const std::string &filename);
@@ -26,6 +26,11 @@ typedef int pthread_mutex_t;
 typedef int pthread_t;
 typedef long pthread_once_t;
 typedef int pthread_mutexattr_t;
+typedef int pthread_cond_t;
+typedef int pthread_condattr_t;
+
+#define PTHREAD_MUTEX_INITIALIZER	0
+#define PTHREAD_COND_INITIALIZER	0
 
 #if defined(__cplusplus)
 extern "C" {
@@ -41,6 +46,11 @@ int pthread_mutex_init(pthread_mutex_t *mutex,const pthread_mutexattr_t *attr);
 int pthread_mutex_lock(pthread_mutex_t *mutex);
 int pthread_mutex_unlock(pthread_mutex_t *mutex);
 int pthread_mutex_destroy(pthread_mutex_t *mutex);
+int pthread_cond_init(pthread_cond_t *cond,const pthread_condattr_t *attr);
+int pthread_cond_wait(pthread_cond_t *cond,pthread_mutex_t *mutex);
+int pthread_cond_signal(pthread_cond_t *cond);
+int pthread_cond_broadcast(pthread_cond_t *cond);
+int pthread_cond_destroy(pthread_cond_t *cond);
 
 #if defined(__cplusplus)
 }
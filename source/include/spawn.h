@@ -0,0 +1,54 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+
+typedef struct posix_spawn_file_action posix_spawn_file_action_t;
+
+typedef struct {
+	size_t count;
+	posix_spawn_file_action_t *actions;
+} posix_spawn_file_actions_t;
+
+typedef int posix_spawnattr_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* as specified by POSIX, these functions return 0 on success and a positive error number on
+ * failure. errno is not set. */
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *fa);
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *fa);
+int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *fa,int fd,const char *path,
+	int oflag,mode_t mode);
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *fa,int fd,int newfd);
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *fa,int fd);
+int posix_spawnattr_init(posix_spawnattr_t *attr);
+int posix_spawnattr_destroy(posix_spawnattr_t *attr);
+int posix_spawn(pid_t *pid,const char *path,const posix_spawn_file_actions_t *fa,
+	const posix_spawnattr_t *attr,char *const argv[],char *const envp[]);
+int posix_spawnp(pid_t *pid,const char *file,const posix_spawn_file_actions_t *fa,
+	const posix_spawnattr_t *attr,char *const argv[],char *const envp[]);
+
+#if defined(__cplusplus)
+}
+#endif
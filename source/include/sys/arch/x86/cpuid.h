@@ -0,0 +1,66 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+
+/* feature-bits of cpuid leaf 1 */
+#define CPUID1_EDX_SSE2			(1 << 26)
+#define CPUID1_ECX_OSXSAVE		(1 << 27)
+#define CPUID1_ECX_AVX			(1 << 28)
+
+/* feature-bits of cpuid leaf 7, subleaf 0 */
+#define CPUID7_EBX_AVX2			(1 << 5)
+#define CPUID7_EBX_ERMS			(1 << 9)
+
+/* the bits in XCR0 the OS has to set to allow the usage of AVX */
+#define XCR0_SSE_AVX			0x6
+
+/**
+ * Executes the cpuid instruction for the given leaf and subleaf.
+ */
+static inline void cpuid(uint32_t leaf,uint32_t subleaf,uint32_t *eax,uint32_t *ebx,
+                         uint32_t *ecx,uint32_t *edx) {
+#if defined(__i586__)
+	/* ebx is the PIC-register on i586 */
+	__asm__ volatile (
+		"mov	%%ebx,%%esi\n\t"
+		"cpuid\n\t"
+		"xchg	%%ebx,%%esi"
+		: "=a" (*eax), "=S" (*ebx), "=c" (*ecx), "=d" (*edx)
+		: "a" (leaf), "c" (subleaf)
+	);
+#else
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+		: "a" (leaf), "c" (subleaf)
+	);
+#endif
+}
+
+/**
+ * @return the value of the extended control register <idx>. Requires OSXSAVE.
+ */
+static inline uint64_t xgetbv(uint32_t idx) {
+	uint32_t u,l;
+	__asm__ volatile ("xgetbv" : "=a" (l), "=d" (u) : "c" (idx));
+	return (uint64_t)u << 32 | l;
+}
@@ -21,27 +21,46 @@
 
 #include <sys/common.h>
 
+/* the number of times we try to grab a taken semaphore before we block */
+#define USEM_SPIN_COUNT		100
+
 static inline int usemcrt(tUserSem *sem,long val) {
 	sem->value = val;
-	sem->sem = semcrt(0);
-	return sem->sem;
+	sem->waiters = 0;
+	return 0;
 }
 
-static inline void usemdown(tUserSem *sem) {
-	/* 1 means free, <= 0 means taken */
-	if(__sync_fetch_and_add(&sem->value,-1) <= 0)
-		IGNSIGS(semdown(sem->sem));
+static inline bool usemtrydown(tUserSem *sem) {
+	int val;
+	while((val = sem->value) > 0) {
+		if(__sync_bool_compare_and_swap(&sem->value,val,val - 1))
+			return true;
+	}
+	return false;
 }
 
-static inline bool usemtrydown(tUserSem *sem) {
-	return __sync_fetch_and_add(&sem->value,-1) > 0;
+static inline void usemdown(tUserSem *sem) {
+	/* spin a bit first, since the holder will probably release it soon. but don't do that if others
+	 * are already sleeping; they will get it first anyway */
+	for(int i = 0; i < USEM_SPIN_COUNT && sem->waiters == 0; ++i) {
+		if(usemtrydown(sem))
+			return;
+		__asm__ volatile ("pause");
+	}
+
+	/* announce us as a waiter before checking the value again. usemup() increases the value before
+	 * checking the waiters, so that one of us notices the other */
+	__sync_fetch_and_add(&sem->waiters,+1);
+	while(!usemtrydown(sem))
+		futexwait(&sem->value,0,0);
+	__sync_fetch_and_add(&sem->waiters,-1);
 }
 
 static inline void usemup(tUserSem *sem) {
-	if(__sync_fetch_and_add(&sem->value,+1) < 0)
-		semup(sem->sem);
+	__sync_fetch_and_add(&sem->value,+1);
+	if(sem->waiters > 0)
+		futexwake(&sem->value,1);
 }
 
-static inline void usemdestr(tUserSem *sem) {
-	semdestr(sem->sem);
+static inline void usemdestr(A_UNUSED tUserSem *sem) {
 }
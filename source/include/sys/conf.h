@@ -28,6 +28,7 @@
 #define CONF_LOG_TO_VGA			4
 #define CONF_CPU_COUNT			6
 #define CONF_TICKS_PER_SEC		8
+#define CONF_SHARED_INFO		14	/* the address of the shared info page (see sys/sharedinfo.h) */
 #define CONF_ROOT_DEVICE		32	/* string */
 #define CONF_SWAP_DEVICE		33	/* string */
 
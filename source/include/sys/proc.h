@@ -204,6 +204,22 @@ int execvp(const char *file,const char **args);
  */
 int execvpe(const char *path,const char **args,const char **env);
 
+/**
+ * Creates a new process that executes the program <path> with <args> and <env>. In contrast to
+ * fork() and exec(), the address-space of the current process is not cloned, which makes it
+ * considerably cheaper for large processes.
+ *
+ * @param path the program-path
+ * @param args a NULL-terminated array of arguments
+ * @param env a NULL-terminated array of environment-variables
+ * @param fds if not NULL, fds[i] is the file-descriptor that becomes fd i in the child (-1 = closed).
+ *  All other file-descriptors are inherited.
+ * @param fdcount the number of entries in <fds>
+ * @return the pid of the child; a negative error-code if failed. Errors during loading the program
+ *  are reported as well, because the call returns after the child has loaded it.
+ */
+int spawn(const char *path,const char **args,const char **env,const int *fds,size_t fdcount);
+
 /**
  * The system function is used to issue a command. Execution of your program will not
  * continue until the command has completed.
@@ -0,0 +1,52 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+
+/**
+ * The interface of the sampling profiler. Writing "start [<freq>]" to /sys/profile starts taking
+ * <freq> samples per second and CPU (default PROF_DEF_FREQ), "stop" stops it and "reset" drops
+ * all buffered samples. Reading from /sys/profile removes the buffered samples and yields them as
+ * an array of sProfSample.
+ */
+
+#define PROF_PATH			"/sys/profile"
+#define PROF_DEF_FREQ		1000
+#define PROF_MAX_FREQ		10000
+
+/* the maximum number of program counters per sample */
+#define PROF_MAX_DEPTH		8
+
+/* the program counters belong to user-space */
+#define PROF_USER			0x1
+
+typedef struct {
+	/* the timestamp in microseconds */
+	uint64_t time;
+	pid_t pid;
+	tid_t tid;
+	cpuid_t cpu;
+	uint8_t flags;
+	/* the number of valid entries in <pcs> */
+	uint8_t depth;
+	/* the interrupted program counter, followed by the return addresses of the callers */
+	uintptr_t pcs[PROF_MAX_DEPTH];
+} sProfSample;
@@ -0,0 +1,65 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+#include <sys/conf.h>
+
+/* the sysconf-ids below this value are available in the shared info page */
+#define SHINFO_CONF_COUNT		CONF_SHARED_INFO
+
+/**
+ * The page with information about the system that the kernel maps read-only into each process
+ * (on request). This way, userland can read the time and configuration values without syscalls.
+ *
+ * The kernel increments <seq> before and after each update. That is, a reader has to retry if
+ * <seq> was odd or has changed while reading the values.
+ */
+typedef struct {
+	volatile ulong seq;
+	/* the page-size */
+	size_t pageSize;
+	/* the values for sysconf() */
+	long conf[SHINFO_CONF_COUNT];
+	/* the current time in microseconds since boot is:
+	 *   timestamp + (rdtsc() - tscBase) / tscPerUs
+	 * if tscPerUs is 0, the time can't be derived from the TSC and timestamp is updated by the
+	 * kernel instead */
+	uint64_t tscPerUs;
+	uint64_t tscBase;
+	uint64_t timestamp;
+	/* the seconds since 1970 at boot */
+	uint64_t bootTime;
+} sSharedInfo;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Maps the shared info page into the current process, if not already done.
+ *
+ * @return the shared info page or NULL if it's not available
+ */
+const sSharedInfo *sharedinfo(void);
+
+#if defined(__cplusplus)
+}
+#endif
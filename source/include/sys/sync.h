@@ -26,14 +26,23 @@
 #define RW_READ		0
 #define RW_WRITE	1
 
+#if defined(__x86__)
+typedef struct {
+	// the current value; the futex-word to wait on
+	volatile int value;
+	// the number of threads that are (about to be) blocked
+	volatile int waiters;
+} tUserSem;
+#else
 typedef struct {
 	int sem;
 	long value;
 } tUserSem;
+#endif
 
 typedef struct {
-	// semaphore for blocking
-	int sem;
+	// the futex-word to wait on; changed on every release
+	volatile int seq;
 	// -1 if somebody writes, >0 if we're reading
 	volatile int count;
 	// the number of waiters
@@ -88,10 +97,38 @@ static inline void semdestr(int id) {
 	syscall1(SYSCALL_SEMDESTROY,id);
 }
 
+/**
+ * Blocks the calling thread as long as the word at <addr> contains <expected> and nobody calls
+ * futexwake() for it. The word is identified by its physical address, so that it works across
+ * processes via shared memory as well.
+ * Note that you might receive a signal during that operation in which case -EINTR is returned.
+ *
+ * @param addr the address of the word (has to be aligned)
+ * @param expected the value that <addr> is expected to contain
+ * @param msecs the maximum number of milliseconds to wait (0 = unlimited)
+ * @return 0 if woken up, -EWOULDBLOCK if <addr> did not contain <expected>, -ETIMEOUT or -EFAULT
+ *  if <addr> is not a writable word
+ */
+static inline int futexwait(volatile int *addr,int expected,time_t msecs) {
+	return syscall3(SYSCALL_FUTEXWAIT,(ulong)addr,expected,msecs);
+}
+
+/**
+ * Wakes up at most <count> threads that are blocked in futexwait() for the word at <addr>.
+ *
+ * @param addr the address of the word
+ * @param count the maximum number of threads to wake up
+ * @return the number of woken threads or a negative error-code
+ */
+static inline int futexwake(volatile int *addr,uint count) {
+	return syscall2(SYSCALL_FUTEXWAKE,(ulong)addr,count);
+}
+
 /**
  * Initializes a user-semaphore, which is optimized for the non-contention case. In most cases, the
- * up/down operation will only perform a atomic increment/decrement and only in the contention-case
- * a kernel-semaphore is used for blocking. That is, the implementation is based on sem*.
+ * up/down operation will only perform a atomic increment/decrement. In the contention-case, the
+ * thread spins for a short time and blocks via futexwait() afterwards (where supported; otherwise
+ * a kernel-semaphore is used for blocking).
  *
  * @param sem the semaphore
  * @param val the initial value
@@ -117,6 +117,10 @@ enum {
 	SYSCALL_GETTOD,
 	SYSCALL_UTIME,
 	SYSCALL_TRUNCATE,
+	SYSCALL_FUTEXWAIT,
+	SYSCALL_FUTEXWAKE,
+	SYSCALL_USLEEP,
+	SYSCALL_SPAWN,
 #	ifdef __x86__
 	SYSCALL_REQIOPORTS,
 	SYSCALL_RELIOPORTS,
@@ -94,6 +94,17 @@ static inline int sleep(time_t msecs) {
 	return syscall1(SYSCALL_SLEEP,msecs);
 }
 
+/**
+ * Puts the current thread to sleep for <usecs> microseconds. If interrupted, -EINTR
+ * is returned. Note that the actual resolution depends on the timer of the kernel.
+ *
+ * @param usecs the number of microseconds to wait
+ * @return 0 on success
+ */
+static inline int usleep(ulong usecs) {
+	return syscall1(SYSCALL_USLEEP,usecs);
+}
+
 /**
  * Joins a thread, i.e. it waits until a thread with given tid has died (from the own process).
  * If interrupted by a signal, -EINTR is returned.
@@ -21,6 +21,7 @@
 
 #include <sys/common.h>
 #include <sys/conf.h>
+#include <sys/sharedinfo.h>
 #include <sys/syscalls.h>
 
 #if defined(__cplusplus)
@@ -41,6 +42,10 @@ static inline uint64_t rdtsc(void);
  * @return the number of microseconds
  */
 static inline uint64_t tsctotime(uint64_t tsc) {
+	const sSharedInfo *info = sharedinfo();
+	if(EXPECT_TRUE(info && info->tscPerUs))
+		return tsc / info->tscPerUs;
+
 	uint64_t tmp = tsc;
 	syscall1(SYSCALL_TSCTOTIME,(ulong)&tmp);
 	return tmp;
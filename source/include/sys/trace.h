@@ -0,0 +1,68 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+
+/**
+ * The interface of the kernel tracepoints. Writing "start [<mask>]" to /sys/trace enables the
+ * events in <mask> (default TRACE_ALL), "stop" disables them, "pid <pid>" records only events of
+ * the given process ("pid" alone records all again) and "reset" drops all buffered records.
+ * Reading from /sys/trace removes the buffered records and yields them as an array of
+ * sTraceRecord.
+ */
+
+#define TRACE_PATH			"/sys/trace"
+
+enum {
+	/* arg1 = syscall number, arg2 = first argument */
+	TRACE_SYSCALL_ENTER,
+	/* arg1 = syscall number, arg2 = return value */
+	TRACE_SYSCALL_EXIT,
+	/* arg1 = message id, arg2 = length */
+	TRACE_MSG_SEND,
+	/* arg1 = message id, arg2 = length */
+	TRACE_MSG_RECEIVE,
+	/* the record describes the old thread; arg1 = new tid, arg2 = new pid */
+	TRACE_SCHED,
+	/* arg1 = address, arg2 = write-access */
+	TRACE_PF_ENTER,
+	/* arg1 = address, arg2 = result */
+	TRACE_PF_EXIT,
+	/* arg1 = interrupt number */
+	TRACE_IRQ_ENTER,
+	/* arg1 = interrupt number */
+	TRACE_IRQ_EXIT,
+	TRACE_EVENT_COUNT
+};
+
+#define TRACE_MASK(ev)		(1U << (ev))
+#define TRACE_ALL			(TRACE_MASK(TRACE_EVENT_COUNT) - 1)
+
+typedef struct {
+	/* the TSC value of the CPU that recorded the event */
+	uint64_t tsc;
+	pid_t pid;
+	tid_t tid;
+	cpuid_t cpu;
+	uint8_t event;
+	ulong arg1;
+	ulong arg2;
+} sTraceRecord;
@@ -45,6 +45,16 @@ struct timeval {
 	suseconds_t tv_usec;
 };
 
+struct timespec {
+	time_t tv_sec;
+	long tv_nsec;
+};
+
+typedef int clockid_t;
+
+#define CLOCK_REALTIME		0	/* the UNIX time */
+#define CLOCK_MONOTONIC		1	/* the time since an unspecified point in the past */
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -65,9 +75,17 @@ clock_t clock(void);
  * @param tv the destination
  * @return 0 on success
  */
-static inline int gettimeofday(struct timeval *tv) {
-	return syscall1(SYSCALL_GETTOD,(ulong)tv);
-}
+int gettimeofday(struct timeval *tv);
+
+/**
+ * Gets the current time of the clock <clk> in seconds and nanoseconds. This is done without
+ * entering the kernel, if possible.
+ *
+ * @param clk the clock (CLOCK_*)
+ * @param ts the destination
+ * @return 0 on success
+ */
+int clock_gettime(clockid_t clk,struct timespec *ts);
 
 /**
  * Calculates the difference in seconds between time1 and time2.
@@ -27,10 +27,18 @@ namespace z {
  * Computes the Cyclic Redundancy Check.
  */
 class CRC32 {
+	/* builds the tables during the static initialization, i.e., before other threads exist */
+	struct Initializer {
+		explicit Initializer() {
+			init();
+		}
+	};
+
 public:
 	typedef uint32_t type;
 
-	explicit CRC32();
+	explicit CRC32() {
+	}
 
 	/**
 	 * Computes the CRC32 of <buf>[0] .. <buf>[<len>-1].
@@ -57,8 +65,34 @@ public:
 	 */
 	type update(type crc,const void *buf,size_t len);
 
+	/**
+	 * Combines the CRCs of two consecutive blocks. That is, if <crc1> is the CRC of block A and
+	 * <crc2> is the CRC of block B with <len2> bytes, the result is the CRC of A followed by B.
+	 * This allows to checksum chunks in parallel and merge the results afterwards.
+	 *
+	 * @param crc1 the CRC of the first block
+	 * @param crc2 the CRC of the second block
+	 * @param len2 the length of the second block
+	 * @return the CRC of both blocks
+	 */
+	static type combine(type crc1,type crc2,size_t len2);
+
 private:
-	type _table[256];
+	static void init();
+	static type updateBytes(type c,const uint8_t *b,size_t len);
+	static type updateSlice8(type c,const uint8_t *b,size_t len);
+#if defined(__x86_64__)
+	static type updateCLMul(type c,const uint8_t *b,size_t len);
+#endif
+	static type multModP(type a,type b);
+	static type x2nModP(size_t n,uint k);
+
+	static Initializer _initializer;
+	static bool _clmul;
+	/* _tables[0] is the classic byte-wise table; _tables[k] advances a byte by k more bytes */
+	static type _tables[8][256];
+	/* _x2n[k] is x^(2^k) modulo the CRC polynomial */
+	static type _x2n[32];
 };
 
 }
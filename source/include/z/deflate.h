@@ -26,6 +26,7 @@
 #include <z/deflatebase.h>
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
 
 namespace z {
 
@@ -50,25 +51,13 @@ public:
 	virtual size_t count() const = 0;
 
 	/**
-	 * @return true if there is more data than the current block
-	 */
-	virtual bool more() = 0;
-
-	/**
-	 * @return the remaining data from the currently cached block
-	 */
-	virtual size_t cached() = 0;
-
-	/**
-	 * @param off the offset (might be negative). has to be within the current block
-	 * @return the byte at current position plus <off>
-	 */
-	virtual uint8_t peek(ssize_t off) = 0;
-
-	/**
-	 * @return the next byte
+	 * Reads up to <count> bytes into <buf>.
+	 *
+	 * @param buf the buffer to write to
+	 * @param count the maximum number of bytes to read
+	 * @return the number of read bytes (0 = no more data)
 	 */
-	virtual uint8_t get() = 0;
+	virtual size_t read(void *buf,size_t count) = 0;
 };
 
 /**
@@ -84,77 +73,42 @@ public:
 	 *
 	 * @param c the character to write
 	 */
-	virtual void put(uint8_t c) = 0;
+	void put(uint8_t c) {
+		write(&c,1);
+	}
+
+	/**
+	 * Writes <count> bytes from <buf> to drain
+	 *
+	 * @param buf the data
+	 * @param count the number of bytes
+	 */
+	virtual void write(const void *buf,size_t count) = 0;
 };
 
 /**
  * A source implementation that reads from a stream.
  */
 class StreamDeflateSource : public DeflateSource {
-	static const size_t CACHE_SIZE	= 4096;
-
 public:
 	explicit StreamDeflateSource(esc::IStream &is)
-		: DeflateSource(), _cache(new uint8_t[CACHE_SIZE / 2]), _next(new uint8_t[CACHE_SIZE / 2]),
-		  _pos(0), _cached(0), _nextcount(0), _total(0), _checksum(0), _crc(), _is(is) {
-	}
-	virtual ~StreamDeflateSource() {
-		delete[] _cache;
-		delete[] _next;
+		: DeflateSource(), _total(0), _checksum(0), _crc(), _is(is) {
 	}
 
 	virtual CRC32::type crc32() {
-		if(_pos != _cached) {
-			_checksum = _crc.update(_checksum,_cache,_pos);
-			_pos = _cached;
-		}
 		return _checksum;
 	}
 	virtual size_t count() const {
 		return _total;
 	}
-	virtual bool more() {
-		load();
-		return _nextcount > 0;
-	}
-	virtual size_t cached() {
-		load();
-		return _cached - _pos;
-	}
-	virtual uint8_t peek(ssize_t off) {
-		load();
-		assert(_pos + off >= 0 && _pos + off < _cached);
-		return _cache[_pos + off];
-	}
-	virtual uint8_t get() {
-		load();
-		assert(_pos < _cached);
-		_total++;
-		return _cache[_pos++];
+	virtual size_t read(void *buf,size_t count) {
+		size_t res = _is.read(buf,count);
+		_checksum = _crc.update(_checksum,buf,res);
+		_total += res;
+		return res;
 	}
 
 private:
-	void load() {
-		if(_cached - _pos == 0) {
-			bool first = _cached == 0 && _pos == 0;
-			if(!first)
-				_checksum = _crc.update(_checksum,_cache,_pos);
-			_cached = _is.read(_cache,CACHE_SIZE / 2);
-			_pos = 0;
-			if(first)
-				_nextcount = _is.read(_next,CACHE_SIZE / 2);
-			else {
-				std::swap(_cache,_next);
-				std::swap(_cached,_nextcount);
-			}
-		}
-	}
-
-	uint8_t *_cache;
-	uint8_t *_next;
-	size_t _pos;
-	size_t _cached;
-	size_t _nextcount;
 	size_t _total;
 	CRC32::type _checksum;
 	CRC32 _crc;
@@ -170,8 +124,8 @@ public:
 		: DeflateDrain(), _os(os) {
 	}
 
-	virtual void put(uint8_t c) {
-		_os.write(c);
+	virtual void write(const void *buf,size_t count) {
+		_os.write(buf,count);
 	}
 
 private:
@@ -179,21 +133,113 @@ private:
 };
 
 /**
- * The encoder part of the deflate compression algorithm.
+ * A source implementation that reads from memory.
+ */
+class MemDeflateSource : public DeflateSource {
+public:
+	explicit MemDeflateSource(const void *buffer,size_t size)
+		: DeflateSource(), _buffer(reinterpret_cast<const uint8_t*>(buffer)), _size(size), _pos() {
+	}
+
+	virtual CRC32::type crc32() {
+		CRC32 crc;
+		return crc.get(_buffer,_pos);
+	}
+	virtual size_t count() const {
+		return _pos;
+	}
+	virtual size_t read(void *buf,size_t count) {
+		size_t amount = std::min(count,_size - _pos);
+		memcpy(buf,_buffer + _pos,amount);
+		_pos += amount;
+		return amount;
+	}
+
+private:
+	const uint8_t *_buffer;
+	size_t _size;
+	size_t _pos;
+};
+
+/**
+ * A drain implementation that writes to memory. Everything beyond <size> is dropped, but still
+ * counted.
+ */
+class MemDeflateDrain : public DeflateDrain {
+public:
+	explicit MemDeflateDrain(void *buffer,size_t size)
+		: DeflateDrain(), _buffer(reinterpret_cast<uint8_t*>(buffer)), _size(size), _pos() {
+	}
+
+	/**
+	 * @return the number of written bytes
+	 */
+	size_t count() const {
+		return _pos;
+	}
+
+	virtual void write(const void *buf,size_t count) {
+		if(_pos < _size)
+			memcpy(_buffer + _pos,buf,std::min(count,_size - _pos));
+		_pos += count;
+	}
+
+private:
+	uint8_t *_buffer;
+	size_t _size;
+	size_t _pos;
+};
+
+/**
+ * The encoder part of the deflate compression algorithm. It uses a 32 KiB sliding window with
+ * hash chains to find matches, lazy matching for the higher levels and emits for each block
+ * whatever is smallest: a dynamic huffman, fixed huffman or uncompressed block.
  */
 class Deflate : public DeflateBase {
-	struct Tree {
-		unsigned int litbase[4];
-		unsigned int length[4];
-		unsigned int codebase[4];
+	static const size_t WSIZE			= 32 * 1024;
+	static const size_t WMASK			= WSIZE - 1;
+	static const size_t HASH_BITS		= 15;
+	static const size_t HASH_SIZE		= 1 << HASH_BITS;
+	static const size_t MIN_MATCH		= 3;
+	static const size_t MAX_MATCH		= 258;
+	/* we need MAX_MATCH bytes for the match and MIN_MATCH + 1 for the next hash */
+	static const size_t MIN_LOOKAHEAD	= MAX_MATCH + MIN_MATCH + 1;
+	static const size_t MAX_DIST		= WSIZE - MIN_LOOKAHEAD;
+	/* matches of length 3 are discarded if their distance exceeds TOO_FAR */
+	static const size_t TOO_FAR			= 4096;
+	static const size_t SYM_BUFSIZE		= 16 * 1024;
+	static const size_t OUT_BUFSIZE		= 16 * 1024;
+	static const size_t MAX_STORED		= 0xFFFF;
+	static const uint16_t NIL			= 0;
+
+	static const size_t L_CODES			= 286;
+	static const size_t D_CODES			= 30;
+	static const size_t BL_CODES		= 19;
+	static const size_t MAX_BITS		= 15;
+	static const size_t MAX_BL_BITS		= 7;
+
+	struct Config {
+		/* reduce the chain length if we already have a match of this length */
+		uint16_t good_length;
+		/* the lazy algorithm does not search further if the match is at least that long. the
+		 * greedy one does not insert all strings of matches that are longer than that */
+		uint16_t max_lazy;
+		/* stop searching if a match of this length has been found */
+		uint16_t nice_length;
+		/* the maximum number of entries to walk in the hash chain */
+		uint16_t max_chain;
+		bool lazy;
 	};
 
-	struct Data {
-		DeflateSource *source;
-		unsigned int tag;
-		unsigned int bitcount;
+	struct Tree {
+		uint32_t freq[L_CODES + 2];
+		uint8_t len[L_CODES + 2];
+		uint16_t code[L_CODES + 2];
+	};
 
-		DeflateDrain *drain;
+	struct CLSym {
+		uint8_t sym;
+		uint8_t extra;
 	};
 
 	enum {
@@ -203,40 +249,143 @@ class Deflate : public DeflateBase {
 
 public:
 	enum Level {
-		NONE	= 0,
-		FIXED	= 1,
-		DYN		= 2
+		NONE		= 0,
+		FASTEST		= 1,
+		DEFAULT		= 6,
+		BEST		= 9
 	};
 
 	/**
 	 * Constructor
 	 */
 	explicit Deflate();
+	~Deflate();
+
+	Deflate(const Deflate&) = delete;
+	Deflate &operator=(const Deflate&) = delete;
 
 	/**
 	 * Compresses the data in <source> into <drain>.
 	 *
 	 * @param drain the destination
 	 * @param source the source
-	 * @param compr the compression level
+	 * @param level the compression level (NONE .. BEST)
 	 * @return 0 on success or -1 on error
 	 */
-	int compress(DeflateDrain *drain,DeflateSource *source,int compr);
+	int compress(DeflateDrain *drain,DeflateSource *source,int level) {
+		return compress(drain,source,level,NULL,0,true);
+	}
+
+	/**
+	 * Compresses the data in <source> into <drain> as one part of a larger stream. The window is
+	 * primed with the last 32 KiB of <dict>, so that matches can refer to the data preceding
+	 * <source>. If <last> is false, the output is terminated with an empty, non-final stored block
+	 * so that it ends on a byte boundary. Thus, the output of several such calls, followed by a
+	 * call with <last> = true, can be concatenated to a single deflate stream.
+	 *
+	 * @param drain the destination
+	 * @param source the source
+	 * @param level the compression level (NONE .. BEST)
+	 * @param dict the data that precedes <source> in the uncompressed stream (may be NULL)
+	 * @param dictlen the length of <dict>
+	 * @param last whether this is the last part of the stream
+	 * @return 0 on success or -1 on error
+	 */
+	int compress(DeflateDrain *drain,DeflateSource *source,int level,const void *dict,
+		size_t dictlen,bool last);
+
+	/**
+	 * Writes an empty final block to <drain>. This can be used to terminate a stream that has been
+	 * produced by compress() calls with <last> = false only.
+	 *
+	 * @param drain the destination
+	 */
+	static void finish(DeflateDrain *drain);
 
 private:
-	void flush(Data *d);
-	void writebit(Data *d,int bit);
-	void write_bits(Data *d,unsigned int bits,int num);
-	void write_bits_reverse(Data *d,unsigned int bits,unsigned int num);
-	void write_symbol(Data *d,Tree *t,unsigned int sym);
-	void write_int(Data *d,Tree *t,unsigned short *base,unsigned char *bits,unsigned int value,int add);
-	void write_symbol_chain(Data *d,Tree *lt,Tree *dt,unsigned int len,unsigned int dist);
-
-	void deflate_fixed_block(Data *d);
-	void deflate_uncompressed_block(Data *d);
-
-	Tree sltree;
-	Tree sdtree;
+	void reset(DeflateDrain *drain,DeflateSource *source,int level);
+	void set_dictionary(const uint8_t *dict,size_t len);
+
+	/* input */
+	void fill_window();
+	void slide_window();
+	uint16_t insert_string(size_t pos);
+	size_t longest_match(uint16_t cur_match,size_t prev_length);
+	void deflate_greedy();
+	void deflate_lazy();
+
+	/* symbol buffer */
+	bool tally_lit(uint8_t c);
+	bool tally_match(size_t dist,size_t len);
+	uint dist_code(size_t dist) const {
+		return dist < 256 ? _distCode[dist] : _distCode[256 + (dist >> 7)];
+	}
+
+	/* huffman codes */
+	static void build_lengths(const uint32_t *freq,uint8_t *lens,size_t num,size_t maxbits);
+	static void build_codes(const uint8_t *lens,uint16_t *codes,size_t num);
+	size_t build_cl_syms(const uint8_t *lens,size_t num,CLSym *syms,uint32_t *freq);
+	size_t data_bits(const Tree &lt,const Tree &dt) const;
+
+	/* output */
+	void flush_block(bool last);
+	void write_stored_block(const uint8_t *data,size_t len,bool last);
+	void write_data(const Tree &lt,const Tree &dt);
+	void write_bits(uint value,uint num) {
+		_bitbuf |= (uint64_t)value << _bitcount;
+		_bitcount += num;
+		if(_bitcount >= 32) {
+			put_byte(_bitbuf);
+			put_byte(_bitbuf >> 8);
+			put_byte(_bitbuf >> 16);
+			put_byte(_bitbuf >> 24);
+			_bitbuf >>= 32;
+			_bitcount -= 32;
+		}
+	}
+	void align_bits();
+	void put_byte(uint8_t c) {
+		_out[_outpos++] = c;
+		if(EXPECT_FALSE(_outpos == OUT_BUFSIZE))
+			flush_output();
+	}
+	void flush_output();
+
+	static const Config configs[];
+
+	/* the sliding window of 2 * WSIZE and the hash chains */
+	uint8_t *_window;
+	uint16_t *_head;
+	uint16_t *_prev;
+	size_t _strstart;
+	size_t _lookahead;
+	size_t _match_start;
+	bool _eof;
+	const Config *_config;
+	int _level;
+
+	/* the symbols of the current block. dist = 0 means literal */
+	uint8_t *_lits;
+	uint16_t *_dists;
+	size_t _symcount;
+	size_t _block_start;
+	size_t _block_len;
+	Tree _ltree;
+	Tree _dtree;
+
+	/* lookup tables for length and distance codes */
+	uint8_t _lengthCode[MAX_MATCH + 1];
+	uint8_t _distCode[512];
+	/* the codes for the fixed trees */
+	Tree _fixed_ltree;
+	Tree _fixed_dtree;
+
+	DeflateSource *_source;
+	DeflateDrain *_drain;
+	uint64_t _bitbuf;
+	uint _bitcount;
+	uint8_t *_out;
+	size_t _outpos;
 };
 
 }
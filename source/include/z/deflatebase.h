@@ -37,6 +37,9 @@ protected:
 	/* extra bits and base tables for distance codes */
 	unsigned char dist_bits[30];
 	unsigned short dist_base[30];
+
+	/* special ordering of code length codes */
+	static const unsigned char clcidx[];
 };
 
 }
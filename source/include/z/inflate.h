@@ -26,6 +26,7 @@
 #include <z/deflatebase.h>
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
 
 namespace z {
 
@@ -72,6 +73,25 @@ public:
 	 * @param c the character to write
 	 */
 	virtual void put(uint8_t c) = 0;
+
+	/**
+	 * Appends <len> bytes, starting with the byte written <off> bytes ago. Note that the regions
+	 * might overlap, i.e. <len> might be larger than <off>. Drains should override this with a
+	 * faster version.
+	 *
+	 * @param off the offset (at most 32*1024)
+	 * @param len the number of bytes to copy
+	 */
+	virtual void copy(size_t off,size_t len) {
+		while(len-- > 0)
+			put(get(off));
+	}
+
+	/**
+	 * Is called when all data has been written.
+	 */
+	virtual void flush() {
+	}
 };
 
 /**
@@ -92,45 +112,84 @@ private:
 };
 
 /**
- * A drain implementation that writes to a stream.
+ * A drain implementation that writes to a stream. The data is collected in a ring buffer, which
+ * serves as the window for back references at the same time, and written in large chunks.
  */
 class StreamInflateDrain : public InflateDrain {
 public:
-	static const size_t BUF_SIZE	= 32 * 1024;	// has to be at least 32K
+	static const size_t BUF_SIZE	= 64 * 1024;	// has to be at least 32K and a power of 2
 
 	explicit StreamInflateDrain(esc::OStream &os)
-		: InflateDrain(), _crc(), _checksum(0), _os(os), _buf(new uint8_t[BUF_SIZE]), _wpos() {
+		: InflateDrain(), _crc(), _checksum(0), _os(os), _buf(new uint8_t[BUF_SIZE]), _wpos(),
+		  _flushed() {
 	}
 	virtual ~StreamInflateDrain() {
 		delete[] _buf;
 	}
 
 	virtual CRC32::type crc32() {
-		if(_wpos > 0) {
-			_checksum = _crc.update(_checksum,_buf,_wpos);
-			_wpos = 0;
-		}
+		flush();
 		return _checksum;
 	}
 
 	virtual uint8_t get(size_t off) {
-		assert(off < BUF_SIZE);
-		return _buf[(_wpos - off) % BUF_SIZE];
+		assert(off <= BUF_SIZE);
+		return _buf[(_wpos - off) & (BUF_SIZE - 1)];
 	}
 	virtual void put(uint8_t c) {
-		_os.write(c);
-		_buf[_wpos] = c;
-		_wpos = (_wpos + 1) % BUF_SIZE;
-		if(_wpos == 0)
-			_checksum = _crc.update(_checksum,_buf,BUF_SIZE);
+		_buf[_wpos++] = c;
+		if(EXPECT_FALSE(_wpos == BUF_SIZE))
+			wrap();
+	}
+	virtual void copy(size_t off,size_t len) {
+		size_t src = (_wpos - off) & (BUF_SIZE - 1);
+		// fast path: neither the source nor the destination wraps around
+		if(EXPECT_TRUE(src + len <= BUF_SIZE && _wpos + len < BUF_SIZE && src < _wpos)) {
+			copyOverlapping(_buf + _wpos,_buf + src,off,len);
+			_wpos += len;
+		}
+		else
+			InflateDrain::copy(off,len);
+	}
+	virtual void flush() {
+		if(_wpos > _flushed) {
+			_os.write(_buf + _flushed,_wpos - _flushed);
+			_checksum = _crc.update(_checksum,_buf + _flushed,_wpos - _flushed);
+			_flushed = _wpos;
+		}
+	}
+
+	/**
+	 * Copies <len> bytes from <src> to <dst>, whereas <src> is <off> bytes before <dst>. The
+	 * ranges overlap if <len> is larger than <off>. The bytes are copied from front to back, so
+	 * that the last <off> bytes are repeated in this case, as required by LZ77.
+	 */
+	static void copyOverlapping(uint8_t *dst,const uint8_t *src,size_t off,size_t len) {
+		if(off >= sizeof(uint64_t)) {
+			// copy in word-sized chunks; each chunk reads only bytes that are already written
+			while(len >= sizeof(uint64_t)) {
+				memcpy(dst,src,sizeof(uint64_t));
+				dst += sizeof(uint64_t);
+				src += sizeof(uint64_t);
+				len -= sizeof(uint64_t);
+			}
+		}
+		while(len-- > 0)
+			*dst++ = *src++;
 	}
 
 private:
+	void wrap() {
+		flush();
+		_wpos = _flushed = 0;
+	}
+
 	CRC32 _crc;
 	CRC32::type _checksum;
 	esc::OStream &_os;
 	uint8_t *_buf;
 	size_t _wpos;
+	size_t _flushed;
 };
 
 class MemInflateSource : public InflateSource {
@@ -172,27 +231,64 @@ public:
 			_buffer[_pos++] = c;
 	}
 
+	virtual void copy(size_t off,size_t len) {
+		assert(off <= _pos);
+		if(EXPECT_FALSE(off == 0 || off > _pos))
+			return;
+		len = std::min(len,_size - _pos);
+		StreamInflateDrain::copyOverlapping(_buffer + _pos,_buffer + _pos - off,off,len);
+		_pos += len;
+	}
+
 private:
 	uint8_t *_buffer;
 	size_t _size;
 	size_t _pos;
 };
 
+/**
+ * The decoder part of the deflate compression algorithm. Symbols are decoded with two-level lookup
+ * tables instead of bit by bit. To be able to continue reading after the compressed data (e.g.
+ * the gzip trailer) from the same source, it never reads more bytes than necessary.
+ */
 class Inflate : public DeflateBase {
+	static const size_t MAX_BITS	= 15;
+	/* number of bits of the primary tables */
+	static const size_t LBITS		= 9;
+	static const size_t DBITS		= 6;
+	static const size_t CLBITS		= 7;
+	/* the maximum number of table entries for the given primary bits (see zlib's enough.c) */
+	static const size_t ENOUGH_L	= 852;
+	static const size_t ENOUGH_D	= 592;
+	static const size_t ENOUGH_CL	= 1 << CLBITS;
+
+	struct Entry {
+		/* the symbol or, for links, the index of the subtable */
+		uint16_t val;
+		/* the length of the code (0xFF = invalid) */
+		uint8_t bits;
+		/* 0 for symbols or the number of index bits of the subtable */
+		uint8_t sub;
+	};
+
+	template<size_t SIZE>
 	struct Tree {
-		unsigned short table[16];  /* table of code length counts */
-		unsigned short trans[288]; /* code -> symbol translation table */
+		uint rootbits;
+		Entry entries[SIZE];
 	};
+	typedef Tree<ENOUGH_L> LTree;
+	typedef Tree<ENOUGH_D> DTree;
+	typedef Tree<ENOUGH_CL> CLTree;
 
 	struct Data {
 		InflateSource *source;
-		unsigned int tag;
+		uint64_t tag;
 		unsigned int bitcount;
 
 		InflateDrain *drain;
 
-		Tree ltree; /* dynamic length/symbol tree */
-		Tree dtree; /* dynamic distance tree */
+		LTree ltree; /* dynamic length/symbol tree */
+		DTree dtree; /* dynamic distance tree */
 	};
 
 	enum {
@@ -216,30 +312,31 @@ public:
 	int uncompress(InflateDrain *drain,InflateSource *source);
 
 private:
-	void build_fixed_trees(Tree *lt,Tree *dt);
-	void build_tree(Tree *t,const unsigned char *lengths,unsigned int num);
-
-	void flush(Data *d);
-	void writebit(Data *d,int bit);
-	void write_bits(Data *d,unsigned int bits,int num);
-
-	int getbit(Data *d);
-	unsigned int read_bits(Data *d,int num,int base);
-	int decode_symbol(Data *d,Tree *t);
-	void decode_trees(Data *d,Tree *lt,Tree *dt);
-
-	int deflate_uncompressed_block(Data *d);
+	template<size_t SIZE>
+	static int build_tree(Tree<SIZE> *t,const unsigned char *lengths,unsigned int num,uint rootbits);
+	int decode_trees(Data *d,LTree *lt,DTree *dt);
+
+	void needbits(Data *d,uint num) {
+		while(d->bitcount < num) {
+			d->tag |= (uint64_t)d->source->get() << d->bitcount;
+			d->bitcount += 8;
+		}
+	}
+	unsigned int read_bits(Data *d,int num,int base) {
+		needbits(d,num);
+		unsigned int val = d->tag & ((1U << num) - 1);
+		d->tag >>= num;
+		d->bitcount -= num;
+		return val + base;
+	}
+	template<size_t SIZE>
+	int decode_symbol(Data *d,const Tree<SIZE> *t);
 
-	int inflate_block_data(Data *d,Tree *lt,Tree *dt);
+	int inflate_block_data(Data *d,LTree *lt,DTree *dt);
 	int inflate_uncompressed_block(Data *d);
-	int inflate_fixed_block(Data *d);
-	int inflate_dynamic_block(Data *d);
-
-	Tree sltree; /* fixed length/symbol tree */
-	Tree sdtree; /* fixed distance tree */
 
-	/* special ordering of code length codes */
-	static const unsigned char clcidx[];
+	LTree sltree; /* fixed length/symbol tree */
+	DTree sdtree; /* fixed distance tree */
 };
 
 }
@@ -115,6 +115,11 @@ inline frameno_t PageDirBase::getFrameNo(uintptr_t virt) const {
 	return pdir->pts.getFrameNo(virt);
 }
 
+inline bool PageDirBase::clearAccessed(uintptr_t virt) {
+	PageDir *pdir = static_cast<PageDir*>(this);
+	return pdir->pts.clearAccessed(virt);
+}
+
 inline void PageDirBase::copyToFrame(frameno_t frame,const void *src) {
 	memcpy((void*)(frame * PAGE_SIZE | DIR_MAP_AREA),src,PAGE_SIZE);
 }
@@ -133,9 +138,10 @@ inline int PageDirBase::map(uintptr_t virt,size_t count,PageTables::Allocator &a
 	return pdir->pts.map(virt,count,alloc,flags);
 }
 
-inline void PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
+inline int PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
 	PageDir *pdir = static_cast<PageDir*>(this);
-	pdir->pts.unmap(virt,count,alloc);
+	int res = pdir->pts.unmap(virt,count,alloc);
+	return res < 0 ? res : 0;
 }
 
 inline size_t PageDirBase::getPageCount() const {
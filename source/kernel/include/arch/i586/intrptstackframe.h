@@ -22,6 +22,8 @@
 #if !defined(__cplusplus)
 #	define SAVE_REGS		pusha
 #	define RESTORE_REGS		popa
+#	define SAVE_SYSC_REGS	pusha
+#	define RESTORE_SYSC_REGS	popa
 #	define IRET				iret
 #	define SYS_ENTER
 #	define SYS_LEAVE		add $4,%esp;	\
@@ -136,6 +136,11 @@ inline frameno_t PageDirBase::getFrameNo(uintptr_t virt) const {
 	return PTE_FRAMENO(pte);
 }
 
+inline bool PageDirBase::clearAccessed(A_UNUSED uintptr_t virt) {
+	/* MMIX has no accessed-bits */
+	return false;
+}
+
 inline uintptr_t PageDirBase::getAccess(frameno_t frame) {
 	return frame * PAGE_SIZE | DIR_MAP_AREA;
 }
@@ -41,12 +41,36 @@ public:
 	 * Acknoleges a timer-interrupt
 	 */
 	static void ackIntrpt();
+
+	/**
+	 * @return false, because the timer always fires periodically
+	 */
+	static bool isTickless() {
+		return false;
+	}
+
+	/**
+	 * Does nothing, because the timer always fires periodically
+	 */
+	static void program(uint64_t,uint64_t) {
+	}
 };
 
+inline uint64_t TimerBase::getTimestamp() {
+	return tickTime;
+}
+
 inline void TimerBase::getTimeval(struct timeval *tv) {
-	time_t time = Timer::getRuntime();
-	tv->tv_sec = time / 1000;
-	tv->tv_usec = time % 1000;
+	uint64_t time = getTimestamp();
+	tv->tv_sec = time / 1000000;
+	tv->tv_usec = time % 1000000;
+}
+
+inline void TimerBase::getTimeBase(uint64_t *cyclesPerUs,uint64_t *cycleBase,time_t *bootTime) {
+	/* the cycle counter is not readable from user mode; the timestamp is updated periodically */
+	*cyclesPerUs = 0;
+	*cycleBase = 0;
+	*bootTime = 0;
 }
 
 inline void TimerBase::archInit() {
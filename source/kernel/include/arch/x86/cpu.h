@@ -30,6 +30,7 @@ class CPU : public CPUBase {
 public:
 	enum CPUIdRequests {
 		CPUID_GETFEATURES	= 1,
+		CPUID_XSTATE		= 0xD,
 		CPUID_INTELFEATURES	= 0x80000001,
 		CPUID_MAXPHYSADDR	= 0x80000008,
 	};
@@ -69,8 +70,10 @@ public:
 		FEAT_PCID		= 1ULL << (32 + 17),
 		FEAT_SSE41		= 1ULL << (32 + 19),
 		FEAT_SSE42		= 1ULL << (32 + 20),
+		FEAT_TSCDEADLINE	= 1ULL << (32 + 24),
 		FEAT_POPCNT		= 1ULL << (32 + 23),
 		FEAT_AES		= 1ULL << (32 + 25),
+		FEAT_XSAVE		= 1ULL << (32 + 26),
 		FEAT_AVX		= 1ULL << (32 + 28),
 
 		// intel edx
@@ -111,6 +114,10 @@ public:
 		CR4_OSFXSR		= 1 << 9,
 		/* for SIMD floating-point exception (#XM) */
 		CR4_OSXMMEXCPT	= 1 << 10,
+		/* process-context identifiers (tags TLB-entries with CR3[11:0]) */
+		CR4_PCIDE		= 1 << 17,
+		/* enables XSAVE/XRSTOR and XCR0 */
+		CR4_OSXSAVE		= 1 << 18,
 	};
 
 	enum {
@@ -258,6 +265,27 @@ public:
 		asm volatile ("mov %0, %%dr7" : : "r"(val));
 	}
 
+	/**
+	 * @param idx the index of the extended control register (requires CR4_OSXSAVE)
+	 * @return its value
+	 */
+	static uint64_t getXCR(uint32_t idx) {
+		uint32_t h,l;
+		asm volatile ("xgetbv" : "=a"(l), "=d"(h) : "c"(idx));
+		return (static_cast<uint64_t>(h) << 32) | l;
+	}
+
+	/**
+	 * Sets the extended control register <idx> to <value> (requires CR4_OSXSAVE)
+	 */
+	static void setXCR(uint32_t idx,uint64_t value) {
+		asm volatile (
+			"xsetbv" : : "a"(static_cast<uint32_t>(value)),
+						 "d"(static_cast<uint32_t>(value >> 32)),
+						 "c"(idx)
+		);
+	}
+
 	/**
 	 * @param msr the msr
 	 * @return the value of the given model-specific-register
@@ -289,6 +317,16 @@ public:
 		asm volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(code));
 	}
 
+	/**
+	 * Executes the cpuid instruction for the given sub-leaf and stores the result to the given
+	 * pointers.
+	 */
+	static void cpuid(unsigned code,unsigned subcode,uint32_t *eax,uint32_t *ebx,uint32_t *ecx,
+	                  uint32_t *edx) {
+		asm volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+		                     : "a"(code), "c"(subcode));
+	}
+
 	/**
 	 * Executes the cpuid instruction and converts the result to a string
 	 */
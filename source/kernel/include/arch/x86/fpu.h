@@ -25,17 +25,64 @@
 class FPU {
 	FPU() = delete;
 
+	/* XSAVE requires the state to be 64-byte aligned (FXSAVE 16-byte), which the cache doesn't
+	 * guarantee */
+	static const size_t STATE_ALIGN		= 64;
+	/* the number of time slices in a row in which a thread has to use the FPU, until we load its
+	 * state eagerly on thread switches */
+	static const uint8_t EAGER_THRESHOLD	= 5;
+
 public:
-	/* the state of FPU/MMX/SSE/SSE2/SSE3/SSSE3/SSE4 */
-	struct XState {
-		uint8_t bytes[512];
-	} A_PACKED;
+	/* the instructions we use to save and restore the state */
+	enum Mode {
+		MODE_FSAVE,
+		MODE_FXSAVE,
+		MODE_XSAVE,
+		MODE_XSAVEOPT,
+	};
+
+	/* the state components in XCR0 */
+	enum {
+		XCR0_X87			= 1 << 0,
+		XCR0_SSE			= 1 << 1,
+		XCR0_AVX			= 1 << 2,
+	};
+
+	/* the state of FPU/MMX/SSE/AVX. its size depends on the CPU and the enabled components */
+	struct XState;
+
+	/* the FPU-context of a thread */
+	struct Context {
+		/* the allocated memory and the aligned state in it; initially NULL */
+		void *mem;
+		XState *state;
+		/* the CPU that loaded the state last */
+		cpuid_t cpu;
+		/* the number of time slices in a row in which the thread used the FPU */
+		uint8_t streak;
+		/* whether the thread used the FPU in its current time slice */
+		bool used;
+	};
 
 	/**
-	 * Inits the FPU for usage of processes
+	 * Detects the available state-saving mechanism and inits the FPU for usage of processes
 	 */
 	static void init();
 
+	/**
+	 * @return the used mechanism to save and restore the state
+	 */
+	static Mode getMode() {
+		return mode;
+	}
+
+	/**
+	 * @return the size of the state in bytes
+	 */
+	static size_t getStateSize() {
+		return stateSize;
+	}
+
 	/**
 	 * Locks the FPU so that we'll receive a EX_CO_PROC_NA exception as soon as someone
 	 * uses a FPU-instruction
@@ -48,39 +95,91 @@ public:
 			CPU::setCR0(cr0 | CPU::CR0_TASK_SWITCHED);
 	}
 
+	/**
+	 * Performs the FPU-part of a thread switch on <cpu>. If the old thread used the FPU in its
+	 * time slice, its state is saved, so that it can continue on any CPU. The state of the new
+	 * thread is usually loaded lazily on its first FPU-instruction. But threads that used the
+	 * FPU in each of their last time slices get their state loaded right away to avoid the
+	 * exception.
+	 *
+	 * @param old the FPU-context of the old thread (may be NULL)
+	 * @param ctx the FPU-context of the new thread
+	 * @param cpu the cpu
+	 */
+	static void switchTo(Context *old,Context *ctx,cpuid_t cpu);
+
 	/**
 	 * Handles the EX_CO_PROC_NA exception
 	 *
-	 * @param state pointer to the state-memory
+	 * @param ctx the FPU-context of the running thread
+	 * @param cpu the cpu
 	 */
-	static void handleCoProcNA(XState **state);
+	static void handleCoProcNA(Context *ctx,cpuid_t cpu);
 
 	/**
-	 * Clones the FPU-state <src> into <dst>
+	 * Clones the FPU-state of <src> into <dst>
 	 *
-	 * @param dst the destination-fpu-state
-	 * @param src the source-fpu-state
+	 * @param dst the destination-context
+	 * @param src the source-context, which belongs to the running thread
+	 * @param cpu the cpu we're running on
 	 */
-	static void cloneState(XState **dst,const XState *src);
+	static void cloneState(Context *dst,const Context *src,cpuid_t cpu);
 
 	/**
-	 * Free's the given FPU-state
+	 * Free's the FPU-state of the given context
 	 *
-	 * @param state the state
+	 * @param ctx the context
 	 */
-	static void freeState(XState **state);
+	static void freeState(Context *ctx);
 
 private:
+	static bool isUnlocked() {
+		return (CPU::getCR0() & CPU::CR0_TASK_SWITCHED) == 0;
+	}
+	static void unlockFPU() {
+		CPU::setCR0(CPU::getCR0() & ~CPU::CR0_TASK_SWITCHED);
+	}
+	static bool acquire(Context *ctx,cpuid_t cpu);
+	static bool allocState(Context *ctx);
+	static void initState(XState *state);
+
 	static void finit() {
 		asm volatile ("fninit");
 	}
-	static void fsave(XState *state) {
-		asm volatile ("fxsave %0" : : "m"(*state));
+	static void save(XState *state) {
+		switch(mode) {
+			case MODE_FSAVE:
+				/* fnsave reinitializes the FPU, but the state should stay */
+				asm volatile ("fnsave (%0); frstor (%0)" : : "r"(state) : "memory");
+				break;
+			case MODE_FXSAVE:
+				asm volatile ("fxsave (%0)" : : "r"(state) : "memory");
+				break;
+			case MODE_XSAVE:
+				asm volatile ("xsave (%0)" : : "r"(state), "a"(-1), "d"(-1) : "memory");
+				break;
+			case MODE_XSAVEOPT:
+				asm volatile ("xsaveopt (%0)" : : "r"(state), "a"(-1), "d"(-1) : "memory");
+				break;
+		}
 	}
-	static void frestore(XState *state) {
-		asm volatile ("fxrstor %0" : : "m"(*state));
+	static void restore(const XState *state) {
+		switch(mode) {
+			case MODE_FSAVE:
+				asm volatile ("frstor (%0)" : : "r"(state) : "memory");
+				break;
+			case MODE_FXSAVE:
+				asm volatile ("fxrstor (%0)" : : "r"(state) : "memory");
+				break;
+			case MODE_XSAVE:
+			case MODE_XSAVEOPT:
+				asm volatile ("xrstor (%0)" : : "r"(state), "a"(-1), "d"(-1) : "memory");
+				break;
+		}
 	}
 
-	/* current FPU state-memory */
-	static XState ***curStates;
+	static Mode mode;
+	static size_t stateSize;
+	/* the context whose state has been loaded into the FPU last, for each CPU */
+	static Context **curStates;
 };
@@ -22,6 +22,7 @@
 #include <mem/physmem.h>
 #include <assert.h>
 #include <common.h>
+#include <cpu.h>
 #include <interrupts.h>
 
 class LAPIC {
@@ -98,6 +99,7 @@ class LAPIC {
 	};
 
 	static const uint32_t MSR_APIC_BASE			= 0x1B;
+	static const uint32_t MSR_TSC_DEADLINE		= 0x6E0;
 	static const uint32_t APIC_BASE_EN			= 1 << 11;
 
 public:
@@ -122,6 +124,7 @@ public:
 		write(REG_TIMER_DCR,0x3);	// set divider to 16
 	}
 	static void enableTimer();
+	static void enableOneshotTimer(bool tscDeadline);
 
 	static void sendIPITo(cpuid_t id,uint8_t vector) {
 		writeIPI(id << 24,ICR_DESTSHORT_NO | ICR_LEVEL_ASSERT |
@@ -145,6 +148,9 @@ public:
 	static uint32_t getTimer() {
 		return read(REG_TIMER_CCR);
 	}
+	static void setDeadline(uint64_t tsc) {
+		CPU::setMSR(MSR_TSC_DEADLINE,tsc);
+	}
 
 private:
 	static void writeIPI(uint32_t high,uint32_t low);
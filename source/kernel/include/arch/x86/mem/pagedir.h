@@ -28,6 +28,7 @@
 #endif
 #include <mem/pagetables.h>
 #include <spinlock.h>
+#include <atomic.h>
 #include <lockguard.h>
 #include <cpu.h>
 #include <string.h>
@@ -69,8 +70,26 @@ class PageDir : public PageDirBase {
 		uintptr_t _end;
 	};
 
+#if defined(__x86_64__)
+	/* the number of PCIDs we use per CPU; PCID 0 is used for boot and never handed out */
+	static const size_t PCID_COUNT		= 6;
+	/* don't flush the TLB-entries of the PCID when loading CR3 */
+	static const ulong CR3_NOFLUSH		= 1UL << 63;
+
+	struct PCIDSlot {
+		ulong uid;
+		ulong gen;
+	};
+	struct CPUPCIDs {
+		PCIDSlot slots[PCID_COUNT];
+		size_t next;
+		bool enabled;
+	};
+#endif
+
 public:
-	explicit PageDir() : PageDirBase(), freeKStack(), lock(), pts() {
+	explicit PageDir() : PageDirBase(), freeKStack(), lock(), pts(), cpuMask(), tlbGen(),
+		uid(Atomic::fetch_and_add(&nextUid,+1) + 1) {
 	}
 
 	PageTables *getPageTables() {
@@ -81,6 +100,29 @@ public:
 		CPU::setCR3(CPU::getCR3());
 	}
 
+	/**
+	 * Enables process-context identifiers on the current CPU, if supported. With PCIDs, the TLB
+	 * entries of recently used page-directories survive a CR3 switch.
+	 */
+	static void initPCID();
+
+	/**
+	 * Makes this page-directory the active one on CPU <cpu>, replacing <old>.
+	 *
+	 * @param old the previously active page-directory (may be NULL)
+	 * @param cpu the CPU-id
+	 * @return the value to load into CR3
+	 */
+	uintptr_t activate(PageDir *old,cpuid_t cpu);
+
+	/**
+	 * @param cpu the CPU-id
+	 * @return true if this page-directory might be active on CPU <cpu>
+	 */
+	bool isActiveOn(cpuid_t cpu) const {
+		return cpu >= sizeof(cpuMask) * 8 || (cpuMask & (1UL << cpu));
+	}
+
 	/**
 	* Creates a kernel-stack at an unused address.
 	*
@@ -106,9 +148,26 @@ private:
 	static uintptr_t mapToTemp(frameno_t frame);
 	static void unmapFromTemp();
 
+	/**
+	 * Invalidates the TLB-entries for <count> pages at <virt> on all other CPUs that use this
+	 * page-directory and forces a flush on the next activation on all CPUs that cached it.
+	 */
+	void shootdown(uintptr_t virt,size_t count);
+
 	uintptr_t freeKStack;
 	SpinLock lock;
 	PageTables pts;
+	/* the CPUs that have this page-directory loaded in CR3 */
+	volatile ulong cpuMask;
+	/* incremented on every change that requires a TLB-flush */
+	volatile ulong tlbGen;
+	/* a unique id to recognize the page-directory in the PCID-slots */
+	ulong uid;
+
+	static ulong nextUid;
+#if defined(__x86_64__)
+	static CPUPCIDs *pcids;
+#endif
 
 	static uintptr_t freeAreaAddr;
 	static uint8_t sharedPtbls[][PAGE_SIZE];
@@ -149,6 +208,11 @@ inline frameno_t PageDirBase::getFrameNo(uintptr_t virt) const {
 	return pdir->pts.getFrameNo(virt);
 }
 
+inline bool PageDirBase::clearAccessed(uintptr_t virt) {
+	PageDir *pdir = static_cast<PageDir*>(this);
+	return pdir->pts.clearAccessed(virt);
+}
+
 inline void PageDirBase::zeroToUser(void *dst,size_t count) {
 	PageDir::setWriteProtection(false);
 	memclear(dst,count);
@@ -21,6 +21,7 @@
 
 #include <arch/x86/gdt.h>
 #include <arch/x86/lapic.h>
+#include <spinlock.h>
 #include <common.h>
 
 class SMP : public SMPBase {
@@ -40,8 +41,32 @@ public:
 	 */
 	static void apIsRunning();
 
+	/**
+	 * Performs the TLB-flushes that have been requested for CPU <id>
+	 *
+	 * @param id the CPU-id
+	 * @param pdir the currently active pagedir
+	 */
+	static void flushPending(cpuid_t id,PageDir *pdir);
+
 private:
+	/* the range to invalidate; if it spans more than this, we flush the TLB completely */
+	static const size_t FLUSH_MAX_PAGES	= 32;
+
+	struct FlushRequest {
+		SpinLock lock;
+		PageDir *pdir;
+		uintptr_t start;
+		uintptr_t end;
+		/* whether there is a request that has not been picked up yet */
+		volatile bool pending;
+		/* incremented for every request and set to the picked up value after the flush is done */
+		volatile ulong seq;
+		volatile ulong flushed;
+	};
+
 	static cpuid_t *log2Phys;
+	static FlushRequest *flushReqs;
 };
 
 inline cpuid_t SMP::getPhysId(cpuid_t logId) {
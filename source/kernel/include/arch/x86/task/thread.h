@@ -37,8 +37,8 @@ public:
 	uintptr_t getKernelStack() const {
 		return kernelStack;
 	}
-	FPU::XState **getFPUState() {
-		return &fpuState;
+	FPU::Context *getFPUContext() {
+		return &fpuCtx;
 	}
 
 private:
@@ -48,8 +48,8 @@ private:
 		asm("thread_resume");
 
 	uintptr_t kernelStack;
-	/* FPU-state; initially NULL */
-	FPU::XState *fpuState;
+	/* FPU-context; initially without state */
+	FPU::Context fpuCtx;
 };
 
 inline Thread *ThreadBase::getRunning() {
@@ -50,21 +50,48 @@ public:
 	 */
 	static void start(bool isBSP);
 
+	/**
+	 * @return true if the LAPIC timer is used in one-shot mode, i.e., is programmed for the next
+	 *  event instead of firing periodically
+	 */
+	static bool isTickless() {
+		return tickless;
+	}
+
+	/**
+	 * Programs the timer of the current CPU to fire at <deadline>.
+	 *
+	 * @param deadline the time in microseconds (NO_DEADLINE = never)
+	 * @param now the current time in microseconds
+	 */
+	static void program(uint64_t deadline,uint64_t now);
+
 private:
 	static uint64_t determineSpeed(int instrCount,uint64_t *busHz);
 
 	static uint64_t bootTSC;
 	static time_t bootTime;
 	static uint64_t cpuMhz;
+	static bool tickless;
+	static bool tscDeadline;
 };
 
+inline uint64_t TimerBase::getTimestamp() {
+	return cyclesToTime(CPU::rdtsc() - Timer::bootTSC);
+}
+
 inline void TimerBase::getTimeval(struct timeval *tv) {
-	uint64_t tsc = CPU::rdtsc();
-	uint64_t usecs = cyclesToTime(tsc - Timer::bootTSC);
+	uint64_t usecs = getTimestamp();
 	tv->tv_sec = Timer::bootTime + usecs / 1000000;
 	tv->tv_usec = usecs % 1000000;
 }
 
+inline void TimerBase::getTimeBase(uint64_t *cyclesPerUs,uint64_t *cycleBase,time_t *bootTime) {
+	*cyclesPerUs = Timer::cpuMhz;
+	*cycleBase = Timer::bootTSC;
+	*bootTime = Timer::bootTime;
+}
+
 inline uint64_t TimerBase::cyclesToTime(uint64_t cycles) {
 	return cycles / Timer::cpuMhz;
 }
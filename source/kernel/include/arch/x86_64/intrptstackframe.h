@@ -51,6 +51,33 @@
  							pop		%rcx;	\
  							pop		%rbx;	\
  							pop		%rax
+/* for syscalls, we only save the registers that the C code might clobber. the callee-saved
+ * registers rbx and r12-r15 are preserved by the syscall-handler itself; their slots in the
+ * stack-frame are left uninitialized. rbp is saved anyway for user stacktraces. */
+#	define SAVE_SYSC_REGS	push	%rax;		\
+ 							sub		$8,%rsp;	\
+ 							push	%rcx;		\
+ 							push	%rdx;		\
+ 							push	%rdi;		\
+ 							push	%rsi;		\
+ 							push	%rbp;		\
+ 							push	%r8;		\
+ 							push	%r9;		\
+ 							push	%r10;		\
+ 							push	%r11;		\
+ 							sub		$32,%rsp
+#	define RESTORE_SYSC_REGS	add		$32,%rsp;	\
+ 							pop		%r11;		\
+ 							pop		%r10;		\
+ 							pop		%r9;		\
+ 							pop		%r8;		\
+ 							pop		%rbp;		\
+ 							pop		%rsi;		\
+ 							pop		%rdi;		\
+ 							pop		%rdx;		\
+ 							pop		%rcx;		\
+ 							add		$8,%rsp;	\
+ 							pop		%rax
 #	define IRET				iretq
 #	define SYS_ENTER		mov		%rsp,%r11;				\
  							mov		$kstackPtr,%rsp;		\
@@ -120,7 +147,8 @@ public:
 	void print(OStream &os) const {
 		os.writef("stack-frame @ %p\n",this);
 		os.writef("\trax: %#016lx\n",rax);
-		os.writef("\trbx: %#016lx\n",rbx);
+		if(intrptNo)
+			os.writef("\trbx: %#016lx\n",rbx);
 		os.writef("\trcx: %#016lx\n",rcx);
 		os.writef("\trdx: %#016lx\n",rdx);
 		os.writef("\trsi: %#016lx\n",rsi);
@@ -131,10 +159,12 @@ public:
 		os.writef("\tr9 : %#016lx\n",r9);
 		os.writef("\tr10: %#016lx\n",r10);
 		os.writef("\tr11: %#016lx\n",r11);
-		os.writef("\tr12: %#016lx\n",r12);
-		os.writef("\tr13: %#016lx\n",r13);
-		os.writef("\tr14: %#016lx\n",r14);
-		os.writef("\tr15: %#016lx\n",r15);
+		if(intrptNo) {
+			os.writef("\tr12: %#016lx\n",r12);
+			os.writef("\tr13: %#016lx\n",r13);
+			os.writef("\tr14: %#016lx\n",r14);
+			os.writef("\tr15: %#016lx\n",r15);
+		}
 		os.writef("\trip: %#016lx\n",getIP());
 		os.writef("\trfl: %#016lx\n",getFlags());
 		if(intrptNo) {
@@ -143,7 +173,7 @@ public:
 		}
 	}
 
-	/* general purpose registers */
+	/* general purpose registers. rbx and r12-r15 are only valid for interrupts (see SAVE_SYSC_REGS) */
 	ulong r15;
 	ulong r14;
 	ulong r13;
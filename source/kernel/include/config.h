@@ -39,6 +39,10 @@ public:
 		FORCE_PIT		= 9,
 		FORCE_PIC		= 10,
 		ACCURATE_CPU	= 11,
+		PERIODIC_TIMER	= 12,
+		ZSWAP			= 13,
+		/* per process; handled by the sysconf syscall */
+		SHARED_INFO		= 14,
 		ROOT_DEVICE		= 32,
 		SWAP_DEVICE		= 33,
 	};
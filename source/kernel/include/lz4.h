@@ -0,0 +1,72 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <common.h>
+#include <spinlock.h>
+
+/**
+ * A compressor that produces the LZ4 block format. It is tuned for speed rather than ratio and
+ * supports inputs up to 64 KiB, which is enough for compressing pages.
+ */
+class LZ4 {
+	LZ4() = delete;
+
+	static const size_t HASH_BITS		= 12;
+	static const size_t MIN_MATCH		= 4;
+	/* the last match has to start at least that many bytes before the end */
+	static const size_t MF_LIMIT		= 12;
+	/* the last bytes are always literals */
+	static const size_t LAST_LITERALS	= 5;
+
+public:
+	static const size_t MAX_INPUT		= 0xFFFF;
+
+	/**
+	 * Compresses <srcSize> bytes at <src> into <dst>.
+	 *
+	 * @param src the data to compress
+	 * @param srcSize the number of bytes (<= MAX_INPUT)
+	 * @param dst the destination buffer
+	 * @param dstSize the size of the destination buffer
+	 * @return the size of the compressed data or 0 if it doesn't fit into <dst>
+	 */
+	static size_t compress(const void *src,size_t srcSize,void *dst,size_t dstSize);
+
+	/**
+	 * Decompresses <srcSize> bytes at <src> into <dst>.
+	 *
+	 * @param src the compressed data
+	 * @param srcSize the size of the compressed data
+	 * @param dst the destination buffer
+	 * @param dstSize the size of the destination buffer
+	 * @return the size of the decompressed data or 0 if the data is corrupt or doesn't fit into <dst>
+	 */
+	static size_t decompress(const void *src,size_t srcSize,void *dst,size_t dstSize);
+
+private:
+	static bool putLength(uint8_t **out,const uint8_t *end,size_t len);
+	static bool putSequence(uint8_t **out,const uint8_t *end,const uint8_t *lits,size_t litLen,
+		size_t offset,size_t matchLen);
+	static bool getLength(const uint8_t **in,const uint8_t *end,size_t *len);
+
+	static uint16_t table[];
+	static SpinLock lock;
+};
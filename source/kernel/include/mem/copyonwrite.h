@@ -19,22 +19,17 @@
 
 #pragma once
 
-#include <esc/col/slist.h>
+#include <mem/physmem.h>
 #include <task/proc.h>
 #include <common.h>
 
+/**
+ * The copy-on-write state is kept in the frame-metadata of PhysMem: the reference-count is the
+ * number of address-spaces that share the frame, so that no allocation or global lock is needed.
+ */
 class CopyOnWrite {
 	CopyOnWrite() = delete;
 
-	struct Entry : public esc::SListItem {
-		explicit Entry(frameno_t frameNo) : esc::SListItem(), frameNumber(frameNo), refCount(0) {
-		}
-		frameno_t frameNumber;
-		size_t refCount;
-	};
-
-	static const size_t HEAP_SIZE	= 64;
-
 public:
 	/**
 	 * Handles a pagefault for given address. Assumes that the pagefault was caused by a write access
@@ -47,12 +42,11 @@ public:
 	static size_t pagefault(uintptr_t address,frameno_t frameNumber);
 
 	/**
-	 * Adds the given frame to the cow-list.
+	 * Adds a reference to the given frame and marks it as copy-on-write.
 	 *
 	 * @param frameNo the frame-number
-	 * @return true if successfull
 	 */
-	static bool add(frameno_t frameNo);
+	static void add(frameno_t frameNo);
 
 	/**
 	 * Removes the given frame from the cow-list
@@ -64,11 +58,11 @@ public:
 	static size_t remove(frameno_t frameNo,bool *foundOther);
 
 	/**
-	 * Note that this is intended for debugging or similar only! (not very efficient)
-	 *
 	 * @return the number of different frames that are in the cow-list
 	 */
-	static size_t getFrmCount();
+	static size_t getFrmCount() {
+		return frmCount;
+	}
 
 	/**
 	 * Prints the cow-list
@@ -78,8 +72,12 @@ public:
 	static void print(OStream &os);
 
 private:
-	static Entry *getByFrame(frameno_t frameNo,bool dec);
+	/**
+	 * Removes a reference from the given frame
+	 *
+	 * @return the number of remaining references
+	 */
+	static uint release(frameno_t frameNo);
 
-	static esc::SList<Entry> frames[];
-	static SpinLock lock;
+	static volatile size_t frmCount;
 };
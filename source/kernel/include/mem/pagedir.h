@@ -142,7 +142,8 @@ public:
 	static int mapToCur(uintptr_t virt,size_t count,PageTables::Allocator &alloc,uint flags);
 
 	/**
-	 * Convenience method for Proc::getCurPageDir()->unmap(...).
+	 * Convenience method for Proc::getCurPageDir()->unmap(...). Only meant for kernel areas, which
+	 * never contain large pages, so that it can't fail.
 	 */
 	static void unmapFromCur(uintptr_t virt,size_t count,PageTables::Allocator &alloc);
 
@@ -177,6 +178,15 @@ public:
 	 */
 	frameno_t getFrameNo(uintptr_t virt) const;
 
+	/**
+	 * Clears the accessed-bit of the given page. On architectures without accessed-bits, it always
+	 * returns false.
+	 *
+	 * @param virt the virtual address
+	 * @return true if the page has been accessed since the last call
+	 */
+	bool clearAccessed(uintptr_t virt);
+
 	/**
 	 * Clones <count> pages at <virtSrc> to <virtDst> from <this> into <dst>. That means
 	 * the flags and frames are copied. Additionally, if <share> is false all present pages will
@@ -204,13 +214,16 @@ public:
 	int map(uintptr_t virt,size_t count,PageTables::Allocator &alloc,uint flags);
 
 	/**
-	 * Removes <count> pages starting at <virt> from the page-tables in this page-directory.
+	 * Removes <count> pages starting at <virt> from the page-tables in this page-directory. Large
+	 * pages that are only partially covered by the range are split, which is the only reason why
+	 * this can fail. Thus, removing complete regions or kernel areas always succeeds.
 	 *
 	 * @param virt the virtual start-address
 	 * @param count the number of pages to unmap
 	 * @param alloc the allocator to use for freeing pages/page-tables
+	 * @return 0 on success or -ENOMEM if a large page could not be split (nothing is changed then)
 	 */
-	void unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc);
+	int unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc);
 
 	/**
 	 * Counts the number of pages that are currently present in this page-directory
@@ -21,6 +21,7 @@
 
 #include <mem/physmem.h>
 #include <assert.h>
+#include <atomic.h>
 #include <common.h>
 #include <cppsupport.h>
 
@@ -36,6 +37,12 @@
 
 #define PT_IDX(addr,lvl)		(((addr) >> (PAGE_BITS + PT_BPL * (lvl))) & ((1 << PT_BPL) - 1))
 
+#if PTE_LARGE != 0
+/* a large page replaces a complete page-table */
+#	define LARGE_PAGE_SIZE		PT_SIZE
+#	define LARGE_PAGE_COUNT		PT_ENTRY_COUNT
+#endif
+
 class PageTables {
 public:
 	/**
@@ -50,7 +57,7 @@ public:
 		}
 
 		/**
-		 * @return the number of allocated and free'd page-tables
+		 * @return the number of allocated minus the number of free'd page-tables
 		 */
 		int pageTables() const {
 			return _pts;
@@ -69,6 +76,15 @@ public:
 			return PhysMem::allocate(PhysMem::KERN);
 		}
 
+		/**
+		 * Allocates the contiguous frames for a large page, if possible.
+		 *
+		 * @return the first frame or INVALID_FRAME if not possible
+		 */
+		virtual frameno_t allocLargePage() {
+			return INVALID_FRAME;
+		}
+
 		/**
 		 * Frees the given frame that belonged to a page.
 		 */
@@ -78,7 +94,7 @@ public:
 		 * Frees the given frame that belonged to a page-table
 		 */
 		virtual void freePT(frameno_t frame) {
-			_pts++;
+			_pts--;
 			PhysMem::free(frame,PhysMem::KERN);
 		}
 
@@ -110,6 +126,7 @@ public:
 		virtual frameno_t allocPage() {
 			return _frame++;
 		}
+		virtual frameno_t allocLargePage();
 		virtual void freePage(frameno_t);
 
 	private:
@@ -218,6 +235,23 @@ public:
 		return PTE_FRAMENO(*pte) + (virt - base) / PAGE_SIZE;
 	}
 
+	/**
+	 * Clears the accessed-bit of the given page. Without hardware-support, it always returns false.
+	 *
+	 * @param virt the virtual address
+	 * @return true if the page has been accessed since the last call
+	 */
+	bool clearAccessed(uintptr_t virt) {
+#if PTE_ACCESSED != 0
+		uintptr_t base;
+		pte_t *pte = getPTE(virt,&base);
+		/* the CPU might set the dirty-bit concurrently */
+		if(pte && (*pte & PTE_ACCESSED))
+			return Atomic::fetch_and_and(pte,~PTE_ACCESSED) & PTE_ACCESSED;
+#endif
+		return false;
+	}
+
 	/**
 	 * Clones <count> pages at <virtSrc> to <virtDst> from <this> into <dst>. That means
 	 * the flags and frames are copied. Additionally, if <share> is false all present pages will
@@ -234,7 +268,8 @@ public:
 	int clone(PageTables *dst,uintptr_t virtSrc,uintptr_t virtDst,size_t count,bool share);
 
 	/**
-	 * Maps <count> pages starting at <virt> in this page-directory.
+	 * Maps <count> pages starting at <virt> in this page-directory. Large pages are used for
+	 * user-pages if <virt> is suitably aligned and the allocator provides contiguous frames.
 	 *
 	 * @param virt the virt start-address
 	 * @param count the number of pages to map
@@ -245,12 +280,14 @@ public:
 	int map(uintptr_t virt,size_t count,Allocator &alloc,uint flags);
 
 	/**
-	 * Removes <count> pages starting at <virt> from the page-tables in this page-directory.
+	 * Removes <count> pages starting at <virt> from the page-tables in this page-directory. Large
+	 * pages that are only partially removed are split into normal pages.
 	 *
 	 * @param virt the virtual start-address
 	 * @param count the number of pages to unmap
 	 * @param alloc the allocator to use for freeing pages/page-tables
-	 * @return 1 if a TLB shootdown is necessary
+	 * @return 1 if a TLB shootdown is necessary or -ENOMEM if a large page could not be split. in
+	 *  the latter case, nothing has been changed
 	 */
 	int unmap(uintptr_t virt,size_t count,Allocator &alloc);
 
@@ -276,6 +313,12 @@ private:
 	static void printPTE(OStream &os,uintptr_t from,uintptr_t to,pte_t page,int level);
 
 	int mapPage(uintptr_t virt,frameno_t frame,pte_t flags,Allocator &alloc);
+#if PTE_LARGE != 0
+	static int splitLargePage(pte_t *pte,Allocator &alloc);
+	int splitPartial(uintptr_t virt,uintptr_t start,size_t count,Allocator &alloc);
+	bool canMapLarge(uintptr_t virt) const;
+	int mapLargePage(uintptr_t virt,frameno_t frame,pte_t flags,Allocator &alloc);
+#endif
 	frameno_t unmapPage(uintptr_t virt);
 	pte_t *getPTE(uintptr_t virt,uintptr_t *base) const;
 	bool gc(uintptr_t virt,pte_t pte,int level,uint bits,Allocator &alloc);
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <assert.h>
 #include <common.h>
 #include <lockguard.h>
 #include <spinlock.h>
@@ -59,10 +60,21 @@ class PhysMem {
 	static const size_t BITS_PER_BMWORD				= sizeof(tBitmap) * 8;
 	static const ulong KERNEL_MEM_PERCENT			= 20;
 	static const ulong KERNEL_MEM_MIN				= 750;
-	static const ulong MAX_SWAP_AT_ONCE				= 10;
+	static const ulong MAX_SWAP_AT_ONCE				= 64;
+	/* swap out at least that many pages to be able to write clusters */
+	static const ulong MIN_SWAP_AT_ONCE				= 16;
 	static const ulong SWAPIN_JOB_COUNT				= 64;
-	/* the amount of memory at which we should start to set the region-timestamp */
-	static const size_t REG_TS_BEGIN				= 4 * 1024 * PAGE_SIZE;
+	/* the capacity of the per-CPU frame caches and the number of frames to move at once between
+	 * them and the stacks */
+	static const size_t FRAME_CACHE_SIZE			= 64;
+	static const size_t FRAME_CACHE_BATCH			= 32;
+
+	/* a per-CPU batch of free user frames */
+	struct FrameCache {
+		SpinLock lock;
+		size_t count;
+		frameno_t frames[FRAME_CACHE_SIZE];
+	};
 
 public:
 	enum MemType {
@@ -80,11 +92,31 @@ public:
 		MATTR_WC	= 1 << 0,
 	};
 
+	enum FrameFlags {
+		/* the frame is shared copy-on-write */
+		FRAME_COW	= 1 << 0,
+	};
+
+	/**
+	 * The metadata for one physical frame
+	 */
+	struct Frame {
+		/* the number of address-spaces that use the frame */
+		volatile uint refs;
+		/* FRAME_* */
+		volatile uint flags;
+	};
+
 	/**
 	 * Initializes the memory-management
 	 */
 	static void init();
 
+	/**
+	 * Creates the per-CPU frame caches. Has to be done after the CPUs are known.
+	 */
+	static void initCaches();
+
 	/**
 	 * @return the total amount of memory
 	 */
@@ -92,6 +124,22 @@ public:
 		return totalMem;
 	}
 
+	/**
+	 * @param frame the frame-number
+	 * @return the metadata for the given frame
+	 */
+	static Frame *getFrame(frameno_t frame) {
+		vassert(frame < frameCount,"Frame %#x out of range",frame);
+		return frames + frame;
+	}
+
+	/**
+	 * @return the number of frames that have metadata
+	 */
+	static size_t getFrameCount() {
+		return frameCount;
+	}
+
 	/**
 	 * Checks whether its allowed to map the given physical address range
 	 *
@@ -139,13 +187,6 @@ public:
 	 */
 	static size_t getFreeFrames(uint types);
 
-	/**
-	 * Determines whether the region-timestamp should be set (depending on the still available memory)
-	 *
-	 * @return true if so
-	 */
-	static bool shouldSetRegTimestamp();
-
 	/**
 	 * Allocates <count> contiguous frames from the MM-bitmap
 	 *
@@ -171,7 +212,8 @@ public:
 
 	/**
 	 * Swaps out frames until at least <frameCount> frames are available.
-	 * Panics if its not possible to make that frames available (swapping disabled, partition full, ...)
+	 * Fails if its not possible to make that frames available (swapping disabled, partition or
+	 * compressed pool full, ...)
 	 *
 	 * @param frameCount the number of frames you need
 	 * @param swap whether to actually swap if necessary (or return an error)
@@ -188,6 +230,17 @@ public:
 	 */
 	static frameno_t allocate(FrameType type);
 
+	/**
+	 * Allocates up to <count> frames at once, which is cheaper than allocating them one by one. As
+	 * for allocate(), you should announce them with reserve() first.
+	 *
+	 * @param type the type of memory (FRM_*)
+	 * @param frames the array to write the frame-numbers to
+	 * @param count the number of frames
+	 * @return the number of allocated frames
+	 */
+	static size_t allocate(FrameType type,frameno_t *frames,size_t count);
+
 	/**
 	 * Frees the given frame
 	 *
@@ -196,6 +249,26 @@ public:
 	 */
 	static void free(frameno_t frame,FrameType type);
 
+	/**
+	 * Frees the given frames
+	 *
+	 * @param frames the frame-numbers
+	 * @param count the number of frames
+	 * @param type the type of memory (FRM_*)
+	 */
+	static void free(const frameno_t *frames,size_t count,FrameType type);
+
+	/**
+	 * Allocates up to <count> user-frames without a reservation. This is only done, if the frames
+	 * are not needed otherwise, i.e. if they would not have to be swapped out again immediately.
+	 * The frames are free'd as usual with free(<frame>,USR).
+	 *
+	 * @param frames the array to write the frame-numbers to
+	 * @param count the max. number of frames
+	 * @return the number of allocated frames
+	 */
+	static size_t allocateSpare(frameno_t *frames,size_t count);
+
 	/**
 	 * Swaps the page with given address for the current process in
 	 *
@@ -242,6 +315,17 @@ private:
 	static uintptr_t lowerEnd();
 	static frameno_t allocFrame(bool forceLower);
 	static void freeFrame(frameno_t frame);
+	static size_t allocFrames(FrameType type,frameno_t *frames,size_t count);
+	static frameno_t doAllocate(FrameType type);
+	static void doFree(frameno_t frame,FrameType type);
+	static bool isStackFrame(frameno_t frame) {
+		return frame >= bitmapStartFrame() + BITMAP_PAGE_COUNT;
+	}
+	static FrameCache *getCache();
+	static size_t allocCached(frameno_t *frames,size_t count);
+	static size_t refill(FrameCache *cache);
+	static void drain(FrameCache *cache,size_t count);
+	static void drainCaches();
 	static size_t getFreeDef();
 	static void markRangeUsed(uintptr_t from,uintptr_t to,bool used);
 	static void doMarkRangeUsed(uintptr_t from,uintptr_t to,bool used);
@@ -252,6 +336,10 @@ private:
 
 	static size_t totalMem;
 
+	/* the metadata for all frames, indexed by the frame-number */
+	static Frame *frames;
+	static size_t frameCount;
+
 	/* the bitmap for the frames of the lowest few MB; 0 = free, 1 = used */
 	static tBitmap *bitmap;
 	static uintptr_t bitmapStart;
@@ -264,6 +352,11 @@ private:
 	static StackFrames upper;
 	static SpinLock defLock;
 
+	/* the per-CPU frame caches in front of the stacks; the frames in there count as free */
+	static FrameCache *caches;
+	static size_t cacheCount;
+	static volatile size_t cachedFrames;
+
 	static bool initialized;
 
 	/* for swapping */
@@ -271,10 +364,11 @@ private:
 	static size_t swappedIn;
 	static bool swapEnabled;
 	static bool swapping;
+	static bool swapFailed;
 	static Thread *swapperThread;
 	static size_t cframes;	/* critical frames; for dynarea, cache and heap */
 	static size_t kframes;	/* kernel frames: for pagedirs, page-tables, kstacks, ... */
-	static size_t uframes;	/* user frames */
+	static volatile size_t uframes;	/* user frames */
 	/* swap-in jobs */
 	static SwapInJob siJobs[];
 	static SwapInJob *siFreelist;
@@ -283,10 +377,3 @@ private:
 	static size_t jobWaiters;
 };
 
-inline bool PhysMem::shouldSetRegTimestamp() {
-	if(!swapEnabled)
-		return false;
-
-	LockGuard<SpinLock> g(&defLock);
-	return getFreeDef() * PAGE_SIZE < REG_TS_BEGIN;
-}
@@ -72,7 +72,19 @@ public:
 	 * @param vm the virtmem-object
 	 * @param success whether it succeeded (is expected to be true before the call!)
 	 */
-	Region(const Region &reg,VirtMem *vm,bool &success);
+	Region(const Region &reg,VirtMem *vm,bool &success) : Region(reg,vm,true,success) {
+	}
+
+	/**
+	 * Like the constructor above, but if <copyPages> is false, the region starts without any
+	 * pages, i.e. they will be allocated and zeroed on demand.
+	 *
+	 * @param reg the region to clone
+	 * @param vm the virtmem-object
+	 * @param copyPages whether to copy the page-flags
+	 * @param success whether it succeeded (is expected to be true before the call!)
+	 */
+	Region(const Region &reg,VirtMem *vm,bool copyPages,bool &success);
 
 	/**
 	 * Destroys this region (regardless of the number of users!)
@@ -139,16 +151,6 @@ public:
 	size_t getPageCount() const {
 		return pfSize;
 	}
-	/**
-	 * @return the timestamp of last usage (for swapping)
-	 */
-	uint64_t getTimestamp() const {
-		return timestamp;
-	}
-	void setTimestamp(uint64_t ts) {
-		timestamp = ts;
-	}
-
 	/**
 	 * @return the flags of the given page
 	 */
@@ -250,7 +252,6 @@ private:
 	off_t offset;
 	size_t loadCount;
 	size_t byteCount;
-	uint64_t timestamp;
 	size_t pfSize;			/* size of pageFlags */
 	ulong *pageFlags;		/* flags for each page; upper bits: swap-block, if swapped */
 	esc::ISList<VirtMem*> vms;
@@ -30,11 +30,6 @@
 class SwapMap {
 	SwapMap() = delete;
 
-	struct Block {
-		uint refCount;
-		Block *next;
-	};
-
 public:
 	/**
 	 * Inits the swap-map
@@ -45,11 +40,13 @@ public:
 	static bool init(size_t swapSize);
 
 	/**
-	 * Allocates 1 block on the swap-device
+	 * Allocates <count> contiguous blocks on the swap-device
 	 *
-	 * @return the starting block on the swap-device or INVALID_BLOCK if no free space is left
+	 * @param count the number of blocks
+	 * @return the starting block on the swap-device or INVALID_BLOCK if there is no free range of
+	 *  that size
 	 */
-	static ulong alloc();
+	static ulong alloc(size_t count = 1);
 
 	/**
 	 * Increases the references of the given block
@@ -79,7 +76,8 @@ public:
 	}
 
 	/**
-	 * Free's the given block
+	 * Free's the given block. If it is no longer used, its page is removed from the compressed
+	 * swap-cache as well.
 	 *
 	 * @param block the block to free
 	 */
@@ -95,19 +93,19 @@ public:
 private:
 	static size_t totalBlocks;
 	static size_t freeBlocks;
-	static Block *swapBlocks;
-	static Block *freeList;
+	static size_t nextBlock;
+	static uint *refCounts;
 	static SpinLock lock;
 };
 
 inline void SwapMap::incRefs(ulong block) {
 	LockGuard<SpinLock> g(&lock);
-	assert(block < totalBlocks && swapBlocks[block].refCount > 0);
-	swapBlocks[block].refCount++;
+	assert(block < totalBlocks && refCounts[block] > 0);
+	refCounts[block]++;
 }
 
 inline bool SwapMap::isUsed(ulong block) {
 	LockGuard<SpinLock> g(&lock);
 	assert(block < totalBlocks);
-	return swapBlocks[block].refCount > 0;
+	return refCounts[block] > 0;
 }
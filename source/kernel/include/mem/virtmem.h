@@ -74,32 +74,29 @@ public:
 	static int pagefault(uintptr_t addr,bool write);
 
 	/**
-	 * Swaps <count> pages out. It searches for the best suited page to swap out.
+	 * Swaps <count> pages out. The pages are chosen with the CLOCK algorithm, i.e. pages that have
+	 * been accessed since the last revolution of the clock-hand get a second chance. The pages are
+	 * stored in the compressed pool, if enabled, or written in clusters to contiguous swap-blocks.
 	 *
 	 * @param pid the process-id for writing the page-content to <file>
-	 * @param file the file to write to
+	 * @param file the file to write to (NULL if there is only the compressed pool)
 	 * @param count the number of pages to swap out
+	 * @return the number of swapped out pages (less than <count> if there are no more candidates)
 	 */
-	static void swapOut(pid_t pid,OpenFile *file,size_t count);
+	static size_t swapOut(pid_t pid,OpenFile *file,size_t count);
 
 	/**
-	 * Swaps the page at given address of the given process in.
+	 * Swaps the page at given address of the given process in. If it is not in the compressed pool,
+	 * the following pages of the region are read ahead, if they are stored in the following
+	 * swap-blocks and free frames are available.
 	 *
 	 * @param pid the process-id for writing the page-content to <file>
 	 * @param file the file to write to
 	 * @param t the thread that wants to swap the page in (and has reserved the frame to do so)
 	 * @param addr the address of the page to swap in
-	 * @return true on success
-	 */
-	static bool swapIn(pid_t pid,OpenFile *file,Thread *t,uintptr_t addr);
-
-	/**
-	 * Sets the timestamp for all regions that are used by the given thread
-	 *
-	 * @param t the thread
-	 * @param timestamp the timestamp to set
+	 * @return the number of pages that have been swapped in
 	 */
-	static void setTimestamp(Thread *t,uint64_t timestamp);
+	static size_t swapIn(pid_t pid,OpenFile *file,Thread *t,uintptr_t addr);
 
 	/**
 	 * @return the id of the process that owns this virtual memory
@@ -159,6 +156,14 @@ public:
 	 */
 	uintptr_t mapphys(uintptr_t *phys,size_t bCount,size_t align,int flags);
 
+	/**
+	 * Maps the shared info page (see SharedInfo) read-only into this VM, if not already done.
+	 *
+	 * @param addr will be set to the virtual address of the page
+	 * @return 0 on success or a negative error-code
+	 */
+	int mapSharedInfo(uintptr_t *addr);
+
 	/**
 	 * Maps a region to this VM.
 	 *
@@ -226,6 +231,14 @@ public:
 	 */
 	ssize_t getShareInfo(uintptr_t addr,char *path,size_t size);
 
+	/**
+	 * Determines the flags of the region that contains the given address
+	 *
+	 * @param addr the address
+	 * @return the flags (RF_*) on success or -EFAULT if there is no region at <addr>
+	 */
+	long getRegFlags(uintptr_t addr) const;
+
 	/**
 	 * Gets the region at given address
 	 *
@@ -297,9 +310,11 @@ public:
 	 * Clones all regions of this virtmem (current) into the destination-virtmem
 	 *
 	 * @param dst the destination-virtmem
+	 * @param stacksOnly if true, only empty copies of the stack-regions of the current thread
+	 *  are created (for spawn, which replaces everything else anyway)
 	 * @return 0 on success
 	 */
-	int cloneAll(VirtMem *dst);
+	int cloneAll(VirtMem *dst,bool stacksOnly = false);
 
 	/**
 	 * If <amount> is positive, the region will be grown by <amount> pages. If negative it
@@ -368,7 +383,7 @@ private:
 	void init(Proc *p) {
 		proc = p;
 		ownFrames = sharedFrames = swapped = 0;
-		freeStackAddr = dataAddr = 0;
+		freeStackAddr = dataAddr = sharedInfoAddr = 0;
 		peakOwnFrames = peakSharedFrames = swapCount = 0;
 		VMFreeMap::init(&freemap,FREE_AREA_BEGIN,FREE_AREA_END - FREE_AREA_BEGIN);
 		VMTree::addTree(this,&regtree);
@@ -392,8 +407,8 @@ private:
 		swapCount = 0;
 	}
 
-	static Region *getLRURegion();
-	static ssize_t getPgIdxForSwap(const Region *reg);
+	static size_t getVictims(Region **victim,size_t *pages,size_t max);
+	static size_t scanRegion(Region *reg,size_t *pages,size_t max);
 	static void setSwappedOut(Region *reg,size_t index);
 	static void setSwappedIn(Region *reg,size_t index,frameno_t frameNo);
 
@@ -444,6 +459,8 @@ private:
 	uintptr_t freeStackAddr;
 	/* address of the data-region; required for chgsize */
 	uintptr_t dataAddr;
+	/* address of the shared info page, if mapped */
+	uintptr_t sharedInfoAddr;
 	/* area-map for the free area */
 	VMFreeMap freemap;
 	/* the regions */
@@ -452,4 +469,9 @@ private:
 	ulong peakOwnFrames;
 	ulong peakSharedFrames;
 	ulong swapCount;
+
+	/* the position of the clock-hand for swapping: the process, the region-number and the page */
+	static pid_t clockPid;
+	static size_t clockReg;
+	static size_t clockPage;
 };
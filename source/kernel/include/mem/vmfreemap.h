@@ -61,6 +61,16 @@ public:
 	 */
 	uintptr_t allocate(size_t size);
 
+	/**
+	 * Allocates an area in the given map, that is <size> bytes large and starts at a multiple of
+	 * <align>.
+	 *
+	 * @param size the size of the area
+	 * @param align the alignment in bytes
+	 * @return the address or 0 if failed
+	 */
+	uintptr_t allocate(size_t size,size_t align);
+
 	/**
 	 * Allocates an area in the given map at the specified address, that is <size> bytes large.
 	 *
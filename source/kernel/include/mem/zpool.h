@@ -0,0 +1,147 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <mem/physmem.h>
+#include <common.h>
+#include <spinlock.h>
+
+class OStream;
+
+/**
+ * A pool for objects of up to PAGE_SIZE bytes, similar to zsmalloc. The objects are grouped into
+ * size-classes. All objects of a class are stored in zspages, which consist of up to MAX_FRAMES
+ * frames, so that the space at the end of a frame is used by an object that spans two frames.
+ */
+class ZPool {
+	ZPool() = delete;
+
+	static const size_t CLASS_SIZE		= 64;
+	static const size_t CLASS_COUNT		= PAGE_SIZE / CLASS_SIZE;
+	static const size_t MAX_FRAMES		= 4;
+	static const size_t MAX_OBJS		= MAX_FRAMES * PAGE_SIZE / CLASS_SIZE;
+	static const size_t BITS_PER_WORD	= sizeof(ulong) * 8;
+
+public:
+	struct ZsPage {
+		ZsPage *prev;
+		ZsPage *next;
+		ushort cls;
+		ushort used;
+		frameno_t frames[MAX_FRAMES];
+		ulong bitmap[MAX_OBJS / BITS_PER_WORD];
+	};
+
+	/**
+	 * Identifies an object in the pool
+	 */
+	struct Handle {
+		ZsPage *page;
+		size_t index;
+	};
+
+	/**
+	 * Sets the maximum number of frames the pool may use
+	 *
+	 * @param frames the number of frames
+	 */
+	static void setLimit(size_t frames) {
+		limit = frames;
+	}
+
+	/**
+	 * @return the number of frames that are currently used by the pool
+	 */
+	static size_t getFrameCount() {
+		return frameCount;
+	}
+
+	/**
+	 * @return the number of objects in the pool
+	 */
+	static size_t getObjCount() {
+		return objCount;
+	}
+
+	/**
+	 * Allocates an object with <size> bytes.
+	 *
+	 * @param size the size of the object (<= PAGE_SIZE)
+	 * @param h will be set to the handle of the object
+	 * @return true on success, false if the limit has been reached or there is no memory left
+	 */
+	static bool alloc(size_t size,Handle *h);
+
+	/**
+	 * Frees the given object
+	 *
+	 * @param h the handle of the object
+	 */
+	static void free(const Handle &h);
+
+	/**
+	 * Copies <size> bytes from <src> into the given object
+	 *
+	 * @param h the handle of the object
+	 * @param src the source
+	 * @param size the number of bytes (<= the size of the object)
+	 */
+	static void write(const Handle &h,const void *src,size_t size) {
+		copy(h,const_cast<void*>(src),size,true);
+	}
+
+	/**
+	 * Copies <size> bytes from the given object into <dst>
+	 *
+	 * @param h the handle of the object
+	 * @param dst the destination
+	 * @param size the number of bytes (<= the size of the object)
+	 */
+	static void read(const Handle &h,void *dst,size_t size) {
+		copy(h,dst,size,false);
+	}
+
+	/**
+	 * Prints the pool
+	 *
+	 * @param os the output-stream
+	 */
+	static void print(OStream &os);
+
+private:
+	static size_t objSize(size_t cls) {
+		return (cls + 1) * CLASS_SIZE;
+	}
+	static size_t framesPerZsPage(size_t cls);
+	static size_t objsPerZsPage(size_t cls) {
+		return framesPerZsPage(cls) * PAGE_SIZE / objSize(cls);
+	}
+	static ZsPage *createZsPage(size_t cls);
+	static void destroyZsPage(ZsPage *zp);
+	static void append(ZsPage *zp);
+	static void remove(ZsPage *zp);
+	static void copy(const Handle &h,void *buf,size_t size,bool write);
+
+	static ZsPage *partial[];
+	static size_t limit;
+	static size_t frameCount;
+	static size_t objCount;
+	static SpinLock lock;
+};
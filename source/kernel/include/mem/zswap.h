@@ -0,0 +1,142 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <mem/zpool.h>
+#include <common.h>
+#include <spinlock.h>
+
+class OpenFile;
+class OStream;
+
+/**
+ * The compressed swap-cache. Swapped out pages are compressed and stored in the ZPool, if that is
+ * worth it. The pages are identified by their swap-block, i.e. they still have a block on the
+ * swap-device (if any), which is used if the page is written back. Without swap-device, the
+ * swap-blocks are purely virtual.
+ */
+class ZSwap {
+	ZSwap() = delete;
+
+	/* a compressed page that doesn't save at least this much is not stored */
+	static const size_t MAX_SIZE		= PAGE_SIZE * 3 / 4;
+	/* the percentage of the memory that may be used for the compressed pages */
+	static const size_t MAX_POOL_PERCENT	= 25;
+
+	static const ulong NONE				= (ulong)-1;
+
+	struct Entry {
+		ZPool::Handle handle;
+		/* the size of the compressed page; 0 = not in the pool */
+		size_t size;
+		/* the list of stored pages in the order in which they have been stored */
+		ulong prev;
+		ulong next;
+	};
+
+public:
+	/**
+	 * Inits the compressed swap-cache for the given number of swap-blocks
+	 *
+	 * @param blocks the number of swap-blocks
+	 * @return true on success
+	 */
+	static bool init(size_t blocks);
+
+	/**
+	 * @return true if the compressed swap-cache is used
+	 */
+	static bool isEnabled() {
+		return entries != NULL;
+	}
+
+	/**
+	 * Compresses the given page and stores it for the swap-block <block>.
+	 *
+	 * @param block the swap-block
+	 * @param page the content of the page
+	 * @param force whether to store the page uncompressed if it is not compressible enough
+	 * @return true if the page has been stored; false if it is not compressible enough or the
+	 *  pool is full
+	 */
+	static bool store(ulong block,const void *page,bool force);
+
+	/**
+	 * @param block the swap-block
+	 * @return true if the page of swap-block <block> is stored here
+	 */
+	static bool contains(ulong block) {
+		return entries && entries[block].size != 0;
+	}
+
+	/**
+	 * @return true if the last attempt to store a page failed because the pool was full
+	 */
+	static bool isFull() {
+		return full;
+	}
+
+	/**
+	 * Copies the page of swap-block <block> into <page>, if it is stored here. The page stays in
+	 * the cache until the block is free'd, because multiple regions might share the block.
+	 *
+	 * @param block the swap-block
+	 * @param page the destination
+	 * @return true if the page was stored here
+	 */
+	static bool load(ulong block,void *page);
+
+	/**
+	 * Removes the page of swap-block <block> from the cache, if present
+	 *
+	 * @param block the swap-block
+	 */
+	static void remove(ulong block);
+
+	/**
+	 * Writes back up to <count> of the least recently stored pages to the swap-device and removes
+	 * them from the cache.
+	 *
+	 * @param pid the process-id for writing to <file>
+	 * @param file the swap-device
+	 * @param count the max. number of pages
+	 * @return the number of written pages
+	 */
+	static size_t writeBack(pid_t pid,OpenFile *file,size_t count);
+
+	/**
+	 * Prints the compressed swap-cache
+	 *
+	 * @param os the output-stream
+	 */
+	static void print(OStream &os);
+
+private:
+	static void decompress(const Entry *e,void *page);
+	static void doRemove(ulong block);
+
+	static Entry *entries;
+	static bool full;
+	static ulong first;
+	static ulong last;
+	static size_t storedBytes;
+	static uint8_t buffer[];
+	static SpinLock lock;
+};
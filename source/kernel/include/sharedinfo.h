@@ -0,0 +1,71 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/sharedinfo.h>
+#include <common.h>
+
+/**
+ * Manages the page with system information that is mapped read-only into the processes that ask
+ * for it (see VirtMem::mapSharedInfo).
+ */
+class SharedInfo {
+	SharedInfo() = delete;
+
+public:
+	/**
+	 * Allocates and fills the page
+	 */
+	static void init();
+
+	/**
+	 * @return the frame of the page
+	 */
+	static frameno_t getFrame() {
+		return frame;
+	}
+
+	/**
+	 * Sets the time in microseconds since boot. This is only done if the time can't be derived
+	 * from the TSC.
+	 *
+	 * @param usecs the time in microseconds since boot
+	 */
+	static void setTimestamp(uint64_t usecs) {
+		if(info && info->tscPerUs == 0) {
+			beginUpdate();
+			info->timestamp = usecs;
+			endUpdate();
+		}
+	}
+
+private:
+	static void beginUpdate() {
+		info->seq++;
+		asm volatile ("" : : : "memory");
+	}
+	static void endUpdate() {
+		asm volatile ("" : : : "memory");
+		info->seq++;
+	}
+
+	static frameno_t frame;
+	static sSharedInfo *info;
+};
@@ -25,6 +25,7 @@
 #include <common.h>
 #include <interrupts.h>
 #include <string.h>
+#include <trace.h>
 
 #if defined(__i586__)
 #	include <arch/i586/syscalls.h>
@@ -67,9 +68,11 @@ public:
 #if PRINT_SYSCALLS
 		printEntry(t,stack);
 #endif
+		Trace::record(TRACE_SYSCALL_ENTER,t,sysCallNo,SYSC_ARG1(stack));
 
 		syscalls[sysCallNo].handler(t,stack);
 
+		Trace::record(TRACE_SYSCALL_EXIT,t,sysCallNo,SYSC_GETRET(stack));
 #if PRINT_SYSCALLS
 		printExit(t,stack);
 #endif
@@ -156,6 +159,7 @@ private:
 	static int fork(Thread *t,IntrptStackFrame *stack);
 	static int waitchild(Thread *t,IntrptStackFrame *stack);
 	static int exec(Thread *t,IntrptStackFrame *stack);
+	static int spawn(Thread *t,IntrptStackFrame *stack);
 
 	// signals
 	static int signal(Thread *t,IntrptStackFrame *stack);
@@ -169,12 +173,15 @@ private:
 	static int getcycles(Thread *t,IntrptStackFrame *stack);
 	static int alarm(Thread *t,IntrptStackFrame *stack);
 	static int sleep(Thread *t,IntrptStackFrame *stack);
+	static int usleep(Thread *t,IntrptStackFrame *stack);
 	static int yield(Thread *t,IntrptStackFrame *stack);
 	static int join(Thread *t,IntrptStackFrame *stack);
 	static int semcrt(Thread *t,IntrptStackFrame *stack);
 	static int semcrtirq(Thread *t,IntrptStackFrame *stack);
 	static int semop(Thread *t,IntrptStackFrame *stack);
 	static int semdestr(Thread *t,IntrptStackFrame *stack);
+	static int futexwait(Thread *t,IntrptStackFrame *stack);
+	static int futexwake(Thread *t,IntrptStackFrame *stack);
 
 	// other
 	static int init(Thread *t,IntrptStackFrame *stack);
@@ -62,6 +62,18 @@ public:
 	 */
 	static int clone(Proc *p);
 
+	/**
+	 * Remaps the file-descriptors of the new process <p>, which have been cloned from the current
+	 * process. That is, fd i of <p> will refer to the file of fd <fds>[i] of the current process or
+	 * will be closed, if <fds>[i] is -1. The file-descriptors >= <count> are left alone.
+	 *
+	 * @param p the new process
+	 * @param fds the file-descriptors of the current process
+	 * @param count the number of entries in <fds>
+	 * @return 0 on success
+	 */
+	static int remap(Proc *p,const int *fds,size_t count);
+
 	/**
 	 * Destroyes all file-descriptors of <p>
 	 *
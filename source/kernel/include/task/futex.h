@@ -0,0 +1,99 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <esc/col/dlist.h>
+#include <common.h>
+#include <spinlock.h>
+
+class Thread;
+
+/**
+ * Address-keyed waiting for user-space synchronization primitives. Threads block on a word in
+ * their address space until another thread wakes them up. Words in shareable regions are
+ * identified by their physical address, so that processes can synchronize via shared memory.
+ * All other words are identified by the address space and their virtual address, because their
+ * frame might change due to swapping or copy-on-write.
+ */
+class Futex {
+	Futex() = delete;
+
+	static const size_t BUCKET_COUNT	= 64;
+	static const int FAULT_TRIES		= 3;
+
+	struct Key {
+		bool operator==(const Key &k) const {
+			return space == k.space && addr == k.addr;
+		}
+
+		/* the address space for private words and 0 for shared ones */
+		uintptr_t space;
+		/* the virtual address for private words and the physical one for shared ones */
+		uintptr_t addr;
+	};
+
+	struct Waiter : public esc::DListItem {
+		explicit Waiter(Thread *t,const Key &key) : esc::DListItem(), thread(t), key(key), woken() {
+		}
+
+		Thread *thread;
+		Key key;
+		bool woken;
+	};
+
+	struct Bucket {
+		explicit Bucket() : lock(), waiters() {
+		}
+
+		SpinLock lock;
+		esc::DList<Waiter> waiters;
+	};
+
+public:
+	/**
+	 * Blocks the current thread as long as the word at <addr> contains <expected> and nobody called
+	 * wake() for it.
+	 *
+	 * @param addr the address of the word in user-space
+	 * @param expected the expected value
+	 * @param msecs the maximum number of milliseconds to wait (0 = unlimited)
+	 * @return 0 if woken up, -EWOULDBLOCK if the value did not match, -ETIMEOUT if the time is up,
+	 *  -EINTR if a signal arrived or -EFAULT if <addr> is invalid
+	 */
+	static int wait(USER int *addr,int expected,time_t msecs);
+
+	/**
+	 * Wakes up at most <count> threads that are waiting for the word at <addr>.
+	 *
+	 * @param addr the address of the word in user-space
+	 * @param count the maximum number of threads to wake up
+	 * @return the number of woken threads or -EFAULT if <addr> is invalid
+	 */
+	static int wake(USER int *addr,uint count);
+
+private:
+	static int getKey(USER int *addr,Key *key,frameno_t *frame);
+	static Bucket *getBucket(const Key &key) {
+		/* words are aligned, so skip the lower bits */
+		return buckets + (((key.addr / sizeof(int)) ^ key.space) * 0x9E3779B1UL) % BUCKET_COUNT;
+	}
+
+	static Bucket buckets[BUCKET_COUNT];
+};
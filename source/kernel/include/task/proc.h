@@ -35,12 +35,15 @@
 #include <common.h>
 #include <interrupts.h>
 #include <mutex.h>
+#include <semaphore.h>
 #include <spinlock.h>
 
 /* max number of coexistent processes */
 #define MAX_PROC_COUNT		8192
 #define MAX_FD_COUNT		1024
 #define MAX_SEM_COUNT		256
+/* max number of file-descriptors that can be remapped by spawn */
+#define SPAWN_MAX_FDS		32
 
 /* for marking unused */
 #define INVALID_PID			(MAX_PROC_COUNT + 1)
@@ -259,6 +262,23 @@ public:
 	 */
 	static int exec(const char *path,const char *const *args,USER const char *const *env);
 
+	/**
+	 * Creates a new process that executes the given program. In contrast to clone() and exec(),
+	 * the address-space of the current process is not cloned: the child starts with empty stacks
+	 * and loads the program immediately.
+	 *
+	 * @param path the path to the program
+	 * @param args the arguments
+	 * @param env the environment
+	 * @param fds if not NULL, fds[i] is the file-descriptor of the current process that becomes
+	 *  fd i in the child (-1 = closed). All other file-descriptors are inherited.
+	 * @param fdCount the number of entries in <fds>
+	 * @return < 0 if an error occurred or the child-pid. The call does not return before the child
+	 *  has loaded the program, so that errors during the load are reported as well.
+	 */
+	static int spawn(const char *path,USER const char *const *args,USER const char *const *env,
+		const int *fds,size_t fdCount);
+
 	/**
 	 * Waits until the thread with given thread-id or all other threads of the process are terminated.
 	 *
@@ -552,6 +572,19 @@ public:
 	void print(OStream &os) const;
 
 private:
+	/**
+	 * The state that is shared between spawn() and the child, which reports the result of the exec
+	 * back. Both hold a reference and the last one frees it.
+	 */
+	struct SpawnState {
+		explicit SpawnState() : done(0), res(), refs(2) {
+		}
+
+		Semaphore done;
+		int res;
+		volatile ulong refs;
+	};
+
 	/**
 	 * Initializes the architecture specific parts of the given process
 	 *
@@ -568,6 +601,30 @@ private:
 	 */
 	static void terminateArch(Proc *p);
 
+	/**
+	 * Clones the current process. If <spawn> is true, only the stack-regions are created (without
+	 * content) and the file-descriptors are remapped according to <fds>.
+	 */
+	static int doClone(uint8_t flags,bool spawn,const int *fds,size_t fdCount);
+
+	/**
+	 * Copies <args> and <env> into a newly allocated buffer, which is stored in <argBuffer>.
+	 */
+	static int buildArgBuffer(USER const char *const *args,USER const char *const *env,
+		char **argBuffer,int *argc,int *envc,size_t *argSize);
+
+	/**
+	 * Replaces the program of the current process with <path>. Takes ownership of <argBuffer>.
+	 * If <spawn> is not NULL, the result is reported to it.
+	 */
+	static int doExec(const char *path,int argc,int envc,char *argBuffer,size_t argSize,
+		SpawnState *spawn = NULL);
+
+	/**
+	 * Reports <res> to the waiting parent and drops the reference to <spawn>.
+	 */
+	static void finishSpawn(SpawnState *spawn,int res);
+
 	void initProps();
 	static void notifyProcDied(pid_t parent);
 	static int getExitState(pid_t ppid,pid_t pid,ExitState *state);
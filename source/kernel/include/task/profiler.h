@@ -0,0 +1,159 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/profile.h>
+#include <vfs/file.h>
+#include <common.h>
+#include <errno.h>
+#include <intrptstackframe.h>
+#include <spinlock.h>
+
+class Thread;
+
+/**
+ * A statistical profiler. While it is enabled, the timer interrupt records the interrupted
+ * program counter and a few return addresses into a ring buffer of the current CPU. The samples
+ * are read and the profiler is controlled via /sys/profile (see sys/profile.h).
+ */
+class Profiler {
+	Profiler() = delete;
+
+	/* the number of samples per CPU that are buffered until somebody reads them */
+	static const size_t RING_SIZE		= 1024;
+
+	struct Ring {
+		SpinLock lock;
+		uint64_t lastSample;
+		/* the number of written and read samples */
+		size_t head;
+		size_t tail;
+		sProfSample samples[RING_SIZE];
+	};
+
+	class ProfileFile : public VFSFile {
+	public:
+		explicit ProfileFile(pid_t pid,VFSNode *parent,bool &success)
+				: VFSFile(pid,parent,(char*)"profile",FILE_DEF_MODE,success) {
+		}
+
+		virtual ssize_t getSize(pid_t) override {
+			return Profiler::getCount() * sizeof(sProfSample);
+		}
+		virtual ssize_t read(pid_t pid,OpenFile *file,void *buffer,off_t offset,
+		                     size_t count) override;
+		virtual ssize_t write(pid_t pid,OpenFile *file,const void *buffer,off_t offset,
+		                      size_t count) override;
+		virtual int truncate(pid_t,off_t) override {
+			/* allow "echo start > /sys/profile" */
+			return 0;
+		}
+	};
+
+public:
+	/**
+	 * Creates the /sys/profile node
+	 *
+	 * @param sysNode the node of /sys
+	 */
+	static void init(VFSNode *sysNode);
+
+	/**
+	 * @return true if samples are taken
+	 */
+	static bool isEnabled() {
+		return enabled;
+	}
+
+	/**
+	 * @return the time between two samples in microseconds
+	 */
+	static uint64_t getInterval() {
+		return interval;
+	}
+
+	/**
+	 * Starts taking samples. With periodic timer interrupts, the frequency is limited by the
+	 * timer frequency.
+	 *
+	 * @param freq the number of samples per second and CPU
+	 * @return 0 on success
+	 */
+	static int start(uint freq);
+
+	/**
+	 * Stops taking samples. The buffered samples are kept.
+	 */
+	static void stop() {
+		enabled = false;
+	}
+
+	/**
+	 * Drops all buffered samples
+	 */
+	static void reset();
+
+	/**
+	 * Takes a sample for the given thread, if the interval has passed on the current CPU. Is
+	 * called by the timer interrupt.
+	 *
+	 * @param t the running thread
+	 * @param stack the interrupted state
+	 */
+	static void sample(Thread *t,const IntrptStackFrame *stack);
+
+	/**
+	 * @return the number of buffered samples
+	 */
+	static size_t getCount();
+
+	/**
+	 * Copies up to <count> buffered samples into <samples> without removing them. The positions
+	 * up to which the rings have been read are stored in <tails>, which has one entry per CPU.
+	 *
+	 * @param samples the array to write to
+	 * @param count the size of the array
+	 * @param tails the array of read positions
+	 * @return the number of samples
+	 */
+	static size_t peek(sProfSample *samples,size_t count,size_t *tails);
+
+	/**
+	 * Removes the samples that have been copied by peek().
+	 *
+	 * @param tails the read positions determined by peek()
+	 */
+	static void consume(const size_t *tails);
+
+private:
+	/**
+	 * Stores the interrupted program counter and the return addresses of its callers into <s>.
+	 * Is implemented by the architectures.
+	 *
+	 * @param t the running thread
+	 * @param stack the interrupted state
+	 * @param s the sample
+	 */
+	static void unwind(Thread *t,const IntrptStackFrame *stack,sProfSample *s);
+
+	static Ring *rings;
+	static volatile bool enabled;
+	static uint64_t interval;
+};
@@ -28,7 +28,6 @@
 #define IPI_FLUSH_TLB		52
 #define IPI_WAIT			53
 #define IPI_HALT			54
-#define IPI_FLUSH_TLB_ACK	55
 #define IPI_CALLBACK		56
 
 class Sched;
@@ -121,7 +120,7 @@ public:
 	static void haltOthers();
 
 	/**
-	 * Tells all other CPUs to flush their TLB and waits until they have done that
+	 * Waits until all other CPUs have performed the TLB-flushes that have been requested so far
 	 */
 	static void ensureTLBFlushed();
 
@@ -131,11 +130,14 @@ public:
 	static void wakeupCPU();
 
 	/**
-	 * If there is any CPU that uses the given pagedir, it is flushed
+	 * Requests all other CPUs that use the given pagedir to invalidate the TLB-entries for the
+	 * given range. Requests that have not been handled yet are merged.
 	 *
 	 * @param pdir the pagedir
+	 * @param virt the virtual address
+	 * @param count the number of pages
 	 */
-	static void flushTLB(PageDir *pdir);
+	static void flushTLB(PageDir *pdir,uintptr_t virt,size_t count);
 
 	/**
 	 * Calls the callback for CPU <id>
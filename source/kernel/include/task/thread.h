@@ -47,6 +47,9 @@
 #define INIT_TID				0
 #define ATA_TID					3
 
+/* the number of reserved frames to allocate/free at once */
+#define FRAME_BATCH_SIZE		32
+
 #define MAX_THREAD_COUNT		8192
 #define INVALID_TID				0xFFFF
 /* use an invalid tid to identify the kernel */
@@ -75,6 +78,7 @@ class ThreadBase : public esc::DListItem {
 	friend class Signals;
 	friend class Event;
 	friend class Terminator;
+	friend class TimerBase;
 
 	struct Stats {
 		/* number of microseconds of runtime this thread has got so far */
@@ -576,6 +580,9 @@ protected:
 	ThreadRegs saveArea;
 	ListItem threadListItem;
 	ListItem signalListItem;
+	/* our entries in the timer wheel; the one for alarms is allocated on demand */
+	TimerBase::Listener sleepListener;
+	TimerBase::Listener *alarmListener;
 	/* a list of currently requested frames, i.e. frames that are not free anymore, but were
 	 * reserved for this thread and have not yet been used */
 	esc::ISList<frameno_t> reqFrames;
@@ -662,9 +669,18 @@ inline frameno_t ThreadBase::getFrame() {
 }
 
 inline void ThreadBase::discardFrames() {
+	frameno_t frames[FRAME_BATCH_SIZE];
+	size_t count = 0;
 	frameno_t frm;
-	while((frm = reqFrames.removeFirst()) != 0)
-		PhysMem::free(frm,PhysMem::USR);
+	while((frm = reqFrames.removeFirst()) != 0) {
+		frames[count++] = frm;
+		if(count == ARRAY_SIZE(frames)) {
+			PhysMem::free(frames,count,PhysMem::USR);
+			count = 0;
+		}
+	}
+	if(count > 0)
+		PhysMem::free(frames,count,PhysMem::USR);
 }
 
 /**
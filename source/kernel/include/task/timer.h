@@ -19,35 +19,74 @@
 
 #pragma once
 
+#include <esc/col/dlist.h>
 #include <common.h>
 #include <spinlock.h>
 #include <time.h>
 
 class OStream;
+class Thread;
 
+/**
+ * The timer keeps track of the time and wakes up sleeping threads. The pending timeouts are
+ * managed in hierarchical timer wheels: level i has WHEEL_SLOTS slots, each covering
+ * WHEEL_SLOTS^i microseconds. Thus, inserting and removing a timeout is O(1) and the expired ones
+ * are found by looking at the slot bitmaps. If the architecture supports it, each CPU has its own
+ * wheel and the timer device is programmed for the next event instead of firing periodically.
+ */
 class TimerBase {
 	TimerBase() = delete;
 
-	/* an entry in the listener-list */
-	struct Listener {
-		tid_t tid;
-		/* difference to the previous listener */
-		time_t time;
+	static const size_t WHEEL_BITS			= 6;
+	static const size_t WHEEL_SLOTS			= 1 << WHEEL_BITS;
+	/* with 6 levels, the wheel covers 2^36 us (about 19 hours); the rest goes to the overflow list */
+	static const size_t WHEEL_LEVELS		= 6;
+
+public:
+	/* the deadline if no timer is pending */
+	static const uint64_t NO_DEADLINE		= ~0ULL;
+
+	/* an entry in the timer wheel; every thread has one for sleeping and one for alarms */
+	struct Listener : public esc::DListItem {
+		explicit Listener(Thread *t) : esc::DListItem(), thread(t), expiry(), cpu(), level(), slot(),
+			block(), active() {
+		}
+
+		Thread *thread;
+		/* the absolute time in microseconds */
+		uint64_t expiry;
+		/* the wheel we're in */
+		cpuid_t cpu;
+		/* the level and slot in the wheel (level = WHEEL_LEVELS means overflow list) */
+		uint8_t level;
+		uint8_t slot;
 		/* if true, the thread is blocked during that time. otherwise it can run and will not be waked
 		 * up, but gets a signal (SIGALRM) */
 		bool block;
-		Listener *next;
+		bool active;
+	};
+
+private:
+	/* note that the wheels are zero-initialized */
+	struct Wheel {
+		SpinLock lock;
+		/* all listeners that expire before <base> have been fired */
+		uint64_t base;
+		/* one bit per non-empty slot */
+		uint64_t occupied[WHEEL_LEVELS];
+		esc::DList<Listener> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+		esc::DList<Listener> overflow;
 	};
 
 	struct PerCPU {
-		/* total elapsed milliseconds */
-		time_t elapsedMsecs;
-		time_t lastResched;
+		Wheel wheel;
+		/* the time of the last thread-switch in microseconds */
+		uint64_t lastResched;
+		/* the time the timer device is programmed for */
+		uint64_t deadline;
 		size_t timerIntrpts;
 	};
 
-	static const size_t LISTENER_COUNT		= 1024;
-
 public:
 	/* timer period = 5ms */
 	static const unsigned FREQUENCY_DIV		= 200;
@@ -63,14 +102,22 @@ public:
 	 * @return the number of timer-interrupts so far
 	 */
 	static size_t getIntrptCount() {
-		return perCPU[0].timerIntrpts;
+		size_t total = 0;
+		for(size_t i = 0; i < cpuCount; ++i)
+			total += perCPU[i].timerIntrpts;
+		return total;
 	}
 
 	/**
-	 * @return the kernel-internal timestamp; starts from zero, in milliseconds, increased by timer-irq
+	 * @return the kernel-internal timestamp; starts from zero, in microseconds
+	 */
+	static uint64_t getTimestamp();
+
+	/**
+	 * @return the kernel-internal timestamp; starts from zero, in milliseconds
 	 */
 	static time_t getRuntime() {
-		return perCPU[0].elapsedMsecs;
+		return getTimestamp() / 1000;
 	}
 
 	/**
@@ -87,6 +134,16 @@ public:
 	 */
 	static void getTimeval(struct timeval *tv);
 
+	/**
+	 * Determines how the time can be derived from the cycle counter without entering the kernel.
+	 * That is, timestamp = (cycles - *cycleBase) / *cyclesPerUs.
+	 *
+	 * @param cyclesPerUs will be set to the cycles per microsecond (0 = not possible)
+	 * @param cycleBase will be set to the cycle counter value at timestamp 0
+	 * @param bootTime will be set to the UNIX timestamp at timestamp 0
+	 */
+	static void getTimeBase(uint64_t *cyclesPerUs,uint64_t *cycleBase,time_t *bootTime);
+
 	/**
 	 * @param cycles the number of cycles
 	 * @return the number of microseconds
@@ -108,7 +165,21 @@ public:
 	 *  SIGALRM)
 	 * @return 0 on success
 	 */
-	static int sleepFor(tid_t tid,time_t msecs,bool block);
+	static int sleepFor(tid_t tid,time_t msecs,bool block) {
+		return usleepFor(tid,(uint64_t)msecs * 1000,block);
+	}
+
+	/**
+	 * Puts the given thread to sleep for the given number of microseconds. Note that the actual
+	 * resolution depends on the timer device; with a periodic timer, it is the timer period.
+	 *
+	 * @param tid the thread-id
+	 * @param usecs the number of microseconds to wait
+	 * @param block whether to block the thread or not (if so, it will be waked up, otherwise it gets
+	 *  SIGALRM)
+	 * @return 0 on success
+	 */
+	static int usleepFor(tid_t tid,uint64_t usecs,bool block);
 
 	/**
 	 * Removes the given thread from the timer
@@ -117,6 +188,14 @@ public:
 	 */
 	static void removeThread(tid_t tid);
 
+	/**
+	 * Removes the sleep (<block> = true) or the alarm (<block> = false) of the given thread
+	 *
+	 * @param tid the thread-id
+	 * @param block whether to remove the sleep or the alarm
+	 */
+	static void removeThread(tid_t tid,bool block);
+
 	/**
 	 * Handles a timer-interrupt
 	 *
@@ -131,19 +210,35 @@ public:
 	 */
 	static void print(OStream &os);
 
+	/**
+	 * Is called if the given CPU switches to thread <t>. Starts the time-slice of <t>.
+	 *
+	 * @param cpu the cpu
+	 * @param t the new thread
+	 */
+	static void switchTo(cpuid_t cpu,const Thread *t);
+
 private:
 	/**
 	 * Inits the architecture-dependent part of the timer
 	 */
 	static void archInit();
 
-	static SpinLock lock;
+	static cpuid_t getWheelId(cpuid_t cpu);
+	static Listener *getListener(Thread *t,bool block,bool create);
+	static void removeListener(Listener *l);
+	static void insert(Wheel *w,Listener *l);
+	static void remove(Wheel *w,Listener *l);
+	static bool advance(Wheel *w,uint64_t now);
+	static bool fire(Listener *l);
+	static uint64_t nextExpiry(const Wheel *w);
+	static void reprogram(cpuid_t cpu,uint64_t now,const Thread *t);
+
 	static PerCPU *perCPU;
-	static time_t lastRuntimeUpdate;
-	static Listener listenObjs[LISTENER_COUNT];
-	static Listener *freeList;
-	/* processes that should be waked up to a specified time */
-	static Listener *listener;
+	static size_t cpuCount;
+	static uint64_t lastRuntimeUpdate;
+	/* the time in microseconds, for architectures that count timer-interrupts */
+	static uint64_t tickTime;
 };
 
 #if defined(__x86__)
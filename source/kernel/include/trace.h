@@ -0,0 +1,150 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/trace.h>
+#include <vfs/file.h>
+#include <common.h>
+#include <errno.h>
+#include <spinlock.h>
+
+class Thread;
+
+/**
+ * Static tracepoints. While an event is enabled, its tracepoint writes a fixed-size record into
+ * the ring buffer of the current CPU. Since the kernel runs with interrupts disabled, the CPU is
+ * the only writer of its ring and doesn't need a lock. Readers copy the records and discard the
+ * ones that have been overwritten in the meantime. The records are read and the tracing is
+ * controlled via /sys/trace (see sys/trace.h).
+ */
+class Trace {
+	Trace() = delete;
+
+	/* the number of records per CPU that are buffered until somebody reads them */
+	static const size_t RING_SIZE		= 4096;
+
+	struct Ring {
+		/* the number of written records; only changed by the owning CPU */
+		volatile size_t head;
+		/* the number of read records; protected by readLock */
+		size_t tail;
+		sTraceRecord records[RING_SIZE];
+	};
+
+	class TraceFile : public VFSFile {
+	public:
+		explicit TraceFile(pid_t pid,VFSNode *parent,bool &success)
+				: VFSFile(pid,parent,(char*)"trace",FILE_DEF_MODE,success) {
+		}
+
+		virtual ssize_t getSize(pid_t) override {
+			return Trace::getCount() * sizeof(sTraceRecord);
+		}
+		virtual ssize_t read(pid_t pid,OpenFile *file,void *buffer,off_t offset,
+		                     size_t count) override;
+		virtual ssize_t write(pid_t pid,OpenFile *file,const void *buffer,off_t offset,
+		                      size_t count) override;
+		virtual int truncate(pid_t,off_t) override {
+			/* allow "echo start > /sys/trace" */
+			return 0;
+		}
+	};
+
+public:
+	/**
+	 * Creates the /sys/trace node
+	 *
+	 * @param sysNode the node of /sys
+	 */
+	static void init(VFSNode *sysNode);
+
+	/**
+	 * Records the given event for <t>, if it is enabled.
+	 *
+	 * @param event the event (TRACE_*)
+	 * @param t the running thread
+	 * @param arg1 the first argument (depends on the event)
+	 * @param arg2 the second argument (depends on the event)
+	 */
+	static void record(uint event,const Thread *t,ulong arg1,ulong arg2) {
+		if(EXPECT_FALSE(mask & TRACE_MASK(event)))
+			doRecord(event,t,arg1,arg2);
+	}
+
+	/**
+	 * Enables the given events
+	 *
+	 * @param events the mask of events (TRACE_MASK)
+	 * @return 0 on success
+	 */
+	static int start(uint events);
+
+	/**
+	 * Disables all events. The buffered records are kept.
+	 */
+	static void stop() {
+		mask = 0;
+	}
+
+	/**
+	 * Records only the events of the given process
+	 *
+	 * @param pid the process-id or INVALID_PID for all processes
+	 */
+	static void setFilter(pid_t pid) {
+		filterPid = pid;
+	}
+
+	/**
+	 * Drops all buffered records
+	 */
+	static void reset();
+
+	/**
+	 * @return the number of buffered records
+	 */
+	static size_t getCount();
+
+	/**
+	 * Copies up to <count> buffered records into <records> without removing them. The positions
+	 * up to which the rings have been read are stored in <tails>, which has one entry per CPU.
+	 *
+	 * @param records the array to write to
+	 * @param count the size of the array
+	 * @param tails the array of read positions
+	 * @return the number of records
+	 */
+	static size_t peek(sTraceRecord *records,size_t count,size_t *tails);
+
+	/**
+	 * Removes the records that have been copied by peek().
+	 *
+	 * @param tails the read positions determined by peek()
+	 */
+	static void consume(const size_t *tails);
+
+private:
+	static void doRecord(uint event,const Thread *t,ulong arg1,ulong arg2);
+
+	static Ring *rings;
+	static SpinLock readLock;
+	static volatile uint mask;
+	static volatile pid_t filterPid;
+};
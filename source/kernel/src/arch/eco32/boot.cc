@@ -21,6 +21,7 @@
 #include <mem/copyonwrite.h>
 #include <mem/dynarray.h>
 #include <mem/pagedir.h>
+#include <mem/physmem.h>
 #include <mem/virtmem.h>
 #include <task/elf.h>
 #include <task/proc.h>
@@ -37,6 +38,7 @@
 #include <common.h>
 #include <config.h>
 #include <log.h>
+#include <sharedinfo.h>
 #include <string.h>
 #include <util.h>
 #include <video.h>
@@ -49,7 +51,9 @@ static const BootTask tasks[] = {
 	{"Preinit processes...",Proc::preinit},
 	{"Initializing dynarray...",DynArray::init},
 	{"Initializing SMP...",SMP::init},
+	{"Initializing frame caches...",PhysMem::initCaches},
 	{"Initializing timer...",Timer::init},
+	{"Initializing shared info page...",SharedInfo::init},
 	{"Initializing VFS...",VFS::init},
 	{"Initializing processes...",Proc::init},
 	{"Initializing scheduler...",Sched::init},
@@ -23,6 +23,7 @@
 #include <mem/virtmem.h>
 #include <sys/keycodes.h>
 #include <task/proc.h>
+#include <task/profiler.h>
 #include <task/signals.h>
 #include <task/timer.h>
 #include <task/uenv.h>
@@ -30,6 +31,7 @@
 #include <cpu.h>
 #include <interrupts.h>
 #include <syscalls.h>
+#include <trace.h>
 #include <util.h>
 #include <video.h>
 
@@ -101,7 +103,13 @@ void InterruptsBase::handler(IntrptStackFrame *stack) {
 	/* call handler */
 	intrpt = Interrupts::intrptList + (stack->irqNo & 0x1F);
 	intrpt->count++;
+	/* the first 16 are device interrupts; exceptions and traps have their own tracepoints */
+	bool isIRQ = (stack->irqNo & 0x1F) < 0x10;
+	if(isIRQ)
+		Trace::record(TRACE_IRQ_ENTER,t,stack->irqNo & 0x1F,0);
 	intrpt->handler(t,stack);
+	if(isIRQ)
+		Trace::record(TRACE_IRQ_EXIT,Thread::getRunning(),stack->irqNo & 0x1F,0);
 
 	/* only handle signals, if we come directly from user-mode */
 	/* note: we might get a kernel-miss at arbitrary places in the kernel; if we checked for
@@ -162,6 +170,8 @@ void Interrupts::exPageFault(A_UNUSED Thread *t,IntrptStackFrame *stack) {
 }
 
 void Interrupts::irqTimer(Thread *t,IntrptStackFrame *stack) {
+	if(Profiler::isEnabled())
+		Profiler::sample(t,stack);
 	bool res = fireIrq(stack->irqNo);
 	res |= Timer::intrpt();
 	Timer::ackIntrpt();
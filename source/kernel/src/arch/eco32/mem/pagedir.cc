@@ -62,7 +62,7 @@ int PageDirBase::mapToCur(uintptr_t virt,size_t count,PageTables::Allocator &all
 }
 
 void PageDirBase::unmapFromCur(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
-	Proc::getCurPageDir()->unmap(virt,count,alloc);
+	sassert(Proc::getCurPageDir()->unmap(virt,count,alloc) == 0);
 }
 
 int PageDirBase::cloneKernelspace(PageDir *pdir,A_UNUSED tid_t tid) {
@@ -145,8 +145,6 @@ void ThreadBase::doSwitch() {
 	if(EXPECT_TRUE(n->getTid() != old->getTid())) {
 		if(!Thread::save(&old->saveArea)) {
 			setRunning(n);
-			if(EXPECT_FALSE(PhysMem::shouldSetRegTimestamp()))
-				VirtMem::setTimestamp(n,cycles);
 
 			SMP::schedule(n->getCPU(),n,cycles);
 			n->stats.cycleStart = CPU::rdtsc();
@@ -22,6 +22,7 @@
 #include <mem/copyonwrite.h>
 #include <mem/dynarray.h>
 #include <mem/pagedir.h>
+#include <mem/physmem.h>
 #include <mem/virtmem.h>
 #include <task/elf.h>
 #include <task/proc.h>
@@ -39,6 +40,7 @@
 #include <config.h>
 #include <cpu.h>
 #include <log.h>
+#include <sharedinfo.h>
 #include <string.h>
 #include <util.h>
 #include <video.h>
@@ -52,7 +54,9 @@ static const BootTask tasks[] = {
 	{"Preinit processes...",Proc::preinit},
 	{"Initializing dynarray...",DynArray::init},
 	{"Initializing SMP...",SMP::init},
+	{"Initializing frame caches...",PhysMem::initCaches},
 	{"Initializing timer...",Timer::init},
+	{"Initializing shared info page...",SharedInfo::init},
 	{"Initializing VFS...",VFS::init},
 	{"Initializing processes...",Proc::init},
 	{"Initializing scheduler...",Sched::init},
@@ -173,7 +173,7 @@ int PageDirBase::clone(PageDir *dst,uintptr_t virtSrc,uintptr_t virtDst,size_t c
 
 error:
 	/* unmap from dest-pagedir; the frames are always owned by src */
-	dst->unmap(orgVirtDst,orgCount - count,alloc);
+	sassert(dst->unmap(orgVirtDst,orgCount - count,alloc) == 0);
 	/* make the cow-pages writable again */
 	spt = NULL;
 	srcPageNo = PAGE_NO(orgVirtSrc);
@@ -258,18 +258,20 @@ int PageDirBase::map(uintptr_t virt,size_t count,PageTables::Allocator &alloc,ui
 	return 0;
 
 error:
-	pdir->unmap(orgVirt,orgCount - count,alloc);
+	sassert(pdir->unmap(orgVirt,orgCount - count,alloc) == 0);
 	return -ENOMEM;
 }
 
 void PageDirBase::unmapFromCur(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
-	Proc::getCurPageDir()->unmap(virt,count,alloc);
+	sassert(Proc::getCurPageDir()->unmap(virt,count,alloc) == 0);
 }
 
-void PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
+int PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
 	PageDir *pdir = static_cast<PageDir*>(this);
 	ulong pageNo = PAGE_NO(virt);
 	uint64_t pte,*pt = NULL;
+	/* the allocator might have been used before */
+	int pts = alloc.pageTables();
 	virt &= ~(PAGE_SIZE - 1);
 	while(count-- > 0) {
 		/* get page-table */
@@ -294,7 +296,8 @@ void PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc
 	/* check if the last changed pagetable is empty (pt is NULL if no pages have been unmapped) */
 	if(pt)
 		pdir->remEmptyPts(virt - PAGE_SIZE,alloc);
-	pdir->ptables -= alloc.pageTables();
+	pdir->ptables += alloc.pageTables() - pts;
+	return 0;
 }
 
 uint64_t *PageDir::getPT(uintptr_t virt,bool create,PageTables::Allocator &alloc) const {
@@ -30,6 +30,7 @@
 #include <mem/copyonwrite.h>
 #include <mem/dynarray.h>
 #include <mem/pagedir.h>
+#include <mem/physmem.h>
 #include <mem/physmemareas.h>
 #include <mem/virtmem.h>
 #include <task/elf.h>
@@ -52,6 +53,7 @@
 #include <cpu.h>
 #include <errno.h>
 #include <log.h>
+#include <sharedinfo.h>
 #include <string.h>
 #include <util.h>
 #include <video.h>
@@ -70,12 +72,15 @@ static const BootTask tasks[] = {
 	{"Initializing LAPIC...",LAPIC::init},
 	{"Initializing ACPI...",ACPI::init},
 	{"Initializing SMP...",SMP::init},
+	{"Initializing frame caches...",PhysMem::initCaches},
 	{"Initializing GDT for BSP...",GDT::initBSP},
 	{"Initializing CPU...",CPU::detect},
+	{"Initializing PCIDs...",PageDir::initPCID},
 	{"Initializing MTRRs...",MTRR::init},
 	{"Initializing FPU...",FPU::init},
 	{"Initializing RTC...",RTC::init},
 	{"Initializing timer...",Timer::init},
+	{"Initializing shared info page...",SharedInfo::init},
 	{"Initializing VFS...",VFS::init},
 	{"Initializing processes...",Proc::init},
 	{"Creating ACPI files...",ACPI::createFiles},
@@ -27,17 +27,55 @@
 #include <util.h>
 #include <video.h>
 
+/* the size of the state saved by fnsave and fxsave */
+static const size_t FSAVE_SIZE		= 108;
+static const size_t FXSAVE_SIZE		= 512;
+
+/* the offsets of the control words in the fxsave area and their values after reset */
+static const size_t FXSAVE_FCW		= 0;
+static const size_t FXSAVE_MXCSR	= 24;
+static const uint16_t FCW_INIT		= 0x37F;
+static const uint32_t MXCSR_INIT	= 0x1F80;
+
+FPU::Mode FPU::mode = MODE_FSAVE;
+size_t FPU::stateSize = FSAVE_SIZE;
 /* current FPU state-memory */
-FPU::XState ***FPU::curStates = NULL;
+FPU::Context **FPU::curStates = NULL;
 
 void FPU::init() {
-	/* TODO check whether we have a FPU/SSE/... */
+	if(!CPU::hasFeature(CPU::BASIC,CPU::FEAT_FPU))
+		Util::panic("This kernel requires a FPU");
+
+	uint32_t maxLeaf,eax,ebx,ecx,edx;
+	CPU::cpuid(0,&maxLeaf,&ebx,&ecx,&edx);
 
 	ulong cr4 = CPU::getCR4();
-	cr4 |= CPU::CR4_OSFXSR;
-	cr4 |= CPU::CR4_OSXMMEXCPT;
+	if(CPU::hasFeature(CPU::BASIC,CPU::FEAT_FXSR)) {
+		cr4 |= CPU::CR4_OSFXSR;
+		if(CPU::hasFeature(CPU::BASIC,CPU::FEAT_SSE))
+			cr4 |= CPU::CR4_OSXMMEXCPT;
+		mode = MODE_FXSAVE;
+		stateSize = FXSAVE_SIZE;
+	}
+	if(maxLeaf >= CPU::CPUID_XSTATE && CPU::hasFeature(CPU::BASIC,CPU::FEAT_XSAVE))
+		cr4 |= CPU::CR4_OSXSAVE;
 	CPU::setCR4(cr4);
 
+	if(cr4 & CPU::CR4_OSXSAVE) {
+		/* enable all components we know how to deal with */
+		CPU::cpuid(CPU::CPUID_XSTATE,0,&eax,&ebx,&ecx,&edx);
+		uint64_t xcr0 = XCR0_X87 | XCR0_SSE;
+		if(CPU::hasFeature(CPU::BASIC,CPU::FEAT_AVX) && (eax & XCR0_AVX))
+			xcr0 |= XCR0_AVX;
+		CPU::setXCR(0,xcr0);
+
+		/* ebx contains the size for the components enabled in XCR0 */
+		CPU::cpuid(CPU::CPUID_XSTATE,0,&eax,&ebx,&ecx,&edx);
+		stateSize = ebx;
+		CPU::cpuid(CPU::CPUID_XSTATE,1,&eax,&ebx,&ecx,&edx);
+		mode = (eax & 0x1) ? MODE_XSAVEOPT : MODE_XSAVE;
+	}
+
 	ulong cr0 = CPU::getCR0();
 	/* enable coprocessor monitoring */
 	cr0 |= CPU::CR0_MONITOR_COPROC;
@@ -50,65 +88,115 @@ void FPU::init() {
 
 	/* allocate a state-pointer for each cpu (do that just once) */
 	if(!curStates) {
-		curStates = (XState***)Cache::calloc(SMP::getCPUCount(),sizeof(XState**));
+		curStates = (Context**)Cache::calloc(SMP::getCPUCount(),sizeof(Context*));
 		if(!curStates)
 			Util::panic("Unable to allocate memory for FPU-states");
 	}
 }
 
-void FPU::handleCoProcNA(XState **state) {
-	Thread *t = Thread::getRunning();
-	XState **current = curStates[t->getCPU()];
-	if(current != state) {
-		/* if any process has used the FPU in the past */
-		if(current != NULL) {
-			/* do we have to allocate space for the state? */
-			if(*current == NULL) {
-				*current = (XState*)Cache::alloc(sizeof(XState));
-				/* if we can't save the state, don't unlock the FPU for another process */
-				/* TODO ok? */
-				if(*current == NULL)
-					return;
+bool FPU::allocState(Context *ctx) {
+	/* XRSTOR requires a zeroed header, so use calloc */
+	ctx->mem = Cache::calloc(1,stateSize + STATE_ALIGN - 1);
+	if(ctx->mem == NULL)
+		return false;
+	ctx->state = (XState*)(((uintptr_t)ctx->mem + STATE_ALIGN - 1) & ~(STATE_ALIGN - 1));
+	return true;
+}
+
+void FPU::initState(XState *state) {
+	/* the state is zeroed, including the XSAVE header. thus, XSTATE_BV is 0 and xrstor puts all
+	 * components into their init state. fxrstor loads the zeros into the registers, so that we
+	 * only have to set the control words (a zero in the abridged tag word means empty). xrstor
+	 * loads MXCSR regardless of XSTATE_BV, so it needs to be valid in both cases. */
+	uint8_t *bytes = reinterpret_cast<uint8_t*>(state);
+	*reinterpret_cast<uint16_t*>(bytes + FXSAVE_FCW) = FCW_INIT;
+	*reinterpret_cast<uint32_t*>(bytes + FXSAVE_MXCSR) = MXCSR_INIT;
+}
+
+bool FPU::acquire(Context *ctx,cpuid_t cpu) {
+	/* the state is saved when the thread is switched away. thus, we only need to load it, if
+	 * the FPU contains something else */
+	if(curStates[cpu] != ctx || ctx->cpu != cpu) {
+		/* if we can't save the state later, don't unlock the FPU */
+		bool first = ctx->state == NULL;
+		if(first && !allocState(ctx))
+			return false;
+
+		unlockFPU();
+		if(first) {
+			/* start with a clean state. fninit doesn't touch the SSE/AVX registers, so that
+			 * we would inherit them from the previous owner. */
+			if(mode == MODE_FSAVE) {
+				finit();
+				save(ctx->state);
+			}
+			else {
+				initState(ctx->state);
+				restore(ctx->state);
 			}
-			/* unlock FPU (necessary here because otherwise fpu_saveState would cause a #NM) */
-			CPU::setCR0(CPU::getCR0() & ~CPU::CR0_TASK_SWITCHED);
-			/* save state */
-			fsave(*current);
 		}
 		else
-			CPU::setCR0(CPU::getCR0() & ~CPU::CR0_TASK_SWITCHED);
-
-		/* init FPU for new process */
-		curStates[t->getCPU()] = state;
-		if(*state != NULL)
-			frestore(*state);
-		else
-			finit();
+			restore(ctx->state);
+		curStates[cpu] = ctx;
+		ctx->cpu = cpu;
 	}
-	/* just unlock */
 	else
-		CPU::setCR0(CPU::getCR0() & ~CPU::CR0_TASK_SWITCHED);
+		unlockFPU();
+	return true;
 }
 
-void FPU::cloneState(XState **dst,const XState *src) {
-	if(src != NULL) {
-		*dst = (XState*)Cache::alloc(sizeof(XState));
-		/* simply ignore it here if alloc fails */
-		if(*dst)
-			memcpy(*dst,src,sizeof(XState));
+void FPU::switchTo(Context *old,Context *ctx,cpuid_t cpu) {
+	/* if the FPU is unlocked, the old thread has used it */
+	if(old && isUnlocked() && curStates[cpu] == old)
+		save(old->state);
+
+	if(ctx->streak >= EAGER_THRESHOLD) {
+		/* the counter wraps around after a while. this way, we'll notice if the thread doesn't
+		 * use the FPU anymore */
+		ctx->streak++;
+		if(acquire(ctx,cpu))
+			return;
+	}
+	else {
+		if(!ctx->used)
+			ctx->streak = 0;
+		ctx->used = false;
+	}
+	lockFPU();
+}
+
+void FPU::handleCoProcNA(Context *ctx,cpuid_t cpu) {
+	if(!ctx->used) {
+		ctx->used = true;
+		ctx->streak++;
+	}
+	acquire(ctx,cpu);
+}
+
+void FPU::cloneState(Context *dst,const Context *src,cpuid_t cpu) {
+	*dst = Context();
+	if(src->state == NULL)
+		return;
+
+	/* simply ignore it here if alloc fails */
+	if(allocState(dst)) {
+		/* if <src> has used the FPU in this time slice, the saved state is outdated */
+		if(isUnlocked() && curStates[cpu] == src)
+			save(dst->state);
+		else
+			memcpy(dst->state,src->state,stateSize);
 	}
-	else
-		*dst = NULL;
 }
 
-void FPU::freeState(XState **state) {
-	if(*state != NULL)
-		Cache::free(*state);
-	*state = NULL;
+void FPU::freeState(Context *ctx) {
+	if(ctx->mem != NULL)
+		Cache::free(ctx->mem);
+	ctx->mem = NULL;
+	ctx->state = NULL;
 	/* we have to unset the current state because maybe the next created process gets
 	 * the same slot, so that the pointer is the same. */
 	for(size_t i = 0, n = SMP::getCPUCount(); i < n; i++) {
-		if(curStates[i] == state)
+		if(curStates[i] == ctx)
 			curStates[i] = NULL;
 	}
 }
@@ -79,7 +79,6 @@ EXTERN_C void isr51();
 EXTERN_C void isr52();
 EXTERN_C void isr53();
 EXTERN_C void isr54();
-EXTERN_C void isr55();
 EXTERN_C void isr56();
 /* the handler for a other interrupts */
 EXTERN_C void isrNull();
@@ -157,7 +156,7 @@ void IDT::init() {
 	set(52,isr52,Desc::DPL_KERNEL);
 	set(53,isr53,Desc::DPL_KERNEL);
 	set(54,isr54,Desc::DPL_KERNEL);
-	set(55,isr55,Desc::DPL_KERNEL);
+	set(55,isrNull,Desc::DPL_KERNEL);
 	set(56,isr56,Desc::DPL_KERNEL);
 
 	/* all other interrupts */
@@ -28,6 +28,7 @@
 #include <mem/virtmem.h>
 #include <sys/keycodes.h>
 #include <sys/syscalls.h>
+#include <task/profiler.h>
 #include <task/signals.h>
 #include <task/smp.h>
 #include <task/thread.h>
@@ -38,6 +39,7 @@
 #include <cpu.h>
 #include <interrupts.h>
 #include <syscalls.h>
+#include <trace.h>
 #include <util.h>
 #include <video.h>
 
@@ -99,11 +101,11 @@ InterruptsBase::Interrupt InterruptsBase::intrptList[] = {
 	/* 0x31 */	{Syscalls::handle,			"Ack-Signal",			0},
 	/* 0x32 */	{Interrupts::irqTimer,		"LAPIC",				0},
 	/* 0x33 */	{Interrupts::ipiWork,		"Work IPI",				0},
-	/* 0x34 */	{NULL,						"??",					0},
-	/* 0x35 */	{NULL,						"??",					0},	// Flush TLB
-	/* 0x36 */	{NULL,						"??",					0},	// Wait
-	/* 0x37 */	{NULL,						"??",					0},	// Halt
-	/* 0x38 */	{NULL,						"??",					0},	// Flush TLB-Ack
+	/* 0x34 */	{Interrupts::ipiFlushTLB,	"Flush TLB IPI",		0},
+	/* 0x35 */	{NULL,						"??",					0},	// Wait
+	/* 0x36 */	{NULL,						"??",					0},	// Halt
+	/* 0x37 */	{NULL,						"??",					0},
+	/* 0x38 */	{NULL,						"??",					0},
 	/* 0x39 */	{Interrupts::ipiCallback,	"IPI Callback",			0},
 	/* 0x3A */	{Interrupts::exFatal,		"??",					0},
 };
@@ -193,6 +195,11 @@ void InterruptsBase::handler(IntrptStackFrame *stack) {
 
 	intrpt = Interrupts::intrptList + stack->intrptNo;
 	intrpt->count++;
+	/* exceptions and syscalls have their own tracepoints */
+	bool isIRQ = stack->intrptNo >= Interrupts::IRQ_MASTER_BASE &&
+		intrpt->handler != Interrupts::debug && intrpt->handler != Syscalls::handle;
+	if(isIRQ)
+		Trace::record(TRACE_IRQ_ENTER,t,stack->intrptNo,0);
 	if(EXPECT_TRUE(intrpt->handler))
 		intrpt->handler(t,stack);
 	else {
@@ -200,6 +207,8 @@ void InterruptsBase::handler(IntrptStackFrame *stack) {
 				intrpt->name,stack->getIP(),t->getProc()->getPid(),t->getProc()->getProgram());
 		Interrupts::eoi(stack->intrptNo);
 	}
+	if(isIRQ)
+		Trace::record(TRACE_IRQ_EXIT,Thread::getRunning(),stack->intrptNo,0);
 
 	/* handle signal */
 	t = Thread::getRunning();
@@ -252,7 +261,7 @@ void Interrupts::exSStep(A_UNUSED Thread *t,A_UNUSED IntrptStackFrame *stack) {
 }
 
 void Interrupts::exCoProcNA(Thread *t,A_UNUSED IntrptStackFrame *stack) {
-	FPU::handleCoProcNA(t->getFPUState());
+	FPU::handleCoProcNA(t->getFPUContext(),t->getCPU());
 }
 
 void Interrupts::exPF(Thread *t,IntrptStackFrame *stack) {
@@ -304,7 +313,9 @@ void Interrupts::exPF(Thread *t,IntrptStackFrame *stack) {
 #endif
 }
 
-void Interrupts::irqTimer(A_UNUSED Thread *t,IntrptStackFrame *stack) {
+void Interrupts::irqTimer(Thread *t,IntrptStackFrame *stack) {
+	if(Profiler::isEnabled())
+		Profiler::sample(t,stack);
 	bool res = Timer::intrpt();
 	eoi(stack->intrptNo);
 	if(res)
@@ -344,6 +355,11 @@ void Interrupts::ipiWork(Thread *t,A_UNUSED IntrptStackFrame *stack) {
 		Thread::switchAway();
 }
 
+void Interrupts::ipiFlushTLB(Thread *t,A_UNUSED IntrptStackFrame *stack) {
+	SMP::flushPending(t->getCPU(),t->getProc()->getPageDir());
+	LAPIC::eoi();
+}
+
 void Interrupts::ipiCallback(Thread *t,A_UNUSED IntrptStackFrame *stack) {
 	SMP::callback(t->getCPU());
 	LAPIC::eoi();
@@ -49,6 +49,13 @@ void LAPIC::enableTimer() {
 	setLVT(REG_LVT_TIMER,Interrupts::IRQ_LAPIC,ICR_DELMODE_FIXED,UNMASKED,MODE_PERIODIC);
 }
 
+void LAPIC::enableOneshotTimer(bool tscDeadline) {
+	/* don't fire until the first deadline is set */
+	setTimer(0);
+	setLVT(REG_LVT_TIMER,Interrupts::IRQ_LAPIC,ICR_DELMODE_FIXED,UNMASKED,
+		tscDeadline ? MODE_TSCDEADLINE : MODE_ONESHOT);
+}
+
 void LAPIC::writeIPI(uint32_t high,uint32_t low) {
 	while((read(REG_ICR_LOW) & ICR_DELSTAT_PENDING))
 		CPU::pause();
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <mem/cache.h>
 #include <mem/pagedir.h>
 #include <task/proc.h>
 #include <task/smp.h>
@@ -26,6 +27,10 @@
 
 extern void *proc0TLPD;
 uintptr_t PageDir::freeAreaAddr = KFREE_AREA;
+ulong PageDir::nextUid = 0;
+#if defined(__x86_64__)
+PageDir::CPUPCIDs *PageDir::pcids = NULL;
+#endif
 
 /* Note that we only need a lock for the temp-page here, because everything else is not shared
  * among different modules. First, the only critical state here are the page-tables. They are
@@ -45,7 +50,7 @@ int PageDirBase::mapToCur(uintptr_t virt,size_t count,PageTables::Allocator &all
 }
 
 void PageDirBase::unmapFromCur(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
-	Proc::getCurPageDir()->unmap(virt,count,alloc);
+	sassert(Proc::getCurPageDir()->unmap(virt,count,alloc) == 0);
 }
 
 void PageDirBase::makeFirst() {
@@ -53,6 +58,63 @@ void PageDirBase::makeFirst() {
 	pdir->pts.setRoot((pte_t)&proc0TLPD & ~KERNEL_AREA);
 	pdir->freeKStack = KSTACK_AREA;
 	pdir->lock = SpinLock();
+	pdir->cpuMask = 1;
+}
+
+void PageDir::initPCID() {
+#if defined(__x86_64__)
+	if(!CPU::hasFeature(CPU::INTEL,CPU::FEAT_PCID))
+		return;
+	if(!pcids) {
+		pcids = (CPUPCIDs*)Cache::calloc(SMP::getCPUCount(),sizeof(CPUPCIDs));
+		if(!pcids)
+			return;
+	}
+	/* the boot page-directory is loaded with PCID 0, which is required to set PCIDE */
+	CPU::setCR4(CPU::getCR4() | CPU::CR4_PCIDE);
+	pcids[SMP::getCurId()].enabled = true;
+#endif
+}
+
+uintptr_t PageDir::activate(PageDir *old,cpuid_t cpu) {
+	ulong bit = cpu < sizeof(cpuMask) * 8 ? 1UL << cpu : 0;
+	if(old)
+		Atomic::fetch_and_and(&old->cpuMask,~bit);
+	/* announce us before reading the generation. either a concurrent shootdown sees our bit and
+	 * sends us an IPI or we see its generation */
+	Atomic::fetch_and_or(&cpuMask,bit);
+
+	uintptr_t cr3 = pts.getRoot();
+#if defined(__x86_64__)
+	if(pcids && pcids[cpu].enabled) {
+		CPUPCIDs *c = pcids + cpu;
+		ulong gen = tlbGen;
+		size_t i;
+		for(i = 0; i < PCID_COUNT; ++i) {
+			if(c->slots[i].uid == uid)
+				break;
+		}
+		if(i < PCID_COUNT && c->slots[i].gen == gen)
+			return cr3 | (i + 1) | CR3_NOFLUSH;
+
+		/* take over the oldest slot, if we have none yet. loading CR3 without NOFLUSH drops all
+		 * entries that are still tagged with this PCID */
+		if(i == PCID_COUNT) {
+			i = c->next;
+			c->next = (c->next + 1) % PCID_COUNT;
+			c->slots[i].uid = uid;
+		}
+		c->slots[i].gen = gen;
+		return cr3 | (i + 1);
+	}
+#endif
+	return cr3;
+}
+
+void PageDir::shootdown(uintptr_t virt,size_t count) {
+	/* CPUs that switched away from us keep our entries with PCIDs; let them flush next time */
+	Atomic::fetch_and_add(&tlbGen,+1);
+	SMP::flushTLB(this,virt,count);
 }
 
 uintptr_t PageDirBase::makeAccessible(uintptr_t phys,size_t pages) {
@@ -96,7 +158,7 @@ void PageDir::removeKernelStack(uintptr_t addr) {
 	PageTables::KStackAllocator alloc;
 	if(addr < freeKStack)
 		freeKStack = addr;
-	unmap(addr,1,alloc);
+	sassert(unmap(addr,1,alloc) == 0);
 }
 
 uintptr_t PageDir::mapToTemp(frameno_t frame) {
@@ -136,7 +198,7 @@ int PageDirBase::clone(PageDir *dst,uintptr_t virtSrc,uintptr_t virtDst,size_t c
 	PageDir *pdir = static_cast<PageDir*>(this);
 	int res = pdir->pts.clone(&dst->pts,virtSrc,virtDst,count,share);
 	if(res >= 0)
-		SMP::flushTLB(pdir);
+		pdir->shootdown(virtSrc,count);
 	return res;
 }
 
@@ -144,13 +206,16 @@ int PageDirBase::map(uintptr_t virt,size_t count,PageTables::Allocator &alloc,ui
 	PageDir *pdir = static_cast<PageDir*>(this);
 	int res = pdir->pts.map(virt,count,alloc,flags);
 	if(res == 1)
-		SMP::flushTLB(pdir);
+		pdir->shootdown(virt,count);
 	return res;
 }
 
-void PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
+int PageDirBase::unmap(uintptr_t virt,size_t count,PageTables::Allocator &alloc) {
 	PageDir *pdir = static_cast<PageDir*>(this);
 	int res = pdir->pts.unmap(virt,count,alloc);
+	if(res < 0)
+		return res;
 	if(res == 1)
-		SMP::flushTLB(pdir);
+		pdir->shootdown(virt,count);
+	return 0;
 }
@@ -0,0 +1,61 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/pagedir.h>
+#include <task/profiler.h>
+#include <task/proc.h>
+#include <task/thread.h>
+#include <common.h>
+
+void Profiler::unwind(Thread *t,const IntrptStackFrame *stack,sProfSample *s) {
+	uintptr_t start,end;
+	PageDir *pdir = NULL;
+	s->pcs[s->depth++] = stack->getIP();
+
+	if(stack->fromUserSpace()) {
+		s->flags |= PROF_USER;
+		if(!t->getStackRange(&start,&end,0))
+			return;
+		pdir = t->getProc()->getPageDir();
+	}
+	else {
+		/* the interrupted code used the stack that the interrupt-frame has been pushed on. as in
+		 * Thread::getRunning(), kernel-stacks are a single page with the thread in the last word */
+		start = (uintptr_t)stack & ~(PAGE_SIZE - 1);
+		end = start + PAGE_SIZE - sizeof(ulong);
+	}
+
+	/* follow the base pointers, as long as they point into the stack */
+	ulong *bp = (ulong*)stack->getBP();
+	while(s->depth < PROF_MAX_DEPTH) {
+		uintptr_t addr = (uintptr_t)bp;
+		if(addr < start || addr + sizeof(ulong) * 2 > end || (addr % sizeof(ulong)) != 0)
+			break;
+		/* we can't handle page-faults here */
+		if(pdir && (!pdir->isPresent(addr) || !pdir->isPresent(addr + sizeof(ulong))))
+			break;
+
+		s->pcs[s->depth++] = bp[1];
+		/* the frames of the callers are above ours */
+		ulong *next = (ulong*)bp[0];
+		if(next <= bp)
+			break;
+		bp = next;
+	}
+}
@@ -24,6 +24,7 @@
 #include <arch/x86/mpconfig.h>
 #include <mem/cache.h>
 #include <mem/pagedir.h>
+#include <task/proc.h>
 #include <task/smp.h>
 #include <task/timer.h>
 #include <common.h>
@@ -40,6 +41,7 @@
 EXTERN_C void apEntry();
 
 cpuid_t *SMP::log2Phys;
+SMP::FlushRequest *SMP::flushReqs;
 
 static SpinLock smpLock;
 static volatile size_t seenAPs = 0;
@@ -47,7 +49,6 @@ static volatile size_t seenAPs = 0;
 extern volatile uint waiting;
 extern volatile uint waitlock;
 extern volatile uint halting;
-extern volatile uint flushed;
 
 bool SMPBase::initArch() {
 	enabled = Config::get(Config::SMP);
@@ -68,6 +69,9 @@ bool SMPBase::initArch() {
 	cpuid_t id = LAPIC::getId();
 	SMP::log2Phys = (cpuid_t*)Cache::alloc(getCPUCount() * sizeof(cpuid_t));
 	SMP::log2Phys[0] = id;
+	SMP::flushReqs = (SMP::FlushRequest*)Cache::calloc(getCPUCount(),sizeof(SMP::FlushRequest));
+	if(!SMP::flushReqs)
+		Util::panic("Unable to allocate TLB-flush requests");
 	return enabled;
 }
 
@@ -132,26 +136,85 @@ void SMPBase::haltOthers() {
 	}
 }
 
+void SMPBase::flushTLB(PageDir *pdir,uintptr_t virt,size_t count) {
+	if(!cpus || cpuCount == 1)
+		return;
+
+	uintptr_t end = virt + count * PAGE_SIZE;
+	cpuid_t cur = getCurId();
+	for(auto cpu = cpuList.cbegin(); cpu != cpuList.cend(); ++cpu) {
+		if(!cpu->ready || cpu->id == cur || !pdir->isActiveOn(cpu->id))
+			continue;
+
+		SMP::FlushRequest *req = SMP::flushReqs + cpu->id;
+		req->lock.down();
+		bool wasPending = req->pending;
+		if(!wasPending) {
+			req->pdir = pdir;
+			req->start = virt;
+			req->end = end;
+		}
+		else {
+			/* a request for a different pagedir can only be handled by a complete flush */
+			if(req->pdir != pdir)
+				req->pdir = NULL;
+			req->start = MIN(req->start,virt);
+			req->end = MAX(req->end,end);
+		}
+		req->pending = true;
+		req->seq++;
+		req->lock.up();
+
+		/* if there is already an IPI on the way, it will handle our range as well */
+		if(!wasPending)
+			sendIPI(cpu->id,IPI_FLUSH_TLB);
+	}
+}
+
+void SMP::flushPending(cpuid_t id,PageDir *pdir) {
+	FlushRequest *req = flushReqs + id;
+	if(!req->pending)
+		return;
+
+	req->lock.down();
+	PageDir *reqpdir = req->pdir;
+	uintptr_t start = req->start;
+	uintptr_t end = req->end;
+	ulong seq = req->seq;
+	req->pending = false;
+	req->lock.up();
+
+	if(reqpdir == NULL || (end - start) / PAGE_SIZE > FLUSH_MAX_PAGES)
+		PageDir::flushTLB();
+	/* if we've switched the pagedir meanwhile, loading CR3 has done the job already */
+	else if(reqpdir == pdir) {
+		for(uintptr_t addr = start; addr < end; addr += PAGE_SIZE)
+			PageTables::flushAddr(addr,true);
+	}
+
+	/* only now the requests are done; new ones might have arrived meanwhile, which have a larger
+	 * sequence number. the compiler must not move the store in front of the flush */
+	asm volatile ("" : : : "memory");
+	req->flushed = seq;
+}
+
 void SMPBase::ensureTLBFlushed() {
+	cpuid_t cur = getCurId();
 	if(smpLock.tryDown()) {
-		cpuid_t cur = getCurId();
-		flushed = 0;
-		size_t count = 0;
+		/* wait until all CPUs have completed the flushes we've requested. waiting for the request
+		 * to be picked up is not sufficient, because the CPU might still use stale translations */
 		for(auto cpu = begin(); cpu != end(); ++cpu) {
 			if(cpu->id != cur && cpu->ready) {
-				sendIPI(cpu->id,IPI_FLUSH_TLB_ACK);
-				count++;
+				SMP::FlushRequest *req = SMP::flushReqs + cpu->id;
+				ulong seq = req->seq;
+				while(halting == 0 && (long)(req->flushed - seq) < 0)
+					::CPU::pause();
 			}
 		}
-		/* wait until all CPUs have flushed their TLB */
-		while(halting == 0 && flushed < count)
-			::CPU::pause();
 		smpLock.up();
 	}
-	else {
-		::CPU::setCR3(::CPU::getCR3());
-		Atomic::fetch_and_add(&flushed,+1);
-	}
+	else
+		SMP::flushPending(cur,Thread::getRunning()->getProc()->getPageDir());
 }
 
 void SMP::apIsRunning() {
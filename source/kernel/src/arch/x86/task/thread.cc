@@ -28,7 +28,7 @@ static SpinLock switchLock;
 
 int ThreadBase::initArch(Thread *t) {
 	t->kernelStack = t->getProc()->getPageDir()->createKernelStack();
-	t->fpuState = NULL;
+	t->fpuCtx = FPU::Context();
 	return 0;
 }
 
@@ -58,11 +58,11 @@ int ThreadBase::createArch(const Thread *src,Thread *dst,bool cloneProc) {
 		int res = dst->getProc()->getVM()->map(NULL,INITIAL_STACK_PAGES * PAGE_SIZE,0,PROT_READ | PROT_WRITE,
 				MAP_STACK | MAP_GROWABLE | MAP_GROWSDOWN,NULL,0,dst->stackRegions + 0);
 		if(res < 0) {
-			dst->getProc()->getPageDir()->unmap(dst->kernelStack,1,alloc);
+			sassert(dst->getProc()->getPageDir()->unmap(dst->kernelStack,1,alloc) == 0);
 			return res;
 		}
 	}
-	FPU::cloneState(&(dst->fpuState),src->fpuState);
+	FPU::cloneState(&dst->fpuCtx,&src->fpuCtx,src->getCPU());
 	return 0;
 }
 
@@ -72,7 +72,7 @@ void ThreadBase::freeArch(Thread *t) {
 		t->stackRegions[0] = NULL;
 	}
 	t->getProc()->getPageDir()->removeKernelStack(t->kernelStack);
-	FPU::freeState(&t->fpuState);
+	FPU::freeState(&t->fpuCtx);
 }
 
 int ThreadBase::finishClone(Thread *t,Thread *nt) {
@@ -128,13 +128,13 @@ void Thread::initialSwitch() {
 	cpuid_t cpu = GDT::getCPUId();
 	Thread *cur = Sched::perform(NULL,cpu);
 	cur->stats.schedCount++;
-	if(PhysMem::shouldSetRegTimestamp())
-		VirtMem::setTimestamp(cur,Timer::getRuntime());
 	GDT::prepareRun(cpu,true,cur);
 	cur->setCPU(cpu);
-	FPU::lockFPU();
+	Timer::switchTo(cpu,cur);
+	FPU::switchTo(NULL,&cur->fpuCtx,cpu);
 	cur->stats.cycleStart = CPU::rdtsc();
-	Thread::resume(cur->getProc()->getPageDir()->getPhysAddr(),&cur->saveArea,&switchLock,true);
+	uintptr_t pdir = cur->getProc()->getPageDir()->activate(NULL,cpu);
+	Thread::resume(pdir,&cur->saveArea,&switchLock,true);
 }
 
 void ThreadBase::doSwitch() {
@@ -156,8 +156,6 @@ void ThreadBase::doSwitch() {
 
 	/* switch thread */
 	if(EXPECT_TRUE(n->getTid() != old->getTid())) {
-		if(EXPECT_FALSE(PhysMem::shouldSetRegTimestamp()))
-			VirtMem::setTimestamp(n,cycles);
 		GDT::prepareRun(cpu,n->getProc() != old->getProc(),n);
 		if(cpu != n->getCPU())
 			n->getStats().migrations++;
@@ -165,15 +163,19 @@ void ThreadBase::doSwitch() {
 
 		/* some stats for SMP */
 		SMP::schedule(cpu,n,cycles);
+		/* start the time-slice of the new thread */
+		Timer::switchTo(cpu,n);
 
-		/* lock the FPU so that we can save the FPU-state for the previous process as soon
-		 * as this one wants to use the FPU */
-		FPU::lockFPU();
+		/* save the FPU-state of the old thread, if necessary, and lock the FPU to load the
+		 * state of the new one as soon as it uses the FPU */
+		FPU::switchTo(&old->fpuCtx,&n->fpuCtx,cpu);
 		if(!Thread::save(&old->saveArea)) {
 			/* old thread */
 			n->stats.cycleStart = CPU::rdtsc();
-			uintptr_t pdir = n->getProc()->getPageDir()->getPhysAddr();
+			uintptr_t pdir = 0;
 			bool chgpdir = n->getProc() != old->getProc();
+			if(chgpdir)
+				pdir = n->getProc()->getPageDir()->activate(old->getProc()->getPageDir(),cpu);
 			Thread::resume(pdir,&n->saveArea,&switchLock,chgpdir);
 		}
 	}
@@ -33,15 +33,21 @@
 uint64_t Timer::bootTSC = 0;
 time_t Timer::bootTime = 0;
 uint64_t Timer::cpuMhz;
+bool Timer::tickless = false;
+bool Timer::tscDeadline = false;
 
 void TimerBase::archInit() {
 	Timer::bootTSC = CPU::rdtsc();
 	Timer::bootTime = RTC::getTime();
+	Timer::tickless = !Config::get(Config::FORCE_PIT) && !Config::get(Config::PERIODIC_TIMER) &&
+		LAPIC::isAvailable();
+	Timer::tscDeadline = Timer::tickless && CPU::hasFeature(CPU::BASIC,CPU::FEAT_TSCDEADLINE);
 }
 
 void Timer::start(bool isBSP) {
 	if(!Config::get(Config::FORCE_PIT) && LAPIC::isAvailable()) {
-		Log::get().writef("CPU %d uses LAPIC as timer device\n",SMP::getCurId());
+		Log::get().writef("CPU %d uses LAPIC as timer device (%s)\n",SMP::getCurId(),
+			tscDeadline ? "TSC-deadline" : (tickless ? "one-shot" : "periodic"));
 		if(isBSP) {
 			/* mask it as well */
 			if(IOAPIC::enabled())
@@ -49,7 +55,14 @@ void Timer::start(bool isBSP) {
 			else
 				PIC::mask(Interrupts::IRQ_PIT - Interrupts::IRQ_MASTER_BASE);
 		}
-		LAPIC::enableTimer();
+		if(tickless) {
+			LAPIC::enableOneshotTimer(tscDeadline);
+			/* start with the first time-slice; afterwards, we program it on demand */
+			uint64_t now = getTimestamp();
+			program(now + TIMESLICE * 1000,now);
+		}
+		else
+			LAPIC::enableTimer();
 	}
 	else if(isBSP) {
 		Log::get().writef("CPU %d uses PIT as timer device\n",SMP::getCurId());
@@ -61,6 +74,24 @@ void Timer::start(bool isBSP) {
 	}
 }
 
+void Timer::program(uint64_t deadline,uint64_t now) {
+	if(tscDeadline) {
+		/* writing 0 disarms the timer */
+		LAPIC::setDeadline(deadline == NO_DEADLINE ? 0 : bootTSC + deadline * cpuMhz);
+		return;
+	}
+
+	/* in one-shot mode, the timer counts down with the bus frequency; 0 stops it */
+	uint64_t count = 0;
+	if(deadline != NO_DEADLINE) {
+		uint64_t usecs = deadline > now ? deadline - now : 1;
+		count = usecs * (CPU::getBusSpeed() / LAPIC::TIMER_DIVIDER) / 1000000;
+		/* if it's too far in the future, we'll get an interrupt earlier and program it again */
+		count = MAX(1,MIN(count,(uint64_t)0xFFFFFFFF));
+	}
+	LAPIC::setTimer(count);
+}
+
 void Timer::wait(uint us) {
 	uint64_t start = CPU::rdtsc();
 	uint64_t end = start + timeToCycles(us);
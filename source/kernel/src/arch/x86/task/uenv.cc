@@ -31,7 +31,7 @@
 
 #if defined(__x86_64__)
 // take care of red-zone
-#	define REG_COUNT		(128 / sizeof(ulong) + 17)
+#	define REG_COUNT		(128 / sizeof(ulong) + 12)
 #else
 #	define REG_COUNT		9
 #endif
@@ -50,7 +50,11 @@ void UEnv::startSignalHandler(Thread *t,IntrptStackFrame *stack,int sig,Signals:
 	/* save regs */
 	UserAccess::writeVar(--sp,stack->getFlags());
 	UserAccess::writeVar(--sp,stack->REG(ax));
+	/* the callee-saved registers are preserved by the handler. on x86_64, they are not even
+	 * present in the stack-frame if we've been interrupted by a syscall */
+#if !defined(__x86_64__)
 	UserAccess::writeVar(--sp,stack->REG(bx));
+#endif
 	UserAccess::writeVar(--sp,stack->REG(cx));
 	UserAccess::writeVar(--sp,stack->REG(dx));
 	UserAccess::writeVar(--sp,stack->REG(di));
@@ -60,10 +64,6 @@ void UEnv::startSignalHandler(Thread *t,IntrptStackFrame *stack,int sig,Signals:
 	UserAccess::writeVar(--sp,stack->r9);
 	UserAccess::writeVar(--sp,stack->r10);
 	UserAccess::writeVar(--sp,stack->r11);
-	UserAccess::writeVar(--sp,stack->r12);
-	UserAccess::writeVar(--sp,stack->r13);
-	UserAccess::writeVar(--sp,stack->r14);
-	UserAccess::writeVar(--sp,stack->r15);
 #endif
 	/* sigRet will remove the argument, restore the register,
 	 * acknoledge the signal and return to eip */
@@ -91,10 +91,6 @@ int UEnvBase::finishSignalHandler(IntrptStackFrame *stack) {
 
 	/* restore regs */
 #if defined(__x86_64__)
-	UserAccess::readVar(&stack->r15,sp++);
-	UserAccess::readVar(&stack->r14,sp++);
-	UserAccess::readVar(&stack->r13,sp++);
-	UserAccess::readVar(&stack->r12,sp++);
 	UserAccess::readVar(&stack->r11,sp++);
 	UserAccess::readVar(&stack->r10,sp++);
 	UserAccess::readVar(&stack->r9,sp++);
@@ -104,7 +100,9 @@ int UEnvBase::finishSignalHandler(IntrptStackFrame *stack) {
 	UserAccess::readVar(&stack->REG(di),sp++);
 	UserAccess::readVar(&stack->REG(dx),sp++);
 	UserAccess::readVar(&stack->REG(cx),sp++);
+#if !defined(__x86_64__)
 	UserAccess::readVar(&stack->REG(bx),sp++);
+#endif
 	UserAccess::readVar(&stack->REG(ax),sp++);
 
 	ulong tmp;
@@ -113,7 +113,7 @@ void PageDirBase::destroy() {
 	PageDir *pdir = static_cast<PageDir*>(this);
 	/* unmap kernel-stacks */
 	PageTables::KStackAllocator alloc;
-	pdir->unmap(KSTACK_AREA,KSTACK_AREA_SIZE / PAGE_SIZE,alloc);
+	sassert(pdir->unmap(KSTACK_AREA,KSTACK_AREA_SIZE / PAGE_SIZE,alloc) == 0);
 	/* free page-dir */
 	PhysMem::free(pdir->pts.getRoot() >> PAGE_BITS,PhysMem::KERN);
 }
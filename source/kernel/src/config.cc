@@ -94,6 +94,8 @@ long Config::get(int id) {
 		case FORCE_PIT:
 		case FORCE_PIC:
 		case ACCURATE_CPU:
+		case PERIODIC_TIMER:
+		case ZSWAP:
 			res = !!(flags & (1 << id));
 			break;
 		default:
@@ -122,4 +124,8 @@ void Config::set(const char *name,const char *value) {
 		flags |= 1 << FORCE_PIC;
 	else if(strcmp(name,"accuratecpu") == 0)
 		flags |= 1 << ACCURATE_CPU;
+	else if(strcmp(name,"periodictimer") == 0)
+		flags |= 1 << PERIODIC_TIMER;
+	else if(strcmp(name,"zswap") == 0)
+		flags |= 1 << ZSWAP;
 }
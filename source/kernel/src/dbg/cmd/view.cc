@@ -44,6 +44,7 @@
 #include <mem/physmemareas.h>
 #include <mem/virtmem.h>
 #include <mem/swapmap.h>
+#include <mem/zswap.h>
 #include <interrupts.h>
 #include <boot.h>
 #include <cpu.h>
@@ -105,6 +106,7 @@ static View views[] = {
 	{"pmemstack",	PhysMem::printStack},
 	{"pmemareas",	PhysMemAreas::print},
 	{"swapmap",		SwapMap::print},
+	{"zswap",		ZSwap::print},
 #if defined(__i586__)
 	{"gdt",			GDT::print},
 #endif
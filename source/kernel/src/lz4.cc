@@ -0,0 +1,178 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <common.h>
+#include <lockguard.h>
+#include <lz4.h>
+#include <spinlock.h>
+#include <string.h>
+
+/* the positions of the last occurrences of 4-byte-sequences */
+uint16_t LZ4::table[1 << HASH_BITS];
+SpinLock LZ4::lock;
+
+static inline uint32_t read32(const uint8_t *p) {
+	uint32_t val;
+	memcpy(&val,p,sizeof(val));
+	return val;
+}
+
+static inline size_t hash(uint32_t seq,size_t bits) {
+	return (seq * 2654435761U) >> (32 - bits);
+}
+
+bool LZ4::putLength(uint8_t **out,const uint8_t *end,size_t len) {
+	for(; len >= 255; len -= 255) {
+		if(*out >= end)
+			return false;
+		*(*out)++ = 255;
+	}
+	if(*out >= end)
+		return false;
+	*(*out)++ = len;
+	return true;
+}
+
+bool LZ4::putSequence(uint8_t **out,const uint8_t *end,const uint8_t *lits,size_t litLen,
+		size_t offset,size_t matchLen) {
+	if(*out >= end)
+		return false;
+	uint8_t *token = (*out)++;
+	*token = MIN(litLen,15) << 4;
+	if(litLen >= 15 && !putLength(out,end,litLen - 15))
+		return false;
+	if((size_t)(end - *out) < litLen)
+		return false;
+	memcpy(*out,lits,litLen);
+	*out += litLen;
+
+	/* the last sequence has no match */
+	if(offset == 0)
+		return true;
+
+	if(end - *out < 2)
+		return false;
+	*(*out)++ = offset & 0xFF;
+	*(*out)++ = offset >> 8;
+	*token |= MIN(matchLen,15);
+	return matchLen < 15 || putLength(out,end,matchLen - 15);
+}
+
+size_t LZ4::compress(const void *src,size_t srcSize,void *dst,size_t dstSize) {
+	const uint8_t *in = (const uint8_t*)src;
+	const uint8_t *inEnd = in + srcSize;
+	const uint8_t *ip = in;
+	const uint8_t *anchor = in;
+	uint8_t *out = (uint8_t*)dst;
+	const uint8_t *outEnd = out + dstSize;
+	if(srcSize > MAX_INPUT)
+		return 0;
+
+	LockGuard<SpinLock> g(&lock);
+	/* since we verify each match, stale entries are harmless; but offsets have to be in range */
+	memclear(table,sizeof(table));
+
+	if(srcSize > MF_LIMIT) {
+		const uint8_t *mfLimit = inEnd - MF_LIMIT;
+		const uint8_t *matchLimit = inEnd - LAST_LITERALS;
+		while(ip < mfLimit) {
+			uint32_t seq = read32(ip);
+			size_t h = hash(seq,HASH_BITS);
+			const uint8_t *ref = in + table[h];
+			table[h] = ip - in;
+			if(ref >= ip || read32(ref) != seq) {
+				ip++;
+				continue;
+			}
+
+			/* extend the match as far as possible */
+			const uint8_t *start = ip;
+			size_t offset = ip - ref;
+			ip += MIN_MATCH;
+			ref += MIN_MATCH;
+			while(ip < matchLimit && *ip == *ref) {
+				ip++;
+				ref++;
+			}
+
+			if(!putSequence(&out,outEnd,anchor,start - anchor,offset,ip - start - MIN_MATCH))
+				return 0;
+			anchor = ip;
+		}
+	}
+
+	/* the remaining literals */
+	if(!putSequence(&out,outEnd,anchor,inEnd - anchor,0,0))
+		return 0;
+	return out - (uint8_t*)dst;
+}
+
+bool LZ4::getLength(const uint8_t **in,const uint8_t *end,size_t *len) {
+	uint8_t b;
+	do {
+		if(*in >= end)
+			return false;
+		b = *(*in)++;
+		*len += b;
+	}
+	while(b == 255);
+	return true;
+}
+
+size_t LZ4::decompress(const void *src,size_t srcSize,void *dst,size_t dstSize) {
+	const uint8_t *ip = (const uint8_t*)src;
+	const uint8_t *inEnd = ip + srcSize;
+	uint8_t *op = (uint8_t*)dst;
+	uint8_t *outEnd = op + dstSize;
+	while(ip < inEnd) {
+		uint8_t token = *ip++;
+
+		/* copy literals */
+		size_t len = token >> 4;
+		if(len == 15 && !getLength(&ip,inEnd,&len))
+			return 0;
+		if(len > (size_t)(inEnd - ip) || len > (size_t)(outEnd - op))
+			return 0;
+		memcpy(op,ip,len);
+		op += len;
+		ip += len;
+
+		/* the last sequence has no match */
+		if(ip == inEnd)
+			break;
+
+		/* copy match; it may overlap with the output, so copy it bytewise */
+		if(inEnd - ip < 2)
+			return 0;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (size_t)(op - (uint8_t*)dst))
+			return 0;
+		len = token & 0xF;
+		if(len == 15 && !getLength(&ip,inEnd,&len))
+			return 0;
+		len += MIN_MATCH;
+		if(len > (size_t)(outEnd - op))
+			return 0;
+		const uint8_t *ref = op - offset;
+		while(len-- > 0)
+			*op++ = *ref++;
+	}
+	return op - (uint8_t*)dst;
+}
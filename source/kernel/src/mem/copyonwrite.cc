@@ -17,99 +17,75 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
-#include <mem/cache.h>
 #include <mem/copyonwrite.h>
 #include <mem/pagedir.h>
+#include <mem/physmem.h>
 #include <task/proc.h>
 #include <assert.h>
+#include <atomic.h>
 #include <common.h>
-#include <spinlock.h>
-#include <string.h>
 #include <util.h>
 #include <video.h>
 
-esc::SList<CopyOnWrite::Entry> CopyOnWrite::frames[HEAP_SIZE];
-SpinLock CopyOnWrite::lock;
+volatile size_t CopyOnWrite::frmCount = 0;
 
 size_t CopyOnWrite::pagefault(uintptr_t address,frameno_t frameNumber) {
-	LockGuard<SpinLock> g(&lock);
-	/* find the cow-entry */
-	Entry *cow = getByFrame(frameNumber,true);
-	vassert(cow != NULL,"No COW entry for frame %#x and address %p",frameNumber,address);
+	PhysMem::Frame *frame = PhysMem::getFrame(frameNumber);
+	vassert(frame->flags & PhysMem::FRAME_COW,"No COW entry for frame %#x and address %p",
+		frameNumber,address);
 
-	/* if there is another process who wants to get the frame, we make a copy for us */
-	/* otherwise we keep the frame for ourself */
-	if(cow->refCount == 0) {
+	/* if we are the last one that uses the frame, we keep it for ourself. nobody else can add a
+	 * reference in the meantime, because only the owners of the frame can clone it */
+	if(frame->refs == 1) {
+		release(frameNumber);
 		PageTables::NoAllocator noalloc;
 		PageDir::mapToCur(address,1,noalloc,PG_PRESENT | PG_WRITABLE);
+		return 1;
 	}
-	else {
-		PageTables::UAllocator ualloc;
-		/* can't fail, we've already allocated the frame */
-		PageDir::mapToCur(address,1,ualloc,PG_PRESENT | PG_WRITABLE);
-	}
 
-	/* copy? */
-	if(cow->refCount > 0)
-		PageDir::copyFromFrame(frameNumber,(void*)(ROUND_PAGE_DN(address)));
-	else
-		delete cow;
+	/* otherwise, make a copy for us before we drop our reference; this way, the frame stays
+	 * unchanged until we're done */
+	PageTables::UAllocator ualloc;
+	/* can't fail, we've already allocated the frame */
+	PageDir::mapToCur(address,1,ualloc,PG_PRESENT | PG_WRITABLE);
+	PageDir::copyFromFrame(frameNumber,(void*)(ROUND_PAGE_DN(address)));
+
+	/* if all others have released the frame meanwhile, it's up to us to free it */
+	if(release(frameNumber) == 0)
+		PhysMem::free(frameNumber,PhysMem::USR);
 	return 1;
 }
 
-bool CopyOnWrite::add(frameno_t frameNo) {
-	LockGuard<SpinLock> g(&lock);
-	Entry *cow = getByFrame(frameNo,false);
-	if(!cow) {
-		cow = new Entry(frameNo);
-		if(cow == NULL)
-			return false;
-		frames[frameNo % HEAP_SIZE].append(cow);
+void CopyOnWrite::add(frameno_t frameNo) {
+	PhysMem::Frame *frame = PhysMem::getFrame(frameNo);
+	if(Atomic::fetch_and_add(&frame->refs,+1) == 0) {
+		Atomic::fetch_and_or(&frame->flags,PhysMem::FRAME_COW);
+		Atomic::fetch_and_add(&frmCount,+1);
 	}
-	cow->refCount++;
-	return true;
 }
 
 size_t CopyOnWrite::remove(frameno_t frameNo,bool *foundOther) {
-	LockGuard<SpinLock> g(&lock);
-	/* find the cow-entry */
-	Entry *cow = getByFrame(frameNo,true);
-	vassert(cow != NULL,"For frameNo %#x",frameNo);
-
-	*foundOther = cow->refCount > 0;
-	if(cow->refCount == 0)
-		delete cow;
+	vassert(PhysMem::getFrame(frameNo)->flags & PhysMem::FRAME_COW,"For frameNo %#x",frameNo);
+	*foundOther = release(frameNo) > 0;
 	return 1;
 }
 
-size_t CopyOnWrite::getFrmCount() {
-	LockGuard<SpinLock> g(&lock);
-	size_t count = 0;
-	for(size_t i = 0; i < HEAP_SIZE; i++)
-		count += frames[i].length();
-	return count;
-}
-
 void CopyOnWrite::print(OStream &os) {
 	os.writef("COW-Frames: (%zu frames)\n",getFrmCount());
-	for(size_t i = 0; i < HEAP_SIZE; i++) {
-		os.writef("\t%zu:\n",i);
-		for(auto it = frames[i].cbegin(); it != frames[i].cend(); ++it)
-			os.writef("\t\t%#x (%zu refs)\n",it->frameNumber,it->refCount);
+	for(size_t i = 0; i < PhysMem::getFrameCount(); i++) {
+		const PhysMem::Frame *frame = PhysMem::getFrame(i);
+		if(frame->flags & PhysMem::FRAME_COW)
+			os.writef("\t%#zx (%u refs)\n",i,frame->refs);
 	}
 }
 
-CopyOnWrite::Entry *CopyOnWrite::getByFrame(frameno_t frameNo,bool dec) {
-	esc::SList<Entry> *list = frames + (frameNo % HEAP_SIZE);
-	Entry *p = NULL;
-	for(auto it = list->begin(); it != list->end(); p = &*it, ++it) {
-		if(it->frameNumber == frameNo) {
-			if(dec) {
-				if(--it->refCount == 0)
-					list->removeAt(p,&*it);
-			}
-			return &*it;
-		}
+uint CopyOnWrite::release(frameno_t frameNo) {
+	PhysMem::Frame *frame = PhysMem::getFrame(frameNo);
+	uint old = Atomic::fetch_and_add(&frame->refs,-1);
+	assert(old > 0);
+	if(old == 1) {
+		Atomic::fetch_and_and(&frame->flags,~PhysMem::FRAME_COW);
+		Atomic::fetch_and_add(&frmCount,-1);
 	}
-	return NULL;
+	return old - 1;
 }
@@ -28,6 +28,18 @@
 
 bool PageTables::hasNXE = false;
 
+frameno_t PageTables::RangeAllocator::allocLargePage() {
+#if PTE_LARGE != 0
+	/* the frames have to be aligned to the large page size */
+	if((_frame & (LARGE_PAGE_COUNT - 1)) == 0) {
+		frameno_t res = _frame;
+		_frame += LARGE_PAGE_COUNT;
+		return res;
+	}
+#endif
+	return INVALID_FRAME;
+}
+
 void PageTables::RangeAllocator::freePage(frameno_t) {
 	Util::panic("Not supported");
 }
@@ -57,12 +69,37 @@ int PageTables::clone(PageTables *dst,uintptr_t virtSrc,uintptr_t virtDst,size_t
 	while(count > 0) {
 		pte_t *spt = getPTE(virtSrc,&base);
 		pte_t pte = *spt;
+		frameno_t frame = PTE_FRAMENO(pte);
+
+#if PTE_LARGE != 0
+		if(pte & PTE_LARGE) {
+			/* shared large pages can be taken over as they are */
+			if(share && base == virtSrc && (virtDst & (LARGE_PAGE_SIZE - 1)) == 0 &&
+					count >= LARGE_PAGE_COUNT && dst->canMapLarge(virtDst)) {
+				if(dst->mapLargePage(virtDst,frame,pte & ~PTE_FRAMENO_MASK,noalloc) < 0)
+					goto error;
+				virtSrc += LARGE_PAGE_SIZE;
+				virtDst += LARGE_PAGE_SIZE;
+				count -= LARGE_PAGE_COUNT;
+				continue;
+			}
+
+			/* otherwise, use normal pages for it. if copy-on-write is used, split the source now,
+			 * because we have to change the flags of single pages below */
+			if(!share && (pte & PTE_PRESENT)) {
+				if(splitLargePage(spt,noalloc) < 0)
+					goto error;
+			}
+			frame += (virtSrc - base) / PAGE_SIZE;
+			pte &= ~PTE_LARGE;
+		}
+#endif
 
 		/* when shared, simply copy the flags; otherwise: if present, we use copy-on-write */
 		if((pte & PTE_WRITABLE) && (!share && (pte & PTE_PRESENT)))
 			pte &= ~PTE_WRITABLE;
 
-		int res = dst->mapPage(virtDst,PTE_FRAMENO(pte),pte & ~PTE_FRAMENO_MASK,noalloc);
+		int res = dst->mapPage(virtDst,frame,pte & ~PTE_FRAMENO_MASK,noalloc);
 		if(res < 0)
 			goto error;
 		/* we never need a flush here because it was not present before */
@@ -70,7 +107,7 @@ int PageTables::clone(PageTables *dst,uintptr_t virtSrc,uintptr_t virtDst,size_t
 		/* if copy-on-write should be used, mark it as readable for the current (parent), too */
 		if(!share && (pte & PTE_PRESENT)) {
 			uint flags = pte & ~(PTE_FRAMENO_MASK | PTE_WRITABLE);
-			sassert(mapPage(virtSrc,PTE_FRAMENO(pte),flags,noalloc) >= 0);
+			sassert(mapPage(virtSrc,frame,flags,noalloc) >= 0);
 			if(this == cur)
 				flushAddr(virtSrc,true);
 		}
@@ -82,13 +119,17 @@ int PageTables::clone(PageTables *dst,uintptr_t virtSrc,uintptr_t virtDst,size_t
 	return noalloc.pageTables();
 
 error:
-	/* unmap from dest-pagedir; the frames are always owned by src */
-	dst->unmap(orgVirtDst,orgCount - count,noalloc);
+	/* unmap from dest-pagedir; the frames are always owned by src. large pages have been mapped
+	 * completely, so that we don't need to split one */
+	sassert(dst->unmap(orgVirtDst,orgCount - count,noalloc) >= 0);
 	/* make the cow-pages writable again */
 	while(orgCount > count) {
 		pte_t *pte = getPTE(orgVirtSrc,&base);
-		if(!share && (*pte & PTE_PRESENT))
-			mapPage(orgVirtSrc,PTE_FRAMENO(*pte),PTE_PRESENT | PTE_WRITABLE | PTE_EXISTS,noalloc);
+		if(!share && (*pte & PTE_PRESENT)) {
+			/* the page might be part of a large page */
+			frameno_t frame = PTE_FRAMENO(*pte) + (orgVirtSrc - base) / PAGE_SIZE;
+			mapPage(orgVirtSrc,frame,PTE_PRESENT | PTE_WRITABLE | PTE_EXISTS,noalloc);
+		}
 		orgVirtSrc += PAGE_SIZE;
 		orgCount--;
 	}
@@ -118,6 +159,13 @@ int PageTables::mapPage(uintptr_t virt,frameno_t frame,pte_t flags,Allocator &al
 			if(crtPageTable(pt + idx,flags,alloc) < 0)
 				return -ENOMEM;
 		}
+#if PTE_LARGE != 0
+		/* to change a part of a large page, we need a page-table for it */
+		else if(pt[idx] & PTE_LARGE) {
+			if(splitLargePage(pt + idx,alloc) < 0)
+				return -ENOMEM;
+		}
+#endif
 		pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + (pt[idx] & PTE_FRAMENO_MASK));
 		bits -= PT_BPL;
 	}
@@ -131,6 +179,75 @@ int PageTables::mapPage(uintptr_t virt,frameno_t frame,pte_t flags,Allocator &al
 	return wasPresent;
 }
 
+#if PTE_LARGE != 0
+int PageTables::splitLargePage(pte_t *pte,Allocator &alloc) {
+	frameno_t frame = alloc.allocPT();
+	if(frame == INVALID_FRAME)
+		return -ENOMEM;
+
+	/* map the same frames with the same flags via the new page-table */
+	pte_t *pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + (frame << PAGE_BITS));
+	frameno_t first = PTE_FRAMENO(*pte);
+	pte_t flags = *pte & ~(PTE_FRAMENO_MASK | PTE_LARGE);
+	for(size_t i = 0; i < PT_ENTRY_COUNT; ++i)
+		pt[i] = ((first + i) << PAGE_BITS) | flags;
+
+	/* since the translation stays the same, we don't need to flush the TLB */
+	*pte = (frame << PAGE_BITS) | PTE_PRESENT | PTE_WRITABLE | PTE_EXISTS | (*pte & PTE_NOTSUPER);
+	return 0;
+}
+
+int PageTables::splitPartial(uintptr_t virt,uintptr_t start,size_t count,Allocator &alloc) {
+	uintptr_t base = virt;
+	pte_t *pte = getPTE(virt,&base);
+	if(!pte || !(*pte & PTE_LARGE))
+		return 0;
+	/* nothing to do if it's completely within the range */
+	if(base >= start && (base - start) / PAGE_SIZE + LARGE_PAGE_COUNT <= count)
+		return 0;
+	return splitLargePage(pte,alloc);
+}
+
+bool PageTables::canMapLarge(uintptr_t virt) const {
+	pte_t *pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + root);
+	uint bits = PT_BITS - PT_BPL;
+	for(int i = 0; i < PT_LEVELS - 2; ++i) {
+		uintptr_t idx = (virt >> bits) & (PT_ENTRY_COUNT - 1);
+		/* the page-tables will be created */
+		if(pt[idx] == 0)
+			return true;
+		if(pt[idx] & PTE_LARGE)
+			return false;
+		pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + (pt[idx] & PTE_FRAMENO_MASK));
+		bits -= PT_BPL;
+	}
+
+	/* we can't replace an existing page-table */
+	uintptr_t idx = (virt >> bits) & (PT_ENTRY_COUNT - 1);
+	return pt[idx] == 0 || (pt[idx] & PTE_LARGE);
+}
+
+int PageTables::mapLargePage(uintptr_t virt,frameno_t frame,pte_t flags,Allocator &alloc) {
+	pte_t *pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + root);
+	uint bits = PT_BITS - PT_BPL;
+	for(int i = 0; i < PT_LEVELS - 2; ++i) {
+		uintptr_t idx = (virt >> bits) & (PT_ENTRY_COUNT - 1);
+		if(pt[idx] == 0) {
+			if(crtPageTable(pt + idx,(flags & PTE_NOTSUPER) ? 0 : PG_SUPERVISOR,alloc) < 0)
+				return -ENOMEM;
+		}
+		pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + (pt[idx] & PTE_FRAMENO_MASK));
+		bits -= PT_BPL;
+	}
+
+	uintptr_t idx = (virt >> bits) & (PT_ENTRY_COUNT - 1);
+	assert(pt[idx] == 0 || (pt[idx] & PTE_LARGE));
+	bool wasPresent = pt[idx] & PTE_PRESENT;
+	pt[idx] = (frame << PAGE_BITS) | flags | PTE_LARGE;
+	return wasPresent;
+}
+#endif
+
 pte_t *PageTables::getPTE(uintptr_t virt,uintptr_t *base) const {
 	pte_t *pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + root);
 	uint bits = PT_BITS - PT_BPL;
@@ -165,7 +282,8 @@ frameno_t PageTables::unmapPage(uintptr_t virt) {
 bool PageTables::gc(uintptr_t virt,pte_t pte,int level,uint bits,Allocator &alloc) {
 	if(~pte & PTE_EXISTS)
 		return true;
-	if(level == 0)
+	/* large pages are pages, not page-tables */
+	if(level == 0 || (pte & PTE_LARGE))
 		return false;
 
 	pte_t *pt = reinterpret_cast<pte_t*>(DIR_MAP_AREA + (pte & PTE_FRAMENO_MASK));
@@ -213,6 +331,27 @@ int PageTables::map(uintptr_t virt,size_t count,Allocator &alloc,uint flags) {
 
 	bool needShootdown = false;
 	while(count > 0) {
+#if PTE_LARGE != 0
+		/* use a large page for user-memory, if possible */
+		if((flags & (PG_PRESENT | PG_SUPERVISOR)) == PG_PRESENT && count >= LARGE_PAGE_COUNT &&
+				(virt & (LARGE_PAGE_SIZE - 1)) == 0 && canMapLarge(virt)) {
+			frameno_t frame = alloc.allocLargePage();
+			if(frame != INVALID_FRAME) {
+				int res = mapLargePage(virt,frame,pteFlags,alloc);
+				if(res < 0)
+					goto error;
+				needShootdown |= res == 1;
+
+				if(this == cur)
+					flushAddr(virt,res == 1);
+
+				virt += LARGE_PAGE_SIZE;
+				count -= LARGE_PAGE_COUNT;
+				continue;
+			}
+		}
+#endif
+
 		frameno_t frame = 0;
 		if(flags & PG_PRESENT) {
 			frame = alloc.allocPage();
@@ -236,7 +375,8 @@ int PageTables::map(uintptr_t virt,size_t count,Allocator &alloc,uint flags) {
 	return needShootdown;
 
 error:
-	unmap(orgVirt,orgCount - count,alloc);
+	/* large pages have been mapped completely, so that we don't need to split one */
+	sassert(unmap(orgVirt,orgCount - count,alloc) >= 0);
 	return -ENOMEM;
 }
 
@@ -245,7 +385,17 @@ int PageTables::unmap(uintptr_t virt,size_t count,Allocator &alloc) {
 	size_t pti = PT_ENTRY_COUNT;
 	size_t lastPti = PT_ENTRY_COUNT;
 	bool needShootdown = false;
-	while(count-- > 0) {
+#if PTE_LARGE != 0
+	/* only the first and the last large page can be partially covered. split them in advance to be
+	 * able to report a failure before we have changed anything */
+	if(count > 0) {
+		if(splitPartial(virt,virt,count,alloc) < 0 ||
+				splitPartial(virt + (count - 1) * PAGE_SIZE,virt,count,alloc) < 0)
+			return -ENOMEM;
+	}
+#endif
+
+	while(count > 0) {
 		/* remove and free page-table, if necessary */
 		pti = PT_IDX(virt,1);
 		if(pti != lastPti) {
@@ -254,6 +404,26 @@ int PageTables::unmap(uintptr_t virt,size_t count,Allocator &alloc) {
 			lastPti = pti;
 		}
 
+#if PTE_LARGE != 0
+		uintptr_t base = virt;
+		pte_t *pte = getPTE(virt,&base);
+		if(pte && (*pte & PTE_LARGE)) {
+			/* the partially covered ones have been split above */
+			assert(base == virt && count >= LARGE_PAGE_COUNT);
+			frameno_t frame = PTE_FRAMENO(*pte);
+			*pte = 0;
+			for(size_t i = 0; i < LARGE_PAGE_COUNT; ++i)
+				alloc.freePage(frame + i);
+			if(this == cur)
+				flushAddr(virt,true);
+			needShootdown = true;
+
+			virt += LARGE_PAGE_SIZE;
+			count -= LARGE_PAGE_COUNT;
+			continue;
+		}
+#endif
+
 		/* remove page and free if necessary */
 		frameno_t frame = unmapPage(virt);
 		if(frame) {
@@ -266,6 +436,7 @@ int PageTables::unmap(uintptr_t virt,size_t count,Allocator &alloc) {
 
 		/* to next page */
 		virt += PAGE_SIZE;
+		count--;
 	}
 	/* check if the last changed pagetable is empty */
 	if(pti != PT_ENTRY_COUNT && (virt < KERNEL_AREA || virt >= KSTACK_AREA))
@@ -281,6 +452,8 @@ size_t PageTables::countEntries(pte_t pte,int level) const {
 		if(pt[i] & PTE_PRESENT) {
 			if(level == 1)
 				count++;
+			else if(pt[i] & PTE_LARGE)
+				count += (size_t)1 << (PT_BPL * (level - 1));
 			else if(level > 1)
 				count += countEntries(pt[i],level - 1);
 		}
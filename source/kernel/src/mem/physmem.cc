@@ -18,17 +18,21 @@
  */
 
 #include <esc/ipc/ipcbuf.h>
+#include <mem/cache.h>
 #include <mem/pagedir.h>
 #include <mem/physmem.h>
 #include <mem/physmemareas.h>
 #include <mem/swapmap.h>
 #include <mem/virtmem.h>
+#include <mem/zswap.h>
 #include <sys/messages.h>
 #include <task/proc.h>
+#include <task/smp.h>
 #include <task/thread.h>
 #include <vfs/openfile.h>
 #include <vfs/vfs.h>
 #include <assert.h>
+#include <atomic.h>
 #include <boot.h>
 #include <common.h>
 #include <config.h>
@@ -49,6 +53,8 @@
 #endif
 
 size_t PhysMem::totalMem = 0;
+PhysMem::Frame *PhysMem::frames;
+size_t PhysMem::frameCount = 0;
 
 /* the bitmap for the frames of the lowest few MB; 0 = free, 1 = used */
 tBitmap *PhysMem::bitmap;
@@ -62,6 +68,11 @@ PhysMem::StackFrames PhysMem::lower;
 PhysMem::StackFrames PhysMem::upper;
 SpinLock PhysMem::defLock;
 
+/* the per-CPU frame caches in front of the stacks; the frames in there count as free */
+PhysMem::FrameCache *PhysMem::caches = NULL;
+size_t PhysMem::cacheCount = 0;
+volatile size_t PhysMem::cachedFrames = 0;
+
 bool PhysMem::initialized = false;
 
 /* for swapping */
@@ -69,10 +80,11 @@ size_t PhysMem::swappedOut = 0;
 size_t PhysMem::swappedIn = 0;
 bool PhysMem::swapEnabled = false;
 bool PhysMem::swapping = false;
+bool PhysMem::swapFailed = false;
 Thread *PhysMem::swapperThread = NULL;
 size_t PhysMem::cframes = 0;	/* critical frames; for dynarea, cache and heap */
 size_t PhysMem::kframes = 0;	/* kernel frames: for pagedirs, page-tables, kstacks, ... */
-size_t PhysMem::uframes = 0;	/* user frames */
+volatile size_t PhysMem::uframes = 0;	/* user frames */
 
 /* swap-in jobs */
 PhysMem::SwapInJob PhysMem::siJobs[SWAPIN_JOB_COUNT];
@@ -114,6 +126,8 @@ void PhysMem::init() {
 		}
 	}
 	totalMem = PhysMemAreas::getAvailable();
+	for(const PhysMemAreas::MemArea *area = PhysMemAreas::get(); area != NULL; area = area->next)
+		frameCount = MAX(frameCount,(area->addr + area->size) / PAGE_SIZE);
 
 	/* remove kernel and the first MB */
 	PhysMemAreas::rem(0,(uintptr_t)&_ebss - KERNEL_BEGIN);
@@ -162,6 +176,10 @@ void PhysMem::init() {
 	/* mark all free */
 	memclear(bitmap,BITMAP_PAGE_COUNT / 8);
 
+	/* map the frame-metadata behind it */
+	frames = (Frame*)PageDir::makeAccessible(0,BYTES_2_PAGES(frameCount * sizeof(Frame)));
+	memclear(frames,frameCount * sizeof(Frame));
+
 	/* now mark the remaining memory as free on stack */
 	for(const PhysMemAreas::MemArea *area = PhysMemAreas::get(); area != NULL; area = area->next)
 		markRangeUsed(area->addr,area->addr + area->size,false);
@@ -169,8 +187,8 @@ void PhysMem::init() {
 	/* stack and bitmap is ready */
 	initialized = true;
 
-	/* test whether a swap-device is present */
-	if(Config::getStr(Config::SWAP_DEVICE) != NULL) {
+	/* test whether a swap-device is present or we should swap into the compressed pool */
+	if(Config::getStr(Config::SWAP_DEVICE) != NULL || Config::get(Config::ZSWAP)) {
 		/* build freelist */
 		siFreelist = siJobs + 0;
 		siJobs[0].next = NULL;
@@ -204,6 +222,14 @@ void PhysMem::init() {
 	}
 }
 
+void PhysMem::initCaches() {
+	cacheCount = SMP::getCPUCount();
+	caches = (FrameCache*)Cache::calloc(cacheCount,sizeof(FrameCache));
+	/* without caches, we just use the stacks directly */
+	if(!caches)
+		Log::get().writef("Unable to create frame caches for %zu CPUs\n",cacheCount);
+}
+
 size_t PhysMem::getFreeFrames(uint types) {
 	/* no lock; just intended for debugging and information */
 	size_t count = 0;
@@ -256,7 +282,7 @@ void PhysMem::freeContiguous(frameno_t first,size_t count) {
 bool PhysMem::reserve(size_t frameCount,bool swap) {
 	defLock.down();
 	size_t free = getFreeDef();
-	uframes += frameCount;
+	Atomic::fetch_and_add(&uframes,frameCount);
 	/* enough user-memory available? */
 	if(free >= frameCount && free - frameCount >= kframes + cframes) {
 		defLock.up();
@@ -267,6 +293,7 @@ bool PhysMem::reserve(size_t frameCount,bool swap) {
 	Thread *t = Thread::getRunning();
 	if(!swap || !swapEnabled || !swapperThread ||
 			t->getTid() == ATA_TID || t->getTid() == swapperThread->getTid()) {
+		Atomic::fetch_and_add(&uframes,-frameCount);
 		defLock.up();
 		return false;
 	}
@@ -281,6 +308,12 @@ bool PhysMem::reserve(size_t frameCount,bool swap) {
 		Thread::switchNoSigs();
 		defLock.down();
 		free = getFreeDef();
+		/* give up if the swapper didn't find anything to swap out */
+		if(swapFailed && free - (kframes + cframes) < frameCount) {
+			Atomic::fetch_and_add(&uframes,-frameCount);
+			defLock.up();
+			return false;
+		}
 	}
 	while(free - (kframes + cframes) < frameCount);
 	defLock.up();
@@ -311,7 +344,37 @@ void PhysMem::freeFrame(frameno_t frame) {
 }
 
 frameno_t PhysMem::allocate(FrameType type) {
+	frameno_t frame;
+	if(allocate(type,&frame,1) == 0)
+		return INVALID_FRAME;
+	return frame;
+}
+
+size_t PhysMem::allocate(FrameType type,frameno_t *frames,size_t count) {
+	size_t res = allocFrames(type,frames,count);
+	/* if the stacks are empty, the remaining free frames might be in the caches of other CPUs */
+	if(EXPECT_FALSE(res < count && cachedFrames > 0)) {
+		drainCaches();
+		res += allocFrames(type,frames + res,count - res);
+	}
+	return res;
+}
+
+size_t PhysMem::allocFrames(FrameType type,frameno_t *frames,size_t count) {
+	if(type == USR && caches)
+		return allocCached(frames,count);
+
 	LockGuard<SpinLock> g(&defLock);
+	size_t i;
+	for(i = 0; i < count; ++i) {
+		frames[i] = doAllocate(type);
+		if(frames[i] == INVALID_FRAME)
+			break;
+	}
+	return i;
+}
+
+frameno_t PhysMem::doAllocate(FrameType type) {
 	/* remove the memory from the available one when we're not yet initialized */
 	frameno_t frame = INVALID_FRAME;
 	if(!initialized)
@@ -340,8 +403,9 @@ frameno_t PhysMem::allocate(FrameType type) {
 			default:
 				if(getFreeDef() > (kframes + cframes)) {
 					assert(uframes > 0);
-					uframes--;
 					frame = allocFrame(false);
+					if(frame != INVALID_FRAME)
+						Atomic::fetch_and_add(&uframes,-1);
 				}
 				break;
 		}
@@ -351,7 +415,36 @@ frameno_t PhysMem::allocate(FrameType type) {
 }
 
 void PhysMem::free(frameno_t frame,FrameType type) {
-	LockGuard<SpinLock> g(&defLock);
+	free(&frame,1,type);
+}
+
+void PhysMem::free(const frameno_t *frames,size_t count,FrameType type) {
+	if(type == USR && caches) {
+		FrameCache *cache = getCache();
+		LockGuard<SpinLock> g(&cache->lock);
+		for(size_t i = 0; i < count; ++i) {
+			/* frames from the bitmap don't belong into the cache */
+			if(EXPECT_FALSE(!isStackFrame(frames[i]))) {
+				LockGuard<SpinLock> dg(&defLock);
+				doFree(frames[i],type);
+				continue;
+			}
+
+			if(cache->count == FRAME_CACHE_SIZE)
+				drain(cache,FRAME_CACHE_BATCH);
+			printAllocFree("[F] %x 1 ",frames[i]);
+			cache->frames[cache->count++] = frames[i];
+			Atomic::fetch_and_add(&cachedFrames,+1);
+		}
+	}
+	else {
+		LockGuard<SpinLock> g(&defLock);
+		for(size_t i = 0; i < count; ++i)
+			doFree(frames[i],type);
+	}
+}
+
+void PhysMem::doFree(frameno_t frame,FrameType type) {
 	printAllocFree("[F] %x 1 ",frame);
 	if(type == CRIT)
 		cframes++;
@@ -360,6 +453,72 @@ void PhysMem::free(frameno_t frame,FrameType type) {
 	markUsed(frame,false);
 }
 
+PhysMem::FrameCache *PhysMem::getCache() {
+	cpuid_t id = SMP::getCurId();
+	return caches + (id < cacheCount ? id : 0);
+}
+
+size_t PhysMem::allocCached(frameno_t *frames,size_t count) {
+	FrameCache *cache = getCache();
+	LockGuard<SpinLock> g(&cache->lock);
+	size_t i;
+	for(i = 0; i < count; ++i) {
+		if(cache->count == 0 && refill(cache) == 0)
+			break;
+		/* the frames in the cache are free; the limit for user frames applies as usual */
+		if(getFreeDef() <= (kframes + cframes))
+			break;
+
+		assert(uframes > 0);
+		frames[i] = cache->frames[--cache->count];
+		Atomic::fetch_and_add(&cachedFrames,-1);
+		Atomic::fetch_and_add(&uframes,-1);
+		printAllocFree("[A] %x 1 ",frames[i]);
+	}
+	return i;
+}
+
+size_t PhysMem::refill(FrameCache *cache) {
+	LockGuard<SpinLock> g(&defLock);
+	size_t i;
+	for(i = 0; i < FRAME_CACHE_BATCH; ++i) {
+		frameno_t frame = allocFrame(false);
+		if(frame == INVALID_FRAME)
+			break;
+		cache->frames[cache->count++] = frame;
+	}
+	Atomic::fetch_and_add(&cachedFrames,i);
+	return i;
+}
+
+void PhysMem::drain(FrameCache *cache,size_t count) {
+	LockGuard<SpinLock> g(&defLock);
+	count = MIN(count,cache->count);
+	for(size_t i = 0; i < count; ++i)
+		freeFrame(cache->frames[--cache->count]);
+	Atomic::fetch_and_add(&cachedFrames,-count);
+}
+
+void PhysMem::drainCaches() {
+	for(size_t i = 0; i < cacheCount; ++i) {
+		LockGuard<SpinLock> g(&caches[i].lock);
+		drain(caches + i,caches[i].count);
+	}
+}
+
+size_t PhysMem::allocateSpare(frameno_t *frames,size_t count) {
+	LockGuard<SpinLock> g(&defLock);
+	size_t free = getFreeDef();
+	size_t i;
+	for(i = 0; i < count && free > kframes + cframes + uframes; ++i, --free) {
+		frames[i] = allocFrame(false);
+		if(frames[i] == INVALID_FRAME)
+			break;
+		printAllocFree("[A] %x 1 ",frames[i]);
+	}
+	return i;
+}
+
 int PhysMem::swapIn(uintptr_t addr) {
 	if(!swapEnabled)
 		return -EFAULT;
@@ -404,19 +563,31 @@ void PhysMem::swapper() {
 	assert(swapEnabled);
 
 	/* open device */
-	OpenFile *swapFile;
-	if(VFS::openPath(pid,VFS_READ | VFS_WRITE,0,dev,&swapFile) < 0) {
-		Log::get().writef("Unable to open swap-device '%s'\n",dev);
-		swapEnabled = false;
+	OpenFile *swapFile = NULL;
+	size_t swapSize = 0;
+	if(dev) {
+		if(VFS::openPath(pid,VFS_READ | VFS_WRITE,0,dev,&swapFile) < 0) {
+			Log::get().writef("Unable to open swap-device '%s'\n",dev);
+			swapEnabled = false;
+		}
+		else {
+			/* get device-size */
+			struct stat info;
+			sassert(swapFile->fstat(pid,&info) == 0);
+			swapSize = info.st_size;
+		}
 	}
-	else {
-		/* get device-size and init swap-map */
-		struct stat info;
-		sassert(swapFile->fstat(pid,&info) == 0);
+	/* without swap-device, the swap-blocks do only identify the pages in the compressed pool */
+	else
+		swapSize = totalMem;
 
-		if(!SwapMap::init(info.st_size)) {
+	/* init swap-map and compressed pool */
+	if(swapEnabled) {
+		bool zswap = Config::get(Config::ZSWAP);
+		if(!SwapMap::init(swapSize) || (zswap && !ZSwap::init(swapSize / PAGE_SIZE))) {
 			swapEnabled = false;
-			swapFile->close(pid);
+			if(swapFile)
+				swapFile->close(pid);
 		}
 	}
 
@@ -425,17 +596,21 @@ void PhysMem::swapper() {
 	while(1) {
 		SwapInJob *job;
 		size_t free = getFreeDef();
+		size_t ufrms = uframes;
 		/* swapping out is more important than swapping in */
-		if((free - (kframes + cframes)) < uframes) {
-			size_t amount = MIN(MAX_SWAP_AT_ONCE,uframes - (free - (kframes + cframes)));
+		if((free - (kframes + cframes)) < ufrms) {
+			size_t amount = ufrms - (free - (kframes + cframes));
+			amount = MIN(MAX_SWAP_AT_ONCE,MAX(MIN_SWAP_AT_ONCE,amount));
 			swapping = true;
 			defLock.up();
 
-			VirtMem::swapOut(pid,swapFile,amount);
-			swappedOut += amount;
+			size_t done = VirtMem::swapOut(pid,swapFile,amount);
+			swappedOut += done;
 
 			defLock.down();
 			swapping = false;
+			/* the waiting threads fail in this case and try again later */
+			swapFailed = done == 0;
 		}
 		/* wakeup in every case because its possible that the frames are available now but weren't
 		 * previously */
@@ -446,8 +621,7 @@ void PhysMem::swapper() {
 			swapping = true;
 			defLock.up();
 
-			if(VirtMem::swapIn(pid,swapFile,job->thread,job->addr))
-				swappedIn++;
+			swappedIn += VirtMem::swapIn(pid,swapFile,job->thread,job->addr);
 
 			defLock.down();
 			job->thread->unblock();
@@ -455,7 +629,8 @@ void PhysMem::swapper() {
 			swapping = false;
 		}
 
-		if(getFreeDef() - (kframes + cframes) >= uframes) {
+		/* don't try again until someone asks for it, if we failed */
+		if(swapFailed || getFreeDef() - (kframes + cframes) >= uframes) {
 			/* we may receive new work now */
 			swapperThread->wait(EV_SWAP_WORK,0);
 			defLock.up();
@@ -475,9 +650,13 @@ void PhysMem::print(OStream &os) {
 	os.writef("CFrames: %zu\n",cframes);
 	os.writef("KFrames: %zu\n",kframes);
 	os.writef("UFrames: %zu\n",uframes);
+	os.writef("Cached: %zu\n",cachedFrames);
 	os.writef("Swapped out: %zu\n",swappedOut);
 	os.writef("Swapped in: %zu\n",swappedIn);
 	os.writef("\n");
+	os.writef("Compressed pool:\n");
+	ZSwap::print(os);
+	os.writef("\n");
 	os.writef("Swap-in-jobs:\n");
 	for(SwapInJob *job = siJobList; job != NULL; job = job->next) {
 		os.writef("\tThread %d:%d:%s @ %p\n",job->thread->getTid(),job->thread->getProc()->getPid(),
@@ -518,7 +697,7 @@ void PhysMem::printCont(OStream &os) {
 }
 
 size_t PhysMem::getFreeDef() {
-	return (lower.frames - lower.begin) + (upper.frames - upper.begin);
+	return (lower.frames - lower.begin) + (upper.frames - upper.begin) + cachedFrames;
 }
 
 void PhysMem::markRangeUsed(uintptr_t from,uintptr_t to,bool used) {
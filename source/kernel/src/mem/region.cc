@@ -53,20 +53,20 @@
 Region::Region(OpenFile *f,size_t bCount,size_t lCount,size_t off,ulong pgFlags,
                ulong _flags,bool &success)
 		: flags(_flags), file(f), offset(off), loadCount(lCount), byteCount(bCount),
-		  timestamp(0), pfSize(), pageFlags(), vms(), lock() {
+		  pfSize(), pageFlags(), vms(), lock() {
 	init(pgFlags,success);
 }
 
-Region::Region(const Region &reg,VirtMem *vm,bool &success)
+Region::Region(const Region &reg,VirtMem *vm,bool copyPages,bool &success)
 		: flags(reg.flags), file(reg.file), offset(reg.offset), loadCount(reg.loadCount),
-		  byteCount(reg.byteCount), timestamp(0), pfSize(), pageFlags(), vms(), lock() {
+		  byteCount(reg.byteCount), pfSize(), pageFlags(), vms(), lock() {
 	assert(!(flags & RF_SHAREABLE));
-	init(-1,success);
+	init(copyPages ? (ulong)-1 : PF_DEMANDLOAD,success);
 	if(!success)
 		return;
 
 	/* increment references to swap-blocks */
-	size_t count = BYTES_2_PAGES(reg.byteCount);
+	size_t count = copyPages ? BYTES_2_PAGES(reg.byteCount) : 0;
 	for(size_t i = 0; i < count; i++) {
 		pageFlags[i] = reg.pageFlags[i];
 		if(reg.pageFlags[i] & PF_SWAPPED)
@@ -190,7 +190,6 @@ void Region::print(OStream &os,uintptr_t virt) const {
 		file->print(os);
 		os.writef("\n");
 	}
-	os.writef("\tTimestamp: %Lu\n",timestamp);
 	os.writef("\tProcesses: ");
 	for(auto it = vms.cbegin(); it != vms.cend(); ++it)
 		os.writef("%d ",(*it)->getProc()->getPid());
@@ -20,6 +20,7 @@
 #include <mem/cache.h>
 #include <mem/pagedir.h>
 #include <mem/swapmap.h>
+#include <mem/zswap.h>
 #include <assert.h>
 #include <common.h>
 #include <spinlock.h>
@@ -32,48 +33,58 @@
 
 size_t SwapMap::totalBlocks = 0;
 size_t SwapMap::freeBlocks = 0;
-SwapMap::Block *SwapMap::swapBlocks = NULL;
-SwapMap::Block *SwapMap::freeList = NULL;
+size_t SwapMap::nextBlock = 0;
+uint *SwapMap::refCounts = NULL;
 SpinLock SwapMap::lock;
 
 bool SwapMap::init(size_t swapSize) {
 	totalBlocks = swapSize / PAGE_SIZE;
 	freeBlocks = totalBlocks;
-	swapBlocks = (Block*)Cache::alloc(totalBlocks * sizeof(Block));
-	if(swapBlocks == NULL)
-		return false;
-
-	/* build freelist */
-	freeList = swapBlocks + 0;
-	swapBlocks[0].refCount = 0;
-	swapBlocks[0].next = NULL;
-	for(size_t i = 1; i < totalBlocks; i++) {
-		swapBlocks[i].next = freeList;
-		swapBlocks[i].refCount = 0;
-		freeList = swapBlocks + i;
-	}
-	return true;
+	refCounts = (uint*)Cache::calloc(totalBlocks,sizeof(uint));
+	return refCounts != NULL;
 }
 
-ulong SwapMap::alloc() {
+ulong SwapMap::alloc(size_t count) {
 	LockGuard<SpinLock> g(&lock);
-	if(!freeList)
+	if(count == 0 || freeBlocks < count)
 		return INVALID_BLOCK;
-	Block *block = freeList;
-	freeList = freeList->next;
-	block->refCount = 1;
-	freeBlocks--;
-	return block - swapBlocks;
+
+	/* next-fit: continue behind the last allocation, so that consecutive allocations tend to be
+	 * contiguous as well and we don't search the used blocks at the beginning again and again */
+	size_t block = nextBlock;
+	size_t run = 0;
+	for(size_t i = 0; i < totalBlocks + count; ++i, ++block) {
+		/* ranges can't wrap around */
+		if(block >= totalBlocks) {
+			block = 0;
+			run = 0;
+		}
+		if(refCounts[block] != 0) {
+			run = 0;
+			continue;
+		}
+
+		if(++run == count) {
+			ulong first = block + 1 - count;
+			for(size_t j = 0; j < count; ++j)
+				refCounts[first + j] = 1;
+			freeBlocks -= count;
+			nextBlock = block + 1;
+			return first;
+		}
+	}
+	return INVALID_BLOCK;
 }
 
 void SwapMap::free(ulong block) {
 	LockGuard<SpinLock> g(&lock);
-	assert(block < totalBlocks);
-	if(--swapBlocks[block].refCount == 0) {
-		swapBlocks[block].next = freeList;
-		freeList = swapBlocks + block;
-		freeBlocks++;
-	}
+	assert(block < totalBlocks && refCounts[block] > 0);
+	if(--refCounts[block] != 0)
+		return;
+	/* drop the compressed page before the block becomes free. otherwise the swapper could
+	 * allocate it and store a new page for it, which we would remove afterwards */
+	ZSwap::remove(block);
+	freeBlocks++;
 }
 
 void SwapMap::print(OStream &os) {
@@ -82,11 +93,10 @@ void SwapMap::print(OStream &os) {
 	os.writef("Free: %zu blocks (%zu KiB)\n",freeBlocks,(freeBlocks * PAGE_SIZE) / 1024);
 	os.writef("Used:");
 	for(size_t i = 0; i < totalBlocks; i++) {
-		Block *block = swapBlocks + i;
-		if(block->refCount > 0) {
+		if(refCounts[i] > 0) {
 			if(c % 8 == 0)
 				os.writef("\n ");
-			os.writef("%5u[%u] ",i,block->refCount);
+			os.writef("%5u[%u] ",i,refCounts[i]);
 			c++;
 		}
 	}
@@ -24,7 +24,9 @@
 #include <mem/shfiles.h>
 #include <mem/swapmap.h>
 #include <mem/virtmem.h>
+#include <mem/zswap.h>
 #include <task/proc.h>
+#include <task/sched.h>
 #include <task/smp.h>
 #include <task/thread.h>
 #include <vfs/openfile.h>
@@ -36,8 +38,10 @@
 #include <log.h>
 #include <mutex.h>
 #include <ostream.h>
+#include <sharedinfo.h>
 #include <spinlock.h>
 #include <string.h>
+#include <trace.h>
 #include <util.h>
 
 /**
@@ -48,7 +52,16 @@
 
 #define DEBUG_SWAP			0
 
-static uint8_t buffer[PAGE_SIZE];
+/* the max. number of pages that are written to contiguous swap-blocks at once */
+#define SWAP_CLUSTER_SIZE	16
+/* the max. number of pages that are read in addition to the requested one on a swap-in */
+#define SWAP_READAHEAD		7
+
+static uint8_t buffer[SWAP_CLUSTER_SIZE * PAGE_SIZE];
+
+pid_t VirtMem::clockPid = 0;
+size_t VirtMem::clockReg = 0;
+size_t VirtMem::clockPage = 0;
 
 void VirtMem::acquire() const {
 	proc->lock(PLOCK_PROG);
@@ -130,6 +143,44 @@ errorRel:
 	return 0;
 }
 
+int VirtMem::mapSharedInfo(uintptr_t *addr) {
+	acquire();
+	if(sharedInfoAddr) {
+		*addr = sharedInfoAddr;
+		release();
+		return 0;
+	}
+	release();
+
+	/* the frame belongs to the kernel and is shared with all processes; never free or swap it */
+	VMRegion *vm;
+	int res = map(0,PAGE_SIZE,0,PROT_READ,MAP_SHARED | MAP_NOMAP | MAP_NOFREE | MAP_LOCKED,NULL,0,&vm);
+	if(res < 0)
+		return res;
+
+	acquire();
+	/* another thread might have been faster */
+	if(sharedInfoAddr) {
+		*addr = sharedInfoAddr;
+		release();
+		unmap(vm);
+		return 0;
+	}
+
+	PageTables::RangeAllocator alloc(SharedInfo::getFrame());
+	res = getPageDir()->map(vm->virt(),1,alloc,PG_PRESENT);
+	if(res < 0) {
+		release();
+		unmap(vm);
+		return res;
+	}
+	addOwn(alloc.pageTables());
+	addShared(1);
+	*addr = sharedInfoAddr = vm->virt();
+	release();
+	return 0;
+}
+
 int VirtMem::map(uintptr_t *addr,size_t length,size_t loadCount,int prot,int flags,OpenFile *f,
                  off_t offset,VMRegion **vmreg) {
 	int res;
@@ -201,6 +252,14 @@ int VirtMem::map(uintptr_t *addr,size_t length,size_t loadCount,int prot,int fla
 		/* find a suitable place */
 		if(rflags & MAP_STACK)
 			virt = findFreeStack(length,rflags);
+#if defined(LARGE_PAGE_SIZE)
+		/* align big physical mappings, so that they can be mapped with large pages */
+		else if((rflags & MAP_NOMAP) && length >= LARGE_PAGE_SIZE) {
+			virt = freemap.allocate(ROUND_PAGE_UP(length),LARGE_PAGE_SIZE);
+			if(virt == 0)
+				virt = freemap.allocate(ROUND_PAGE_UP(length));
+		}
+#endif
 		else
 			virt = freemap.allocate(ROUND_PAGE_UP(length));
 		if(virt == 0)
@@ -254,7 +313,8 @@ int VirtMem::map(uintptr_t *addr,size_t length,size_t loadCount,int prot,int fla
 errPf:
 	addShared(oldSh - getSharedFrames());
 	addOwn(oldOwn - getOwnFrames());
-	getPageDir()->unmap(*addr,pageCount,alloc);
+	/* the whole region is removed, so that no large page needs to be split */
+	sassert(getPageDir()->unmap(*addr,pageCount,alloc) == 0);
 errMap:
 	regtree.remove(vm);
 errAdd:
@@ -388,116 +448,170 @@ int VirtMem::populatePages(VMRegion *vm,size_t count) {
 	return 0;
 }
 
-void VirtMem::swapOut(pid_t pid,OpenFile *file,size_t count) {
+size_t VirtMem::swapOut(pid_t pid,OpenFile *file,size_t count) {
+	size_t total = 0;
+
 	while(count > 0) {
-		Region *reg = getLRURegion();
-		if(reg == NULL)
-			Util::panic("No pages to swap out");
-
-		/* the list of processes may have changed in the meantime; we can't swap out in this case */
-		while(count > 0) {
-			/* get page to swap out */
-			ssize_t index = getPgIdxForSwap(reg);
-			if(index < 0)
-				break;
-
-			/* get VM-region of first process */
-			VirtMem *vm = *reg->vmbegin();
-			VMRegion *vmreg = vm->regtree.getByReg(reg);
-
-			/* find swap-block */
-			ulong block = SwapMap::alloc();
+		/* without swap-device, we can't swap out anything if the compressed pool is full */
+		if(!file && ZSwap::isFull())
+			break;
+
+		/* choose the victims; the region is locked afterwards */
+		Region *reg;
+		size_t pages[SWAP_CLUSTER_SIZE];
+		size_t n = getVictims(&reg,pages,MIN(count,SWAP_CLUSTER_SIZE));
+		if(n == 0)
+			break;
+
+		/* get VM-region of first process */
+		VirtMem *vm = *reg->vmbegin();
+		VMRegion *vmreg = vm->regtree.getByReg(reg);
+
+		/* get the frames first, because the pages have to be present */
+		frameno_t frames[SWAP_CLUSTER_SIZE];
+		for(size_t i = 0; i < n; ++i)
+			frames[i] = vm->getPageDir()->getFrameNo(vmreg->virt() + pages[i] * PAGE_SIZE);
+
+		/* find contiguous swap-blocks, as large as possible */
+		ulong blocks[SWAP_CLUSTER_SIZE];
+		for(size_t i = 0; i < n; ) {
+			size_t amount = n - i;
+			ulong block;
+			while((block = SwapMap::alloc(amount)) == INVALID_BLOCK && amount > 1)
+				amount /= 2;
 			assert(block != INVALID_BLOCK);
 
 #if DEBUG_SWAP
-			Log::get().writef("OUT: %d of region %x (block %d)\n",index,vmreg->reg,block);
-			for(auto mp = reg->vmbegin(); mp != reg->vmend(); ++mp) {
-				VMRegion *mpreg = (*mp)->regtree.getByReg(reg);
-				Log::get().writef("\tProcess %d:%s -> page %p\n",(*mp)->getProc()->getPid(),
-						(*mp)->getProc()->getProgram(),mpreg->virt() + index * PAGE_SIZE);
-			}
-			Log::get().writef("\n");
+			Log::get().writef("OUT: %zu pages starting with %d of region %x (block %d)\n",
+				amount,pages[i],vmreg->reg,block);
 #endif
 
-			/* get the frame first, because the page has to be present */
-			frameno_t frameNo = vm->getPageDir()->getFrameNo(vmreg->virt() + index * PAGE_SIZE);
-			/* unmap the page in all processes and ensure that all CPUs have flushed their TLB */
-			/* this way we know that nobody can still access the page; if someone tries, he will
-			 * cause a page-fault and will wait until we release the region-mutex */
-			setSwappedOut(reg,index);
-			reg->setSwapBlock(index,block);
-			SMP::ensureTLBFlushed();
+			/* unmap the pages in all processes. this way, if someone tries to access them, he
+			 * will cause a page-fault and will wait until we release the region-mutex */
+			for(size_t j = 0; j < amount; ++j) {
+				setSwappedOut(reg,pages[i + j]);
+				reg->setSwapBlock(pages[i + j],block + j);
+				blocks[i + j] = block + j;
+			}
+			i += amount;
+		}
 
-			/* copy to a temporary buffer because we can't use the temp-area when switching threads */
-			PageDir::copyFromFrame(frameNo,buffer);
-			PhysMem::free(frameNo,PhysMem::USR);
+		/* ensure that all CPUs have flushed their TLB; once for the whole cluster */
+		SMP::ensureTLBFlushed();
+
+		/* copy to a temporary buffer because we can't use the temp-area when switching threads.
+		 * the pages that can be stored in the compressed pool don't need to be written to disk */
+		bool stored[SWAP_CLUSTER_SIZE];
+		size_t done = 0;
+		for(size_t i = 0; i < n; ++i) {
+			uint8_t *page = buffer + i * PAGE_SIZE;
+			PageDir::copyFromFrame(frames[i],page);
+			stored[i] = ZSwap::isEnabled() && ZSwap::store(blocks[i],page,file == NULL);
+			if(!stored[i] && !file) {
+				/* the pool is full; put the page back */
+				setSwappedIn(reg,pages[i],frames[i]);
+				SwapMap::free(blocks[i]);
+				continue;
+			}
+			PhysMem::free(frames[i],PhysMem::USR);
+			done++;
+		}
+		reg->release();
 
-			/* write out on disk */
-			sassert(file->seek(pid,block * PAGE_SIZE,SEEK_SET) >= 0);
-			sassert(file->write(pid,buffer,PAGE_SIZE) == PAGE_SIZE);
+		/* the frames are free now, so that the waiting threads can continue while we write the
+		 * content to disk. if they want to swap in one of these pages, they will have to wait until
+		 * we're done, because we're handling the swap-in-jobs as well */
+		Sched::wakeup(EV_SWAP_FREE,0);
 
-			count--;
+		/* write the remaining pages on disk; as few writes as possible */
+		for(size_t i = 0; file && i < n; ) {
+			if(stored[i]) {
+				i++;
+				continue;
+			}
+			size_t j = i + 1;
+			while(j < n && !stored[j] && blocks[j] == blocks[j - 1] + 1)
+				j++;
+			size_t bytes = (j - i) * PAGE_SIZE;
+			sassert(file->seek(pid,blocks[i] * PAGE_SIZE,SEEK_SET) >= 0);
+			sassert(file->write(pid,buffer + i * PAGE_SIZE,bytes) == (ssize_t)bytes);
+			i = j;
 		}
-		reg->release();
+
+		/* make room in the pool for the next time by writing the oldest pages to disk */
+		if(file && ZSwap::isFull())
+			ZSwap::writeBack(pid,file,SWAP_CLUSTER_SIZE);
+
+		count -= MIN(count,n);
+		total += done;
+		if(done < n)
+			break;
 	}
+	return total;
 }
 
-bool VirtMem::swapIn(pid_t pid,OpenFile *file,Thread *t,uintptr_t addr) {
+size_t VirtMem::swapIn(pid_t pid,OpenFile *file,Thread *t,uintptr_t addr) {
 	VMRegion *vmreg = t->getProc()->getVM()->regtree.getByAddr(addr);
 	if(!vmreg)
-		return false;
+		return 0;
 
+	Region *reg = vmreg->reg;
 	addr &= ~(PAGE_SIZE - 1);
 	size_t index = (addr - vmreg->virt()) / PAGE_SIZE;
 
 	/* not swapped anymore? so probably another process has already swapped it in */
-	if(!(vmreg->reg->getPageFlags(index) & PF_SWAPPED))
-		return false;
+	if(!(reg->getPageFlags(index) & PF_SWAPPED))
+		return 0;
 
-	ulong block = vmreg->reg->getSwapBlock(index);
+	ulong block = reg->getSwapBlock(index);
 
+	/* if it's in the compressed pool, no I/O is required and thus, we don't read ahead */
+	if(ZSwap::load(block,buffer)) {
 #if DEBUG_SWAP
-	Log::get().writef("IN: %d of region %x (block %d)\n",index,vmreg->reg,block);
-	for(auto mp = vmreg->reg->vmbegin(); mp != vmreg->reg->vmend(); ++mp) {
-		VMRegion *mpreg = (*mp)->regtree.getByReg(vmreg->reg);
-		Log::get().writef("\tProcess %d:%s -> page %p\n",(*mp)->getProc()->getPid(),
-				(*mp)->getProc()->getProgram(),mpreg->virt() + index * PAGE_SIZE);
+		Log::get().writef("IN: page %d of region %x (block %d) from pool\n",index,reg,block);
+#endif
+		PageDir::copyToFrame(t->getFrame(),buffer);
+		setSwappedIn(reg,index,t->getFrame());
+		SwapMap::free(block);
+		return 1;
 	}
-	Log::get().writef("\n");
+	assert(file != NULL);
+
+	/* read the following pages of the region as well, if they have been written to the following
+	 * blocks. note that the thread holds the region-mutex */
+	size_t pages = BYTES_2_PAGES(reg->getByteCount());
+	size_t count = 1;
+	while(count <= SWAP_READAHEAD && index + count < pages &&
+			(reg->getPageFlags(index + count) & PF_SWAPPED) &&
+			reg->getSwapBlock(index + count) == block + count &&
+			!ZSwap::contains(block + count))
+		count++;
+
+	/* the thread has reserved one frame; the others are only read if there is memory left */
+	frameno_t frames[SWAP_READAHEAD + 1];
+	frames[0] = t->getFrame();
+	count = 1 + PhysMem::allocateSpare(frames + 1,count - 1);
+
+#if DEBUG_SWAP
+	Log::get().writef("IN: %zu pages starting with %d of region %x (block %d)\n",
+		count,index,reg,block);
 #endif
 
 	/* read into buffer (note that we can use the same for swap-in and swap-out because its both
 	 * done by the swapper-thread) */
 	sassert(file->seek(pid,block * PAGE_SIZE,SEEK_SET) >= 0);
-	sassert(file->read(pid,buffer,PAGE_SIZE) == PAGE_SIZE);
-
-	/* copy into a new frame */
-	frameno_t frame = t->getFrame();
-	PageDir::copyToFrame(frame,buffer);
+	sassert(file->read(pid,buffer,count * PAGE_SIZE) == (ssize_t)(count * PAGE_SIZE));
 
-	/* mark as not-swapped and map into all affected processes */
-	setSwappedIn(vmreg->reg,index,frame);
-	/* free swap-block */
-	SwapMap::free(block);
-	return true;
-}
+	for(size_t i = 0; i < count; ++i) {
+		/* copy into the new frame */
+		PageDir::copyToFrame(frames[i],buffer + i * PAGE_SIZE);
 
-void VirtMem::setTimestamp(Thread *t,uint64_t timestamp) {
-	/* ignore setting the timestamp if the process is currently locked; its not that critical and
-	 * we can't wait for the mutex here because this is called from Thread::switchAway() and the wait
-	 * for the mutex would call that as well */
-	VirtMem *vm = t->getProc()->getVM();
-	if(vm->tryAquire()) {
-		for(size_t i = 0; i < STACK_REG_COUNT; i++) {
-			if(t->getStackRegion(i))
-				t->getStackRegion(i)->reg->setTimestamp(timestamp);
-		}
-		for(auto reg = vm->regtree.begin(); reg != vm->regtree.end(); ++reg) {
-			if(!(reg->reg->getFlags() & RF_STACK))
-				reg->reg->setTimestamp(timestamp);
-		}
-		vm->release();
+		/* mark as not-swapped and map into all affected processes */
+		setSwappedIn(reg,index + i,frames[i]);
+		/* free swap-block */
+		SwapMap::free(block + i);
 	}
+	return count;
 }
 
 size_t VirtMem::getMemUsage(size_t *pages) const {
@@ -559,27 +673,46 @@ error:
 	return res;
 }
 
+long VirtMem::getRegFlags(uintptr_t addr) const {
+	long res = -EFAULT;
+	acquire();
+	VMRegion *reg = regtree.getByAddr(addr);
+	if(reg)
+		res = reg->reg->getFlags();
+	release();
+	return res;
+}
+
 int VirtMem::pagefault(uintptr_t addr,bool write) {
 	Thread *t = Thread::getRunning();
 	VMRegion *vmreg;
+	int res;
+
+	Trace::record(TRACE_PF_ENTER,t,addr,write);
 
 	/* we can swap here; note that we don't need page-tables in this case, they're always present */
-	if(!t->reserveFrames(1))
-		return -ENOMEM;
+	if(!t->reserveFrames(1)) {
+		res = -ENOMEM;
+		goto done;
+	}
 
-	VirtMem *vm = t->getProc()->getVM();
-	vm->acquire();
-	vmreg = vm->regtree.getByAddr(addr);
-	if(vmreg == NULL) {
+	{
+		VirtMem *vm = t->getProc()->getVM();
+		vm->acquire();
+		vmreg = vm->regtree.getByAddr(addr);
+		if(vmreg == NULL)
+			res = -EFAULT;
+		else {
+			vmreg->reg->acquire();
+			res = vm->doPagefault(addr,vmreg,write);
+			vmreg->reg->release();
+		}
 		vm->release();
 		t->discardFrames();
-		return -EFAULT;
 	}
-	vmreg->reg->acquire();
-	int res = vm->doPagefault(addr,vmreg,write);
-	vmreg->reg->release();
-	vm->release();
-	t->discardFrames();
+
+done:
+	Trace::record(TRACE_PF_EXIT,t,addr,res);
 	return res;
 }
 
@@ -706,9 +839,10 @@ void VirtMem::doUnmap(VMRegion *vm) {
 			virt += PAGE_SIZE;
 		}
 
-		/* now unmap it (do it here to prevent multiple calls for it (locking, ...) */
-		getPageDir()->unmap(vm->virt(),pcount,alloc);
-		addOwn(-alloc.pageTables());
+		/* now unmap it (do it here to prevent multiple calls for it (locking, ...). this can't fail,
+		 * because the whole region is removed, so that no large page needs to be split */
+		sassert(getPageDir()->unmap(vm->virt(),pcount,alloc) == 0);
+		addOwn(alloc.pageTables());
 
 		/* store next free stack-address, if its a stack */
 		if(vm->virt() + vm->reg->getByteCount() > freeStackAddr && (vm->reg->getFlags() & RF_STACK))
@@ -718,6 +852,8 @@ void VirtMem::doUnmap(VMRegion *vm) {
 			freemap.free(vm->virt(),ROUND_PAGE_UP(vm->reg->getByteCount()));
 		if(vm->virt() == dataAddr)
 			dataAddr = 0;
+		else if(vm->virt() == sharedInfoAddr)
+			sharedInfoAddr = 0;
 		/* remove from shared tree */
 		if(vm->reg->getFlags() & RF_SHAREABLE)
 			ShFiles::remove(vm);
@@ -730,13 +866,13 @@ void VirtMem::doUnmap(VMRegion *vm) {
 	}
 	else {
 		size_t sw,cow;
-		/* no free here, just unmap */
-		getPageDir()->unmap(vm->virt(),pcount,alloc);
+		/* no free here, just unmap (the whole region, so it can't fail) */
+		sassert(getPageDir()->unmap(vm->virt(),pcount,alloc) == 0);
 		/* in this case its always a shared region because otherwise there wouldn't be other users */
 		/* so we have to substract the present content-frames from the shared ones,
 		 * and the ptables from ours */
 		addShared(-vm->reg->pageCount(&sw,&cow));
-		addOwn(-alloc.pageTables());
+		addOwn(alloc.pageTables());
 		addSwap(-sw);
 		/* remove from shared tree */
 		if(vm->reg->getFlags() & RF_SHAREABLE)
@@ -841,7 +977,8 @@ int VirtMem::join(uintptr_t srcAddr,VirtMem *dst,VMRegion **nvm,uintptr_t *dstAd
 errUnmap:
 	dst->addShared(oldSh - dst->getSharedFrames());
 	dst->addOwn(oldOwn - dst->getOwnFrames());
-	getPageDir()->unmap(vm->virt(),pageCount,alloc);
+	/* the whole region is removed, so that no large page needs to be split */
+	sassert(dst->getPageDir()->unmap((*nvm)->virt(),pageCount,alloc) == 0);
 errRem:
 	vm->reg->remFrom(dst);
 errAdd:
@@ -858,7 +995,7 @@ errProc:
 	return res;
 }
 
-int VirtMem::cloneAll(VirtMem *dst) {
+int VirtMem::cloneAll(VirtMem *dst,bool stacksOnly) {
 	Thread *t = Thread::getRunning();
 	VMTree::iterator vm;
 	VMRegion *nvm;
@@ -877,11 +1014,14 @@ int VirtMem::cloneAll(VirtMem *dst) {
 	dst->sharedFrames = 0;
 	dst->ownFrames = 0;
 	dst->dataAddr = dataAddr;
+	/* the shared info page is not cloned if we just clone the stacks */
+	dst->sharedInfoAddr = stacksOnly ? 0 : sharedInfoAddr;
 
 	VMTree::addTree(dst,&dst->regtree);
 	for(vm = regtree.begin(); vm != regtree.end(); ++vm) {
 		/* just clone the tls- and stack-region of the current thread */
-		if(!(vm->reg->getFlags() & RF_STACK) || t->hasStackRegion(&*vm)) {
+		bool isStack = t->hasStackRegion(&*vm);
+		if(stacksOnly ? isStack : (!(vm->reg->getFlags() & RF_STACK) || isStack)) {
 			vm->reg->acquire();
 			/* TODO ?? better don't share the file; they may have to read in parallel */
 			if(vm->reg->getFlags() & RF_SHAREABLE) {
@@ -889,7 +1029,7 @@ int VirtMem::cloneAll(VirtMem *dst) {
 				reg = vm->reg;
 			}
 			else {
-				reg = cloneObj<Region>(*vm->reg,dst);
+				reg = createObj<Region>(*vm->reg,dst,!stacksOnly);
 				if(reg == NULL)
 					goto errorRel;
 			}
@@ -906,6 +1046,16 @@ int VirtMem::cloneAll(VirtMem *dst) {
 
 			/* now copy the pages */
 			size_t pageCount = BYTES_2_PAGES(nvm->reg->getByteCount());
+			if(stacksOnly) {
+				/* the stack starts empty, so that we just need the page-tables */
+				PageTables::UAllocator alloc;
+				if(dst->getPageDir()->map(nvm->virt(),pageCount,alloc,0) < 0)
+					goto errorFreeArea;
+				dst->addOwn(alloc.pageTables());
+				vm->reg->release();
+				continue;
+			}
+
 			ssize_t res = getPageDir()->clone(dst->getPageDir(),vm->virt(),nvm->virt(),pageCount,
 					vm->reg->getFlags() & RF_SHAREABLE);
 			if(res < 0)
@@ -929,31 +1079,18 @@ int VirtMem::cloneAll(VirtMem *dst) {
 					/* not when demand-load or swapping is outstanding since we've not loaded it
 					 * from disk yet */
 					else if(!(vm->reg->getPageFlags(j) & (PF_DEMANDLOAD | PF_SWAPPED))) {
-						bool marked = false;
 						frameno_t frameNo = getPageDir()->getFrameNo(virt);
 						/* if not already done, mark as cow for parent */
 						if(!(vm->reg->getPageFlags(j) & PF_COPYONWRITE)) {
-							if(!CopyOnWrite::add(frameNo))
-								goto errorPages;
+							CopyOnWrite::add(frameNo);
 							vm->reg->setPageFlags(j,vm->reg->getPageFlags(j) | PF_COPYONWRITE);
 							addShared(1);
 							addOwn(-1);
-							marked = true;
 						}
 						/* do it always for the child */
 						nvm->reg->setPageFlags(j,nvm->reg->getPageFlags(j) | PF_COPYONWRITE);
 						dst->addShared(1);
-						if(!CopyOnWrite::add(frameNo)) {
-							if(marked) {
-								bool other;
-								CopyOnWrite::remove(frameNo,&other);
-								if(!other)
-									vm->reg->setPageFlags(j,vm->reg->getPageFlags(j) & ~PF_COPYONWRITE);
-								addShared(-1);
-								addOwn(1);
-							}
-							goto errorPages;
-						}
+						CopyOnWrite::add(frameNo);
 					}
 					virt += PAGE_SIZE;
 				}
@@ -965,25 +1102,6 @@ int VirtMem::cloneAll(VirtMem *dst) {
 	release();
 	return 0;
 
-errorPages:
-	/* undo the stats-change for this and remove the frames from copy-on-write */
-	for(; j-- > 0; ) {
-		virt -= PAGE_SIZE;
-		if(!(vm->reg->getPageFlags(j) & (PF_DEMANDLOAD | PF_SWAPPED))) {
-			bool other;
-			frameno_t frameNo = getPageDir()->getFrameNo(virt);
-			CopyOnWrite::remove(frameNo,&other);
-			if(vm->reg->getPageFlags(j) & PF_COPYONWRITE) {
-				CopyOnWrite::remove(frameNo,&other);
-				/* if there are no other users of this frame, it's our own and we don't have to
-				 * mark it as copy-on-write anymore */
-				if(!other)
-					vm->reg->setPageFlags(j,vm->reg->getPageFlags(j) & ~PF_COPYONWRITE);
-				addShared(-1);
-				addOwn(1);
-			}
-		}
-	}
 errorFreeArea:
 	if(vm->virt() >= FREE_AREA_BEGIN)
 		dst->freemap.free(nvm->virt(),ROUND_PAGE_UP(nvm->reg->getByteCount()));
@@ -1092,14 +1210,31 @@ size_t VirtMem::doGrow(VMRegion *vm,ssize_t amount) {
 				}
 			}
 		}
+		/* unmap the pages before the region is shrunk, because we might have to split a large page,
+		 * which can fail */
+		uintptr_t virt;
+		if(amount < 0) {
+			if(oldSize < (size_t)-amount * PAGE_SIZE) {
+				vm->reg->release();
+				return 0;
+			}
+			if(vm->reg->getFlags() & RF_GROWS_DOWN)
+				virt = oldVirt;
+			else
+				virt = oldVirt + ROUND_PAGE_UP(oldSize) + amount * PAGE_SIZE;
+			if(getPageDir()->unmap(virt,-amount,alloc) < 0) {
+				vm->reg->release();
+				return 0;
+			}
+		}
+
 		size_t own = 0;
 		if((res = vm->reg->grow(amount,&own)) < 0) {
 			vm->reg->release();
 			return 0;
 		}
 
-		/* map / unmap pages */
-		uintptr_t virt;
+		/* map pages or account the unmapped ones */
 		if(amount > 0) {
 			uint mapFlags = PG_PRESENT;
 			if(vm->reg->getFlags() & RF_WRITABLE)
@@ -1125,17 +1260,13 @@ size_t VirtMem::doGrow(VMRegion *vm,ssize_t amount) {
 				freemap.allocate(amount * PAGE_SIZE);
 		}
 		else {
-			if(vm->reg->getFlags() & RF_GROWS_DOWN) {
-				virt = vm->virt();
+			if(vm->reg->getFlags() & RF_GROWS_DOWN)
 				vm->virt(vm->virt() - amount * PAGE_SIZE);
-			}
-			else
-				virt = vm->virt() + ROUND_PAGE_UP(vm->reg->getByteCount());
 			/* give it back to the free area */
 			if(vm->virt() >= FREE_AREA_BEGIN)
 				freemap.free(virt,-amount * PAGE_SIZE);
-			getPageDir()->unmap(virt,-amount,alloc);
-			addOwn(-(alloc.pageTables() - own));
+			/* splitting large pages might have allocated page-tables, too */
+			addOwn(alloc.pageTables() + own);
 			addSwap(-res);
 		}
 	}
@@ -1149,6 +1280,8 @@ const char *VirtMem::getRegName(const VMRegion *vm) const {
 	const char *name = "";
 	if(vm->virt() == dataAddr)
 		name = "data";
+	else if(vm->virt() == sharedInfoAddr)
+		name = "sharedinfo";
 	else if(vm->reg->getFlags() & RF_STACK)
 		name = "stack";
 	else if(vm->reg->getFlags() & RF_NOFREE)
@@ -1326,67 +1459,87 @@ error:
 	return err;
 }
 
-Region *VirtMem::getLRURegion() {
-	Region *lru = NULL;
-	uint64_t ts = (uint64_t)-1;
-	VMTree *tree = VMTree::reqTree();
-	for(; tree != NULL; tree = tree->getNext()) {
+size_t VirtMem::getVictims(Region **victim,size_t *pages,size_t max) {
+	size_t count = 0;
+	VMTree *head = VMTree::reqTree();
+	if(head == NULL) {
+		VMTree::relTree();
+		return 0;
+	}
+
+	/* find the tree of the process the clock-hand points to. if it doesn't exist anymore, start
+	 * at the beginning */
+	size_t trees = 0;
+	VMTree *tree = head;
+	for(VMTree *t = head; t != NULL; t = t->getNext()) {
+		if(t->getVM()->getProc()->getPid() == clockPid)
+			tree = t;
+		trees++;
+	}
+	if(tree == head && head->getVM()->getProc()->getPid() != clockPid) {
+		clockPid = head->getVM()->getProc()->getPid();
+		clockReg = clockPage = 0;
+	}
+
+	/* do at most two revolutions, because the first one might just clear the accessed-bits */
+	for(size_t i = 0; count == 0 && i <= trees * 2; ++i) {
 		/* same as below; we have to try to acquire the mutex, otherwise we risk a deadlock */
 		if(tree->getVM()->tryAquire()) {
-			for(auto vm = tree->cbegin(); vm != tree->cend(); ++vm) {
-				size_t count = 0;
-				if(vm->reg->getTimestamp() >= ts)
+			size_t regNo = 0;
+			for(auto vm = tree->begin(); vm != tree->end(); ++vm, ++regNo) {
+				if(regNo < clockReg)
 					continue;
 
 				/* we can't block here because otherwise we risk a deadlock. suppose that fs has to
-				 * swap out to get more memory. if we want to demand-load something before this operation
-				 * is finished and lock the region for that, the swapper will find this region at this
-				 * place locked. so we have to skip it in this case to be able to continue. */
+				 * swap out to get more memory. if we want to demand-load something before this
+				 * operation is finished and lock the region for that, the swapper will find this
+				 * region at this place locked. so we have to skip it in this case to be able to
+				 * continue. */
 				if(vm->reg->tryAquire()) {
 					/* skip locked regions */
-					if(~vm->reg->getFlags() & RF_LOCKED) {
-						size_t pages = BYTES_2_PAGES(vm->reg->getByteCount());
-						for(size_t j = 0; j < pages; j++) {
-							if(!(vm->reg->getPageFlags(j) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD))) {
-								count++;
-								break;
-							}
-						}
-					}
+					if(~vm->reg->getFlags() & RF_LOCKED)
+						count = scanRegion(vm->reg,pages,max);
 					if(count > 0) {
-						if(lru)
-							lru->release();
-						ts = vm->reg->getTimestamp();
-						lru = vm->reg;
+						*victim = vm->reg;
+						clockReg = regNo;
+						break;
 					}
-					else
-						vm->reg->release();
+					vm->reg->release();
 				}
+				clockPage = 0;
 			}
 			tree->getVM()->release();
 		}
+
+		if(count == 0) {
+			tree = tree->getNext() ? tree->getNext() : head;
+			clockPid = tree->getVM()->getProc()->getPid();
+			clockReg = clockPage = 0;
+		}
 	}
 	VMTree::relTree();
-	return lru;
+	return count;
 }
 
-ssize_t VirtMem::getPgIdxForSwap(const Region *reg) {
-	size_t pages = BYTES_2_PAGES(reg->getByteCount());
+size_t VirtMem::scanRegion(Region *reg,size_t *pages,size_t max) {
+	size_t total = BYTES_2_PAGES(reg->getByteCount());
 	size_t count = 0;
-	for(size_t i = 0; i < pages; i++) {
-		if(!(reg->getPageFlags(i) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD)))
-			count++;
-	}
-	if(count > 0) {
-		size_t index = Util::rand() % count;
-		for(size_t i = 0; i < pages; i++) {
-			if(!(reg->getPageFlags(i) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD))) {
-				if(index-- == 0)
-					return i;
-			}
+	for(; clockPage < total && count < max; ++clockPage) {
+		if(reg->getPageFlags(clockPage) & (PF_SWAPPED | PF_COPYONWRITE | PF_DEMANDLOAD))
+			continue;
+
+		/* give pages that have been accessed since the last revolution a second chance */
+		bool accessed = false;
+		for(auto mp = reg->vmbegin(); mp != reg->vmend(); ++mp) {
+			/* the region may be mapped to a different virtual address */
+			VMRegion *mpreg = (*mp)->regtree.getByReg(reg);
+			if((*mp)->getPageDir()->clearAccessed(mpreg->virt() + clockPage * PAGE_SIZE))
+				accessed = true;
 		}
+		if(!accessed)
+			pages[count++] = clockPage;
 	}
-	return -1;
+	return count;
 }
 
 void VirtMem::setSwappedOut(Region *reg,size_t index) {
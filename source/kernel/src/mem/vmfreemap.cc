@@ -76,6 +76,16 @@ uintptr_t VMFreeMap::allocate(size_t size) {
 	return res;
 }
 
+uintptr_t VMFreeMap::allocate(size_t size,size_t align) {
+	assert((size & 0xFFF) == 0);
+	for(Area *a = list; a != NULL; a = a->next) {
+		uintptr_t addr = ROUND_UP(a->addr,align);
+		if(addr >= a->addr && addr + size <= a->addr + a->size)
+			return allocateAt(addr,size) ? addr : 0;
+	}
+	return 0;
+}
+
 bool VMFreeMap::allocateAt(uintptr_t addr,size_t size) {
 	Area *a,*p = NULL;
 	for(a = list; a != NULL && addr > a->addr + a->size; p = a, a = a->next)
@@ -0,0 +1,180 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/cache.h>
+#include <mem/pagedir.h>
+#include <mem/zpool.h>
+#include <assert.h>
+#include <common.h>
+#include <lockguard.h>
+#include <ostream.h>
+#include <spinlock.h>
+#include <string.h>
+
+/* the zspages with at least one free object for each size-class. full zspages are in no list */
+ZPool::ZsPage *ZPool::partial[CLASS_COUNT];
+size_t ZPool::limit = 0;
+size_t ZPool::frameCount = 0;
+size_t ZPool::objCount = 0;
+SpinLock ZPool::lock;
+
+size_t ZPool::framesPerZsPage(size_t cls) {
+	/* use the number of frames with the least waste */
+	size_t best = 1,bestWaste = PAGE_SIZE;
+	for(size_t i = 1; i <= MAX_FRAMES; ++i) {
+		size_t waste = ((i * PAGE_SIZE) % objSize(cls)) / i;
+		if(waste < bestWaste) {
+			best = i;
+			bestWaste = waste;
+		}
+	}
+	return best;
+}
+
+bool ZPool::alloc(size_t size,Handle *h) {
+	assert(size > 0 && size <= PAGE_SIZE);
+	size_t cls = (size + CLASS_SIZE - 1) / CLASS_SIZE - 1;
+	LockGuard<SpinLock> g(&lock);
+
+	ZsPage *zp = partial[cls];
+	if(zp == NULL) {
+		zp = createZsPage(cls);
+		if(zp == NULL)
+			return false;
+		append(zp);
+	}
+
+	/* search for a free object */
+	size_t count = objsPerZsPage(cls);
+	size_t i;
+	for(i = 0; i < count; ++i) {
+		if(!(zp->bitmap[i / BITS_PER_WORD] & (1UL << (i % BITS_PER_WORD))))
+			break;
+	}
+	assert(i < count);
+	zp->bitmap[i / BITS_PER_WORD] |= 1UL << (i % BITS_PER_WORD);
+	if(++zp->used == count)
+		remove(zp);
+	objCount++;
+
+	h->page = zp;
+	h->index = i;
+	return true;
+}
+
+void ZPool::free(const Handle &h) {
+	LockGuard<SpinLock> g(&lock);
+	ZsPage *zp = h.page;
+	assert(zp->bitmap[h.index / BITS_PER_WORD] & (1UL << (h.index % BITS_PER_WORD)));
+	zp->bitmap[h.index / BITS_PER_WORD] &= ~(1UL << (h.index % BITS_PER_WORD));
+	objCount--;
+
+	/* if it was full, it can be used again */
+	if(zp->used-- == objsPerZsPage(zp->cls))
+		append(zp);
+	if(zp->used == 0) {
+		remove(zp);
+		destroyZsPage(zp);
+	}
+}
+
+void ZPool::copy(const Handle &h,void *buf,size_t size,bool write) {
+	assert(size <= objSize(h.page->cls));
+	uint8_t *ptr = (uint8_t*)buf;
+	size_t offset = h.index * objSize(h.page->cls);
+	while(size > 0) {
+		/* the object might span two frames */
+		frameno_t frame = h.page->frames[offset / PAGE_SIZE];
+		size_t off = offset % PAGE_SIZE;
+		size_t amount = MIN(PAGE_SIZE - off,size);
+		uint8_t *addr = (uint8_t*)PageDir::getAccess(frame) + off;
+		if(write)
+			memcpy(addr,ptr,amount);
+		else
+			memcpy(ptr,addr,amount);
+		PageDir::removeAccess(frame);
+		ptr += amount;
+		offset += amount;
+		size -= amount;
+	}
+}
+
+ZPool::ZsPage *ZPool::createZsPage(size_t cls) {
+	size_t frames = framesPerZsPage(cls);
+	if(frameCount + frames > limit)
+		return NULL;
+
+	ZsPage *zp = (ZsPage*)Cache::calloc(1,sizeof(ZsPage));
+	if(zp == NULL)
+		return NULL;
+	zp->cls = cls;
+	for(size_t i = 0; i < frames; ++i) {
+		/* kernel-frames are always accessible without a temporary mapping */
+		zp->frames[i] = PhysMem::allocate(PhysMem::KERN);
+		if(zp->frames[i] == INVALID_FRAME) {
+			while(i-- > 0)
+				PhysMem::free(zp->frames[i],PhysMem::KERN);
+			Cache::free(zp);
+			return NULL;
+		}
+	}
+	frameCount += frames;
+	return zp;
+}
+
+void ZPool::destroyZsPage(ZsPage *zp) {
+	size_t frames = framesPerZsPage(zp->cls);
+	for(size_t i = 0; i < frames; ++i)
+		PhysMem::free(zp->frames[i],PhysMem::KERN);
+	frameCount -= frames;
+	Cache::free(zp);
+}
+
+void ZPool::append(ZsPage *zp) {
+	zp->prev = NULL;
+	zp->next = partial[zp->cls];
+	if(zp->next)
+		zp->next->prev = zp;
+	partial[zp->cls] = zp;
+}
+
+void ZPool::remove(ZsPage *zp) {
+	if(zp->prev)
+		zp->prev->next = zp->next;
+	else
+		partial[zp->cls] = zp->next;
+	if(zp->next)
+		zp->next->prev = zp->prev;
+	zp->prev = zp->next = NULL;
+}
+
+void ZPool::print(OStream &os) {
+	LockGuard<SpinLock> g(&lock);
+	os.writef("Frames: %zu of %zu\n",frameCount,limit);
+	os.writef("Objects: %zu\n",objCount);
+	for(size_t i = 0; i < CLASS_COUNT; ++i) {
+		size_t count = 0;
+		for(ZsPage *zp = partial[i]; zp != NULL; zp = zp->next)
+			count++;
+		if(count > 0) {
+			os.writef("\tClass %4zu: %zu partial zspages with %zu frames\n",
+				objSize(i),count,framesPerZsPage(i));
+		}
+	}
+}
@@ -0,0 +1,162 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/cache.h>
+#include <mem/physmem.h>
+#include <mem/zpool.h>
+#include <mem/zswap.h>
+#include <sys/io.h>
+#include <vfs/openfile.h>
+#include <assert.h>
+#include <common.h>
+#include <lockguard.h>
+#include <lz4.h>
+#include <ostream.h>
+#include <spinlock.h>
+#include <string.h>
+
+ZSwap::Entry *ZSwap::entries = NULL;
+bool ZSwap::full = false;
+ulong ZSwap::first = NONE;
+ulong ZSwap::last = NONE;
+size_t ZSwap::storedBytes = 0;
+/* for compressing and decompressing; only used by the swapper-thread */
+uint8_t ZSwap::buffer[PAGE_SIZE];
+SpinLock ZSwap::lock;
+
+bool ZSwap::init(size_t blocks) {
+	entries = (Entry*)Cache::calloc(blocks,sizeof(Entry));
+	if(entries == NULL)
+		return false;
+	ZPool::setLimit(((PhysMem::getTotal() / PAGE_SIZE) * MAX_POOL_PERCENT) / 100);
+	return true;
+}
+
+bool ZSwap::store(ulong block,const void *page,bool force) {
+	const void *src = buffer;
+	size_t size = LZ4::compress(page,PAGE_SIZE,buffer,MAX_SIZE);
+	if(size == 0) {
+		/* without swap-device, we have to store incompressible pages as well */
+		if(!force)
+			return false;
+		src = page;
+		size = PAGE_SIZE;
+	}
+
+	ZPool::Handle h;
+	if(!ZPool::alloc(size,&h)) {
+		full = true;
+		return false;
+	}
+	ZPool::write(h,src,size);
+
+	LockGuard<SpinLock> g(&lock);
+	Entry *e = entries + block;
+	assert(e->size == 0);
+	e->handle = h;
+	e->size = size;
+	e->prev = last;
+	e->next = NONE;
+	if(last != NONE)
+		entries[last].next = block;
+	else
+		first = block;
+	last = block;
+	storedBytes += size;
+	return true;
+}
+
+bool ZSwap::load(ulong block,void *page) {
+	LockGuard<SpinLock> g(&lock);
+	Entry *e = entries + block;
+	if(e->size == 0)
+		return false;
+	decompress(e,page);
+	return true;
+}
+
+void ZSwap::decompress(const Entry *e,void *page) {
+	/* incompressible pages are stored uncompressed */
+	if(e->size == PAGE_SIZE)
+		ZPool::read(e->handle,page,PAGE_SIZE);
+	else {
+		ZPool::read(e->handle,buffer,e->size);
+		sassert(LZ4::decompress(buffer,e->size,page,PAGE_SIZE) == PAGE_SIZE);
+	}
+}
+
+void ZSwap::remove(ulong block) {
+	if(!entries)
+		return;
+	LockGuard<SpinLock> g(&lock);
+	doRemove(block);
+}
+
+void ZSwap::doRemove(ulong block) {
+	Entry *e = entries + block;
+	if(e->size == 0)
+		return;
+
+	ZPool::free(e->handle);
+	full = false;
+	storedBytes -= e->size;
+	e->size = 0;
+	if(e->prev != NONE)
+		entries[e->prev].next = e->next;
+	else
+		first = e->next;
+	if(e->next != NONE)
+		entries[e->next].prev = e->prev;
+	else
+		last = e->prev;
+}
+
+size_t ZSwap::writeBack(pid_t pid,OpenFile *file,size_t count) {
+	static uint8_t page[PAGE_SIZE];
+	size_t done = 0;
+	for(; done < count; ++done) {
+		ulong block;
+		{
+			LockGuard<SpinLock> g(&lock);
+			block = first;
+			if(block == NONE)
+				break;
+			decompress(entries + block,page);
+			/* the content is in <page> now; if the block is free'd meanwhile, we just write it in
+			 * vain. it can't be reused until we're done, because only the swapper allocates blocks */
+			doRemove(block);
+		}
+
+		sassert(file->seek(pid,block * PAGE_SIZE,SEEK_SET) >= 0);
+		sassert(file->write(pid,page,PAGE_SIZE) == PAGE_SIZE);
+	}
+	return done;
+}
+
+void ZSwap::print(OStream &os) {
+	os.writef("Enabled: %d\n",isEnabled());
+	if(!isEnabled())
+		return;
+
+	size_t pages = ZPool::getObjCount();
+	os.writef("Stored pages: %zu (%zu KiB)\n",pages,(pages * PAGE_SIZE) / 1024);
+	os.writef("Compressed: %zu KiB\n",storedBytes / 1024);
+	os.writef("Pool: %zu KiB\n",(ZPool::getFrameCount() * PAGE_SIZE) / 1024);
+	ZPool::print(os);
+}
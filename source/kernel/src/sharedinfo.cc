@@ -0,0 +1,49 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/pagedir.h>
+#include <mem/physmem.h>
+#include <task/timer.h>
+#include <common.h>
+#include <config.h>
+#include <sharedinfo.h>
+#include <string.h>
+#include <util.h>
+
+frameno_t SharedInfo::frame;
+sSharedInfo *SharedInfo::info = NULL;
+
+void SharedInfo::init() {
+	frame = PhysMem::allocate(PhysMem::KERN);
+	if(frame == INVALID_FRAME)
+		Util::panic("Unable to allocate frame for shared info page");
+
+	/* kernel frames are always accessible */
+	sSharedInfo *ninfo = (sSharedInfo*)PageDir::getAccess(frame);
+	memclear(ninfo,PAGE_SIZE);
+	ninfo->pageSize = PAGE_SIZE;
+	for(int i = 0; i < SHINFO_CONF_COUNT; ++i)
+		ninfo->conf[i] = Config::get(i);
+
+	time_t bootTime;
+	Timer::getTimeBase(&ninfo->tscPerUs,&ninfo->tscBase,&bootTime);
+	ninfo->bootTime = bootTime;
+	ninfo->timestamp = ninfo->tscPerUs ? 0 : Timer::getTimestamp();
+	info = ninfo;
+}
@@ -124,6 +124,10 @@ const Syscalls::Syscall Syscalls::syscalls[] = {
 	{gettimeofday,		"gettimeofday",		1},
 	{utime,				"utime",			2},
 	{truncate,			"truncate",			2},
+	{futexwait,			"futexwait",			3},
+	{futexwake,			"futexwake",			2},
+	{usleep,			"usleep",			1},
+	{spawn,				"spawn",			5},
 #if defined(__x86__)
 	{reqports,			"reqports",   		2},
 	{relports,			"relports",    		2},
@@ -20,6 +20,8 @@
 #include <dbg/console.h>
 #include <mem/cache.h>
 #include <mem/pagedir.h>
+#include <mem/virtmem.h>
+#include <task/proc.h>
 #include <task/thread.h>
 #include <task/timer.h>
 #include <boot.h>
@@ -42,8 +44,16 @@ int Syscalls::debugc(A_UNUSED Thread *t,IntrptStackFrame *stack) {
 	SYSC_RET1(stack,0);
 }
 
-int Syscalls::sysconf(A_UNUSED Thread *t,IntrptStackFrame *stack) {
+int Syscalls::sysconf(Thread *t,IntrptStackFrame *stack) {
 	int id = SYSC_ARG1(stack);
+	if(id == Config::SHARED_INFO) {
+		uintptr_t addr;
+		int res = t->getProc()->getVM()->mapSharedInfo(&addr);
+		if(EXPECT_FALSE(res < 0))
+			SYSC_ERROR(stack,res);
+		SYSC_RET1(stack,addr);
+	}
+
 	long res = Config::get(id);
 	if(EXPECT_FALSE(res < 0))
 		SYSC_ERROR(stack,res);
@@ -177,3 +177,26 @@ int Syscalls::exec(A_UNUSED Thread *t,IntrptStackFrame *stack) {
 		SYSC_ERROR(stack,res);
 	SYSC_RET1(stack,res);
 }
+
+int Syscalls::spawn(A_UNUSED Thread *t,IntrptStackFrame *stack) {
+	char pathSave[MAX_PATH_LEN + 1];
+	int kfds[SPAWN_MAX_FDS];
+	const char *path = (const char*)SYSC_ARG1(stack);
+	const char *const *args = (const char *const *)SYSC_ARG2(stack);
+	const char *const *env = (const char *const *)SYSC_ARG3(stack);
+	const int *fds = (const int*)SYSC_ARG4(stack);
+	size_t count = SYSC_ARG5(stack);
+	if(EXPECT_FALSE(!copyPath(pathSave,sizeof(pathSave),path)))
+		SYSC_ERROR(stack,-EFAULT);
+	if(fds) {
+		if(EXPECT_FALSE(count > SPAWN_MAX_FDS))
+			SYSC_ERROR(stack,-EINVAL);
+		if(EXPECT_FALSE(UserAccess::read(kfds,fds,count * sizeof(int)) < 0))
+			SYSC_ERROR(stack,-EFAULT);
+	}
+
+	int res = Proc::spawn(pathSave,args,env,fds ? kfds : NULL,count);
+	if(EXPECT_FALSE(res < 0))
+		SYSC_ERROR(stack,res);
+	SYSC_RET1(stack,res);
+}
@@ -20,6 +20,7 @@
 #include <mem/cache.h>
 #include <mem/pagedir.h>
 #include <task/filedesc.h>
+#include <task/futex.h>
 #include <task/proc.h>
 #include <task/sched.h>
 #include <task/sems.h>
@@ -66,8 +67,6 @@ int Syscalls::getcycles(Thread *t,IntrptStackFrame *stack) {
 int Syscalls::alarm(Thread *t,IntrptStackFrame *stack) {
 	time_t msecs = SYSC_ARG1(stack);
 	int res;
-	/* ensure that we're not already in the list */
-	Timer::removeThread(t->getTid());
 	if(EXPECT_FALSE((res = Timer::sleepFor(t->getTid(),msecs,false)) < 0))
 		SYSC_ERROR(stack,res);
 	SYSC_RET1(stack,0);
@@ -81,7 +80,19 @@ int Syscalls::sleep(Thread *t,IntrptStackFrame *stack) {
 	Thread::switchAway();
 	/* ensure that we're no longer in the timer-list. this may for example happen if we get a signal
 	 * and the sleep-time was not over yet. */
-	Timer::removeThread(t->getTid());
+	Timer::removeThread(t->getTid(),true);
+	if(EXPECT_FALSE(t->hasSignal()))
+		SYSC_ERROR(stack,-EINTR);
+	SYSC_RET1(stack,0);
+}
+
+int Syscalls::usleep(Thread *t,IntrptStackFrame *stack) {
+	ulong usecs = SYSC_ARG1(stack);
+	int res;
+	if(EXPECT_FALSE((res = Timer::usleepFor(t->getTid(),usecs,true)) < 0))
+		SYSC_ERROR(stack,res);
+	Thread::switchAway();
+	Timer::removeThread(t->getTid(),true);
 	if(EXPECT_FALSE(t->hasSignal()))
 		SYSC_ERROR(stack,-EINTR);
 	SYSC_RET1(stack,0);
@@ -156,3 +167,22 @@ int Syscalls::semdestr(Thread *t,IntrptStackFrame *stack) {
 	Sems::destroy(t->getProc(),sem);
 	SYSC_RET1(stack,0);
 }
+
+int Syscalls::futexwait(A_UNUSED Thread *t,IntrptStackFrame *stack) {
+	int *addr = (int*)SYSC_ARG1(stack);
+	int expected = (int)SYSC_ARG2(stack);
+	time_t msecs = SYSC_ARG3(stack);
+	int res = Futex::wait(addr,expected,msecs);
+	if(EXPECT_FALSE(res < 0))
+		SYSC_ERROR(stack,res);
+	SYSC_RET1(stack,0);
+}
+
+int Syscalls::futexwake(A_UNUSED Thread *t,IntrptStackFrame *stack) {
+	int *addr = (int*)SYSC_ARG1(stack);
+	uint count = (uint)SYSC_ARG2(stack);
+	int res = Futex::wake(addr,count);
+	if(EXPECT_FALSE(res < 0))
+		SYSC_ERROR(stack,res);
+	SYSC_RET1(stack,res);
+}
@@ -75,6 +75,50 @@ int FileDesc::clone(Proc *p) {
 	return 0;
 }
 
+int FileDesc::remap(Proc *p,const int *fds,size_t count) {
+	Proc *cur = Thread::getRunning()->getProc();
+	if(count > MAX_FD_COUNT)
+		return -EINVAL;
+
+	/* make room for all fds; p is not running yet, so nobody else can access its fds */
+	if(count > p->fileDescsSize) {
+		/* use the next power of two, because assoc() doubles the size until MAX_FD_COUNT, which is
+		 * a power of two as well. count is in [2 .. MAX_FD_COUNT] here, so that this can't overflow */
+		size_t size = 1UL << (sizeof(ulong) * 8 - __builtin_clzl(count - 1));
+		OpenFile **nfds = (OpenFile**)Cache::realloc(p->fileDescs,size * sizeof(OpenFile*));
+		if(!nfds)
+			return -ENOMEM;
+		memclear(nfds + p->fileDescsSize,(size - p->fileDescsSize) * sizeof(OpenFile*));
+		p->fileDescs = nfds;
+		p->fileDescsSize = size;
+	}
+
+	cur->lock(PLOCK_FDS);
+	for(size_t i = 0; i < count; i++) {
+		if(fds[i] != -1 && (!isValid(cur,fds[i]) || cur->fileDescs[fds[i]] == NULL)) {
+			cur->unlock(PLOCK_FDS);
+			return -EBADF;
+		}
+	}
+
+	/* first take the new references, because a file might be replaced and mapped elsewhere */
+	for(size_t i = 0; i < count; i++) {
+		if(fds[i] != -1)
+			cur->fileDescs[fds[i]]->incRefs();
+	}
+	for(size_t i = 0; i < count; i++) {
+		OpenFile *old = p->fileDescs[i];
+		p->fileDescs[i] = fds[i] != -1 ? cur->fileDescs[fds[i]] : NULL;
+		if(old != NULL) {
+			old->incUsages();
+			if(!old->close(p->getPid()))
+				old->decUsages();
+		}
+	}
+	cur->unlock(PLOCK_FDS);
+	return 0;
+}
+
 void FileDesc::destroy(Proc *p) {
 	p->lock(PLOCK_FDS);
 	for(size_t i = 0; i < p->fileDescsSize; i++) {
@@ -0,0 +1,147 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/pagedir.h>
+#include <mem/virtmem.h>
+#include <task/futex.h>
+#include <task/proc.h>
+#include <task/sched.h>
+#include <task/thread.h>
+#include <task/timer.h>
+#include <common.h>
+#include <errno.h>
+
+Futex::Bucket Futex::buckets[BUCKET_COUNT];
+
+int Futex::getKey(USER int *addr,Key *key,frameno_t *frame) {
+	if(EXPECT_FALSE(((uintptr_t)addr % sizeof(int)) != 0 ||
+			!PageDir::isInUserSpace((uintptr_t)addr,sizeof(int))))
+		return -EFAULT;
+
+	/* the write-fault below succeeds for not yet loaded pages of read-only regions, too */
+	Proc *p = Thread::getRunning()->getProc();
+	long flags = p->getVM()->getRegFlags((uintptr_t)addr);
+	if(EXPECT_FALSE(flags < 0 || !(flags & RF_WRITABLE)))
+		return -EFAULT;
+
+	/* never touch the word directly, because the kernel can't handle page-faults on arbitrary user
+	 * addresses. instead, handle a write-fault for it to resolve copy-on-write and bring it into
+	 * memory, if necessary. this way, wait() can read the word via its frame afterwards. */
+	PageDir *pdir = p->getPageDir();
+	for(int i = 0; ; ++i) {
+		if(EXPECT_FALSE(i == FAULT_TRIES || VirtMem::pagefault((uintptr_t)addr,true) < 0))
+			return -EFAULT;
+		/* it might have been swapped out again in the meantime */
+		if(EXPECT_TRUE(pdir->isPresent((uintptr_t)addr)))
+			break;
+	}
+
+	*frame = pdir->getFrameNo((uintptr_t)addr);
+	if(flags & RF_SHAREABLE) {
+		key->space = 0;
+		key->addr = *frame * PAGE_SIZE + ((uintptr_t)addr & (PAGE_SIZE - 1));
+	}
+	else {
+		key->space = (uintptr_t)p->getVM();
+		key->addr = (uintptr_t)addr;
+	}
+	return 0;
+}
+
+int Futex::wait(USER int *addr,int expected,time_t msecs) {
+	Thread *t = Thread::getRunning();
+	PageDir *pdir = t->getProc()->getPageDir();
+	Bucket *b;
+	Key key;
+	frameno_t frame;
+	for(int i = 0; ; ++i) {
+		if(EXPECT_FALSE(i == FAULT_TRIES))
+			return -EFAULT;
+		int res = getKey(addr,&key,&frame);
+		if(EXPECT_FALSE(res < 0))
+			return res;
+
+		b = getBucket(key);
+		b->lock.down();
+		/* the frame might have changed in the meantime and we would read a stale value */
+		if(EXPECT_TRUE(pdir->isPresent((uintptr_t)addr) &&
+				pdir->getFrameNo((uintptr_t)addr) == frame))
+			break;
+		b->lock.up();
+	}
+
+	/* check the value again while holding the lock, because wake() has to acquire it as well.
+	 * read it via the physical address to not cause a page-fault here */
+	uintptr_t access = PageDir::getAccess(frame);
+	int val = *(volatile int*)(access + ((uintptr_t)addr & (PAGE_SIZE - 1)));
+	PageDir::removeAccess(frame);
+	if(val != expected) {
+		b->lock.up();
+		return -EWOULDBLOCK;
+	}
+
+	int res = 0;
+	Waiter w(t,key);
+	b->waiters.append(&w);
+	if(msecs) {
+		res = Timer::sleepFor(t->getTid(),msecs,true);
+		if(EXPECT_FALSE(res < 0)) {
+			b->waiters.remove(&w);
+			b->lock.up();
+			return res;
+		}
+	}
+	else
+		t->block();
+	b->lock.up();
+
+	Thread::switchAway();
+
+	if(msecs)
+		Timer::removeThread(t->getTid(),true);
+	b->lock.down();
+	if(!w.woken) {
+		b->waiters.remove(&w);
+		res = t->hasSignal() ? -EINTR : -ETIMEOUT;
+	}
+	b->lock.up();
+	return res;
+}
+
+int Futex::wake(USER int *addr,uint count) {
+	Key key;
+	frameno_t frame;
+	int res = getKey(addr,&key,&frame);
+	if(EXPECT_FALSE(res < 0))
+		return res;
+
+	int woken = 0;
+	Bucket *b = getBucket(key);
+	LockGuard<SpinLock> g(&b->lock);
+	for(auto it = b->waiters.begin(); (uint)woken < count && it != b->waiters.end(); ) {
+		Waiter *w = &*it++;
+		if(w->key == key) {
+			b->waiters.remove(w);
+			w->woken = true;
+			Sched::unblock(w->thread);
+			woken++;
+		}
+	}
+	return woken;
+}
@@ -38,6 +38,7 @@
 #include <vfs/openfile.h>
 #include <vfs/vfs.h>
 #include <assert.h>
+#include <atomic.h>
 #include <common.h>
 #include <errno.h>
 #include <interrupts.h>
@@ -232,6 +233,79 @@ void ProcBase::getMemUsage(size_t *dataShared,size_t *dataOwn,size_t *dataReal)
 }
 
 int ProcBase::clone(uint8_t flags) {
+	return doClone(flags,false,NULL,0);
+}
+
+int ProcBase::spawn(const char *path,USER const char *const *args,USER const char *const *env,
+		const int *fds,size_t fdCount) {
+	char *argBuffer;
+	int argc,envc,res;
+	size_t argSize;
+	Thread *t = Thread::getRunning();
+
+	/* copy the arguments now; the child won't see our address-space */
+	res = buildArgBuffer(args,env,&argBuffer,&argc,&envc,&argSize);
+	if(res < 0)
+		return res;
+
+	SpawnState *spawn = new SpawnState();
+	if(!spawn) {
+		Cache::free(argBuffer);
+		return -ENOMEM;
+	}
+
+	res = doClone(0,true,fds,fdCount);
+	if(res == 0) {
+		/* child: our path and the argument buffer have been copied with the kernel-stack. on
+		 * success, we return to the new program. on failure, we have no program to return to */
+		if(doExec(path,argc,envc,argBuffer,argSize,spawn) < 0) {
+			terminate(1,SIG_COUNT);
+			A_UNREACHED;
+		}
+		return 0;
+	}
+
+	if(res < 0) {
+		Cache::free(argBuffer);
+		delete spawn;
+		return res;
+	}
+
+	/* parent: wait until the child has loaded the program or failed to do so */
+	pid_t pid = res;
+	spawn->done.down();
+	res = spawn->res;
+	if(Atomic::fetch_and_add(&spawn->refs,-1) == 1)
+		delete spawn;
+
+	if(res < 0) {
+		/* the child terminates itself; reap it to not leave a zombie behind */
+		Proc *p = t->getProc();
+		int dead;
+		childLock.down();
+		while((dead = getExitState(p->pid,pid,NULL)) == 0) {
+			t->wait(EV_CHILD_DIED,(evobj_t)p);
+			childLock.up();
+			Thread::switchNoSigs();
+			childLock.down();
+		}
+		childLock.up();
+		/* somebody else might have collected it already */
+		if(dead > 0)
+			kill(pid);
+		return res;
+	}
+	return pid;
+}
+
+void ProcBase::finishSpawn(SpawnState *spawn,int res) {
+	spawn->res = res;
+	spawn->done.up();
+	if(Atomic::fetch_and_add(&spawn->refs,-1) == 1)
+		delete spawn;
+}
+
+int ProcBase::doClone(uint8_t flags,bool spawn,const int *fds,size_t fdCount) {
 	int newPid,res = 0;
 	Proc *p,*cur;
 	Thread *nt,*curThread = Thread::getRunning();
@@ -314,7 +388,7 @@ int ProcBase::clone(uint8_t flags) {
 
 	/* clone regions */
 	p->virtmem.init(p);
-	if((res = cur->virtmem.cloneAll(&p->virtmem)) < 0)
+	if((res = cur->virtmem.cloneAll(&p->virtmem,spawn)) < 0)
 		goto errorGroups;
 
 	/* clone current thread */
@@ -328,6 +402,8 @@ int ProcBase::clone(uint8_t flags) {
 	/* inherit file-descriptors */
 	if((res = FileDesc::clone(p)) < 0)
 		goto errorThreadAppend;
+	if(fds && (res = FileDesc::remap(p,fds,fdCount)) < 0)
+		goto errorFileDescs;
 
 	/* init arch-dependent stuff */
 	if((res = cloneArch(p,cur) < 0))
@@ -437,13 +513,61 @@ errorReqProc:
 
 int ProcBase::exec(const char *path,USER const char *const *args,USER const char *const *env) {
 	char *argBuffer;
+	int argc,envc;
+	size_t argSize;
+	int res = buildArgBuffer(args,env,&argBuffer,&argc,&envc,&argSize);
+	if(res < 0)
+		return res;
+	return doExec(path,argc,envc,argBuffer,argSize);
+}
+
+int ProcBase::buildArgBuffer(USER const char *const *args,USER const char *const *env,
+		char **argBuffer,int *argc,int *envc,size_t *argSize) {
+	size_t rem = EXEC_MAX_ARGSIZE;
+	*argc = 0;
+	*envc = 0;
+	*argBuffer = NULL;
+	if(args != NULL || env != NULL) {
+		/* alloc space for the arguments */
+		*argBuffer = (char*)Cache::alloc(EXEC_MAX_ARGSIZE);
+		if(*argBuffer == NULL)
+			return -ENOMEM;
+
+		/* copy arguments into buffer */
+		if(args != NULL) {
+			*argc = buildArgs(args,*argBuffer,&rem);
+			if(*argc < 0)
+				goto error;
+		}
+
+		/* copy env into buffer */
+		if(env != NULL) {
+			size_t current = EXEC_MAX_ARGSIZE - rem;
+			*envc = buildArgs(env,*argBuffer + current,&rem);
+			if(*envc < 0)
+				goto error;
+		}
+	}
+	*argSize = EXEC_MAX_ARGSIZE - rem;
+	return 0;
+
+error:
+	Cache::free(*argBuffer);
+	return *argc < 0 ? *argc : *envc;
+}
+
+int ProcBase::doExec(const char *path,int argc,int envc,char *argBuffer,size_t argSize,
+		SpawnState *spawn) {
 	ELF::StartupInfo info;
 	Thread *t = Thread::getRunning();
 	Proc *p = request(t->getProc()->pid,PLOCK_PROG);
-	size_t argSize = EXEC_MAX_ARGSIZE;
-	int argc,envc,res,fd = -1;
-	if(!p)
+	int res,fd = -1;
+	if(!p) {
+		Cache::free(argBuffer);
+		if(spawn)
+			finishSpawn(spawn,-ESRCH);
 		return -ESRCH;
+	}
 	/* don't allow exec when the process should die */
 	if(p->flags & (P_ZOMBIE | P_PREZOMBIE)) {
 		res = -EINVAL;
@@ -456,53 +580,22 @@ int ProcBase::exec(const char *path,USER const char *const *args,USER const char
 		goto error;
 	}
 
-	argc = 0;
-	envc = 0;
-	argBuffer = NULL;
-	if(args != NULL || env != NULL) {
-		/* alloc space for the arguments */
-		argBuffer = (char*)Cache::alloc(EXEC_MAX_ARGSIZE);
-		if(argBuffer == NULL) {
-			res = -ENOMEM;
-			goto error;
-		}
-
-		/* copy arguments into buffer */
-		if(args != NULL) {
-			argc = buildArgs(args,argBuffer,&argSize);
-			if(argc < 0) {
-				res = argc;
-				goto errorFree;
-			}
-		}
-
-		/* copy env into buffer */
-		if(env != NULL) {
-			size_t current = EXEC_MAX_ARGSIZE - argSize;
-			envc = buildArgs(env,argBuffer + current,&argSize);
-			if(envc < 0) {
-				res = envc;
-				goto errorFree;
-			}
-		}
-	}
-	argSize = EXEC_MAX_ARGSIZE - argSize;
-
 	/* remove all except stack */
 	doRemoveRegions(p,false);
 
 	/* load program */
-	if(ELF::load(path,&info) < 0)
+	if((res = ELF::load(path,&info)) < 0)
 		goto errorTerm;
 
 	/* if its the dynamic linker, we need to give it the file-descriptor for the program to load */
 	/* we need to do this here without lock, because VFS::openPath will perform a context-switch */
 	if(info.linkerEntry != info.progEntry) {
 		OpenFile *file;
-		if(VFS::openPath(p->pid,VFS_READ,0,path,&file) < 0)
+		if((res = VFS::openPath(p->pid,VFS_READ,0,path,&file)) < 0)
 			goto errorTerm;
 		fd = FileDesc::assoc(p,file);
 		if(fd < 0) {
+			res = fd;
 			file->close(p->pid);
 			goto errorTerm;
 		}
@@ -530,21 +623,28 @@ int ProcBase::exec(const char *path,USER const char *const *args,USER const char
 	release(p,PLOCK_PROG);
 
 	/* for starting use the linker-entry, which will be progEntry if no dl is present */
-	if(!UEnv::setupProc(argc,envc,argBuffer,argSize,&info,info.linkerEntry,fd))
+	if(!UEnv::setupProc(argc,envc,argBuffer,argSize,&info,info.linkerEntry,fd)) {
+		res = -ENOMEM;
 		goto errorTermNoRel;
+	}
 	Cache::free(argBuffer);
+	if(spawn)
+		finishSpawn(spawn,0);
 	return 0;
 
-errorFree:
-	Cache::free(argBuffer);
 error:
 	release(p,PLOCK_PROG);
+	Cache::free(argBuffer);
+	if(spawn)
+		finishSpawn(spawn,res);
 	return res;
 
 errorTerm:
 	release(p,PLOCK_PROG);
 errorTermNoRel:
 	Cache::free(argBuffer);
+	if(spawn)
+		finishSpawn(spawn,res);
 	terminate(1,SIG_COUNT);
 	A_UNREACHED;
 }
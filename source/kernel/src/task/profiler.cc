@@ -0,0 +1,185 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/cache.h>
+#include <mem/useraccess.h>
+#include <task/profiler.h>
+#include <task/proc.h>
+#include <task/smp.h>
+#include <task/thread.h>
+#include <task/timer.h>
+#include <vfs/node.h>
+#include <common.h>
+#include <errno.h>
+#include <string.h>
+
+Profiler::Ring *Profiler::rings = NULL;
+volatile bool Profiler::enabled = false;
+uint64_t Profiler::interval = 1000000 / PROF_DEF_FREQ;
+
+void Profiler::init(VFSNode *sysNode) {
+	VFSNode::release(createObj<ProfileFile>(KERNEL_PID,sysNode));
+}
+
+int Profiler::start(uint freq) {
+	if(freq == 0 || freq > PROF_MAX_FREQ)
+		return -EINVAL;
+
+	/* the buffers are allocated on first use and kept afterwards */
+	if(rings == NULL) {
+		Ring *r = (Ring*)Cache::calloc(SMP::getCPUCount(),sizeof(Ring));
+		if(r == NULL)
+			return -ENOMEM;
+		rings = r;
+	}
+
+	interval = 1000000 / freq;
+	enabled = true;
+	return 0;
+}
+
+void Profiler::reset() {
+	if(rings == NULL)
+		return;
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i) {
+		LockGuard<SpinLock> g(&rings[i].lock);
+		rings[i].tail = rings[i].head;
+	}
+}
+
+void Profiler::sample(Thread *t,const IntrptStackFrame *stack) {
+	/* there is nothing to learn from the idle-threads */
+	if(!enabled || (t->getFlags() & T_IDLE))
+		return;
+
+	cpuid_t cpu = t->getCPU();
+	Ring *r = rings + cpu;
+	uint64_t now = Timer::getTimestamp();
+	/* the timer fires for other reasons as well; we're fine with half the interval */
+	if(now - r->lastSample < interval / 2)
+		return;
+	r->lastSample = now;
+
+	LockGuard<SpinLock> g(&r->lock);
+	/* overwrite the oldest sample, if nobody reads them */
+	if(r->head - r->tail == RING_SIZE)
+		r->tail++;
+
+	sProfSample *s = r->samples + (r->head % RING_SIZE);
+	s->time = now;
+	s->pid = t->getProc()->getPid();
+	s->tid = t->getTid();
+	s->cpu = cpu;
+	s->flags = 0;
+	s->depth = 0;
+	unwind(t,stack,s);
+	if(s->depth > 0)
+		r->head++;
+}
+
+size_t Profiler::getCount() {
+	size_t total = 0;
+	if(rings) {
+		for(size_t i = 0; i < SMP::getCPUCount(); ++i)
+			total += rings[i].head - rings[i].tail;
+	}
+	return total;
+}
+
+size_t Profiler::peek(sProfSample *samples,size_t count,size_t *tails) {
+	size_t total = 0;
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i) {
+		Ring *r = rings + i;
+		LockGuard<SpinLock> g(&r->lock);
+		size_t tail = r->tail;
+		while(tail != r->head && total < count)
+			samples[total++] = r->samples[tail++ % RING_SIZE];
+		tails[i] = tail;
+	}
+	return total;
+}
+
+void Profiler::consume(const size_t *tails) {
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i) {
+		Ring *r = rings + i;
+		LockGuard<SpinLock> g(&r->lock);
+		/* the samples might have been overwritten or dropped in the meantime */
+		if((ssize_t)(tails[i] - r->tail) > 0)
+			r->tail = tails[i];
+	}
+}
+
+ssize_t Profiler::ProfileFile::read(A_UNUSED pid_t pid,A_UNUSED OpenFile *file,USER void *buffer,
+		A_UNUSED off_t offset,size_t count) {
+	/* the samples are removed when they are read, so that the offset doesn't matter */
+	count = MIN(count / sizeof(sProfSample),Profiler::RING_SIZE);
+	if(count == 0 || Profiler::rings == NULL)
+		return 0;
+
+	size_t cpus = SMP::getCPUCount();
+	sProfSample *samples = (sProfSample*)Cache::alloc(count * sizeof(sProfSample));
+	size_t *tails = (size_t*)Cache::alloc(cpus * sizeof(size_t));
+	if(samples == NULL || tails == NULL) {
+		Cache::free(tails);
+		Cache::free(samples);
+		return -ENOMEM;
+	}
+
+	/* copy them out first and remove them only if that succeeded, so that nothing gets lost */
+	ssize_t res = Profiler::peek(samples,count,tails) * sizeof(sProfSample);
+	if(res > 0) {
+		int err = UserAccess::write(buffer,samples,res);
+		if(err < 0)
+			res = err;
+		else
+			Profiler::consume(tails);
+	}
+	Cache::free(tails);
+	Cache::free(samples);
+	acctime = Timer::getTime();
+	return res;
+}
+
+ssize_t Profiler::ProfileFile::write(A_UNUSED pid_t pid,A_UNUSED OpenFile *file,
+		USER const void *buffer,A_UNUSED off_t offset,size_t count) {
+	char cmd[32];
+	size_t len = MIN(count,sizeof(cmd) - 1);
+	int res = UserAccess::read(cmd,buffer,len);
+	if(res < 0)
+		return res;
+	cmd[len] = '\0';
+
+	if(strncmp(cmd,"start",5) == 0) {
+		uint freq = PROF_DEF_FREQ;
+		if(cmd[5] == ' ')
+			freq = atoi(cmd + 6);
+		else if(cmd[5] != '\0' && cmd[5] != '\n')
+			return -EINVAL;
+		res = Profiler::start(freq);
+	}
+	else if(strncmp(cmd,"stop",4) == 0)
+		Profiler::stop();
+	else if(strncmp(cmd,"reset",5) == 0)
+		Profiler::reset();
+	else
+		res = -EINVAL;
+
+	modtime = Timer::getTime();
+	return res < 0 ? res : (ssize_t)count;
+}
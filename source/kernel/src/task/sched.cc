@@ -29,6 +29,7 @@
 #include <log.h>
 #include <spinlock.h>
 #include <string.h>
+#include <trace.h>
 #include <util.h>
 #include <video.h>
 
@@ -153,6 +154,9 @@ Thread *Sched::perform(Thread *old,cpuid_t cpu) {
 		t->setNewState(Thread::READY);
 	}
 
+	if(old && t != old)
+		Trace::record(TRACE_SCHED,old,t->getTid(),t->getProc()->getPid());
+
 	/* if there is another thread ready, check if we have another cpu that we can start for it */
 	if(rdyCount > 0)
 		SMP::wakeupCPU();
@@ -268,6 +272,9 @@ void Sched::setReady(Thread *t) {
 	else if(setReadyState(t)) {
 		assert(t->event == 0);
 		enqueue(t);
+		/* idle CPUs don't get timer interrupts in tickless mode, so that we have to notify them */
+		if(Timer::isTickless())
+			SMP::wakeupCPU();
 	}
 }
 
@@ -292,6 +299,8 @@ void Sched::setReadyQuick(Thread *t) {
 	else if(setReadyState(t)) {
 		assert(t->event == 0);
 		enqueueQuick(t);
+		if(Timer::isTickless())
+			SMP::wakeupCPU();
 	}
 }
 
@@ -123,6 +123,8 @@ void ThreadBase::initProps() {
 	reqFrames = esc::ISList<frameno_t>();
 	threadListItem = ListItem(static_cast<Thread*>(this));
 	signalListItem = ListItem(static_cast<Thread*>(this));
+	sleepListener = TimerBase::Listener(static_cast<Thread*>(this));
+	alarmListener = NULL;
 	refs = 1;
 }
 
@@ -189,17 +191,21 @@ void ThreadBase::updateRuntimes() {
 }
 
 bool ThreadBase::reserveFrames(size_t count,bool swap) {
+	frameno_t frames[FRAME_BATCH_SIZE];
 	while(count > 0) {
 		if(!PhysMem::reserve(count,swap)) {
 			discardFrames();
 			return false;
 		}
-		for(size_t i = count; i > 0; i--) {
-			frameno_t frm = PhysMem::allocate(PhysMem::USR);
-			if(frm == INVALID_FRAME)
+		/* allocate them in batches to reduce the locking overhead */
+		while(count > 0) {
+			size_t amount = MIN(count,ARRAY_SIZE(frames));
+			size_t got = PhysMem::allocate(PhysMem::USR,frames,amount);
+			for(size_t i = 0; i < got; ++i)
+				reqFrames.append(frames[i]);
+			count -= got;
+			if(got < amount)
 				break;
-			reqFrames.append(frm);
-			count--;
 		}
 	}
 	return true;
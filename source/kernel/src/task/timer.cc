@@ -18,160 +18,322 @@
  */
 
 #include <task/proc.h>
+#include <task/profiler.h>
 #include <task/sched.h>
+#include <task/signals.h>
 #include <task/smp.h>
+#include <task/thread.h>
 #include <task/timer.h>
 #include <common.h>
 #include <errno.h>
+#include <sharedinfo.h>
 #include <spinlock.h>
 #include <util.h>
 #include <video.h>
 
-/* total elapsed milliseconds */
 TimerBase::PerCPU *TimerBase::perCPU = NULL;
-time_t TimerBase::lastRuntimeUpdate = 0;
-
-SpinLock TimerBase::lock;
-TimerBase::Listener TimerBase::listenObjs[LISTENER_COUNT];
-TimerBase::Listener *TimerBase::freeList;
-TimerBase::Listener *TimerBase::listener = NULL;
+size_t TimerBase::cpuCount = 0;
+uint64_t TimerBase::lastRuntimeUpdate = 0;
+uint64_t TimerBase::tickTime = 0;
+static SpinLock runtimeLock;
 
 void TimerBase::init() {
 	archInit();
 
-	perCPU = (PerCPU*)Cache::calloc(SMP::getCPUCount(),sizeof(PerCPU));
+	/* all-zero is a valid initial state for the wheels */
+	cpuCount = SMP::getCPUCount();
+	perCPU = (PerCPU*)Cache::calloc(cpuCount,sizeof(PerCPU));
 	if(!perCPU)
 		Util::panic("Unable to create per-cpu-array");
+	for(size_t i = 0; i < cpuCount; ++i)
+		perCPU[i].deadline = NO_DEADLINE;
+}
 
-	/* init objects */
-	listenObjs->next = NULL;
-	freeList = listenObjs;
-	for(size_t i = 1; i < LISTENER_COUNT; i++) {
-		listenObjs[i].next = freeList;
-		freeList = listenObjs + i;
-	}
+cpuid_t TimerBase::getWheelId(cpuid_t cpu) {
+	/* without a per-CPU timer, only the BSP gets interrupts */
+	return Timer::isTickless() ? cpu : 0;
 }
 
-int TimerBase::sleepFor(tid_t tid,time_t msecs,bool block) {
-	LockGuard<SpinLock> g(&lock);
-	Listener *l = freeList;
+TimerBase::Listener *TimerBase::getListener(Thread *t,bool block,bool create) {
+	if(block)
+		return &t->sleepListener;
+	/* alarms are rare, so that we don't want to make all threads larger for that */
+	if(!t->alarmListener && create)
+		t->alarmListener = new Listener(t);
+	return t->alarmListener;
+}
+
+int TimerBase::usleepFor(tid_t tid,uint64_t usecs,bool block) {
+	Thread *t = Thread::getById(tid);
+	Listener *l = getListener(t,block,true);
 	if(l == NULL)
 		return -ENOMEM;
+	/* a thread can only sleep once and have one alarm at a time */
+	removeListener(l);
 
-	/* remove from freelist */
-	freeList = freeList->next;
-	/* find place and calculate time */
-	l->tid = tid;
-	time_t msecDiff = 0;
-	Listener *p = NULL;
-	Listener *nl;
-	for(nl = listener; nl != NULL; p = nl, nl = nl->next) {
-		if(msecDiff + nl->time > msecs)
-			break;
-		msecDiff += nl->time;
-	}
-
-	l->time = msecs - msecDiff;
-	l->block = block;
-	/* insert entry */
-	l->next = nl;
-	if(p)
-		p->next = l;
-	else
-		listener = l;
+	cpuid_t cpu = Thread::getRunning()->getCPU();
+	Wheel *w = &perCPU[getWheelId(cpu)].wheel;
+	uint64_t now = getTimestamp();
+	bool earlier;
+	{
+		LockGuard<SpinLock> g(&w->lock);
+		l->expiry = now + usecs;
+		l->cpu = getWheelId(cpu);
+		l->block = block;
+		l->active = true;
+		insert(w,l);
+		earlier = l->expiry < perCPU[cpu].deadline;
 
-	/* now change time of next one */
-	if(nl)
-		nl->time -= l->time;
+		/* put thread to sleep */
+		if(block)
+			t->block();
+	}
 
-	/* put process to sleep */
-	if(block)
-		Thread::getById(tid)->block();
+	/* make sure that the timer device fires in time */
+	if(Timer::isTickless() && earlier) {
+		perCPU[cpu].deadline = l->expiry;
+		Timer::program(l->expiry,now);
+	}
 	return 0;
 }
 
 void TimerBase::removeThread(tid_t tid) {
-	LockGuard<SpinLock> g(&lock);
-	Listener *p = NULL;
-	for(Listener *l = listener; l != NULL; p = l, l = l->next) {
-		if(l->tid == tid) {
-			/* increase time of next */
-			if(l->next)
-				l->next->time += l->time;
-			/* remove from list */
-			if(p)
-				p->next = l->next;
-			else
-				listener = l->next;
-			/* put on freelist */
-			l->next = freeList;
-			freeList = l;
-			/* it's not possible to be in the list twice */
+	Thread *t = Thread::getById(tid);
+	if(t) {
+		removeListener(&t->sleepListener);
+		if(t->alarmListener) {
+			removeListener(t->alarmListener);
+			delete t->alarmListener;
+			t->alarmListener = NULL;
+		}
+	}
+}
+
+void TimerBase::removeThread(tid_t tid,bool block) {
+	Thread *t = Thread::getById(tid);
+	Listener *l = t ? getListener(t,block,false) : NULL;
+	if(l)
+		removeListener(l);
+}
+
+void TimerBase::removeListener(Listener *l) {
+	while(l->active) {
+		cpuid_t cpu = l->cpu;
+		Wheel *w = &perCPU[cpu].wheel;
+		LockGuard<SpinLock> g(&w->lock);
+		/* it might have been fired or moved in the meantime */
+		if(l->active && l->cpu == cpu) {
+			remove(w,l);
+			l->active = false;
+		}
+	}
+}
+
+void TimerBase::insert(Wheel *w,Listener *l) {
+	/* if it's already over, fire it as soon as possible */
+	if(l->expiry < w->base)
+		l->expiry = w->base;
+
+	/* the level is determined by the highest bit in which the expiry differs from the base. thus,
+	 * all listeners on level i are in the same WHEEL_SLOTS^(i+1) block as the base */
+	uint64_t diff = l->expiry ^ w->base;
+	size_t level = 0;
+	while(level < WHEEL_LEVELS && (diff >> ((level + 1) * WHEEL_BITS)) != 0)
+		level++;
+
+	l->level = level;
+	if(level == WHEEL_LEVELS) {
+		w->overflow.append(l);
+		return;
+	}
+
+	l->slot = (l->expiry >> (level * WHEEL_BITS)) & (WHEEL_SLOTS - 1);
+	w->slots[level][l->slot].append(l);
+	w->occupied[level] |= 1ULL << l->slot;
+}
+
+void TimerBase::remove(Wheel *w,Listener *l) {
+	if(l->level == WHEEL_LEVELS) {
+		w->overflow.remove(l);
+		return;
+	}
+
+	esc::DList<Listener> *list = &w->slots[l->level][l->slot];
+	list->remove(l);
+	if(list->length() == 0)
+		w->occupied[l->level] &= ~(1ULL << l->slot);
+}
+
+uint64_t TimerBase::nextExpiry(const Wheel *w) {
+	uint64_t next = NO_DEADLINE;
+	for(size_t i = 0; i < WHEEL_LEVELS; ++i) {
+		/* all slots on this level are at or behind the slot of the base */
+		size_t shift = i * WHEEL_BITS;
+		size_t cur = (w->base >> shift) & (WHEEL_SLOTS - 1);
+		uint64_t bits = w->occupied[i] & (~0ULL << cur);
+		if(bits == 0)
+			continue;
+
+		/* the beginning of the first non-empty slot. on the higher levels, this is the time where we
+		 * have to move the slot down, not necessarily the time when a listener expires */
+		uint64_t block = (w->base >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS);
+		uint64_t start = block | ((uint64_t)__builtin_ctzll(bits) << shift);
+		next = MIN(next,MAX(start,w->base));
+	}
+
+	if(w->overflow.length() > 0) {
+		size_t shift = WHEEL_LEVELS * WHEEL_BITS;
+		uint64_t mask = (1ULL << shift) - 1;
+		uint64_t start = (w->base & mask) == 0 ? w->base : ((w->base >> shift) + 1) << shift;
+		next = MIN(next,start);
+	}
+	return next;
+}
+
+bool TimerBase::advance(Wheel *w,uint64_t now) {
+	bool foundThread = false;
+	while(true) {
+		uint64_t next = nextExpiry(w);
+		if(next > now)
 			break;
+
+		/* note that we can skip all time in between, because nothing happens there */
+		w->base = next;
+
+		/* move the listeners of the slots that start now one or more levels down */
+		if(w->overflow.length() > 0 && (next & ((1ULL << (WHEEL_LEVELS * WHEEL_BITS)) - 1)) == 0) {
+			for(size_t count = w->overflow.length(); count > 0; --count)
+				insert(w,w->overflow.removeFirst());
+		}
+		for(size_t i = WHEEL_LEVELS - 1; i > 0; --i) {
+			size_t shift = i * WHEEL_BITS;
+			size_t slot = (next >> shift) & (WHEEL_SLOTS - 1);
+			if((next & ((1ULL << shift) - 1)) != 0 || !(w->occupied[i] & (1ULL << slot)))
+				continue;
+
+			w->occupied[i] &= ~(1ULL << slot);
+			Listener *l;
+			while((l = w->slots[i][slot].removeFirst()) != NULL)
+				insert(w,l);
 		}
+
+		/* fire the listeners that expire now */
+		size_t slot = next & (WHEEL_SLOTS - 1);
+		if(w->occupied[0] & (1ULL << slot)) {
+			w->occupied[0] &= ~(1ULL << slot);
+			Listener *l;
+			while((l = w->slots[0][slot].removeFirst()) != NULL)
+				foundThread |= fire(l);
+		}
+
+		w->base = next + 1;
+	}
+
+	/* nothing expires until <now>, so that we can skip that time */
+	w->base = MAX(w->base,now + 1);
+	return foundThread;
+}
+
+bool TimerBase::fire(Listener *l) {
+	l->active = false;
+	if(l->block) {
+		l->thread->unblock();
+		return true;
+	}
+	Signals::addSignalFor(l->thread,SIGALRM);
+	return false;
+}
+
+void TimerBase::reprogram(cpuid_t cpu,uint64_t now,const Thread *t) {
+	PerCPU *pc = perCPU + cpu;
+	uint64_t deadline;
+	{
+		LockGuard<SpinLock> g(&pc->wheel.lock);
+		deadline = nextExpiry(&pc->wheel);
+	}
+	/* the idle-thread doesn't need to be preempted; that's what makes the CPU sleep */
+	if(!(t->getFlags() & T_IDLE)) {
+		deadline = MIN(deadline,pc->lastResched + TIMESLICE * 1000);
+		/* the profiler takes its samples in the timer interrupt */
+		if(Profiler::isEnabled())
+			deadline = MIN(deadline,now + Profiler::getInterval());
+	}
+
+	if(deadline != pc->deadline) {
+		pc->deadline = deadline;
+		Timer::program(deadline,now);
+	}
+}
+
+void TimerBase::switchTo(cpuid_t cpu,const Thread *t) {
+	if(Timer::isTickless()) {
+		uint64_t now = getTimestamp();
+		perCPU[cpu].lastResched = now;
+		reprogram(cpu,now,t);
 	}
 }
 
 bool TimerBase::intrpt() {
 	bool res,foundThread = false;
-	time_t timeInc = 1000 / FREQUENCY_DIV;
-	cpuid_t cpu = Thread::getRunning()->getCPU();
+	Thread *t = Thread::getRunning();
+	cpuid_t cpu = t->getCPU();
+	PerCPU *pc = perCPU + cpu;
 
-	perCPU[cpu].timerIntrpts++;
-	perCPU[cpu].elapsedMsecs += timeInc;
+	pc->timerIntrpts++;
+	if(!Timer::isTickless() && cpu == 0)
+		tickTime += 1000000 / FREQUENCY_DIV;
+	uint64_t now = getTimestamp();
+	/* keep the time in the shared info page current, if it can't be derived from the TSC */
+	if(cpu == 0)
+		SharedInfo::setTimestamp(now);
 
-	if(cpu == 0) {
-		LockGuard<SpinLock> g(&lock);
-		if((perCPU[cpu].elapsedMsecs - lastRuntimeUpdate) >= RUNTIME_UPDATE_INTVAL) {
+	/* without periodic interrupts, we can't rely on a specific CPU to do that */
+	if((now - lastRuntimeUpdate) >= RUNTIME_UPDATE_INTVAL * 1000 && runtimeLock.tryDown()) {
+		if((now - lastRuntimeUpdate) >= RUNTIME_UPDATE_INTVAL * 1000) {
 			Thread::updateRuntimes();
 			SMP::updateRuntimes();
-			lastRuntimeUpdate = perCPU[cpu].elapsedMsecs;
+			lastRuntimeUpdate = now;
 		}
+		runtimeLock.up();
+	}
 
-		/* look if there are threads to wakeup */
-		for(Listener *l = listener; l != NULL; ) {
-			/* stop if we have to continue waiting for this one */
-			/* note that multiple listeners may have l->time = 0 */
-			if(l->time > timeInc) {
-				l->time -= timeInc;
-				break;
-			}
-
-			timeInc -= l->time;
-			/* wake up thread */
-			Thread *t = Thread::getById(l->tid);
-			if(l->block) {
-				t->unblock();
-				foundThread = true;
-			}
-			else
-				Signals::addSignalFor(t,SIGALRM);
-			/* remove from list */
-			listener = l->next;
-			Listener *tl = l->next;
-			/* put on freelist */
-			l->next = freeList;
-			freeList = l;
-			/* to next */
-			l = tl;
-		}
+	/* look if there are threads to wakeup */
+	if(Timer::isTickless() || cpu == 0) {
+		Wheel *w = &perCPU[cpu].wheel;
+		LockGuard<SpinLock> g(&w->lock);
+		foundThread = advance(w,now);
 	}
 
 	/* if a process has been waked up or the time-slice is over, reschedule */
 	res = false;
-	if(foundThread || (perCPU[cpu].elapsedMsecs - perCPU[cpu].lastResched) >= TIMESLICE) {
-		perCPU[cpu].lastResched = perCPU[cpu].elapsedMsecs;
+	if(foundThread || (now - pc->lastResched) >= TIMESLICE * 1000) {
+		pc->lastResched = now;
 		res = true;
 	}
+
+	/* program the timer for the next event */
+	if(Timer::isTickless()) {
+		pc->deadline = NO_DEADLINE;
+		reprogram(cpu,now,t);
+	}
 	return res;
 }
 
 void TimerBase::print(OStream &os) {
+	uint64_t now = getTimestamp();
 	os.writef("Timer-Listener:\n");
-	time_t time = 0;
-	for(Listener *l = listener; l != NULL; l = l->next) {
-		time += l->time;
-		os.writef("	diff=%u ms, rem=%u ms, thread=%d(%s), block=%d\n",l->time,time,l->tid,
-				Thread::getById(l->tid)->getProc()->getProgram(),l->block);
+	for(size_t i = 0; i < cpuCount; ++i) {
+		Wheel *w = &perCPU[i].wheel;
+		LockGuard<SpinLock> g(&w->lock);
+		for(size_t lvl = 0; lvl <= WHEEL_LEVELS; ++lvl) {
+			for(size_t slot = 0; slot < (lvl == WHEEL_LEVELS ? 1 : WHEEL_SLOTS); ++slot) {
+				esc::DList<Listener> *list = lvl == WHEEL_LEVELS ? &w->overflow : &w->slots[lvl][slot];
+				for(auto l = list->cbegin(); l != list->cend(); ++l) {
+					os.writef("	cpu=%zu, level=%zu, rem=%Lu us, thread=%d(%s), block=%d\n",
+						i,lvl,l->expiry > now ? l->expiry - now : 0,l->thread->getTid(),
+						l->thread->getProc()->getProgram(),l->block);
+				}
+			}
+		}
 	}
 }
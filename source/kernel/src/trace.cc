@@ -0,0 +1,202 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/cache.h>
+#include <mem/useraccess.h>
+#include <task/proc.h>
+#include <task/smp.h>
+#include <task/thread.h>
+#include <task/timer.h>
+#include <vfs/node.h>
+#include <common.h>
+#include <cpu.h>
+#include <errno.h>
+#include <string.h>
+#include <trace.h>
+
+Trace::Ring *Trace::rings = NULL;
+SpinLock Trace::readLock;
+volatile uint Trace::mask = 0;
+volatile pid_t Trace::filterPid = INVALID_PID;
+
+void Trace::init(VFSNode *sysNode) {
+	VFSNode::release(createObj<TraceFile>(KERNEL_PID,sysNode));
+}
+
+int Trace::start(uint events) {
+	if(events == 0 || (events & ~TRACE_ALL))
+		return -EINVAL;
+
+	/* the buffers are allocated on first use and kept afterwards */
+	if(rings == NULL) {
+		Ring *r = (Ring*)Cache::calloc(SMP::getCPUCount(),sizeof(Ring));
+		if(r == NULL)
+			return -ENOMEM;
+		rings = r;
+	}
+
+	mask = events;
+	return 0;
+}
+
+void Trace::reset() {
+	if(rings == NULL)
+		return;
+	LockGuard<SpinLock> g(&readLock);
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i)
+		rings[i].tail = rings[i].head;
+}
+
+void Trace::doRecord(uint event,const Thread *t,ulong arg1,ulong arg2) {
+	pid_t pid = t->getProc()->getPid();
+	/* a thread switch is interesting for both threads */
+	if(filterPid != INVALID_PID && pid != filterPid &&
+			(event != TRACE_SCHED || arg2 != filterPid))
+		return;
+
+	Ring *r = rings + t->getCPU();
+	size_t head = r->head;
+	sTraceRecord *rec = r->records + (head % RING_SIZE);
+	rec->tsc = CPU::rdtsc();
+	rec->pid = pid;
+	rec->tid = t->getTid();
+	rec->cpu = t->getCPU();
+	rec->event = event;
+	rec->arg1 = arg1;
+	rec->arg2 = arg2;
+	/* publish the record not before it is complete */
+	__asm__ volatile ("" : : : "memory");
+	r->head = head + 1;
+}
+
+size_t Trace::getCount() {
+	size_t total = 0;
+	if(rings) {
+		for(size_t i = 0; i < SMP::getCPUCount(); ++i)
+			total += MIN(rings[i].head - rings[i].tail,RING_SIZE);
+	}
+	return total;
+}
+
+size_t Trace::peek(sTraceRecord *records,size_t count,size_t *tails) {
+	size_t total = 0;
+	LockGuard<SpinLock> g(&readLock);
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i) {
+		Ring *r = rings + i;
+		size_t head = r->head;
+		size_t tail = r->tail;
+		/* skip the records that have already been overwritten */
+		if(head - tail > RING_SIZE)
+			tail = head - RING_SIZE;
+
+		size_t first = tail;
+		size_t start = total;
+		while(tail != head && total < count)
+			records[total++] = r->records[tail++ % RING_SIZE];
+		tails[i] = tail;
+		__asm__ volatile ("" : : : "memory");
+
+		/* the CPU might have overwritten some of them while we copied them. note that it might
+		 * currently write the record behind the head */
+		size_t end = r->head + 1;
+		if(end - first > RING_SIZE) {
+			size_t lost = MIN(end - RING_SIZE - first,total - start);
+			memmove(records + start,records + start + lost,
+				(total - start - lost) * sizeof(sTraceRecord));
+			total -= lost;
+		}
+	}
+	return total;
+}
+
+void Trace::consume(const size_t *tails) {
+	LockGuard<SpinLock> g(&readLock);
+	for(size_t i = 0; i < SMP::getCPUCount(); ++i) {
+		/* the records might have been dropped by reset() in the meantime */
+		if((ssize_t)(tails[i] - rings[i].tail) > 0)
+			rings[i].tail = tails[i];
+	}
+}
+
+ssize_t Trace::TraceFile::read(A_UNUSED pid_t pid,A_UNUSED OpenFile *file,USER void *buffer,
+		A_UNUSED off_t offset,size_t count) {
+	/* the records are removed when they are read, so that the offset doesn't matter */
+	count = MIN(count / sizeof(sTraceRecord),Trace::RING_SIZE);
+	if(count == 0 || Trace::rings == NULL)
+		return 0;
+
+	size_t cpus = SMP::getCPUCount();
+	sTraceRecord *records = (sTraceRecord*)Cache::alloc(count * sizeof(sTraceRecord));
+	size_t *tails = (size_t*)Cache::alloc(cpus * sizeof(size_t));
+	if(records == NULL || tails == NULL) {
+		Cache::free(tails);
+		Cache::free(records);
+		return -ENOMEM;
+	}
+
+	/* copy them out first and remove them only if that succeeded, so that nothing gets lost */
+	ssize_t res = Trace::peek(records,count,tails) * sizeof(sTraceRecord);
+	if(res > 0) {
+		int err = UserAccess::write(buffer,records,res);
+		if(err < 0)
+			res = err;
+		else
+			Trace::consume(tails);
+	}
+	Cache::free(tails);
+	Cache::free(records);
+	acctime = Timer::getTime();
+	return res;
+}
+
+ssize_t Trace::TraceFile::write(A_UNUSED pid_t pid,A_UNUSED OpenFile *file,
+		USER const void *buffer,A_UNUSED off_t offset,size_t count) {
+	char cmd[32];
+	size_t len = MIN(count,sizeof(cmd) - 1);
+	int res = UserAccess::read(cmd,buffer,len);
+	if(res < 0)
+		return res;
+	cmd[len] = '\0';
+
+	if(strncmp(cmd,"start",5) == 0) {
+		uint events = TRACE_ALL;
+		if(cmd[5] == ' ')
+			events = strtoul(cmd + 6,NULL,0);
+		else if(cmd[5] != '\0' && cmd[5] != '\n')
+			return -EINVAL;
+		res = Trace::start(events);
+	}
+	else if(strncmp(cmd,"stop",4) == 0)
+		Trace::stop();
+	else if(strncmp(cmd,"reset",5) == 0)
+		Trace::reset();
+	else if(strncmp(cmd,"pid",3) == 0) {
+		pid_t filter = INVALID_PID;
+		if(cmd[3] == ' ')
+			filter = atoi(cmd + 4);
+		else if(cmd[3] != '\0' && cmd[3] != '\n')
+			return -EINVAL;
+		Trace::setFilter(filter);
+	}
+	else
+		res = -EINVAL;
+
+	modtime = Timer::getTime();
+	return res < 0 ? res : (ssize_t)count;
+}
@@ -37,6 +37,7 @@
 #include <log.h>
 #include <spinlock.h>
 #include <string.h>
+#include <trace.h>
 #include <video.h>
 
 #define PRINT_MSGS			0
@@ -563,6 +564,7 @@ ssize_t VFSChannel::send(A_UNUSED pid_t pid,ushort flags,msgid_t id,USER const v
 			Sched::wakeup(EV_RECEIVED_MSG,(evobj_t)this,true);
 		}
 	}
+	Trace::record(TRACE_MSG_SEND,Thread::getRunning(),id,size1 + size2);
 
 #if PRINT_MSGS
 	{
@@ -644,6 +646,7 @@ ssize_t VFSChannel::receive(A_UNUSED pid_t pid,ushort flags,msgid_t *id,USER voi
 			t->getTid(),pid,p ? p->getProgram() : "??",msg->id >> 16,msg->id & 0xFFFF,
 			msg->length,this,getPath());
 #endif
+	Trace::record(TRACE_MSG_RECEIVE,t,msg->id,msg->length);
 
 	if(EXPECT_FALSE(data && msg->length > size)) {
 		Log::get().writef("INVALID: len=%zu, size=%zu\n",msg->length,size);
@@ -39,6 +39,7 @@
 #include <cppsupport.h>
 #include <cpu.h>
 #include <errno.h>
+#include <ksymbols.h>
 #include <ostringstream.h>
 #include <spinlock.h>
 #include <string.h>
@@ -49,6 +50,7 @@ void VFSInfo::init(VFSNode *sysNode) {
 	VFSNode::release(createObj<CPUFile>(KERNEL_PID,sysNode));
 	VFSNode::release(createObj<StatsFile>(KERNEL_PID,sysNode));
 	VFSNode::release(createObj<IRQsFile>(KERNEL_PID,sysNode));
+	VFSNode::release(createObj<KSymbolsFile>(KERNEL_PID,sysNode));
 }
 
 void VFSInfo::traceReadCallback(VFSNode *node,size_t *dataSize,void **buffer) {
@@ -199,7 +201,7 @@ void VFSInfo::statsReadCallback(A_UNUSED VFSNode *node,size_t *dataSize,void **b
 		"Threads:",Thread::getCount(),
 		"Interrupts:",Interrupts::getCount(),
 		"CPUCycles:",cycles.val64,
-		"UpTime:",Timer::getIntrptCount() / Timer::FREQUENCY_DIV
+		"UpTime:",(size_t)(Timer::getRuntime() / 1000)
 	);
 	*buffer = os.keepString();
 	*dataSize = os.getLength();
@@ -298,6 +300,13 @@ void VFSInfo::irqsReadCallback(A_UNUSED VFSNode *node,size_t *dataSize,void **bu
 	*dataSize = os.getLength();
 }
 
+void VFSInfo::ksymbolsReadCallback(A_UNUSED VFSNode *node,size_t *dataSize,void **buffer) {
+	OStringStream os;
+	KSymbols::print(os);
+	*buffer = os.keepString();
+	*dataSize = os.getLength();
+}
+
 Proc *VFSInfo::getProc(VFSNode *node,size_t *dataSize,void **buffer) {
 	Proc *p = NULL;
 	VFSNode::acquireTree();
@@ -23,6 +23,7 @@
 #include <sys/messages.h>
 #include <task/groups.h>
 #include <task/proc.h>
+#include <task/profiler.h>
 #include <task/timer.h>
 #include <vfs/channel.h>
 #include <vfs/device.h>
@@ -40,6 +41,7 @@
 #include <cppsupport.h>
 #include <errno.h>
 #include <string.h>
+#include <trace.h>
 #include <util.h>
 #include <video.h>
 
@@ -54,6 +56,7 @@ void VFS::init() {
 	/*
 	 *  /
 	 *   |- sys
+	 *   |   |- profile
 	 *   |   |- boot
 	 *   |   |- shm
 	 *   |   |- devices
@@ -83,6 +86,8 @@ void VFS::init() {
 	VFSNode::release(root);
 
 	VFSInfo::init(sys);
+	Profiler::init(sys);
+	Trace::init(sys);
 }
 
 void VFS::mountAll(Proc *p) {
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <mem/copyonwrite.h>
 #include <mem/physmem.h>
 #include <sys/test.h>
 #include <common.h>
@@ -24,12 +25,16 @@
 #include "testutils.h"
 
 #define FRAME_COUNT 50
+/* more than fit into the per-CPU cache */
+#define USR_FRAME_COUNT 200
 
 /* forward declarations */
 static void test_mm();
 static void test_default();
+static void test_bulk();
 static void test_contiguous();
 static void test_contiguous_align();
+static void test_cow();
 static void test_mm_allocate();
 static void test_mm_free();
 
@@ -40,11 +45,14 @@ sTestModule tModMM = {
 };
 
 static frameno_t frames[FRAME_COUNT];
+static frameno_t uframes[USR_FRAME_COUNT];
 
 static void test_mm() {
 	test_default();
+	test_bulk();
 	test_contiguous();
 	test_contiguous_align();
+	test_cow();
 }
 
 static void test_default() {
@@ -58,6 +66,34 @@ static void test_default() {
 	test_caseSucceeded();
 }
 
+static void test_bulk() {
+	test_caseStart("Requesting and freeing %d user frames at once",USR_FRAME_COUNT);
+	checkMemoryBefore(false);
+
+	test_assertTrue(PhysMem::reserve(USR_FRAME_COUNT,false));
+	test_assertSize(PhysMem::allocate(PhysMem::USR,uframes,USR_FRAME_COUNT),USR_FRAME_COUNT);
+	for(size_t i = 1; i < USR_FRAME_COUNT; ++i)
+		test_assertTrue(uframes[i] != uframes[i - 1]);
+	PhysMem::free(uframes,USR_FRAME_COUNT,PhysMem::USR);
+
+	checkMemoryAfter(false);
+	test_caseSucceeded();
+
+	test_caseStart("Requesting and freeing %d user frames one by one",USR_FRAME_COUNT);
+	checkMemoryBefore(false);
+
+	test_assertTrue(PhysMem::reserve(USR_FRAME_COUNT,false));
+	for(size_t i = 0; i < USR_FRAME_COUNT; ++i) {
+		uframes[i] = PhysMem::allocate(PhysMem::USR);
+		test_assertTrue(uframes[i] != INVALID_FRAME);
+	}
+	for(size_t i = 0; i < USR_FRAME_COUNT; ++i)
+		PhysMem::free(uframes[i],PhysMem::USR);
+
+	checkMemoryAfter(false);
+	test_caseSucceeded();
+}
+
 static void test_contiguous() {
 	ssize_t res1,res2,res3,res4;
 
@@ -166,6 +202,36 @@ static void test_contiguous_align() {
 	test_caseSucceeded();
 }
 
+static void test_cow() {
+	test_caseStart("Sharing a frame copy-on-write");
+	checkMemoryBefore(false);
+
+	frameno_t frame = PhysMem::allocate(PhysMem::KERN);
+	PhysMem::Frame *info = PhysMem::getFrame(frame);
+	size_t cowFrames = CopyOnWrite::getFrmCount();
+	test_assertUInt(info->refs,0);
+	test_assertFalse(info->flags & PhysMem::FRAME_COW);
+
+	CopyOnWrite::add(frame);
+	CopyOnWrite::add(frame);
+	test_assertUInt(info->refs,2);
+	test_assertTrue(info->flags & PhysMem::FRAME_COW);
+	test_assertSize(CopyOnWrite::getFrmCount(),cowFrames + 1);
+
+	bool other;
+	test_assertSize(CopyOnWrite::remove(frame,&other),1);
+	test_assertTrue(other);
+	test_assertSize(CopyOnWrite::remove(frame,&other),1);
+	test_assertFalse(other);
+	test_assertUInt(info->refs,0);
+	test_assertFalse(info->flags & PhysMem::FRAME_COW);
+	test_assertSize(CopyOnWrite::getFrmCount(),cowFrames);
+
+	PhysMem::free(frame,PhysMem::KERN);
+	checkMemoryAfter(false);
+	test_caseSucceeded();
+}
+
 static void test_mm_allocate() {
 	ssize_t i = 0;
 	while(i < FRAME_COUNT) {
@@ -48,6 +48,7 @@ extern sTestModule tModEscCodes;
 extern sTestModule tModSwapMap;
 extern sTestModule tModVmm;
 extern sTestModule tModPmemAreas;
+extern sTestModule tModZSwap;
 
 EXTERN_C void unittest_run();
 EXTERN_C void unittest_start();
@@ -87,6 +88,7 @@ void unittest_run() {
 	test_register(&tModSwapMap);
 	test_register(&tModVmm);
 	test_register(&tModPmemAreas);
+	test_register(&tModZSwap);
 	test_start();
 
 	/* stay here */
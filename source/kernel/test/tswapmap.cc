@@ -28,6 +28,7 @@ static void test_swapmap1();
 static void test_swapmap2();
 static void test_swapmap5();
 static void test_swapmap6();
+static void test_swapmap7();
 static void test_doStart(const char *title);
 static void test_finish();
 
@@ -44,6 +45,7 @@ static void test_swapmap() {
 	test_swapmap2();
 	test_swapmap5();
 	test_swapmap6();
+	test_swapmap7();
 }
 
 static void test_swapmap1() {
@@ -61,8 +63,11 @@ static void test_swapmap1() {
 	test_assertTrue(SwapMap::isUsed(blocks[2]));
 	test_assertTrue(SwapMap::isUsed(blocks[3]));
 	test_assertTrue(SwapMap::isUsed(blocks[4]));
-	test_assertFalse(SwapMap::isUsed(blocks[4] - 1));
-	test_assertFalse(SwapMap::isUsed(blocks[4] - 2));
+	/* next-fit continues behind the last allocated block */
+	if(blocks[4] + 2 < SwapMap::totalSpace() / PAGE_SIZE) {
+		test_assertFalse(SwapMap::isUsed(blocks[4] + 1));
+		test_assertFalse(SwapMap::isUsed(blocks[4] + 2));
+	}
 
 	SwapMap::free(blocks[0]);
 	SwapMap::free(blocks[1]);
@@ -161,6 +166,33 @@ static void test_swapmap6() {
 	Cache::free(blocks);
 }
 
+static void test_swapmap7() {
+	ulong blocks[3];
+	test_doStart("Testing contiguous alloc");
+
+	blocks[0] = SwapMap::alloc(8);
+	test_assertTrue(blocks[0] != INVALID_BLOCK);
+	for(size_t i = 0; i < 8; i++)
+		test_assertTrue(SwapMap::isUsed(blocks[0] + i));
+
+	blocks[1] = SwapMap::alloc();
+	test_assertTrue(blocks[1] < blocks[0] || blocks[1] >= blocks[0] + 8);
+	blocks[2] = SwapMap::alloc(4);
+	test_assertTrue(blocks[2] != INVALID_BLOCK);
+	test_assertTrue(blocks[2] + 4 <= blocks[0] || blocks[2] >= blocks[0] + 8);
+
+	/* more than we have */
+	test_assertTrue(SwapMap::alloc(SwapMap::totalSpace() / PAGE_SIZE + 1) == INVALID_BLOCK);
+
+	for(size_t i = 0; i < 8; i++)
+		SwapMap::free(blocks[0] + i);
+	SwapMap::free(blocks[1]);
+	for(size_t i = 0; i < 4; i++)
+		SwapMap::free(blocks[2] + i);
+
+	test_finish();
+}
+
 static void test_doStart(const char *title) {
 	test_caseStart(title);
 	spaceBefore = SwapMap::freeSpace();
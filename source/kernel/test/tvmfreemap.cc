@@ -33,6 +33,7 @@ static void test_vmfree_inOrder();
 static void test_vmfree_revOrder();
 static void test_vmfree_randOrder();
 static void test_vmfree_allocAt();
+static void test_vmfree_allocAlign();
 static void test_vmfree_allocNFree(size_t *sizes,size_t *freeIndices,const char *msg);
 
 /* our test-module */
@@ -46,6 +47,7 @@ static void test_vmfree() {
 	test_vmfree_revOrder();
 	test_vmfree_randOrder();
 	test_vmfree_allocAt();
+	test_vmfree_allocAlign();
 }
 
 static void test_vmfree_inOrder() {
@@ -120,6 +122,36 @@ static void test_vmfree_allocAt() {
 	test_caseSucceeded();
 }
 
+static void test_vmfree_allocAlign() {
+	VMFreeMap map;
+	size_t areas,size = TOTAL_SIZE;
+	test_caseStart("Allocating aligned areas");
+	checkMemoryBefore(false);
+
+	test_assertTrue(VMFreeMap::init(&map,PAGE_SIZE,size));
+
+	uintptr_t addr1 = map.allocate(2 * PAGE_SIZE,8 * PAGE_SIZE);
+	test_assertUIntPtr(addr1,8 * PAGE_SIZE);
+	uintptr_t addr2 = map.allocate(1 * PAGE_SIZE,8 * PAGE_SIZE);
+	test_assertUIntPtr(addr2,16 * PAGE_SIZE);
+	/* the space in front of the aligned areas is still available */
+	uintptr_t addr3 = map.allocate(7 * PAGE_SIZE);
+	test_assertUIntPtr(addr3,1 * PAGE_SIZE);
+	/* too large */
+	test_assertUIntPtr(map.allocate(size,2 * PAGE_SIZE),0);
+
+	map.free(addr2,1 * PAGE_SIZE);
+	map.free(addr3,7 * PAGE_SIZE);
+	map.free(addr1,2 * PAGE_SIZE);
+
+	test_assertSize(map.getSize(&areas),size);
+	test_assertSize(areas,1);
+	map.destroy();
+
+	checkMemoryAfter(false);
+	test_caseSucceeded();
+}
+
 static void test_vmfree_allocNFree(size_t *sizes,size_t *freeIndices,const char *msg) {
 	size_t areas;
 	uintptr_t addrs[AREA_COUNT];
@@ -0,0 +1,198 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <mem/cache.h>
+#include <mem/zpool.h>
+#include <sys/test.h>
+#include <common.h>
+#include <lz4.h>
+#include <string.h>
+
+static void test_zswap();
+static void test_lz4();
+static void test_zpool1();
+static void test_zpool2();
+static void test_zpool3();
+static void test_doStart(const char *title);
+static void test_finish();
+
+/* our test-module */
+sTestModule tModZSwap = {
+	"ZSwap",
+	&test_zswap
+};
+
+static const size_t POOL_LIMIT = 256;
+static size_t framesBefore;
+
+static void test_zswap() {
+	ZPool::setLimit(POOL_LIMIT);
+	test_lz4();
+	test_zpool1();
+	test_zpool2();
+	test_zpool3();
+}
+
+static void test_lz4() {
+	uint8_t *page = (uint8_t*)Cache::alloc(PAGE_SIZE);
+	uint8_t *comp = (uint8_t*)Cache::alloc(PAGE_SIZE);
+	uint8_t *res = (uint8_t*)Cache::alloc(PAGE_SIZE);
+	test_caseStart("Testing LZ4");
+
+	/* zeros compress very well */
+	memclear(page,PAGE_SIZE);
+	size_t size = LZ4::compress(page,PAGE_SIZE,comp,PAGE_SIZE);
+	test_assertTrue(size > 0 && size < PAGE_SIZE / 16);
+	test_assertSize(LZ4::decompress(comp,size,res,PAGE_SIZE),PAGE_SIZE);
+	test_assertTrue(memcmp(page,res,PAGE_SIZE) == 0);
+
+	/* repeated text as well */
+	for(size_t i = 0; i < PAGE_SIZE; ++i)
+		page[i] = "Lorem ipsum dolor sit amet"[i % 26];
+	size = LZ4::compress(page,PAGE_SIZE,comp,PAGE_SIZE);
+	test_assertTrue(size > 0 && size < PAGE_SIZE / 4);
+	test_assertSize(LZ4::decompress(comp,size,res,PAGE_SIZE),PAGE_SIZE);
+	test_assertTrue(memcmp(page,res,PAGE_SIZE) == 0);
+
+	/* pseudo-random data doesn't fit into half a page */
+	uint32_t x = 0x12345678;
+	for(size_t i = 0; i < PAGE_SIZE; ++i) {
+		x = x * 1103515245 + 12345;
+		page[i] = x >> 24;
+	}
+	test_assertSize(LZ4::compress(page,PAGE_SIZE,comp,PAGE_SIZE / 2),0);
+	size = LZ4::compress(page,PAGE_SIZE,comp,PAGE_SIZE);
+	if(size > 0) {
+		test_assertSize(LZ4::decompress(comp,size,res,PAGE_SIZE),PAGE_SIZE);
+		test_assertTrue(memcmp(page,res,PAGE_SIZE) == 0);
+	}
+
+	/* truncated input is detected */
+	memclear(page,PAGE_SIZE);
+	size = LZ4::compress(page,PAGE_SIZE,comp,PAGE_SIZE);
+	test_assertSize(LZ4::decompress(comp,size - 1,res,PAGE_SIZE),0);
+
+	test_caseSucceeded();
+	Cache::free(res);
+	Cache::free(comp);
+	Cache::free(page);
+}
+
+static void test_zpool1() {
+	ZPool::Handle h[3];
+	char *buf = (char*)Cache::alloc(PAGE_SIZE / 2);
+	test_doStart("Testing alloc, write, read & free");
+
+	test_assertTrue(ZPool::alloc(10,h + 0));
+	test_assertTrue(ZPool::alloc(100,h + 1));
+	test_assertTrue(ZPool::alloc(PAGE_SIZE / 2,h + 2));
+	test_assertSize(ZPool::getObjCount(),3);
+
+	ZPool::write(h[0],"0123456789",10);
+	memset(buf,'a',100);
+	ZPool::write(h[1],buf,100);
+	memset(buf,'b',PAGE_SIZE / 2);
+	ZPool::write(h[2],buf,PAGE_SIZE / 2);
+
+	ZPool::read(h[0],buf,10);
+	test_assertTrue(memcmp(buf,"0123456789",10) == 0);
+	ZPool::read(h[1],buf,100);
+	for(size_t i = 0; i < 100; ++i)
+		test_assertInt(buf[i],'a');
+	ZPool::read(h[2],buf,PAGE_SIZE / 2);
+	for(size_t i = 0; i < PAGE_SIZE / 2; ++i)
+		test_assertInt(buf[i],'b');
+
+	ZPool::free(h[1]);
+	ZPool::free(h[0]);
+	ZPool::free(h[2]);
+
+	test_finish();
+	Cache::free(buf);
+}
+
+static void test_zpool2() {
+	const size_t count = 100;
+	ZPool::Handle *h = (ZPool::Handle*)Cache::alloc(count * sizeof(ZPool::Handle));
+	uint8_t *buf = (uint8_t*)Cache::alloc(PAGE_SIZE);
+	test_doStart("Testing many objects of odd size");
+
+	/* odd sizes, so that objects span frames */
+	for(size_t i = 0; i < count; ++i) {
+		size_t size = 3 * PAGE_SIZE / 4 - 1;
+		test_assertTrue(ZPool::alloc(size,h + i));
+		memset(buf,i,size);
+		ZPool::write(h[i],buf,size);
+	}
+	/* they occupy less frames than objects */
+	test_assertTrue(ZPool::getFrameCount() < count);
+
+	for(size_t i = 0; i < count; ++i) {
+		size_t size = 3 * PAGE_SIZE / 4 - 1;
+		ZPool::read(h[i],buf,size);
+		for(size_t j = 0; j < size; ++j) {
+			if(buf[j] != (uint8_t)i) {
+				test_assertInt(buf[j],(uint8_t)i);
+				break;
+			}
+		}
+	}
+
+	for(size_t i = 0; i < count; ++i)
+		ZPool::free(h[i]);
+
+	test_finish();
+	Cache::free(buf);
+	Cache::free(h);
+}
+
+static void test_zpool3() {
+	const size_t count = 16;
+	ZPool::Handle h[count];
+	test_doStart("Testing limit");
+
+	ZPool::setLimit(4);
+	size_t i;
+	for(i = 0; i < count; ++i) {
+		if(!ZPool::alloc(PAGE_SIZE,h + i))
+			break;
+	}
+	test_assertSize(i,4);
+	test_assertSize(ZPool::getFrameCount(),4);
+	while(i-- > 0)
+		ZPool::free(h[i]);
+	ZPool::setLimit(POOL_LIMIT);
+
+	test_finish();
+}
+
+static void test_doStart(const char *title) {
+	test_caseStart(title);
+	framesBefore = ZPool::getFrameCount();
+}
+
+static void test_finish() {
+	size_t framesAfter = ZPool::getFrameCount();
+	if(ZPool::getObjCount() != 0)
+		test_caseFailed("Objects left: %zu",ZPool::getObjCount());
+	else if(framesAfter != framesBefore)
+		test_caseFailed("Frames before: %zu, After: %zu",framesBefore,framesAfter);
+	else
+		test_caseSucceeded();
+}
@@ -21,9 +21,9 @@
 #include <string.h>
 
 void *memchr(const void *buffer,int c,size_t count) {
-	const char *str = (const char*)buffer;
-	while(*str && count-- > 0) {
-		if(*str == c)
+	const uchar *str = (const uchar*)buffer;
+	while(count-- > 0) {
+		if(*str == (uchar)c)
 			return (void*)str;
 		str++;
 	}
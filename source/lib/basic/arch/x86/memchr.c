@@ -0,0 +1,320 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "memimpl.h"
+
+/* this is necessary to prevent that gcc transforms a loop into library-calls
+ * (which might lead to recursion here) */
+#pragma GCC optimize ("no-tree-loop-distribute-patterns")
+
+/* note that all implementations read memory only in aligned blocks. this way, they might read
+ * behind the end of the buffer, but never cross a page-boundary. thus, strlen can simply use
+ * memchr with an unlimited count. */
+
+static void *memchr_init(const void *buffer,int c,size_t count);
+
+/* the implementation we use; determined on the first call */
+static void *(*memchr_impl)(const void *buffer,int c,size_t count) = memchr_init;
+
+void *memchr(const void *buffer,int c,size_t count) {
+	return memchr_impl(buffer,c,count);
+}
+
+/**
+ * @return the address of the last byte in [buffer, buffer + count), saturated to the end of the
+ *  address space
+ */
+static inline uintptr_t last_byte(const void *buffer,size_t count) {
+	if(count - 1 > (uintptr_t)-1 - (uintptr_t)buffer)
+		return (uintptr_t)-1;
+	return (uintptr_t)buffer + count - 1;
+}
+
+static void *memchr_words(const void *buffer,int c,size_t count) {
+	static const ulong ones = ~0UL / 0xFF;
+	const uchar *str = (const uchar*)buffer;
+	uchar ch = (uchar)c;
+
+	/* align it */
+	while(count > 0 && (uintptr_t)str % sizeof(ulong)) {
+		if(*str == ch)
+			return (void*)str;
+		str++;
+		count--;
+	}
+
+	/* search word by word for a word that contains <ch> */
+	ulong pattern = ch * ones;
+	const ulong *wstr = (const ulong*)str;
+	while(count >= sizeof(ulong)) {
+		ulong w = *wstr ^ pattern;
+		if((w - ones) & ~w & (ones << 7))
+			break;
+		wstr++;
+		count -= sizeof(ulong);
+	}
+
+	str = (const uchar*)wstr;
+	while(count-- > 0) {
+		if(*str == ch)
+			return (void*)str;
+		str++;
+	}
+	return NULL;
+}
+
+#if !defined(IN_KERNEL)
+
+/**
+ * Compares the 16 bytes at the aligned address <p> against the byte-pattern <val>.
+ *
+ * @return the bitmask of matching bytes
+ */
+static inline A_SSE2 uint cmp16(const uchar *p,uint32_t val) {
+	uint mask;
+	__asm__ volatile (
+		"movd	%2,%%xmm1\n\t"
+		"pshufd	$0,%%xmm1,%%xmm1\n\t"
+		"pcmpeqb	(%1),%%xmm1\n\t"
+		"pmovmskb	%%xmm1,%0\n\t"
+		: "=r" (mask)
+		: "r" (p), "r" (val)
+		: "xmm1", "memory"
+	);
+	return mask;
+}
+
+/**
+ * Compares up to <blocks> 16-byte blocks, starting at the aligned address <*p>, against the
+ * byte-pattern <val> until a block with a match is found. <*p> is set to that block.
+ *
+ * @return the bitmask of matching bytes in the block or 0 if there is none
+ */
+static inline A_SSE2 uint scan16(const uchar **p,uint32_t val,size_t blocks) {
+	const uchar *q = *p;
+	uint mask;
+	__asm__ volatile (
+		"movd	%3,%%xmm1\n\t"
+		"pshufd	$0,%%xmm1,%%xmm1\n\t"
+		"1:\n\t"
+		"movdqa	(%1),%%xmm0\n\t"
+		"pcmpeqb	%%xmm1,%%xmm0\n\t"
+		"pmovmskb	%%xmm0,%0\n\t"
+		"test	%0,%0\n\t"
+		"jnz	2f\n\t"
+		"add	$16,%1\n\t"
+		"dec	%2\n\t"
+		"jnz	1b\n\t"
+		"2:\n\t"
+		: "=&r" (mask), "+r" (q), "+r" (blocks)
+		: "r" (val)
+		: "xmm0", "xmm1", "memory", "cc"
+	);
+	*p = q;
+	return mask;
+}
+
+/**
+ * Compares up to <groups> groups of four 16-byte blocks, starting at the aligned address <*p>,
+ * against the byte-pattern <val> until a group with a match is found. <*p> is set to that group.
+ *
+ * @return true if a match has been found
+ */
+static inline A_SSE2 bool scan64(const uchar **p,uint32_t val,size_t groups) {
+	const uchar *q = *p;
+	uint mask;
+	__asm__ volatile (
+		"movd	%3,%%xmm4\n\t"
+		"pshufd	$0,%%xmm4,%%xmm4\n\t"
+		"1:\n\t"
+		"movdqa	(%1),%%xmm0\n\t"
+		"movdqa	16(%1),%%xmm1\n\t"
+		"movdqa	32(%1),%%xmm2\n\t"
+		"movdqa	48(%1),%%xmm3\n\t"
+		"pcmpeqb	%%xmm4,%%xmm0\n\t"
+		"pcmpeqb	%%xmm4,%%xmm1\n\t"
+		"pcmpeqb	%%xmm4,%%xmm2\n\t"
+		"pcmpeqb	%%xmm4,%%xmm3\n\t"
+		"por	%%xmm1,%%xmm0\n\t"
+		"por	%%xmm3,%%xmm2\n\t"
+		"por	%%xmm2,%%xmm0\n\t"
+		"pmovmskb	%%xmm0,%0\n\t"
+		"test	%0,%0\n\t"
+		"jnz	2f\n\t"
+		"add	$64,%1\n\t"
+		"dec	%2\n\t"
+		"jnz	1b\n\t"
+		"2:\n\t"
+		: "=&r" (mask), "+r" (q), "+r" (groups)
+		: "r" (val)
+		: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory", "cc"
+	);
+	*p = q;
+	return mask != 0;
+}
+
+static A_SSE2 void *memchr_sse2(const void *buffer,int c,size_t count) {
+	if(count == 0)
+		return NULL;
+
+	uint32_t val = (uchar)c * 0x01010101U;
+	uintptr_t last = last_byte(buffer,count);
+	uintptr_t off = (uintptr_t)buffer & 15;
+	const uchar *p = (const uchar*)buffer - off;
+
+	/* ignore the matches before the buffer in the first block */
+	uint mask = cmp16(p,val) & (0xFFFFU << off);
+	if(!mask) {
+		uintptr_t lastblk = last & ~(uintptr_t)15;
+		if((uintptr_t)p == lastblk)
+			return NULL;
+		p += 16;
+		size_t blocks = (lastblk - (uintptr_t)p) / 16 + 1;
+		/* the groups have to be aligned to their size to not cross a page-boundary */
+		size_t head = MIN(blocks,(-(uintptr_t)p & 63) / 16);
+		mask = head ? scan16(&p,val,head) : 0;
+		if(!mask) {
+			blocks -= head;
+			/* search in groups of 4 blocks first and determine the block afterwards */
+			if(blocks >= 4 && scan64(&p,val,blocks / 4))
+				blocks = 4;
+			else
+				blocks %= 4;
+			if(blocks == 0 || !(mask = scan16(&p,val,blocks)))
+				return NULL;
+		}
+	}
+
+	const uchar *res = p + __builtin_ctz(mask);
+	return (uintptr_t)res <= last ? (void*)res : NULL;
+}
+
+/**
+ * The same as scan16, but with 32-byte blocks.
+ */
+static inline A_AVX2 uint scan32(const uchar **p,uint32_t val,size_t blocks) {
+	const uchar *q = *p;
+	uint mask;
+	__asm__ volatile (
+		"vmovd	%3,%%xmm1\n\t"
+		"vpbroadcastd	%%xmm1,%%ymm1\n\t"
+		"1:\n\t"
+		"vpcmpeqb	(%1),%%ymm1,%%ymm0\n\t"
+		"vpmovmskb	%%ymm0,%0\n\t"
+		"test	%0,%0\n\t"
+		"jnz	2f\n\t"
+		"add	$32,%1\n\t"
+		"dec	%2\n\t"
+		"jnz	1b\n\t"
+		"2:\n\t"
+		"vzeroupper\n\t"
+		: "=&r" (mask), "+r" (q), "+r" (blocks)
+		: "r" (val)
+		: "ymm0", "ymm1", "memory", "cc"
+	);
+	*p = q;
+	return mask;
+}
+
+/**
+ * The same as scan64, but with groups of four 32-byte blocks.
+ */
+static inline A_AVX2 bool scan128(const uchar **p,uint32_t val,size_t groups) {
+	const uchar *q = *p;
+	uint mask;
+	__asm__ volatile (
+		"vmovd	%3,%%xmm4\n\t"
+		"vpbroadcastd	%%xmm4,%%ymm4\n\t"
+		"1:\n\t"
+		"vpcmpeqb	(%1),%%ymm4,%%ymm0\n\t"
+		"vpcmpeqb	32(%1),%%ymm4,%%ymm1\n\t"
+		"vpcmpeqb	64(%1),%%ymm4,%%ymm2\n\t"
+		"vpcmpeqb	96(%1),%%ymm4,%%ymm3\n\t"
+		"vpor	%%ymm1,%%ymm0,%%ymm0\n\t"
+		"vpor	%%ymm3,%%ymm2,%%ymm2\n\t"
+		"vpor	%%ymm2,%%ymm0,%%ymm0\n\t"
+		"vpmovmskb	%%ymm0,%0\n\t"
+		"test	%0,%0\n\t"
+		"jnz	2f\n\t"
+		"add	$128,%1\n\t"
+		"dec	%2\n\t"
+		"jnz	1b\n\t"
+		"2:\n\t"
+		"vzeroupper\n\t"
+		: "=&r" (mask), "+r" (q), "+r" (groups)
+		: "r" (val)
+		: "ymm0", "ymm1", "ymm2", "ymm3", "ymm4", "memory", "cc"
+	);
+	*p = q;
+	return mask != 0;
+}
+
+static A_AVX2 void *memchr_avx2(const void *buffer,int c,size_t count) {
+	if(count == 0)
+		return NULL;
+
+	uint32_t val = (uchar)c * 0x01010101U;
+	uintptr_t last = last_byte(buffer,count);
+	uintptr_t off = (uintptr_t)buffer & 31;
+	const uchar *p = (const uchar*)buffer - off;
+
+	/* the first block can be handled with two 16-byte blocks */
+	uint mask = (cmp16(p,val) | (cmp16(p + 16,val) << 16)) & (0xFFFFFFFFU << off);
+	if(!mask) {
+		uintptr_t lastblk = last & ~(uintptr_t)31;
+		if((uintptr_t)p == lastblk)
+			return NULL;
+		p += 32;
+		size_t blocks = (lastblk - (uintptr_t)p) / 32 + 1;
+		/* the groups have to be aligned to their size to not cross a page-boundary */
+		size_t head = MIN(blocks,(-(uintptr_t)p & 127) / 32);
+		mask = head ? scan32(&p,val,head) : 0;
+		if(!mask) {
+			blocks -= head;
+			/* search in groups of 4 blocks first and determine the block afterwards */
+			if(blocks >= 4 && scan128(&p,val,blocks / 4))
+				blocks = 4;
+			else
+				blocks %= 4;
+			if(blocks == 0 || !(mask = scan32(&p,val,blocks)))
+				return NULL;
+		}
+	}
+
+	const uchar *res = p + __builtin_ctz(mask);
+	return (uintptr_t)res <= last ? (void*)res : NULL;
+}
+
+#endif
+
+static void *memchr_init(const void *buffer,int c,size_t count) {
+#if !defined(IN_KERNEL)
+	uint feats = __mem_features();
+	if(feats & MEMFEAT_AVX2)
+		memchr_impl = memchr_avx2;
+	else if(feats & MEMFEAT_SSE2)
+		memchr_impl = memchr_sse2;
+	else
+#endif
+		memchr_impl = memchr_words;
+	return memchr_impl(buffer,c,count);
+}
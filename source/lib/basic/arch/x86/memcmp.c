@@ -0,0 +1,162 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "memimpl.h"
+
+static int memcmp_init(const void *str1,const void *str2,size_t count);
+
+/* the implementation we use; determined on the first call */
+static int (*memcmp_impl)(const void *str1,const void *str2,size_t count) = memcmp_init;
+
+int memcmp(const void *str1,const void *str2,size_t count) {
+	return memcmp_impl(str1,str2,count);
+}
+
+static int memcmp_words(const void *str1,const void *str2,size_t count) {
+	const uchar *s1 = (const uchar*)str1;
+	const uchar *s2 = (const uchar*)str2;
+	/* skip equal words; unaligned accesses are fine on x86 */
+	while(count >= sizeof(ulong) && *(const memulong_t*)s1 == *(const memulong_t*)s2) {
+		s1 += sizeof(ulong);
+		s2 += sizeof(ulong);
+		count -= sizeof(ulong);
+	}
+	while(count-- > 0) {
+		if(*s1++ != *s2++)
+			return s1[-1] < s2[-1] ? -1 : 1;
+	}
+	return 0;
+}
+
+#if !defined(IN_KERNEL)
+
+/**
+ * Compares up to <blocks> 16-byte blocks of <*s1> and <*s2> until a difference is found. <*s1>
+ * and <*s2> are set to the blocks with the difference.
+ *
+ * @return the bitmask of the differing bytes or 0 if there is none
+ */
+static inline A_SSE2 uint cmpblocks16(const uchar **s1,const uchar **s2,size_t blocks) {
+	const uchar *p1 = *s1;
+	const uchar *p2 = *s2;
+	uint mask;
+	__asm__ volatile (
+		"1:\n\t"
+		"movdqu	(%1),%%xmm0\n\t"
+		"movdqu	(%2),%%xmm1\n\t"
+		"pcmpeqb	%%xmm1,%%xmm0\n\t"
+		"pmovmskb	%%xmm0,%0\n\t"
+		"xor	$0xFFFF,%0\n\t"
+		"jnz	2f\n\t"
+		"add	$16,%1\n\t"
+		"add	$16,%2\n\t"
+		"dec	%3\n\t"
+		"jnz	1b\n\t"
+		"2:\n\t"
+		: "=&r" (mask), "+r" (p1), "+r" (p2), "+r" (blocks)
+		: : "xmm0", "xmm1", "memory", "cc"
+	);
+	*s1 = p1;
+	*s2 = p2;
+	return mask;
+}
+
+/**
+ * Compares up to <groups> groups of four 16-byte blocks of <*s1> and <*s2> until a difference is
+ * found. <*s1> and <*s2> are set to the group with the difference.
+ *
+ * @return true if a difference has been found
+ */
+static inline A_SSE2 bool cmpblocks64(const uchar **s1,const uchar **s2,size_t groups) {
+	const uchar *p1 = *s1;
+	const uchar *p2 = *s2;
+	uint mask;
+	__asm__ volatile (
+		"1:\n\t"
+		"movdqu	(%1),%%xmm0\n\t"
+		"movdqu	16(%1),%%xmm1\n\t"
+		"movdqu	32(%1),%%xmm2\n\t"
+		"movdqu	48(%1),%%xmm3\n\t"
+		"movdqu	(%2),%%xmm4\n\t"
+		"movdqu	16(%2),%%xmm5\n\t"
+		"movdqu	32(%2),%%xmm6\n\t"
+		"movdqu	48(%2),%%xmm7\n\t"
+		"pcmpeqb	%%xmm4,%%xmm0\n\t"
+		"pcmpeqb	%%xmm5,%%xmm1\n\t"
+		"pcmpeqb	%%xmm6,%%xmm2\n\t"
+		"pcmpeqb	%%xmm7,%%xmm3\n\t"
+		"pand	%%xmm1,%%xmm0\n\t"
+		"pand	%%xmm3,%%xmm2\n\t"
+		"pand	%%xmm2,%%xmm0\n\t"
+		"pmovmskb	%%xmm0,%0\n\t"
+		"xor	$0xFFFF,%0\n\t"
+		"jnz	2f\n\t"
+		"add	$64,%1\n\t"
+		"add	$64,%2\n\t"
+		"dec	%3\n\t"
+		"jnz	1b\n\t"
+		"2:\n\t"
+		: "=&r" (mask), "+r" (p1), "+r" (p2), "+r" (groups)
+		: : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc"
+	);
+	*s1 = p1;
+	*s2 = p2;
+	return mask != 0;
+}
+
+static A_SSE2 int memcmp_sse2(const void *str1,const void *str2,size_t count) {
+	const uchar *s1 = (const uchar*)str1;
+	const uchar *s2 = (const uchar*)str2;
+	if(count < 16)
+		return memcmp_words(s1,s2,count);
+
+	/* compare groups of 4 blocks first and determine the block afterwards */
+	size_t blocks = count / 16;
+	if(blocks >= 4 && cmpblocks64(&s1,&s2,blocks / 4))
+		blocks = 4;
+	else
+		blocks %= 4;
+	uint mask = blocks ? cmpblocks16(&s1,&s2,blocks) : 0;
+	if(!mask && (count & 15)) {
+		/* compare the last 16 bytes, which overlap with the already compared ones */
+		s1 = (const uchar*)str1 + count - 16;
+		s2 = (const uchar*)str2 + count - 16;
+		mask = cmpblocks16(&s1,&s2,1);
+	}
+	if(!mask)
+		return 0;
+
+	size_t idx = __builtin_ctz(mask);
+	return s1[idx] < s2[idx] ? -1 : 1;
+}
+
+#endif
+
+static int memcmp_init(const void *str1,const void *str2,size_t count) {
+#if !defined(IN_KERNEL)
+	if(__mem_features() & MEMFEAT_SSE2)
+		memcmp_impl = memcmp_sse2;
+	else
+#endif
+		memcmp_impl = memcmp_words;
+	return memcmp_impl(str1,str2,count);
+}
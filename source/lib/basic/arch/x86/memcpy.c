@@ -20,13 +20,66 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "memimpl.h"
+
 /* this is necessary to prevent that gcc transforms a loop into library-calls
  * (which might lead to recursion here) */
 #pragma GCC optimize ("no-tree-loop-distribute-patterns")
 
+static void *memcpy_init(void *dest,const void *src,size_t len);
+
+/* the implementation we use; determined on the first call */
+static void *(*memcpy_impl)(void *dest,const void *src,size_t len) = memcpy_init;
+static bool memcpy_erms = false;
+
 void *memcpy(void *dest,const void *src,size_t len) {
+	return memcpy_impl(dest,src,len);
+}
+
+/**
+ * Copies less than 16 bytes with at most 4 (possibly overlapping) loads and stores.
+ */
+static inline void copy_small(uchar *d,const uchar *s,size_t len) {
+	if(len >= 8) {
+		uint32_t a = *(const memu32_t*)s;
+		uint32_t b = *(const memu32_t*)(s + 4);
+		uint32_t c = *(const memu32_t*)(s + len - 8);
+		uint32_t e = *(const memu32_t*)(s + len - 4);
+		*(memu32_t*)d = a;
+		*(memu32_t*)(d + 4) = b;
+		*(memu32_t*)(d + len - 8) = c;
+		*(memu32_t*)(d + len - 4) = e;
+	}
+	else if(len >= 4) {
+		uint32_t a = *(const memu32_t*)s;
+		uint32_t b = *(const memu32_t*)(s + len - 4);
+		*(memu32_t*)d = a;
+		*(memu32_t*)(d + len - 4) = b;
+	}
+	else if(len > 0) {
+		/* covers all of the 1, 2 or 3 bytes */
+		d[0] = s[0];
+		d[len >> 1] = s[len >> 1];
+		d[len - 1] = s[len - 1];
+	}
+}
+
+static inline void copy_rep(void *dest,const void *src,size_t len) {
+	__asm__ volatile (
+		"rep movsb"
+		: "+D" (dest), "+S" (src), "+c" (len)
+		: : "memory"
+	);
+}
+
+static void *memcpy_words(void *dest,const void *src,size_t len) {
 	uchar *bdest = (uchar*)dest;
 	uchar *bsrc = (uchar*)src;
+	if(len < 16) {
+		copy_small(bdest,bsrc,len);
+		return dest;
+	}
+
 	/* copy bytes for alignment */
 	if(((uintptr_t)bdest % sizeof(ulong)) == ((uintptr_t)bsrc % sizeof(ulong))) {
 		while(len > 0 && (uintptr_t)bdest % sizeof(ulong)) {
@@ -35,8 +88,8 @@ void *memcpy(void *dest,const void *src,size_t len) {
 		}
 	}
 
-	ulong *ddest = (ulong*)bdest;
-	ulong *dsrc = (ulong*)bsrc;
+	memulong_t *ddest = (memulong_t*)bdest;
+	memulong_t *dsrc = (memulong_t*)bsrc;
 	/* copy words with loop-unrolling */
 	while(len >= sizeof(ulong) * 16) {
 		*ddest = *dsrc;
@@ -73,3 +126,226 @@ void *memcpy(void *dest,const void *src,size_t len) {
 		*bdest++ = *bsrc++;
 	return dest;
 }
+
+static void *memcpy_rep(void *dest,const void *src,size_t len) {
+	/* the startup-costs of "rep movsb" are too high for small copies */
+	if(len < 128)
+		return memcpy_words(dest,src,len);
+	copy_rep(dest,src,len);
+	return dest;
+}
+
+#if !defined(IN_KERNEL)
+
+static inline A_SSE2 void copy16(uchar *d,const uchar *s) {
+	__asm__ volatile (
+		"movdqu	(%1),%%xmm0\n\t"
+		"movdqu	%%xmm0,(%0)\n\t"
+		: : "r" (d), "r" (s)
+		: "xmm0", "memory"
+	);
+}
+
+/**
+ * Copies <blocks> times 64 bytes from <s> to the 16-byte aligned <d>. If <nt> is true, the
+ * stores bypass the cache.
+ */
+static A_SSE2 void copy_sse2_blocks(uchar *d,const uchar *s,size_t blocks,bool nt) {
+	if(nt) {
+		__asm__ volatile (
+			"1:\n\t"
+			"movdqu	(%1),%%xmm0\n\t"
+			"movdqu	16(%1),%%xmm1\n\t"
+			"movdqu	32(%1),%%xmm2\n\t"
+			"movdqu	48(%1),%%xmm3\n\t"
+			"movntdq	%%xmm0,(%0)\n\t"
+			"movntdq	%%xmm1,16(%0)\n\t"
+			"movntdq	%%xmm2,32(%0)\n\t"
+			"movntdq	%%xmm3,48(%0)\n\t"
+			"add	$64,%1\n\t"
+			"add	$64,%0\n\t"
+			"dec	%2\n\t"
+			"jnz	1b\n\t"
+			/* non-temporal stores are weakly ordered */
+			"sfence\n\t"
+			: "+r" (d), "+r" (s), "+r" (blocks)
+			: : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc"
+		);
+	}
+	else {
+		__asm__ volatile (
+			"1:\n\t"
+			"movdqu	(%1),%%xmm0\n\t"
+			"movdqu	16(%1),%%xmm1\n\t"
+			"movdqu	32(%1),%%xmm2\n\t"
+			"movdqu	48(%1),%%xmm3\n\t"
+			"movdqa	%%xmm0,(%0)\n\t"
+			"movdqa	%%xmm1,16(%0)\n\t"
+			"movdqa	%%xmm2,32(%0)\n\t"
+			"movdqa	%%xmm3,48(%0)\n\t"
+			"add	$64,%1\n\t"
+			"add	$64,%0\n\t"
+			"dec	%2\n\t"
+			"jnz	1b\n\t"
+			: "+r" (d), "+r" (s), "+r" (blocks)
+			: : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc"
+		);
+	}
+}
+
+static A_SSE2 void *memcpy_sse2(void *dest,const void *src,size_t len) {
+	uchar *d = (uchar*)dest;
+	const uchar *s = (const uchar*)src;
+	if(len < 16) {
+		copy_small(d,s,len);
+		return dest;
+	}
+	if(len <= 32) {
+		copy16(d,s);
+		copy16(d + len - 16,s + len - 16);
+		return dest;
+	}
+	if(memcpy_erms && len >= MEM_ERMS_THRESHOLD && len < MEM_NT_THRESHOLD) {
+		copy_rep(d,s,len);
+		return dest;
+	}
+
+	/* copy the unaligned head and continue with an aligned destination */
+	copy16(d,s);
+	size_t skip = 16 - ((uintptr_t)d & 15);
+	d += skip;
+	s += skip;
+	len -= skip;
+
+	size_t blocks = len / 64;
+	if(blocks) {
+		copy_sse2_blocks(d,s,blocks,len >= MEM_NT_THRESHOLD);
+		d += blocks * 64;
+		s += blocks * 64;
+		len &= 63;
+	}
+	while(len > 16) {
+		copy16(d,s);
+		d += 16;
+		s += 16;
+		len -= 16;
+	}
+	/* the tail overlaps with the already copied part, if necessary */
+	copy16(d + len - 16,s + len - 16);
+	return dest;
+}
+
+static inline A_AVX2 void copy32(uchar *d,const uchar *s) {
+	__asm__ volatile (
+		"vmovdqu	(%1),%%ymm0\n\t"
+		"vmovdqu	%%ymm0,(%0)\n\t"
+		: : "r" (d), "r" (s)
+		: "ymm0", "memory"
+	);
+}
+
+/**
+ * Copies <blocks> times 128 bytes from <s> to the 32-byte aligned <d>. If <nt> is true, the
+ * stores bypass the cache.
+ */
+static A_AVX2 void copy_avx2_blocks(uchar *d,const uchar *s,size_t blocks,bool nt) {
+	if(nt) {
+		__asm__ volatile (
+			"1:\n\t"
+			"vmovdqu	(%1),%%ymm0\n\t"
+			"vmovdqu	32(%1),%%ymm1\n\t"
+			"vmovdqu	64(%1),%%ymm2\n\t"
+			"vmovdqu	96(%1),%%ymm3\n\t"
+			"vmovntdq	%%ymm0,(%0)\n\t"
+			"vmovntdq	%%ymm1,32(%0)\n\t"
+			"vmovntdq	%%ymm2,64(%0)\n\t"
+			"vmovntdq	%%ymm3,96(%0)\n\t"
+			"add	$128,%1\n\t"
+			"add	$128,%0\n\t"
+			"dec	%2\n\t"
+			"jnz	1b\n\t"
+			"sfence\n\t"
+			: "+r" (d), "+r" (s), "+r" (blocks)
+			: : "ymm0", "ymm1", "ymm2", "ymm3", "memory", "cc"
+		);
+	}
+	else {
+		__asm__ volatile (
+			"1:\n\t"
+			"vmovdqu	(%1),%%ymm0\n\t"
+			"vmovdqu	32(%1),%%ymm1\n\t"
+			"vmovdqu	64(%1),%%ymm2\n\t"
+			"vmovdqu	96(%1),%%ymm3\n\t"
+			"vmovdqa	%%ymm0,(%0)\n\t"
+			"vmovdqa	%%ymm1,32(%0)\n\t"
+			"vmovdqa	%%ymm2,64(%0)\n\t"
+			"vmovdqa	%%ymm3,96(%0)\n\t"
+			"add	$128,%1\n\t"
+			"add	$128,%0\n\t"
+			"dec	%2\n\t"
+			"jnz	1b\n\t"
+			: "+r" (d), "+r" (s), "+r" (blocks)
+			: : "ymm0", "ymm1", "ymm2", "ymm3", "memory", "cc"
+		);
+	}
+}
+
+static A_AVX2 void *memcpy_avx2(void *dest,const void *src,size_t len) {
+	uchar *d = (uchar*)dest;
+	const uchar *s = (const uchar*)src;
+	if(len <= 32)
+		return memcpy_sse2(dest,src,len);
+	if(memcpy_erms && len >= MEM_ERMS_THRESHOLD && len < MEM_NT_THRESHOLD) {
+		copy_rep(d,s,len);
+		return dest;
+	}
+
+	if(len <= 64) {
+		copy32(d,s);
+		copy32(d + len - 32,s + len - 32);
+	}
+	else {
+		copy32(d,s);
+		size_t skip = 32 - ((uintptr_t)d & 31);
+		d += skip;
+		s += skip;
+		len -= skip;
+
+		size_t blocks = len / 128;
+		if(blocks) {
+			copy_avx2_blocks(d,s,blocks,len >= MEM_NT_THRESHOLD);
+			d += blocks * 128;
+			s += blocks * 128;
+			len &= 127;
+		}
+		while(len > 32) {
+			copy32(d,s);
+			d += 32;
+			s += 32;
+			len -= 32;
+		}
+		copy32(d + len - 32,s + len - 32);
+	}
+	/* avoid the penalty for mixing AVX and SSE code */
+	__asm__ volatile ("vzeroupper");
+	return dest;
+}
+
+#endif
+
+static void *memcpy_init(void *dest,const void *src,size_t len) {
+	uint feats = __mem_features();
+	memcpy_erms = (feats & MEMFEAT_ERMS) != 0;
+#if !defined(IN_KERNEL)
+	if(feats & MEMFEAT_AVX2)
+		memcpy_impl = memcpy_avx2;
+	else if(feats & MEMFEAT_SSE2)
+		memcpy_impl = memcpy_sse2;
+	else
+#endif
+	if(memcpy_erms)
+		memcpy_impl = memcpy_rep;
+	else
+		memcpy_impl = memcpy_words;
+	return memcpy_impl(dest,src,len);
+}
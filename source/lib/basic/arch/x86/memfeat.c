@@ -0,0 +1,56 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/arch/x86/cpuid.h>
+#include <sys/common.h>
+
+#include "memimpl.h"
+
+static uint features = (uint)-1;
+
+uint __mem_features(void) {
+	if(features == (uint)-1) {
+		uint32_t eax,ebx,ecx,edx,maxleaf;
+		uint feats = 0;
+
+		cpuid(0,0,&maxleaf,&ebx,&ecx,&edx);
+		cpuid(1,0,&eax,&ebx,&ecx,&edx);
+#if !defined(IN_KERNEL)
+		if(edx & CPUID1_EDX_SSE2)
+			feats |= MEMFEAT_SSE2;
+		/* AVX requires that the OS saves the upper halfs of the ymm registers */
+		bool avx = (ecx & (CPUID1_ECX_OSXSAVE | CPUID1_ECX_AVX)) ==
+				(CPUID1_ECX_OSXSAVE | CPUID1_ECX_AVX) &&
+			(xgetbv(0) & XCR0_SSE_AVX) == XCR0_SSE_AVX;
+#endif
+
+		if(maxleaf >= 7) {
+			cpuid(7,0,&eax,&ebx,&ecx,&edx);
+			if(ebx & CPUID7_EBX_ERMS)
+				feats |= MEMFEAT_ERMS;
+#if !defined(IN_KERNEL)
+			if(avx && (ebx & CPUID7_EBX_AVX2))
+				feats |= MEMFEAT_AVX2;
+#endif
+		}
+		/* if multiple threads do that concurrently, they will all write the same value */
+		features = feats;
+	}
+	return features;
+}
@@ -0,0 +1,54 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <sys/common.h>
+
+/* the instruction set extensions the mem*-functions can use */
+#define MEMFEAT_SSE2			(1 << 0)
+#define MEMFEAT_AVX2			(1 << 1)
+#define MEMFEAT_ERMS			(1 << 2)
+
+/* from this size on, "rep movsb/stosb" beats the other variants if ERMS is available */
+#define MEM_ERMS_THRESHOLD		2048
+/* from this size on, we bypass the cache with non-temporal stores, because the destination
+ * would evict most of the cache anyway */
+#define MEM_NT_THRESHOLD		(4 * 1024 * 1024)
+
+/* allows the usage of SSE2/AVX2 registers in the corresponding functions, independent of the
+ * target we compile for. the AVX2 target is also required to name the ymm registers in the clobber
+ * lists of the inline assembly; an xmm clobber would only tell the compiler about the lower half.
+ * the AVX2 functions execute vzeroupper before they return to avoid the penalty for transitions
+ * to SSE code, so that callers never see dirty upper halves. */
+#define A_SSE2					__attribute__((target("sse2")))
+#define A_AVX2					__attribute__((target("avx2")))
+
+typedef uint16_t __attribute__((may_alias)) memu16_t;
+typedef uint32_t __attribute__((may_alias)) memu32_t;
+typedef uint64_t __attribute__((may_alias)) memu64_t;
+typedef ulong __attribute__((may_alias)) memulong_t;
+
+/**
+ * Determines the features of the CPU that are usable for the mem*-functions once. In the kernel,
+ * no SSE/AVX is reported, because the kernel does not save its own FPU state.
+ *
+ * @return the MEMFEAT_* flags
+ */
+uint __mem_features(void);
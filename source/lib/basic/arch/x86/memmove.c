@@ -30,6 +30,10 @@ void *memmove(void *dest,const void *src,size_t count) {
 	if((uchar*)dest == (uchar*)src || count == 0)
 		return dest;
 
+	/* without overlap, memcpy is faster */
+	if((uintptr_t)dest + count <= (uintptr_t)src || (uintptr_t)src + count <= (uintptr_t)dest)
+		return memcpy(dest,src,count);
+
 	/* moving forward */
 	if((uintptr_t)dest > (uintptr_t)src) {
 		ulong *dsrc = (ulong*)((uintptr_t)src + count - sizeof(ulong));
@@ -43,9 +47,19 @@ void *memmove(void *dest,const void *src,size_t count) {
 		while(count-- > 0)
 			*d-- = *s--;
 	}
-	/* moving backwards */
-	else
-		memcpy(dest,src,count);
+	/* moving backwards; memcpy might load the end of the source before storing the beginning */
+	else {
+		ulong *dsrc = (ulong*)src;
+		ulong *ddest = (ulong*)dest;
+		while(count >= sizeof(ulong)) {
+			*ddest++ = *dsrc++;
+			count -= sizeof(ulong);
+		}
+		s = (uchar*)dsrc;
+		d = (uchar*)ddest;
+		while(count-- > 0)
+			*d++ = *s++;
+	}
 
 	return dest;
 }
@@ -20,24 +20,71 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "memimpl.h"
+
 /* this is necessary to prevent that gcc transforms a loop into library-calls
  * (which might lead to recursion here) */
 #pragma GCC optimize ("no-tree-loop-distribute-patterns")
 
+static void *memset_init(void *addr,int value,size_t count);
+
+/* the implementation we use; determined on the first call */
+static void *(*memset_impl)(void *addr,int value,size_t count) = memset_init;
+static bool memset_erms = false;
+
 void *memset(void *addr,int value,size_t count) {
+	return memset_impl(addr,value,count);
+}
+
+/**
+ * Sets less than 16 bytes to the byte-pattern <val> with at most 4 (possibly overlapping) stores.
+ */
+static inline void set_small(uchar *d,uint32_t val,size_t count) {
+	if(count >= 8) {
+		*(memu32_t*)d = val;
+		*(memu32_t*)(d + 4) = val;
+		*(memu32_t*)(d + count - 8) = val;
+		*(memu32_t*)(d + count - 4) = val;
+	}
+	else if(count >= 4) {
+		*(memu32_t*)d = val;
+		*(memu32_t*)(d + count - 4) = val;
+	}
+	else if(count > 0) {
+		d[0] = val;
+		d[count >> 1] = val;
+		d[count - 1] = val;
+	}
+}
+
+static inline void set_rep(void *addr,int value,size_t count) {
+	__asm__ volatile (
+		"rep stosb"
+		: "+D" (addr), "+c" (count)
+		: "a" (value)
+		: "memory"
+	);
+}
+
+static void *memset_words(void *addr,int value,size_t count) {
 	uchar *baddr = (uchar*)addr;
+	uint32_t val = (uchar)value * 0x01010101U;
+	if(count < 16) {
+		set_small(baddr,val,count);
+		return addr;
+	}
+
 	/* align it */
 	while(count > 0 && (uintptr_t)baddr % sizeof(ulong)) {
 		*baddr++ = value;
 		count--;
 	}
 
-	ulong dwval = (value << 24) | (value << 16) | (value << 8) | value;
+	ulong dwval = val;
 #if defined(__x86_64__)
-	dwval |= ((ulong)value << 56) | ((ulong)value << 48);
-	dwval |= ((ulong)value << 40) | ((ulong)value << 32);
+	dwval |= dwval << 32;
 #endif
-	ulong *dwaddr = (ulong*)baddr;
+	memulong_t *dwaddr = (memulong_t*)baddr;
 	/* set words with loop-unrolling */
 	while(count >= sizeof(ulong) * 16) {
 		*dwaddr = dwval;
@@ -72,3 +119,213 @@ void *memset(void *addr,int value,size_t count) {
 		*baddr++ = value;
 	return addr;
 }
+
+static void *memset_rep(void *addr,int value,size_t count) {
+	/* the startup-costs of "rep stosb" are too high for small counts */
+	if(count < 128)
+		return memset_words(addr,value,count);
+	set_rep(addr,value,count);
+	return addr;
+}
+
+#if !defined(IN_KERNEL)
+
+static inline A_SSE2 void set16(uchar *d,uint32_t val) {
+	__asm__ volatile (
+		"movd	%1,%%xmm0\n\t"
+		"pshufd	$0,%%xmm0,%%xmm0\n\t"
+		"movdqu	%%xmm0,(%0)\n\t"
+		: : "r" (d), "r" (val)
+		: "xmm0", "memory"
+	);
+}
+
+/**
+ * Sets <blocks> times 64 bytes at the 16-byte aligned <d> to the byte-pattern <val>. If <nt> is
+ * true, the stores bypass the cache.
+ */
+static A_SSE2 void set_sse2_blocks(uchar *d,uint32_t val,size_t blocks,bool nt) {
+	if(nt) {
+		__asm__ volatile (
+			"movd	%2,%%xmm0\n\t"
+			"pshufd	$0,%%xmm0,%%xmm0\n\t"
+			"1:\n\t"
+			"movntdq	%%xmm0,(%0)\n\t"
+			"movntdq	%%xmm0,16(%0)\n\t"
+			"movntdq	%%xmm0,32(%0)\n\t"
+			"movntdq	%%xmm0,48(%0)\n\t"
+			"add	$64,%0\n\t"
+			"dec	%1\n\t"
+			"jnz	1b\n\t"
+			/* non-temporal stores are weakly ordered */
+			"sfence\n\t"
+			: "+r" (d), "+r" (blocks)
+			: "r" (val)
+			: "xmm0", "memory", "cc"
+		);
+	}
+	else {
+		__asm__ volatile (
+			"movd	%2,%%xmm0\n\t"
+			"pshufd	$0,%%xmm0,%%xmm0\n\t"
+			"1:\n\t"
+			"movdqa	%%xmm0,(%0)\n\t"
+			"movdqa	%%xmm0,16(%0)\n\t"
+			"movdqa	%%xmm0,32(%0)\n\t"
+			"movdqa	%%xmm0,48(%0)\n\t"
+			"add	$64,%0\n\t"
+			"dec	%1\n\t"
+			"jnz	1b\n\t"
+			: "+r" (d), "+r" (blocks)
+			: "r" (val)
+			: "xmm0", "memory", "cc"
+		);
+	}
+}
+
+static A_SSE2 void *memset_sse2(void *addr,int value,size_t count) {
+	uchar *d = (uchar*)addr;
+	uint32_t val = (uchar)value * 0x01010101U;
+	if(count < 16) {
+		set_small(d,val,count);
+		return addr;
+	}
+	if(count <= 32) {
+		set16(d,val);
+		set16(d + count - 16,val);
+		return addr;
+	}
+	if(memset_erms && count >= MEM_ERMS_THRESHOLD && count < MEM_NT_THRESHOLD) {
+		set_rep(d,value,count);
+		return addr;
+	}
+
+	/* set the unaligned head and continue with an aligned destination */
+	set16(d,val);
+	size_t skip = 16 - ((uintptr_t)d & 15);
+	d += skip;
+	count -= skip;
+
+	size_t blocks = count / 64;
+	if(blocks) {
+		set_sse2_blocks(d,val,blocks,count >= MEM_NT_THRESHOLD);
+		d += blocks * 64;
+		count &= 63;
+	}
+	while(count > 16) {
+		set16(d,val);
+		d += 16;
+		count -= 16;
+	}
+	set16(d + count - 16,val);
+	return addr;
+}
+
+static inline A_AVX2 void set32(uchar *d,uint32_t val) {
+	__asm__ volatile (
+		"vmovd	%1,%%xmm0\n\t"
+		"vpbroadcastd	%%xmm0,%%ymm0\n\t"
+		"vmovdqu	%%ymm0,(%0)\n\t"
+		: : "r" (d), "r" (val)
+		: "ymm0", "memory"
+	);
+}
+
+/**
+ * Sets <blocks> times 128 bytes at the 32-byte aligned <d> to the byte-pattern <val>. If <nt> is
+ * true, the stores bypass the cache.
+ */
+static A_AVX2 void set_avx2_blocks(uchar *d,uint32_t val,size_t blocks,bool nt) {
+	if(nt) {
+		__asm__ volatile (
+			"vmovd	%2,%%xmm0\n\t"
+			"vpbroadcastd	%%xmm0,%%ymm0\n\t"
+			"1:\n\t"
+			"vmovntdq	%%ymm0,(%0)\n\t"
+			"vmovntdq	%%ymm0,32(%0)\n\t"
+			"vmovntdq	%%ymm0,64(%0)\n\t"
+			"vmovntdq	%%ymm0,96(%0)\n\t"
+			"add	$128,%0\n\t"
+			"dec	%1\n\t"
+			"jnz	1b\n\t"
+			"sfence\n\t"
+			: "+r" (d), "+r" (blocks)
+			: "r" (val)
+			: "ymm0", "memory", "cc"
+		);
+	}
+	else {
+		__asm__ volatile (
+			"vmovd	%2,%%xmm0\n\t"
+			"vpbroadcastd	%%xmm0,%%ymm0\n\t"
+			"1:\n\t"
+			"vmovdqa	%%ymm0,(%0)\n\t"
+			"vmovdqa	%%ymm0,32(%0)\n\t"
+			"vmovdqa	%%ymm0,64(%0)\n\t"
+			"vmovdqa	%%ymm0,96(%0)\n\t"
+			"add	$128,%0\n\t"
+			"dec	%1\n\t"
+			"jnz	1b\n\t"
+			: "+r" (d), "+r" (blocks)
+			: "r" (val)
+			: "ymm0", "memory", "cc"
+		);
+	}
+}
+
+static A_AVX2 void *memset_avx2(void *addr,int value,size_t count) {
+	uchar *d = (uchar*)addr;
+	uint32_t val = (uchar)value * 0x01010101U;
+	if(count <= 32)
+		return memset_sse2(addr,value,count);
+	if(memset_erms && count >= MEM_ERMS_THRESHOLD && count < MEM_NT_THRESHOLD) {
+		set_rep(d,value,count);
+		return addr;
+	}
+
+	if(count <= 64) {
+		set32(d,val);
+		set32(d + count - 32,val);
+	}
+	else {
+		set32(d,val);
+		size_t skip = 32 - ((uintptr_t)d & 31);
+		d += skip;
+		count -= skip;
+
+		size_t blocks = count / 128;
+		if(blocks) {
+			set_avx2_blocks(d,val,blocks,count >= MEM_NT_THRESHOLD);
+			d += blocks * 128;
+			count &= 127;
+		}
+		while(count > 32) {
+			set32(d,val);
+			d += 32;
+			count -= 32;
+		}
+		set32(d + count - 32,val);
+	}
+	/* avoid the penalty for mixing AVX and SSE code */
+	__asm__ volatile ("vzeroupper");
+	return addr;
+}
+
+#endif
+
+static void *memset_init(void *addr,int value,size_t count) {
+	uint feats = __mem_features();
+	memset_erms = (feats & MEMFEAT_ERMS) != 0;
+#if !defined(IN_KERNEL)
+	if(feats & MEMFEAT_AVX2)
+		memset_impl = memset_avx2;
+	else if(feats & MEMFEAT_SSE2)
+		memset_impl = memset_sse2;
+	else
+#endif
+	if(memset_erms)
+		memset_impl = memset_rep;
+	else
+		memset_impl = memset_words;
+	return memset_impl(addr,value,count);
+}
@@ -22,13 +22,33 @@
 #include <sys/sync.h>
 #include <sys/thread.h>
 #include <sys/tls.h>
+#include <limits.h>
 #include <pthread.h>
 
+/* the number of times we try to grab a taken mutex before we block */
+#define MUTEX_SPIN_COUNT    100
+
+#if defined(__x86__)
+/* the mutex is a futex-word: 0 = unlocked, 1 = locked, 2 = locked and maybe contended */
+static inline int mutex_xchg(pthread_mutex_t *mutex,int val) {
+    return __sync_lock_test_and_set(mutex,val);
+}
+static inline void cond_inc(pthread_cond_t *cond) {
+    __sync_fetch_and_add(cond,1);
+}
+#else
+/* the other architectures have no atomic operations on ints, so that we use user-semaphores */
 #define MAX_LOCKS   4
 
 static long lockCount = 0;
 static tUserSem usems[MAX_LOCKS];
 
+/* signal and broadcast are usually called with the mutex held, which protects the counter */
+static inline void cond_inc(pthread_cond_t *cond) {
+    (*(volatile pthread_cond_t*)cond)++;
+}
+#endif
+
 int pthread_key_create(pthread_key_t* key,A_UNUSED void (*func)(void*)) {
     *key = tlsadd();
     return 0;
@@ -57,6 +77,47 @@ int pthread_setspecific(pthread_key_t key,void* data) {
     return 0;
 }
 
+#if defined(__x86__)
+int pthread_mutex_init(pthread_mutex_t *mutex,A_UNUSED const pthread_mutexattr_t *attr) {
+    *mutex = 0;
+    return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    int c = __sync_val_compare_and_swap(mutex,0,1);
+    if(EXPECT_TRUE(c == 0))
+        return 0;
+
+    /* spin a bit, unless others are already sleeping */
+    for(int i = 0; i < MUTEX_SPIN_COUNT && c == 1; ++i) {
+        __asm__ volatile ("pause");
+        c = *(volatile pthread_mutex_t*)mutex;
+        if(c == 0 && (c = __sync_val_compare_and_swap(mutex,0,1)) == 0)
+            return 0;
+    }
+
+    /* mark it as contended, so that the holder wakes us up */
+    if(c != 2)
+        c = mutex_xchg(mutex,2);
+    while(c != 0) {
+        futexwait(mutex,2,0);
+        c = mutex_xchg(mutex,2);
+    }
+    return 0;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex) {
+    if(__sync_fetch_and_sub(mutex,1) != 1) {
+        *(volatile pthread_mutex_t*)mutex = 0;
+        futexwake(mutex,1);
+    }
+    return 0;
+}
+
+int pthread_mutex_destroy(A_UNUSED pthread_mutex_t *mutex) {
+    return 0;
+}
+#else
 int pthread_mutex_init(pthread_mutex_t *mutex,A_UNUSED const pthread_mutexattr_t *attr) {
     int id = atomic_add(&lockCount,+1);
     *mutex = id;
@@ -77,3 +138,41 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex) {
     usemdestr(usems + *mutex);
     return 0;
 }
+#endif
+
+int pthread_cond_init(pthread_cond_t *cond,A_UNUSED const pthread_condattr_t *attr) {
+    *cond = 0;
+    return 0;
+}
+
+int pthread_cond_wait(pthread_cond_t *cond,pthread_mutex_t *mutex) {
+    /* the counter changes with every signal. thus, if we get signaled after releasing the mutex,
+     * futexwait returns immediately */
+    int seq = *(volatile pthread_cond_t*)cond;
+    pthread_mutex_unlock(mutex);
+    futexwait(cond,seq,0);
+#if defined(__x86__)
+    /* there might be other waiters now, so we have to acquire it in the contended state */
+    while(mutex_xchg(mutex,2) != 0)
+        futexwait(mutex,2,0);
+    return 0;
+#else
+    return pthread_mutex_lock(mutex);
+#endif
+}
+
+int pthread_cond_signal(pthread_cond_t *cond) {
+    cond_inc(cond);
+    futexwake(cond,1);
+    return 0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t *cond) {
+    cond_inc(cond);
+    futexwake(cond,INT_MAX);
+    return 0;
+}
+
+int pthread_cond_destroy(A_UNUSED pthread_cond_t *cond) {
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/io.h>
+#include <sys/proc.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* has to match the limit of the kernel */
+#define MAX_FDS		32
+
+enum {
+	ACT_OPEN,
+	ACT_DUP2,
+	ACT_CLOSE,
+};
+
+struct posix_spawn_file_action {
+	int type;
+	int fd;
+	int srcfd;
+	char *path;
+	uint flags;
+	mode_t mode;
+};
+
+static posix_spawn_file_action_t *addAction(posix_spawn_file_actions_t *fa,int type,int fd) {
+	if(fd < 0 || fd >= MAX_FDS)
+		return NULL;
+	posix_spawn_file_action_t *acts = (posix_spawn_file_action_t*)realloc(
+		fa->actions,(fa->count + 1) * sizeof(posix_spawn_file_action_t));
+	if(!acts)
+		return NULL;
+	fa->actions = acts;
+	acts[fa->count].type = type;
+	acts[fa->count].fd = fd;
+	acts[fa->count].path = NULL;
+	return acts + fa->count++;
+}
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *fa) {
+	fa->count = 0;
+	fa->actions = NULL;
+	return 0;
+}
+
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *fa) {
+	for(size_t i = 0; i < fa->count; ++i)
+		free(fa->actions[i].path);
+	free(fa->actions);
+	fa->actions = NULL;
+	fa->count = 0;
+	return 0;
+}
+
+int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *fa,int fd,const char *path,
+		int oflag,mode_t mode) {
+	char *pathcpy = strdup(path);
+	if(!pathcpy)
+		return ENOMEM;
+	posix_spawn_file_action_t *act = addAction(fa,ACT_OPEN,fd);
+	if(!act) {
+		free(pathcpy);
+		return fd < 0 || fd >= MAX_FDS ? EBADF : ENOMEM;
+	}
+	act->path = pathcpy;
+	act->flags = oflag;
+	act->mode = mode;
+	return 0;
+}
+
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *fa,int fd,int newfd) {
+	if(fd < 0 || fd >= MAX_FDS)
+		return EBADF;
+	posix_spawn_file_action_t *act = addAction(fa,ACT_DUP2,newfd);
+	if(!act)
+		return newfd < 0 || newfd >= MAX_FDS ? EBADF : ENOMEM;
+	act->srcfd = fd;
+	return 0;
+}
+
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *fa,int fd) {
+	if(!addAction(fa,ACT_CLOSE,fd))
+		return fd < 0 || fd >= MAX_FDS ? EBADF : ENOMEM;
+	return 0;
+}
+
+int posix_spawnattr_init(posix_spawnattr_t *attr) {
+	*attr = 0;
+	return 0;
+}
+
+int posix_spawnattr_destroy(A_UNUSED posix_spawnattr_t *attr) {
+	return 0;
+}
+
+int posix_spawn(pid_t *pid,const char *path,const posix_spawn_file_actions_t *fa,
+		A_UNUSED const posix_spawnattr_t *attr,char *const argv[],char *const envp[]) {
+	int map[MAX_FDS];
+	int temps[MAX_FDS];
+	size_t count = 0,tempCount = 0;
+	int res;
+
+	if(envp == NULL)
+		envp = environ;
+
+	if(fa && fa->count > 0) {
+		/* the kernel does not know about the actions, but only receives the resulting fd-map. thus,
+		 * open the files here and let the kernel pass them to the child */
+		for(size_t i = 0; i < fa->count; ++i) {
+			const posix_spawn_file_action_t *act = fa->actions + i;
+			if(act->type == ACT_OPEN) {
+				int fd;
+				if(act->flags & O_CREAT)
+					fd = create(act->path,act->flags,act->mode);
+				else
+					fd = open(act->path,act->flags);
+				if(fd < 0) {
+					res = -fd;
+					goto error;
+				}
+				temps[tempCount++] = fd;
+				if(fd >= MAX_FDS) {
+					res = EMFILE;
+					goto error;
+				}
+				count = MAX(count,(size_t)fd + 1);
+			}
+			count = MAX(count,(size_t)act->fd + 1);
+			if(act->type == ACT_DUP2)
+				count = MAX(count,(size_t)act->srcfd + 1);
+		}
+
+		/* start with the current fds, but don't pass our temporary fds to the child */
+		for(size_t i = 0; i < count; ++i)
+			map[i] = i;
+		for(size_t i = 0; i < tempCount; ++i)
+			map[temps[i]] = -1;
+
+		for(size_t i = 0, t = 0; i < fa->count; ++i) {
+			const posix_spawn_file_action_t *act = fa->actions + i;
+			switch(act->type) {
+				case ACT_OPEN:
+					map[act->fd] = temps[t++];
+					break;
+				case ACT_DUP2:
+					if(map[act->srcfd] == -1) {
+						res = EBADF;
+						goto error;
+					}
+					map[act->fd] = map[act->srcfd];
+					break;
+				case ACT_CLOSE:
+					map[act->fd] = -1;
+					break;
+			}
+		}
+	}
+
+	/* unlike spawn(), we have to return the error number as a positive value */
+	res = spawn(path,(const char**)argv,(const char**)envp,count ? map : NULL,count);
+	if(res >= 0) {
+		if(pid)
+			*pid = res;
+		res = 0;
+	}
+	else
+		res = -res;
+
+error:
+	for(size_t i = 0; i < tempCount; ++i)
+		close(temps[i]);
+	return res;
+}
+
+int posix_spawnp(pid_t *pid,const char *file,const posix_spawn_file_actions_t *fa,
+		const posix_spawnattr_t *attr,char *const argv[],char *const envp[]) {
+	char path[MAX_PATH_LEN];
+	size_t len,flen;
+
+	/* if there is a slash in file, use it directly */
+	if(strchr(file,'/') != NULL || getenvto(path,sizeof(path),"PATH") < 0)
+		return posix_spawn(pid,file,fa,attr,argv,envp);
+
+	/* append file */
+	len = strlen(path);
+	if(len < MAX_PATH_LEN - 1 && path[len - 1] != '/') {
+		path[len++] = '/';
+		path[len] = '\0';
+	}
+	flen = strlen(file);
+	if(len + flen < MAX_PATH_LEN)
+		strcpy(path + len,file);
+	return posix_spawn(pid,path,fa,attr,argv,envp);
+}
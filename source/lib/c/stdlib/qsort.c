@@ -22,47 +22,175 @@
 #include <string.h>
 
 /**
- * Quicksort-implementation
- * source: http://de.wikipedia.org/wiki/Quicksort
+ * Introsort: quicksort with median-of-3 or ninther pivots, which switches to heapsort if the
+ * recursion gets too deep and uses insertion sort for small partitions. Instead of recursion,
+ * we push the larger partition onto an explicit stack and continue with the smaller one, so that
+ * the stack never needs more than log2(nmemb) entries.
+ * see "Introspective Sorting and Selection Algorithms", Musser, 1997 and
+ * "Engineering a Sort Function", Bentley and McIlroy, 1993
  */
-static void _qsort(void *base,size_t size,fCompare cmp,int left,int right);
-static int divide(void *base,size_t size,fCompare cmp,int left,int right);
+
+#define INSERTION_THRESHOLD		16
+#define NINTHER_THRESHOLD		128
+#define STACK_SIZE				(sizeof(size_t) * 8)
+
+typedef struct {
+	char *base;
+	size_t nmemb;
+	size_t depth;
+} sPartition;
+
+static void swap(char *a,char *b,size_t size,bool words);
+static void insertionSort(char *base,size_t nmemb,size_t size,fCompare cmp,bool words);
+static void heapSort(char *base,size_t nmemb,size_t size,fCompare cmp,bool words);
+static char *median3(char *a,char *b,char *c,fCompare cmp);
+static char *choosePivot(char *base,size_t nmemb,size_t size,fCompare cmp);
+static size_t partition(char *base,size_t nmemb,size_t size,fCompare cmp,bool words);
 
 void qsort(void *base,size_t nmemb,size_t size,fCompare cmp) {
-	_qsort(base,size,cmp,0,nmemb - 1);
+	sPartition stack[STACK_SIZE];
+	size_t sp = 0;
+	/* swap word-wise if possible */
+	bool words = ((uintptr_t)base % sizeof(ulong)) == 0 && (size % sizeof(ulong)) == 0;
+
+	/* limit the depth to 2 * log2(nmemb) */
+	size_t depth = 0;
+	for(size_t n = nmemb; n > 1; n >>= 1)
+		depth += 2;
+
+	char *b = (char*)base;
+	size_t n = nmemb;
+	while(1) {
+		while(n > INSERTION_THRESHOLD) {
+			if(depth == 0) {
+				heapSort(b,n,size,cmp,words);
+				n = 0;
+				break;
+			}
+			depth--;
+
+			size_t p = partition(b,n,size,cmp,words);
+			char *right = b + (p + 1) * size;
+			size_t rn = n - p - 1;
+			/* continue with the smaller one */
+			if(p < rn) {
+				stack[sp++] = (sPartition){right,rn,depth};
+				n = p;
+			}
+			else {
+				stack[sp++] = (sPartition){b,p,depth};
+				b = right;
+				n = rn;
+			}
+		}
+
+		if(n > 1)
+			insertionSort(b,n,size,cmp,words);
+		if(sp == 0)
+			break;
+
+		sp--;
+		b = stack[sp].base;
+		n = stack[sp].nmemb;
+		depth = stack[sp].depth;
+	}
 }
 
-static void _qsort(void *base,size_t size,fCompare cmp,int left,int right) {
-	/* TODO someday we should provide a better implementation which uses another sort-algo
-	 * for small arrays, don't uses recursion and so on */
-	if(left < right) {
-		int i = divide(base,size,cmp,left,right);
-		_qsort(base,size,cmp,left,i - 1);
-		_qsort(base,size,cmp,i + 1,right);
+static void swap(char *a,char *b,size_t size,bool words) {
+	if(words) {
+		ulong *wa = (ulong*)a;
+		ulong *wb = (ulong*)b;
+		for(size = size / sizeof(ulong); size > 0; --size) {
+			ulong tmp = *wa;
+			*wa++ = *wb;
+			*wb++ = tmp;
+		}
+	}
+	else {
+		for(; size > 0; --size) {
+			char tmp = *a;
+			*a++ = *b;
+			*b++ = tmp;
+		}
 	}
 }
 
-static int divide(void *base,size_t size,fCompare cmp,int left,int right) {
-	char *pleft = (char*)base + left * size;
-	char *piv = (char*)base + right * size;
-	char *i = pleft;
-	char *j = piv - size;
-	do {
-		/* right until the element is > piv */
-		while(cmp(i,piv) <= 0 && i < piv)
+static void insertionSort(char *base,size_t nmemb,size_t size,fCompare cmp,bool words) {
+	char *end = base + nmemb * size;
+	for(char *i = base + size; i < end; i += size) {
+		for(char *j = i; j > base && cmp(j - size,j) > 0; j -= size)
+			swap(j - size,j,size,words);
+	}
+}
+
+static void siftDown(char *base,size_t root,size_t nmemb,size_t size,fCompare cmp,bool words) {
+	size_t child;
+	while((child = root * 2 + 1) < nmemb) {
+		if(child + 1 < nmemb && cmp(base + child * size,base + (child + 1) * size) < 0)
+			child++;
+		if(cmp(base + root * size,base + child * size) >= 0)
+			break;
+		swap(base + root * size,base + child * size,size,words);
+		root = child;
+	}
+}
+
+static void heapSort(char *base,size_t nmemb,size_t size,fCompare cmp,bool words) {
+	for(size_t i = nmemb / 2; i > 0; --i)
+		siftDown(base,i - 1,nmemb,size,cmp,words);
+	for(size_t end = nmemb - 1; end > 0; --end) {
+		swap(base,base + end * size,size,words);
+		siftDown(base,0,end,size,cmp,words);
+	}
+}
+
+static char *median3(char *a,char *b,char *c,fCompare cmp) {
+	if(cmp(a,b) < 0) {
+		if(cmp(b,c) < 0)
+			return b;
+		return cmp(a,c) < 0 ? c : a;
+	}
+	if(cmp(b,c) > 0)
+		return b;
+	return cmp(a,c) > 0 ? c : a;
+}
+
+static char *choosePivot(char *base,size_t nmemb,size_t size,fCompare cmp) {
+	char *lo = base;
+	char *mid = base + (nmemb / 2) * size;
+	char *hi = base + (nmemb - 1) * size;
+	if(nmemb > NINTHER_THRESHOLD) {
+		/* the median of the medians of three groups of three */
+		size_t d = (nmemb / 8) * size;
+		lo = median3(lo,lo + d,lo + 2 * d,cmp);
+		mid = median3(mid - d,mid,mid + d,cmp);
+		hi = median3(hi - 2 * d,hi - d,hi,cmp);
+	}
+	return median3(lo,mid,hi,cmp);
+}
+
+static size_t partition(char *base,size_t nmemb,size_t size,fCompare cmp,bool words) {
+	/* put the pivot at the front */
+	swap(base,choosePivot(base,nmemb,size,cmp),size,words);
+
+	/* stop at elements equal to the pivot on both sides, so that many duplicates still lead to
+	 * balanced partitions */
+	char *end = base + nmemb * size;
+	char *i = base;
+	char *j = end;
+	while(1) {
+		do
 			i += size;
-		/* left until the element is < piv */
-		while(cmp(j,piv) >= 0 && j > pleft)
+		while(i < end && cmp(i,base) < 0);
+		do
 			j -= size;
-
-		/* swap */
-		if(i < j)
-			memswp(i,j,size);
+		while(cmp(j,base) > 0);
+		if(i >= j)
+			break;
+		swap(i,j,size,words);
 	}
-	while(i < j);
 
-	/* swap piv with element i */
-	if(cmp(i,piv) > 0)
-		memswp(i,piv,size);
-	return (uint)(i - (char*)base) / size;
+	/* put the pivot in its final place */
+	swap(base,j,size,words);
+	return (size_t)(j - base) / size;
 }
@@ -18,9 +18,20 @@
  */
 
 #include <sys/conf.h>
+#include <sys/sharedinfo.h>
 #include <sys/syscalls.h>
+#include <errno.h>
 
 long sysconf(int id) {
+	/* the constant values can be read from the shared info page */
+	if(id >= 0 && id < SHINFO_CONF_COUNT) {
+		const sSharedInfo *info = sharedinfo();
+		if(EXPECT_TRUE(info)) {
+			long res = info->conf[id];
+			errno = res < 0 ? res : 0;
+			return res;
+		}
+	}
 	return syscall1(SYSCALL_GETCONF,id);
 }
 
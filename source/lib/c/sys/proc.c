@@ -35,6 +35,12 @@ int execvpe(const char *path,const char **args,const char **env) {
 	return syscall3(SYSCALL_EXEC,(ulong)abspath(apath,sizeof(apath),path),(ulong)args,(ulong)env);
 }
 
+int spawn(const char *path,const char **args,const char **env,const int *fds,size_t fdcount) {
+	char apath[MAX_PATH_LEN];
+	return syscall7(SYSCALL_SPAWN,(ulong)abspath(apath,sizeof(apath),path),(ulong)args,(ulong)env,
+		(ulong)fds,fdcount,0,0);
+}
+
 int execvp(const char *file,const char **args) {
 	char path[MAX_PATH_LEN];
 	size_t len,flen;
@@ -0,0 +1,34 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/sharedinfo.h>
+#include <sys/syscalls.h>
+
+/* 0 = not requested yet, 1 = not available */
+static uintptr_t infoAddr = 0;
+
+const sSharedInfo *sharedinfo(void) {
+	if(EXPECT_FALSE(infoAddr == 0)) {
+		/* the kernel maps the page on the first request and returns its address */
+		long res = syscall1(SYSCALL_GETCONF,CONF_SHARED_INFO);
+		infoAddr = res <= 0 ? 1 : (uintptr_t)res;
+	}
+	return infoAddr == 1 ? NULL : (const sSharedInfo*)infoAddr;
+}
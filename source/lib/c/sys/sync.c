@@ -25,21 +25,20 @@ int rwcrt(tRWLock *l) {
 	int res = usemcrt(&l->mutex,1);
 	if(res < 0)
 		return res;
-	l->sem = semcrt(0);
-	if(l->sem < 0) {
-		usemdestr(&l->mutex);
-		return l->sem;
-	}
+	l->seq = 0;
 	l->count = 0;
 	l->waits = 0;
 	return 0;
 }
 
 static void rwwait(tRWLock *l) {
-	// store that we're waiting, so that we know that we should up the sem in rwrel().
+	// store that we're waiting, so that we know that we should wake somebody up in rwrel().
+	// remember the sequence number before releasing the mutex; if somebody releases the lock in
+	// the meantime, it changes and futexwait returns immediately.
+	int seq = l->seq;
 	l->waits++;
 	usemup(&l->mutex);
-	IGNSIGS(semdown(l->sem));
+	futexwait(&l->seq,seq,0);
 	usemdown(&l->mutex);
 	l->waits--;
 }
@@ -76,20 +75,23 @@ void rwrel(tRWLock *l,int op) {
 	if(op == RW_READ) {
 		assert(l->count > 0);
 		// if we're the last reader and there is somebody waiting, wake him up
-		if(--l->count == 0 && l->waits)
-			semup(l->sem);
+		if(--l->count == 0 && l->waits) {
+			l->seq++;
+			futexwake(&l->seq,1);
+		}
 	}
 	else {
 		assert(l->count == -1);
 		l->count = 0;
-		// if there is somebody waiting, wake him up
-		if(l->waits)
-			semup(l->sem);
+		// if there is somebody waiting, wake them all up, because all readers can continue
+		if(l->waits) {
+			l->seq++;
+			futexwake(&l->seq,l->waits);
+		}
 	}
 	usemup(&l->mutex);
 }
 
 void rwdestr(tRWLock *l) {
-	semdestr(l->sem);
 	usemdestr(&l->mutex);
 }
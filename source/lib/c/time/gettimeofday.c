@@ -0,0 +1,98 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/sharedinfo.h>
+#include <sys/syscalls.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <time.h>
+
+/**
+ * Reads the microseconds since boot and the boot time from the shared info page.
+ *
+ * @return true if successful
+ */
+static bool readTime(uint64_t *usecs,time_t *bootTime) {
+	const sSharedInfo *info = sharedinfo();
+	if(EXPECT_FALSE(!info))
+		return false;
+
+	ulong seq;
+	do {
+		/* wait until the kernel is done with updating it */
+		while((seq = info->seq) & 1)
+			;
+		__asm__ volatile ("" : : : "memory");
+		if(info->tscPerUs)
+			*usecs = info->timestamp + (rdtsc() - info->tscBase) / info->tscPerUs;
+		else
+			*usecs = info->timestamp;
+		*bootTime = info->bootTime;
+		__asm__ volatile ("" : : : "memory");
+	}
+	while(EXPECT_FALSE(info->seq != seq));
+	return true;
+}
+
+int gettimeofday(struct timeval *tv) {
+	uint64_t usecs;
+	time_t bootTime;
+	if(EXPECT_FALSE(!readTime(&usecs,&bootTime)))
+		return syscall1(SYSCALL_GETTOD,(ulong)tv);
+
+	tv->tv_sec = bootTime + usecs / 1000000;
+	tv->tv_usec = usecs % 1000000;
+	errno = 0;
+	return 0;
+}
+
+int clock_gettime(clockid_t clk,struct timespec *ts) {
+	uint64_t usecs;
+	time_t bootTime = 0;
+	switch(clk) {
+		case CLOCK_REALTIME:
+			if(!readTime(&usecs,&bootTime)) {
+				struct timeval tv;
+				int res = syscall1(SYSCALL_GETTOD,(ulong)&tv);
+				if(res < 0)
+					return res;
+				usecs = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+				bootTime = 0;
+			}
+			break;
+
+		case CLOCK_MONOTONIC:
+			/* the time of day might be set backwards, so use the TSC instead */
+			if(!readTime(&usecs,&bootTime))
+				usecs = tsctotime(rdtsc());
+			break;
+
+		default:
+			errno = -EINVAL;
+			return -EINVAL;
+	}
+
+	if(clk == CLOCK_MONOTONIC)
+		bootTime = 0;
+	ts->tv_sec = bootTime + usecs / 1000000;
+	ts->tv_nsec = (usecs % 1000000) * 1000;
+	errno = 0;
+	return 0;
+}
@@ -24,6 +24,8 @@
 #define REGEX_FLAG_BEGIN		(1 << 0)
 #define REGEX_FLAG_END			(1 << 1)
 
+#define REGEX_REPEAT_INF		(1 << 30)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
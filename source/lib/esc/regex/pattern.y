@@ -85,15 +85,15 @@ std_elem:
 			charclass_list T_CHARCLASS_END				{ $$ = pattern_createCharClass($2,false); }
 	| T_CHARCLASS_BEGIN
 			T_NEGATE charclass_list T_CHARCLASS_END		{ $$ = pattern_createCharClass($3,true); }
-	| std_elem T_REP_ANY								{ $$ = pattern_createRepeat($1,0,1 << 30); }
-	| std_elem T_REP_ONEPLUS							{ $$ = pattern_createRepeat($1,1,1 << 30); }
+	| std_elem T_REP_ANY								{ $$ = pattern_createRepeat($1,0,REGEX_REPEAT_INF); }
+	| std_elem T_REP_ONEPLUS							{ $$ = pattern_createRepeat($1,1,REGEX_REPEAT_INF); }
 	| std_elem T_REP_OPTIONAL							{ $$ = pattern_createRepeat($1,0,1); }
 	| std_elem T_REPSPEC_BEGIN
 			T_NUMBER T_COMMA T_NUMBER
 			T_REPSPEC_END								{ $$ = pattern_createRepeat($1,$3,$5); }
 	| std_elem T_REPSPEC_BEGIN
 			T_NUMBER T_COMMA
-			T_REPSPEC_END								{ $$ = pattern_createRepeat($1,$3,1 << 30); }
+			T_REPSPEC_END								{ $$ = pattern_createRepeat($1,$3,REGEX_REPEAT_INF); }
 	| std_elem T_REPSPEC_BEGIN
 			T_NUMBER
 			T_REPSPEC_END								{ $$ = pattern_createRepeat($1,$3,$3); }
@@ -0,0 +1,623 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/regex/regex.h>
+#include <esc/regex/elements.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+
+#include "pattern.h"
+#include "program.h"
+
+namespace esc {
+
+const size_t Regex::Program::MAX_INSTS;
+const size_t Regex::Program::MAX_DFA_STATES;
+const size_t Regex::Program::NOPOS;
+
+/**
+ * The set of threads of the Pike-VM at one position. A sparse set makes insert, lookup and
+ * clear O(1). Each thread has its own copy of the group offsets.
+ */
+class Regex::Program::ThreadList {
+public:
+	explicit ThreadList(size_t insts,size_t ncaps)
+		: _sparse(insts), _dense(insts), _caps(insts * ncaps), _count(), _ncaps(ncaps) {
+	}
+
+	size_t count() const {
+		return _count;
+	}
+	uint pc(size_t i) const {
+		return _dense[i];
+	}
+	size_t *caps(size_t i) {
+		return _caps.data() + i * _ncaps;
+	}
+	bool contains(uint pc) const {
+		uint i = _sparse[pc];
+		return i < _count && _dense[i] == pc;
+	}
+	size_t *add(uint pc) {
+		_sparse[pc] = _count;
+		_dense[_count] = pc;
+		return caps(_count++);
+	}
+	void clear() {
+		_count = 0;
+	}
+	void swap(ThreadList &l) {
+		_sparse.swap(l._sparse);
+		_dense.swap(l._dense);
+		_caps.swap(l._caps);
+		std::swap(_count,l._count);
+	}
+
+private:
+	std::vector<uint> _sparse;
+	std::vector<uint> _dense;
+	std::vector<size_t> _caps;
+	size_t _count;
+	size_t _ncaps;
+};
+
+Regex::Program::DState::DState(const std::vector<uint> &_insts,size_t classes)
+		: insts(_insts), match(), matchEol(), dead(_insts.empty()), next(new DState*[classes]) {
+	for(size_t i = 0; i < classes; ++i)
+		next[i] = NULL;
+}
+
+void Regex::Program::DFA::clear() {
+	for(auto it = states.begin(); it != states.end(); ++it)
+		delete it->second;
+	states.clear();
+	start = NULL;
+}
+
+Regex::Program::Program(const Element *root,int flags,size_t groups)
+		: _flags(flags), _groups(groups), _start(), _insts(), _classes(), _byteClasses(),
+		  _classReps(), _numByteClasses(), _literal(), _literalFolds(), _litRare(),
+		  _litSuffix(), _litPeriod(), _litPeriodic(), _dfas(), _set(), _mark(), _stack(), _gen() {
+	emit(root);
+	if(flags & REGEX_FLAG_END)
+		add(OP_EOL);
+	add(OP_MATCH);
+	_mark.resize(_insts.size());
+
+	buildByteClasses();
+
+	std::string cur;
+	extractLiteral(root,cur,_literal);
+	if(cur.length() > _literal.length())
+		_literal = cur;
+	prepareLiteral();
+}
+
+Regex::Program::~Program() {
+	for(size_t i = 0; i < ARRAY_SIZE(_dfas); ++i)
+		delete _dfas[i];
+}
+
+uint Regex::Program::add(uint op,uint x,uint y) {
+	if(_insts.size() >= MAX_INSTS)
+		throw std::runtime_error("Pattern too large");
+	Inst inst;
+	inst.op = op;
+	inst.x = x;
+	inst.y = y;
+	_insts.push_back(inst);
+	return _insts.size() - 1;
+}
+
+uint Regex::Program::addClass(const Element *e) {
+	// let the elements decide which bytes they accept, so that we get exactly their semantic
+	CharClass cls[2];
+	for(int ci = 0; ci < 2; ++ci) {
+		memset(cls[ci].bits,0,sizeof(cls[ci].bits));
+		for(int c = 0; c < 256; ++c) {
+			std::string str(1,(char)c);
+			Input in(str,0,ci ? CASE_INSENSITIVE : NONE);
+			if(e->match(NULL,in))
+				cls[ci].bits[c / 32] |= 1U << (c % 32);
+		}
+	}
+
+	for(size_t i = 0; i < _classes[0].size(); ++i) {
+		if(_classes[0][i] == cls[0] && _classes[1][i] == cls[1])
+			return i;
+	}
+	_classes[0].push_back(cls[0]);
+	_classes[1].push_back(cls[1]);
+	return _classes[0].size() - 1;
+}
+
+void Regex::Program::emit(const Element *e) {
+	switch(e->type()) {
+		case Element::CHAR:
+		case Element::CHARCLASS:
+		case Element::CHARCLASS_RANGE:
+		case Element::DOT:
+			add(OP_CHAR,addClass(e));
+			break;
+
+		case Element::GROUP: {
+			const ElementList *list = static_cast<const GroupElement*>(e)->list();
+			add(OP_SAVE,list->id() * 2);
+			for(auto it = list->begin(); it != list->end(); ++it)
+				emit(*it);
+			add(OP_SAVE,list->id() * 2 + 1);
+		}
+		break;
+
+		case Element::CHOICE: {
+			const ElementList *list = static_cast<const ChoiceElement*>(e)->list();
+			std::vector<uint> jumps;
+			for(auto it = list->begin(); it != list->end(); ++it) {
+				if(it + 1 != list->end()) {
+					uint split = add(OP_SPLIT,_insts.size() + 1);
+					emit(*it);
+					jumps.push_back(add(OP_JMP));
+					_insts[split].y = _insts.size();
+				}
+				else
+					emit(*it);
+			}
+			for(auto it = jumps.begin(); it != jumps.end(); ++it)
+				_insts[*it].x = _insts.size();
+		}
+		break;
+
+		case Element::REPEAT: {
+			const RepeatElement *rep = static_cast<const RepeatElement*>(e);
+			for(int i = 0; i < rep->min(); ++i)
+				emit(rep->element());
+			if(rep->max() == REGEX_REPEAT_INF) {
+				uint split = add(OP_SPLIT,_insts.size() + 1);
+				emit(rep->element());
+				add(OP_JMP,split);
+				_insts[split].y = _insts.size();
+			}
+			else {
+				std::vector<uint> splits;
+				for(int i = rep->min(); i < rep->max(); ++i) {
+					splits.push_back(add(OP_SPLIT,_insts.size() + 1));
+					emit(rep->element());
+				}
+				for(auto it = splits.begin(); it != splits.end(); ++it)
+					_insts[*it].y = _insts.size();
+			}
+		}
+		break;
+	}
+}
+
+void Regex::Program::buildByteClasses() {
+	for(int ci = 0; ci < 2; ++ci) {
+		// start with one class for all bytes and split it by every character class
+		size_t num = 1;
+		memset(_byteClasses[ci],0,sizeof(_byteClasses[ci]));
+		for(auto cls = _classes[ci].begin(); cls != _classes[ci].end(); ++cls) {
+			int remap[256][2];
+			memset(remap,-1,sizeof(remap));
+			size_t newnum = 0;
+			for(int c = 0; c < 256; ++c) {
+				int *id = &remap[_byteClasses[ci][c]][cls->contains(c)];
+				if(*id == -1)
+					*id = newnum++;
+				_byteClasses[ci][c] = *id;
+			}
+			num = newnum;
+		}
+
+		for(int c = 255; c >= 0; --c)
+			_classReps[ci][_byteClasses[ci][c]] = c;
+		_numByteClasses[ci] = num;
+	}
+}
+
+void Regex::Program::extractLiteral(const Element *e,std::string &cur,std::string &best) {
+	switch(e->type()) {
+		case Element::CHAR:
+			cur += static_cast<const CharElement*>(e)->character();
+			return;
+
+		case Element::GROUP: {
+			const ElementList *list = static_cast<const GroupElement*>(e)->list();
+			for(auto it = list->begin(); it != list->end(); ++it)
+				extractLiteral(*it,cur,best);
+			return;
+		}
+
+		case Element::REPEAT: {
+			// the first repetition is required, but we don't know what follows it
+			const RepeatElement *rep = static_cast<const RepeatElement*>(e);
+			if(rep->min() > 0)
+				extractLiteral(rep->element(),cur,best);
+		}
+		break;
+
+		default:
+			break;
+	}
+
+	if(cur.length() > best.length())
+		best = cur;
+	cur.clear();
+}
+
+void Regex::Program::prepareLiteral() {
+	// bytes that are typically frequent in text, starting with the most frequent one. we search
+	// for the least frequent byte of the literal with memchr to get as few false hits as possible
+	static const char frequent[] = " etaoinsrhldcumfpgwybvk\n.,-_/:=0123456789";
+	size_t best = 0;
+	for(size_t i = 0; i < _literal.length(); ++i) {
+		uchar c = _literal[i];
+		if(tolower(c) != toupper(c))
+			_literalFolds = true;
+
+		const char *pos = c ? strchr(frequent,tolower(c)) : NULL;
+		size_t rank = pos ? (size_t)(pos - frequent) : sizeof(frequent);
+		// uppercase letters are less frequent than lowercase ones
+		if(pos && isupper(c))
+			rank = sizeof(frequent) - 1;
+		if(rank > best || i == 0) {
+			best = rank;
+			_litRare = i;
+		}
+	}
+
+	// compute the critical factorization for the two-way algorithm, i.e., the maximal suffix
+	// according to both orderings of the alphabet. see Crochemore and Perrin, "Two-way string
+	// matching", 1991
+	const uchar *n = reinterpret_cast<const uchar*>(_literal.c_str());
+	size_t len = _literal.length();
+	size_t suffix[2];
+	size_t period[2];
+	for(int rev = 0; rev < 2; ++rev) {
+		size_t ms = NOPOS, j = 0, k = 1, p = 1;
+		while(j + k < len) {
+			uchar a = n[j + k];
+			uchar b = n[ms + k];
+			if(rev ? b < a : a < b) {
+				j += k;
+				k = 1;
+				p = j - ms;
+			}
+			else if(a == b) {
+				if(k != p)
+					k++;
+				else {
+					j += p;
+					k = 1;
+				}
+			}
+			else {
+				ms = j++;
+				k = p = 1;
+			}
+		}
+		suffix[rev] = ms + 1;
+		period[rev] = p;
+	}
+	int which = suffix[1] >= suffix[0] ? 1 : 0;
+	_litSuffix = suffix[which];
+	_litPeriod = period[which];
+	_litPeriodic = len > 0 && memcmp(n,n + _litPeriod,_litSuffix) == 0;
+	if(!_litPeriodic)
+		_litPeriod = MAX(_litSuffix,len - _litSuffix) + 1;
+}
+
+const char *Regex::Program::findLiteral(const char *begin,const char *end) const {
+	const uchar *h = reinterpret_cast<const uchar*>(begin);
+	const uchar *n = reinterpret_cast<const uchar*>(_literal.c_str());
+	size_t hlen = end - begin;
+	size_t nlen = _literal.length();
+	if(nlen == 1)
+		return static_cast<const char*>(memchr(begin,n[0],hlen));
+
+	size_t memory = 0;
+	size_t j = 0;
+	while(j + nlen <= hlen) {
+		// quickly skip the positions where the rarest byte does not match
+		if(h[j + _litRare] != n[_litRare]) {
+			const void *next = memchr(h + j + _litRare,n[_litRare],hlen - nlen + 1 - j);
+			if(!next)
+				return NULL;
+			j = static_cast<const uchar*>(next) - h - _litRare;
+			memory = 0;
+		}
+
+		// match the right half
+		size_t i = MAX(_litSuffix,memory);
+		while(i < nlen && n[i] == h[i + j])
+			i++;
+		if(i < nlen) {
+			j += i - _litSuffix + 1;
+			memory = 0;
+			continue;
+		}
+
+		// match the left half
+		size_t stop = _litPeriodic ? memory : 0;
+		i = _litSuffix;
+		while(i > stop && n[i - 1] == h[i - 1 + j])
+			i--;
+		if(i <= stop)
+			return begin + j;
+		j += _litPeriod;
+		// for periodic needles, the part after the period has already been matched
+		if(_litPeriodic)
+			memory = nlen - _litPeriod;
+	}
+	return NULL;
+}
+
+Regex::Program::DFA *Regex::Program::dfa(uint flags,bool anchored) const {
+	bool ci = flags & CASE_INSENSITIVE;
+	DFA *&d = _dfas[(ci ? 2 : 0) + (anchored ? 1 : 0)];
+	if(!d)
+		d = new DFA(ci,anchored);
+	return d;
+}
+
+void Regex::Program::closure(uint pc) const {
+	// adds all states reachable from <pc> without consuming a byte to _set
+	_stack.push_back(pc);
+	while(!_stack.empty()) {
+		pc = _stack.back();
+		_stack.pop_back();
+		while(_mark[pc] != _gen) {
+			_mark[pc] = _gen;
+			const Inst &inst = _insts[pc];
+			if(inst.op == OP_JMP)
+				pc = inst.x;
+			else if(inst.op == OP_SPLIT) {
+				_stack.push_back(inst.y);
+				pc = inst.x;
+			}
+			else if(inst.op == OP_SAVE)
+				pc++;
+			else {
+				_set.push_back(pc);
+				break;
+			}
+		}
+	}
+}
+
+Regex::Program::DState *Regex::Program::state(DFA *d,bool *flushed) const {
+	std::sort(_set.begin(),_set.end());
+	auto it = d->states.find(_set);
+	if(it != d->states.end())
+		return it->second;
+
+	// don't let the cache grow without bounds. clearing it is always possible, because the
+	// states can be rebuilt from the NFA
+	if(d->states.size() >= MAX_DFA_STATES) {
+		d->clear();
+		*flushed = true;
+	}
+
+	DState *s = new DState(_set,_numByteClasses[d->ci]);
+	for(auto pc = _set.begin(); pc != _set.end(); ++pc) {
+		if(_insts[*pc].op == OP_MATCH)
+			s->match = true;
+		else if(_insts[*pc].op == OP_EOL)
+			s->matchEol = true;
+	}
+	d->states.insert(std::make_pair(_set,s));
+	return s;
+}
+
+Regex::Program::DState *Regex::Program::startState(DFA *d) const {
+	if(!d->start) {
+		_set.clear();
+		_gen++;
+		closure(_start);
+		bool flushed = false;
+		d->start = state(d,&flushed);
+	}
+	return d->start;
+}
+
+Regex::Program::DState *Regex::Program::step(DFA *d,DState *s,uint cls) const {
+	const CharClass *classes = _classes[d->ci].data();
+	uchar c = _classReps[d->ci][cls];
+	_set.clear();
+	_gen++;
+	for(auto pc = s->insts.begin(); pc != s->insts.end(); ++pc) {
+		const Inst &inst = _insts[*pc];
+		if(inst.op == OP_CHAR && classes[inst.x].contains(c))
+			closure(*pc + 1);
+	}
+	// a match can start at every position
+	if(!d->anchored)
+		closure(_start);
+
+	bool flushed = false;
+	DState *next = state(d,&flushed);
+	// if the cache has been flushed, <s> is gone
+	if(!flushed)
+		s->next[cls] = next;
+	return next;
+}
+
+bool Regex::Program::useLiteral(uint flags) const {
+	return !_literal.empty() && (!_literalFolds || !(flags & CASE_INSENSITIVE));
+}
+
+bool Regex::Program::contains(const char *begin,const char *end,uint flags) const {
+	if(useLiteral(flags) && !findLiteral(begin,end))
+		return false;
+	return scan(begin,end,flags);
+}
+
+bool Regex::Program::scan(const char *begin,const char *end,uint flags) const {
+	DFA *d = dfa(flags,_flags & REGEX_FLAG_BEGIN);
+	const uchar *map = _byteClasses[d->ci];
+	DState *s = startState(d);
+	if(s->match)
+		return true;
+	for(const char *p = begin; p < end; ++p) {
+		uint cls = map[static_cast<uchar>(*p)];
+		DState *next = s->next[cls];
+		if(EXPECT_FALSE(next == NULL))
+			next = step(d,s,cls);
+		s = next;
+		if(EXPECT_FALSE(s->match))
+			return true;
+		if(EXPECT_FALSE(s->dead))
+			return false;
+	}
+	return s->matchEol;
+}
+
+bool Regex::Program::matches(const char *begin,const char *end,uint flags) const {
+	DFA *d = dfa(flags,true);
+	const uchar *map = _byteClasses[d->ci];
+	DState *s = startState(d);
+	for(const char *p = begin; p < end; ++p) {
+		uint cls = map[static_cast<uchar>(*p)];
+		DState *next = s->next[cls];
+		if(EXPECT_FALSE(next == NULL))
+			next = step(d,s,cls);
+		s = next;
+		if(EXPECT_FALSE(s->dead))
+			return false;
+	}
+	return s->match || s->matchEol;
+}
+
+const char *Regex::Program::searchLine(const char *begin,const char *end,uint flags) const {
+	bool literal = useLiteral(flags);
+	if(literal && memchr(_literal.c_str(),'\n',_literal.length()))
+		return NULL;
+
+	while(begin < end) {
+		const char *line = begin;
+		if(literal) {
+			// lines without the literal can't match
+			const char *hit = findLiteral(begin,end);
+			if(!hit)
+				return NULL;
+			line = hit;
+			while(line > begin && line[-1] != '\n')
+				line--;
+		}
+
+		const char *eol = static_cast<const char*>(memchr(line,'\n',end - line));
+		if(!eol)
+			eol = end;
+		if(scan(line,eol,flags))
+			return line;
+		begin = eol + 1;
+	}
+	return NULL;
+}
+
+void Regex::Program::addThread(ThreadList &list,uint pc,size_t *caps,size_t pos,size_t len) const {
+	// follow the epsilon transitions in priority order. SAVE changes <caps> on the way, which is
+	// undone by the restore-entries (NOPOS followed by slot and old value) on the stack.
+	size_t ncaps = _groups * 2;
+	std::vector<size_t> stack;
+	stack.push_back(pc);
+	while(!stack.empty()) {
+		size_t e = stack.back();
+		stack.pop_back();
+		if(e == NOPOS) {
+			size_t slot = stack.back();
+			stack.pop_back();
+			caps[slot] = stack.back();
+			stack.pop_back();
+			continue;
+		}
+
+		pc = e;
+		while(!list.contains(pc)) {
+			size_t *tcaps = list.add(pc);
+			const Inst &inst = _insts[pc];
+			if(inst.op == OP_JMP)
+				pc = inst.x;
+			else if(inst.op == OP_SPLIT) {
+				stack.push_back(inst.y);
+				pc = inst.x;
+			}
+			else if(inst.op == OP_SAVE) {
+				if(inst.x < ncaps) {
+					stack.push_back(caps[inst.x]);
+					stack.push_back(inst.x);
+					stack.push_back(NOPOS);
+					caps[inst.x] = pos;
+				}
+				pc++;
+			}
+			else if(inst.op == OP_EOL) {
+				if(pos != len)
+					break;
+				pc++;
+			}
+			else {
+				memcpy(tcaps,caps,ncaps * sizeof(size_t));
+				break;
+			}
+		}
+	}
+}
+
+bool Regex::Program::exec(const char *begin,const char *end,size_t *caps,uint flags) const {
+	const CharClass *classes = _classes[(flags & CASE_INSENSITIVE) ? 1 : 0].data();
+	bool anchored = _flags & REGEX_FLAG_BEGIN;
+	size_t ncaps = _groups * 2;
+	size_t len = end - begin;
+	ThreadList clist(_insts.size(),ncaps);
+	ThreadList nlist(_insts.size(),ncaps);
+	std::vector<size_t> tmp(ncaps);
+	bool matched = false;
+
+	for(size_t pos = 0; ; ++pos) {
+		// start a new thread with the lowest priority until we found the leftmost match
+		if(!matched && (pos == 0 || !anchored)) {
+			std::fill(tmp.begin(),tmp.end(),NOPOS);
+			addThread(clist,_start,tmp.data(),pos,len);
+		}
+		if(clist.count() == 0 && (matched || anchored))
+			break;
+
+		nlist.clear();
+		for(size_t i = 0; i < clist.count(); ++i) {
+			const Inst &inst = _insts[clist.pc(i)];
+			if(inst.op == OP_MATCH) {
+				// the remaining threads have a lower priority
+				memcpy(caps,clist.caps(i),ncaps * sizeof(size_t));
+				matched = true;
+				break;
+			}
+			if(pos < len && inst.op == OP_CHAR && classes[inst.x].contains(static_cast<uchar>(begin[pos])))
+				addThread(nlist,clist.pc(i) + 1,clist.caps(i),pos + 1,len);
+		}
+
+		if(pos == len)
+			break;
+		clist.swap(nlist);
+	}
+	return matched;
+}
+
+}
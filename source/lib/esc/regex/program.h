@@ -0,0 +1,212 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <esc/regex/regex.h>
+#include <esc/regex/elements.h>
+#include <sys/common.h>
+#include <unordered_map>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace esc {
+
+/**
+ * The compiled form of a pattern. The AST is translated into a Thompson-NFA, i.e., a small program
+ * of CHAR, SPLIT, JMP, SAVE, EOL and MATCH instructions, which is executed in two ways:
+ * - as a lazily built DFA to test whether there is a match. DFA states are sets of NFA states,
+ *   which are created on demand and cached, so that most bytes cost a single table lookup.
+ * - as a Pike-VM, which runs all NFA threads in lock step, to determine the groups.
+ * Both take linear time in the length of the input. Additionally, the longest literal that every
+ * match has to contain is searched with memchr and the two-way algorithm first, which allows us
+ * to skip the parts of the input that can't contain a match.
+ */
+class Regex::Program {
+	enum Op {
+		OP_CHAR,		// consume a byte of class x
+		OP_SPLIT,		// continue at x and y, preferring x
+		OP_JMP,			// continue at x
+		OP_SAVE,		// store the current position in slot x
+		OP_EOL,			// continue only at the end of the input
+		OP_MATCH,
+	};
+
+	struct Inst {
+		uint op;
+		uint x;
+		uint y;
+	};
+
+	struct CharClass {
+		bool contains(uchar c) const {
+			return bits[c / 32] & (1U << (c % 32));
+		}
+		bool operator==(const CharClass &c) const {
+			return memcmp(bits,c.bits,sizeof(bits)) == 0;
+		}
+
+		uint32_t bits[256 / 32];
+	};
+
+	struct DState {
+		explicit DState(const std::vector<uint> &_insts,size_t classes);
+		~DState() {
+			delete[] next;
+		}
+
+		std::vector<uint> insts;
+		bool match;
+		bool matchEol;
+		bool dead;
+		// the successor states, indexed by byte class; NULL if not computed yet
+		DState **next;
+	};
+
+	struct InstSetHash {
+		size_t operator()(const std::vector<uint> &set) const {
+			return std::detail::hash_bytes(set.data(),set.size() * sizeof(uint));
+		}
+	};
+
+	struct DFA {
+		explicit DFA(bool _ci,bool _anchored) : states(), start(), ci(_ci), anchored(_anchored) {
+		}
+		~DFA() {
+			clear();
+		}
+
+		void clear();
+
+		std::unordered_map<std::vector<uint>,DState*,InstSetHash> states;
+		DState *start;
+		bool ci;
+		bool anchored;
+	};
+
+	class ThreadList;
+
+public:
+	static const size_t MAX_INSTS			= 16384;
+	static const size_t MAX_DFA_STATES		= 1024;
+	static const size_t NOPOS				= (size_t)-1;
+
+	/**
+	 * Compiles the given AST into a program
+	 *
+	 * @param root the root element
+	 * @param flags the REGEX_FLAG_* flags
+	 * @param groups the number of groups
+	 * @throws runtime_error if the program gets too large
+	 */
+	explicit Program(const Element *root,int flags,size_t groups);
+	~Program();
+
+	Program(const Program&) = delete;
+	Program &operator=(const Program&) = delete;
+
+	/**
+	 * @return the number of groups, including the whole match
+	 */
+	size_t groups() const {
+		return _groups;
+	}
+
+	/**
+	 * @param begin the beginning of the input
+	 * @param end the end of the input
+	 * @param flags the Regex::Flags
+	 * @return true if the input contains a match
+	 */
+	bool contains(const char *begin,const char *end,uint flags) const;
+
+	/**
+	 * @param begin the beginning of the input
+	 * @param end the end of the input
+	 * @param flags the Regex::Flags
+	 * @return true if the whole input matches
+	 */
+	bool matches(const char *begin,const char *end,uint flags) const;
+
+	/**
+	 * Finds the first line in [<begin>, <end>) that contains a match.
+	 *
+	 * @param begin the beginning of the input
+	 * @param end the end of the input
+	 * @param flags the Regex::Flags
+	 * @return the beginning of the line or NULL
+	 */
+	const char *searchLine(const char *begin,const char *end,uint flags) const;
+
+	/**
+	 * Determines the leftmost match and stores the offsets of all groups into <caps>. Groups
+	 * that did not participate in the match are set to NOPOS.
+	 *
+	 * @param begin the beginning of the input
+	 * @param end the end of the input
+	 * @param caps the array of 2 * groups() offsets (begin and end of each group)
+	 * @param flags the Regex::Flags
+	 * @return true if there is a match
+	 */
+	bool exec(const char *begin,const char *end,size_t *caps,uint flags) const;
+
+private:
+	uint add(uint op,uint x = 0,uint y = 0);
+	uint addClass(const Element *e);
+	void emit(const Element *e);
+	void buildByteClasses();
+	static void extractLiteral(const Element *e,std::string &cur,std::string &best);
+	void prepareLiteral();
+	bool useLiteral(uint flags) const;
+	const char *findLiteral(const char *begin,const char *end) const;
+	bool scan(const char *begin,const char *end,uint flags) const;
+
+	DFA *dfa(uint flags,bool anchored) const;
+	void closure(uint pc) const;
+	DState *state(DFA *d,bool *flushed) const;
+	DState *startState(DFA *d) const;
+	DState *step(DFA *d,DState *s,uint cls) const;
+	void addThread(ThreadList &list,uint pc,size_t *caps,size_t pos,size_t len) const;
+
+	int _flags;
+	size_t _groups;
+	uint _start;
+	std::vector<Inst> _insts;
+	// the classes for case-sensitive and case-insensitive matching
+	std::vector<CharClass> _classes[2];
+	// bytes that are in the same classes behave equally, so that DFA states only need one
+	// transition per byte class
+	uchar _byteClasses[2][256];
+	uchar _classReps[2][256];
+	size_t _numByteClasses[2];
+	std::string _literal;
+	bool _literalFolds;
+	size_t _litRare;
+	size_t _litSuffix;
+	size_t _litPeriod;
+	bool _litPeriodic;
+	mutable DFA *_dfas[4];
+	mutable std::vector<uint> _set;
+	mutable std::vector<uint> _mark;
+	mutable std::vector<uint> _stack;
+	mutable uint _gen;
+};
+
+}
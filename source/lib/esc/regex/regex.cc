@@ -22,6 +22,7 @@
 #include <esc/stream/std.h>
 
 #include "pattern.h"
+#include "program.h"
 
 // TODO it would be nice to be reentrant
 static const char *regex_err = NULL;
@@ -37,6 +38,11 @@ extern "C" void yyerror(char const *s) {
 
 namespace esc {
 
+Regex::Pattern::~Pattern() {
+	delete _prog;
+	delete _root;
+}
+
 esc::OStream &operator<<(esc::OStream &os,const Regex::Pattern &p) {
 	p._root->print(os,0);
 	return os;
@@ -57,33 +63,43 @@ Regex::Pattern Regex::compile(const std::string &regex) {
 	}
 
 	Regex::Element *root = reinterpret_cast<Regex::Element*>(regex_result);
-	return Regex::Pattern(root,regex_flags);
+	Program *prog;
+	try {
+		prog = new Program(root,regex_flags,regex_groups);
+	}
+	catch(...) {
+		delete root;
+		throw;
+	}
+	return Regex::Pattern(root,prog,regex_flags);
 }
 
-Regex::Result Regex::test(const Pattern &p,const std::string &str,size_t pos,uint flags) {
-	Input in(str,pos,flags);
-	Regex::Result res(regex_groups);
-	if(p.root()->match(&res,in))
+Regex::Result Regex::search(const Pattern &p,const std::string &str,uint flags) {
+	const Program *prog = p.program();
+	const char *begin = str.c_str();
+	const char *end = begin + str.length();
+	// the DFA is much faster and most strings don't match, so check that first
+	if(!prog->contains(begin,end,flags))
+		return Regex::Result();
+
+	std::vector<size_t> caps(prog->groups() * 2);
+	Regex::Result res(prog->groups());
+	if(prog->exec(begin,end,caps.data(),flags)) {
+		for(size_t i = 0; i < prog->groups(); ++i) {
+			if(caps[i * 2] != Program::NOPOS && caps[i * 2 + 1] != Program::NOPOS)
+				res.set(i,str.substr(caps[i * 2],caps[i * 2 + 1] - caps[i * 2]));
+		}
 		res.setSuccess(true);
+	}
 	return res;
 }
 
-Regex::Result Regex::search(const Pattern &p,const std::string &str,uint flags) {
-	if(p.flags() & REGEX_FLAG_BEGIN)
-		return test(p,str,0,flags);
-	for(size_t i = 0; i < str.length(); ++i) {
-		Regex::Result res = test(p,str,i,flags);
-		if(res.matched()) {
-			if((~p.flags() & REGEX_FLAG_END) || (i + res.get(0).length() == str.length()))
-				return res;
-		}
-	}
-	return Regex::Result();
+const char *Regex::searchLine(const Pattern &p,const char *begin,const char *end,uint flags) {
+	return p.program()->searchLine(begin,end,flags);
 }
 
 bool Regex::matches(const Pattern &p,const std::string &str,uint flags) {
-	Input in(str,0,flags);
-	return p.root()->match(NULL,in) && in.peek() == '\0';
+	return p.program()->matches(str.c_str(),str.c_str() + str.length(),flags);
 }
 
 std::string Regex::replace(const Pattern &p,const std::string &str,const std::string &repl,uint flags) {
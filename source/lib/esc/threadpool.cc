@@ -0,0 +1,374 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/threadpool.h>
+#include <sys/atomic.h>
+#include <sys/common.h>
+#include <sys/conf.h>
+#include <sys/sync.h>
+#include <sys/thread.h>
+#include <sys/tls.h>
+#include <exception>
+#include <limits.h>
+
+namespace esc {
+
+/* all pools share one TLS slot that points to the Worker of the current thread, because there
+ * are only MAX_TLS_ENTRIES slots. 0 = not created, 1 = in creation, 2 = ready */
+static volatile long tlsState = 0;
+static size_t tlsIndex;
+
+static inline void barrier() {
+	__asm__ volatile ("" : : : "memory");
+}
+
+static inline void fence() {
+#if defined(__x86__)
+	__sync_synchronize();
+#else
+	/* eco32 and mmix have only one CPU */
+	barrier();
+#endif
+}
+
+static void initTLS() {
+	if(tlsState == 2)
+		return;
+	if(atomic_cmpnswap(&tlsState,0,1)) {
+		tlsIndex = tlsadd();
+		fence();
+		tlsState = 2;
+	}
+	else {
+		while(tlsState != 2)
+			yield();
+	}
+}
+
+/**
+ * The work-stealing deque by Chase and Lev. The owner pushes and pops at the bottom, while the
+ * thieves steal from the top. Only taking the last element and stealing require a CAS. The
+ * array grows on demand; old arrays are kept until the deque is destroyed, because thieves
+ * might still read from them.
+ */
+class ThreadPool::WorkDeque {
+	struct Array {
+		explicit Array(long sz,Array *prv) : size(sz), items(new Task*[sz]), prev(prv) {
+		}
+		~Array() {
+			delete[] items;
+		}
+
+		Task *get(long i) const {
+			return items[i & (size - 1)];
+		}
+		void put(long i,Task *task) {
+			items[i & (size - 1)] = task;
+		}
+
+		long size;
+		Task **items;
+		Array *prev;
+	};
+
+	static const long INITIAL_SIZE	= 64;
+
+public:
+	explicit WorkDeque() : _top(), _bottom(), _array(new Array(INITIAL_SIZE,NULL)) {
+	}
+	~WorkDeque() {
+		while(_array) {
+			Array *prev = _array->prev;
+			delete _array;
+			_array = prev;
+		}
+	}
+
+	bool empty() const {
+		return _bottom - _top <= 0;
+	}
+
+	void push(Task *task) {
+		long b = _bottom;
+		long t = _top;
+		Array *a = _array;
+		if(b - t >= a->size)
+			a = grow(a,t,b);
+		a->put(b,task);
+		/* the task has to be visible before the new bottom */
+		barrier();
+		_bottom = b + 1;
+	}
+
+	Task *pop() {
+		long b = _bottom - 1;
+		Array *a = _array;
+		_bottom = b;
+		/* the store to bottom has to be visible before we load top */
+		fence();
+		long t = _top;
+		if(t > b) {
+			_bottom = b + 1;
+			return NULL;
+		}
+
+		Task *task = a->get(b);
+		if(t == b) {
+			/* it's the last one, so that we compete with the thieves */
+			if(!atomic_cmpnswap(&_top,t,t + 1))
+				task = NULL;
+			_bottom = b + 1;
+		}
+		return task;
+	}
+
+	Task *steal() {
+		long t = _top;
+		barrier();
+		long b = _bottom;
+		if(t >= b)
+			return NULL;
+
+		Array *a = _array;
+		Task *task = a->get(t);
+		if(!atomic_cmpnswap(&_top,t,t + 1))
+			return NULL;
+		return task;
+	}
+
+private:
+	Array *grow(Array *a,long t,long b) {
+		Array *na = new Array(a->size * 2,a);
+		for(long i = t; i < b; ++i)
+			na->put(i,a->get(i));
+		barrier();
+		_array = na;
+		return na;
+	}
+
+	volatile long _top;
+	volatile long _bottom;
+	Array *volatile _array;
+};
+
+struct ThreadPool::Worker {
+	explicit Worker() : pool(), tid(-1), seed(), deque() {
+	}
+
+	ThreadPool *pool;
+	int tid;
+	uint seed;
+	WorkDeque deque;
+};
+
+ThreadPool::ThreadPool(size_t workers)
+		: _count(workers), _workers(), _lock(), _first(), _last(), _queued(), _sleepers(),
+		  _idle(), _stop() {
+	if(_count == 0) {
+		long cpus = sysconf(CONF_CPU_COUNT);
+		_count = cpus > 0 ? cpus : 1;
+	}
+	if(usemcrt(&_idle,0) < 0)
+		throw default_error("Unable to create semaphore");
+	initTLS();
+
+	_workers = new Worker[_count];
+	for(size_t i = 0; i < _count; ++i) {
+		_workers[i].pool = this;
+		_workers[i].seed = i + 1;
+	}
+	for(size_t i = 0; i < _count; ++i) {
+		int res = startthread(workerLoop,_workers + i);
+		if(res < 0) {
+			shutdown();
+			throw default_error("Unable to start worker thread",res);
+		}
+		_workers[i].tid = res;
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	shutdown();
+}
+
+void ThreadPool::shutdown() {
+	_stop = true;
+	fence();
+	for(size_t i = 0; i < _count; ++i)
+		usemup(&_idle);
+	for(size_t i = 0; i < _count; ++i) {
+		if(_workers[i].tid >= 0)
+			::join(_workers[i].tid);
+	}
+	delete[] _workers;
+	usemdestr(&_idle);
+}
+
+int ThreadPool::workerLoop(void *arg) {
+	Worker *self = static_cast<Worker*>(arg);
+	ThreadPool *pool = self->pool;
+	tlsset(tlsIndex,reinterpret_cast<ulong>(self));
+	while(true) {
+		Task *task = pool->take(self);
+		if(task)
+			pool->execute(task);
+		else if(pool->_stop)
+			break;
+		else
+			pool->idle();
+	}
+	return 0;
+}
+
+ThreadPool::Worker *ThreadPool::current() const {
+	Worker *w = reinterpret_cast<Worker*>(tlsget(tlsIndex));
+	return w && w->pool == this ? w : NULL;
+}
+
+void ThreadPool::submit(Task *task) {
+	Worker *self = current();
+	if(self)
+		self->deque.push(task);
+	else {
+		std::lock_guard<std::mutex> guard(_lock);
+		task->_next = NULL;
+		if(_last)
+			_last->_next = task;
+		else
+			_first = task;
+		_last = task;
+		_queued++;
+	}
+	notify();
+}
+
+void ThreadPool::wait(Task *task) {
+	Worker *self = current();
+	while(task->_state != Task::DONE) {
+		/* other threads don't help, because they would take the oldest tasks from the queue
+		 * and steal, which might nest arbitrarily deep on their stack */
+		Task *other = self ? take(self) : NULL;
+		if(other) {
+			execute(other);
+			continue;
+		}
+
+		/* there is nothing to help with, so that the task is being executed by somebody else */
+#if defined(__x86__)
+		__sync_bool_compare_and_swap(&task->_state,Task::RUNNING,Task::WAITING);
+		futexwait(&task->_state,Task::WAITING,0);
+#else
+		futexwait(&task->_state,Task::RUNNING,0);
+#endif
+	}
+}
+
+Task *ThreadPool::take(Worker *self) {
+	Task *task;
+	if(self && (task = self->deque.pop()))
+		return task;
+
+	if(_queued > 0) {
+		std::lock_guard<std::mutex> guard(_lock);
+		task = _first;
+		if(task) {
+			_first = task->_next;
+			if(!_first)
+				_last = NULL;
+			_queued--;
+			return task;
+		}
+	}
+
+	/* start at a random victim to distribute the thieves */
+	size_t start = 0;
+	if(self) {
+		self->seed = self->seed * 1103515245 + 12345;
+		start = (self->seed >> 16) % _count;
+	}
+	for(size_t i = 0; i < _count; ++i) {
+		Worker *victim = _workers + (start + i) % _count;
+		if(victim != self && (task = victim->deque.steal()))
+			return task;
+	}
+	return NULL;
+}
+
+bool ThreadPool::hasWork() const {
+	if(_queued > 0)
+		return true;
+	for(size_t i = 0; i < _count; ++i) {
+		if(!_workers[i].deque.empty())
+			return true;
+	}
+	return false;
+}
+
+void ThreadPool::execute(Task *task) {
+	try {
+		task->run();
+	}
+	catch(const std::exception &e) {
+		task->_error = new std::string(e.what());
+	}
+	catch(...) {
+		task->_error = new std::string("Unknown exception");
+	}
+
+	if(task->_autoDelete) {
+		delete task;
+		return;
+	}
+
+	/* the waiter might delete the task as soon as it sees DONE, so that we may not access it
+	 * afterwards (except for the futex address) */
+#if defined(__x86__)
+	if(__sync_lock_test_and_set(&task->_state,Task::DONE) == Task::WAITING)
+		futexwake(&task->_state,INT_MAX);
+#else
+	/* the other architectures have no atomic operations on ints. thus, we don't know whether
+	 * somebody waits and wake up potential waiters in every case */
+	volatile int *state = &task->_state;
+	*state = Task::DONE;
+	futexwake(state,INT_MAX);
+#endif
+}
+
+void ThreadPool::idle() {
+	for(int i = 0; i < IDLE_SPIN_COUNT; ++i) {
+		if(_stop || hasWork())
+			return;
+		yield();
+	}
+
+	/* announce that we're going to sleep before we check again. notify() does it the other way
+	 * around, so that either we see the new task or it sees us */
+	atomic_add(&_sleepers,1);
+	if(!_stop && !hasWork())
+		usemdown(&_idle);
+	atomic_add(&_sleepers,-1);
+}
+
+void ThreadPool::notify() {
+	fence();
+	if(_sleepers > 0)
+		usemup(&_idle);
+}
+
+}
@@ -35,9 +35,15 @@ void Image::paint(Graphics &g,const Pos &pos) {
 		return;
 	rpos -= Size(pos.x,pos.y);
 
-	_painter->reset(&g,pos);
-
-	_img->paint(rpos.x,rpos.y,rsize.width,rsize.height);
+	// convert the image once into the format of the screen; afterwards we just copy it
+	const esc::Screen::Mode *mode = Application::getInstance()->getScreenMode();
+	_img->prepare(img::PixelFormat(*mode));
+
+	size_t bpp = mode->bitsPerPixel / 8;
+	size_t pitch = g.getBuffer()->getSize().width * bpp;
+	uint8_t *dst = g.getBuffer()->getBuffer() +
+		(g._off.y + pos.y + rpos.y) * pitch + (g._off.x + pos.x + rpos.x) * bpp;
+	_img->paint(dst,pitch,rpos.x,rpos.y,rsize.width,rsize.height);
 
 	g.updateMinMax(Pos(pos.x + rpos.x,pos.y + rpos.y));
 	g.updateMinMax(Pos(pos.x + rpos.x + rsize.width - 1,pos.y + rpos.y + rsize.height - 1));
@@ -25,67 +25,39 @@ namespace img {
 const size_t BitmapImage::SIG_LEN = 2;
 const uint8_t BitmapImage::SIG[] = {'B','M'};
 
-void BitmapImage::paintRGB(gpos_t x,gpos_t y,gsize_t width,gsize_t height) {
+void BitmapImage::decodeRGB(const uint8_t *data,uint32_t *row) const {
 	size_t bitCount = _infoHeader->bitCount;
-	gpos_t w = _infoHeader->width, h = _infoHeader->height;
-	gsize_t colBytes = bitCount / 8;
-	gpos_t pad = (colBytes * w) % 4;
-	pad = pad ? 4 - pad : 0;
-
-	uint8_t *data = _data + (h - 1) * ((w * colBytes) + pad);
+	gsize_t w = _infoHeader->width;
 	if(bitCount == 8) {
-		for(gpos_t cy = y + height - 1; cy >= y; cy--) {
-			gpos_t xend = x + width;
-			for(gpos_t cx = x; cx < xend; cx++) {
-				uint32_t col = data[cx];
-				if(EXPECT_TRUE(col != TRANSPARENT))
-					_painter->paintPixel(cx,height - 1 - cy,_colorTable[col]);
-			}
-			data -= w + pad;
+		for(gsize_t x = 0; x < w; x++) {
+			uint32_t col = _colorTable[data[x]];
+			row[x] = EXPECT_TRUE(col != TRANSPARENT) ? col : Image::TRANSPARENT;
 		}
 	}
 	else if(bitCount == 16) {
-		for(gpos_t cy = y + height - 1; cy >= y; cy--) {
-			gpos_t xend = x + width;
-			for(gpos_t cx = x; cx < xend; cx++) {
-				uint32_t col = *(uint16_t*)(data + (cx << 1));
-				if(EXPECT_TRUE(col != TRANSPARENT))
-					_painter->paintPixel(cx,height - 1 - cy,col);
-			}
-			data -= (w << 1) + pad;
+		const uint16_t *src = reinterpret_cast<const uint16_t*>(data);
+		for(gsize_t x = 0; x < w; x++) {
+			uint32_t col = src[x];
+			row[x] = EXPECT_TRUE(col != TRANSPARENT) ? col : Image::TRANSPARENT;
 		}
 	}
 	else if(bitCount == 24) {
-		for(gpos_t cy = y + height - 1; cy >= y; cy--) {
-			gpos_t xend = x + width;
-			for(gpos_t cx = x; cx < xend; cx++) {
-				/* cx * 3 = cx << 1 + cx */
-				uint8_t *cdata = data + (cx << 1) + cx;
-				uint32_t col = (cdata[0] | (cdata[1] << 8) | (cdata[2] << 16));
-				if(EXPECT_TRUE(col != TRANSPARENT))
-					_painter->paintPixel(cx,height - 1 - cy,col);
-			}
-			data -= (w << 1) + w + pad;
+		for(gsize_t x = 0; x < w; x++, data += 3) {
+			uint32_t col = (data[0] | (data[1] << 8) | (data[2] << 16));
+			row[x] = EXPECT_TRUE(col != TRANSPARENT) ? col : Image::TRANSPARENT;
 		}
 	}
 	else {
-		for(gpos_t cy = y + height - 1; cy >= y; cy--) {
-			gpos_t xend = x + width;
-			for(gpos_t cx = x; cx < xend; cx++) {
-				uint32_t col = *(uint32_t*)(data + (cx << 2));
-				if(EXPECT_TRUE(col != TRANSPARENT))
-					_painter->paintPixel(cx,height - 1 - cy,col);
-			}
-			data -= (w << 2) + pad;
+		const uint32_t *src = reinterpret_cast<const uint32_t*>(data);
+		for(gsize_t x = 0; x < w; x++) {
+			uint32_t col = src[x];
+			row[x] = EXPECT_TRUE(col != TRANSPARENT) ? col : Image::TRANSPARENT;
 		}
 	}
 }
 
-void BitmapImage::paintBitfields(gpos_t x,gpos_t y,gsize_t width,gsize_t height) {
-	gpos_t w = _infoHeader->width, h = _infoHeader->height;
-	gpos_t pad = w % 4;
-	pad = pad ? 4 - pad : 0;
-
+void BitmapImage::decodeBitfields(const uint8_t *data,uint32_t *row) const {
+	gsize_t w = _infoHeader->width;
 	uint32_t redmask = _infoHeader->redmask;
 	uint32_t greenmask = _infoHeader->greenmask;
 	uint32_t bluemask = _infoHeader->bluemask;
@@ -97,47 +69,45 @@ void BitmapImage::paintBitfields(gpos_t x,gpos_t y,gsize_t width,gsize_t height)
 
 	// we know that bitdepth is 32
 	assert(_infoHeader->bitCount == 32);
-	uint8_t *data = _data + (h - 1) * ((w << 2) + pad);
-	for(gpos_t cy = y + height - 1; cy >= y; cy--) {
-		gpos_t xend = x + width;
-		for(gpos_t cx = x; cx < xend; cx++) {
-			uint32_t col = *(uint32_t*)(data + (cx << 2));
-			uint32_t red = (col & redmask) >> redshift;
-			uint32_t green = (col & greenmask) >> greenshift;
-			uint32_t blue = (col & bluemask) >> blueshift;
-			uint32_t alpha = (col & alphamask) >> alphashift;
-			col = ((256 - alpha) << 24) | (red << 16) | (green << 8) | blue;
-			if(EXPECT_TRUE(col != TRANSPARENT))
-				_painter->paintPixel(cx,height - 1 - cy,col);
-		}
-		data -= (w << 2) + pad;
+	const uint32_t *src = reinterpret_cast<const uint32_t*>(data);
+	for(gsize_t x = 0; x < w; x++) {
+		uint32_t col = src[x];
+		uint32_t red = (col & redmask) >> redshift;
+		uint32_t green = (col & greenmask) >> greenshift;
+		uint32_t blue = (col & bluemask) >> blueshift;
+		uint32_t alpha = (col & alphamask) >> alphashift;
+		col = ((256 - alpha) << 24) | (red << 16) | (green << 8) | blue;
+		row[x] = EXPECT_TRUE(col != TRANSPARENT) ? col : Image::TRANSPARENT;
 	}
 }
 
 uint BitmapImage::getShift(uint32_t val) {
 	uint c = 0;
+	if(val == 0)
+		return c;
 	for(; (val & 0x1) == 0; val >>= 1, ++c)
 		;
 	return c;
 }
 
-void BitmapImage::paint(gpos_t x,gpos_t y,gsize_t width,gsize_t height) {
-	if(_data == nullptr)
+void BitmapImage::decodeRow(gpos_t y,uint32_t *row) const {
+	gsize_t w = _infoHeader->width, h = _infoHeader->height;
+	if(_data == nullptr) {
+		for(gsize_t x = 0; x < w; ++x)
+			row[x] = Image::TRANSPARENT;
 		return;
+	}
+
+	// the rows are stored bottom-up and padded to 4 bytes
+	size_t bytesPerLine = ROUND_UP(w * (_infoHeader->bitCount / 8),sizeof(uint32_t));
+	const uint8_t *data = _data + (h - 1 - y) * bytesPerLine;
 	switch(_infoHeader->compression) {
 		case BI_RGB:
-			paintRGB(x,y,width,height);
+			decodeRGB(data,row);
 			break;
 
 		case BI_BITFIELDS:
-			paintBitfields(x,y,width,height);
-			break;
-
-		case BI_RLE4:
-			// TODO
-			break;
-		case BI_RLE8:
-			// TODO
+			decodeBitfields(data,row);
 			break;
 	}
 }
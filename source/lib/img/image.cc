@@ -21,11 +21,13 @@
 #include <img/image.h>
 #include <img/pngimage.h>
 #include <sys/common.h>
+#include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 namespace img {
 
-Image *Image::loadImage(const std::shared_ptr<Painter> &painter,const std::string& path) {
+Image *Image::loadImage(const std::string& path) {
 	char header[MAX(PNGImage::SIG_LEN,BitmapImage::SIG_LEN)];
 	FILE *f = fopen(path.c_str(),"r");
 	if(!f)
@@ -34,11 +36,110 @@ Image *Image::loadImage(const std::shared_ptr<Painter> &painter,const std::strin
 	fclose(f);
 	// check header-type
 	if(memcmp(header,BitmapImage::SIG,BitmapImage::SIG_LEN) == 0)
-		return new BitmapImage(painter,path);
+		return new BitmapImage(path);
 	if(memcmp(header,PNGImage::SIG,PNGImage::SIG_LEN) == 0)
-		return new PNGImage(painter,path);
+		return new PNGImage(path);
 	// unknown image-type
 	throw img_load_error(path + ": Unknown image-type (header " + header + ")");
 }
 
+void Image::prepare(const PixelFormat &format,bool premultiply) {
+	if(_cache && _format == format && _premultiply == premultiply)
+		return;
+
+	gsize_t width,height;
+	getSize(&width,&height);
+
+	_format = format;
+	_premultiply = premultiply;
+	delete[] _cache;
+	_cache = new uint8_t[width * height * _format.bytesPerPixel];
+	_spans.clear();
+	_rows.clear();
+	_rows.reserve(height + 1);
+
+	// decode and convert row by row; the ARGB row is only needed temporarily
+	std::unique_ptr<uint32_t[]> row(new uint32_t[width]);
+	size_t pitch = width * _format.bytesPerPixel;
+	for(gsize_t y = 0; y < height; ++y) {
+		decodeRow(y,row.get());
+		_rows.push_back(_spans.size());
+		addSpans(row.get(),width);
+		convertRow(row.get(),_cache + y * pitch,width);
+	}
+	_rows.push_back(_spans.size());
+}
+
+void Image::addSpans(const uint32_t *src,gsize_t width) {
+	for(gsize_t x = 0; x < width; ) {
+		while(x < width && (src[x] >> 24) == 0xFF)
+			x++;
+		gpos_t begin = x;
+		while(x < width && (src[x] >> 24) != 0xFF)
+			x++;
+		if((gpos_t)x > begin)
+			_spans.push_back(Span(begin,x - begin));
+	}
+}
+
+void Image::convertRow(const uint32_t *src,uint8_t *dst,gsize_t width) const {
+	uint rshift = 8 - _format.redMaskSize, rpos = _format.redFieldPosition;
+	uint gshift = 8 - _format.greenMaskSize, gpos = _format.greenFieldPosition;
+	uint bshift = 8 - _format.blueMaskSize, bpos = _format.blueFieldPosition;
+	for(gsize_t x = 0; x < width; ++x) {
+		uint32_t col = src[x];
+		uint32_t alpha = col >> 24;
+		uint32_t red = (col >> 16) & 0xFF;
+		uint32_t green = (col >> 8) & 0xFF;
+		uint32_t blue = col & 0xFF;
+		if(_premultiply && alpha) {
+			// alpha is the transparency, i.e. 0 means opaque
+			uint32_t opacity = 0xFF - alpha;
+			red = (red * opacity + 0x80) / 0xFF;
+			green = (green * opacity + 0x80) / 0xFF;
+			blue = (blue * opacity + 0x80) / 0xFF;
+		}
+		uint32_t val = ((red >> rshift) << rpos) | ((green >> gshift) << gpos) |
+			((blue >> bshift) << bpos);
+
+		switch(_format.bytesPerPixel) {
+			case 2:
+				*(uint16_t*)dst = val;
+				dst += 2;
+				break;
+			case 3:
+				*dst++ = val & 0xFF;
+				*dst++ = val >> 8;
+				*dst++ = val >> 16;
+				break;
+			case 4:
+				*(uint32_t*)dst = val | (alpha << 24);
+				dst += 4;
+				break;
+		}
+	}
+}
+
+void Image::paint(uint8_t *dst,size_t pitch,gpos_t x,gpos_t y,gsize_t width,gsize_t height) const {
+	assert(_cache != nullptr);
+	gsize_t imgw,imgh;
+	getSize(&imgw,&imgh);
+
+	size_t bpp = _format.bytesPerPixel;
+	gpos_t xend = x + width;
+	gpos_t yend = y + height;
+	for(gpos_t cy = y; cy < yend; ++cy) {
+		const uint8_t *src = _cache + (cy * imgw) * bpp;
+		// copy the visible part of each run of non-transparent pixels
+		for(size_t i = _rows[cy]; i < _rows[cy + 1]; ++i) {
+			const Span &s = _spans[i];
+			gpos_t begin = MAX(s.begin,x);
+			gpos_t end = MIN(s.begin + (gpos_t)s.len,xend);
+			if(begin < end)
+				memcpy(dst + (begin - x) * bpp,src + begin * bpp,(end - begin) * bpp);
+		}
+		dst += pitch;
+	}
+}
+
 }
@@ -29,56 +29,44 @@ const uint8_t PNGImage::SIG[] = {
 	137,80,78,71,13,10,26,10
 };
 
-void PNGImage::paint(gpos_t x,gpos_t y,gsize_t width,gsize_t height) {
-	size_t p = y * ((_header.width * _bpp) + 1);
-	gpos_t yend = y + height;
-	for(gpos_t cy = y; cy < yend; cy++) {
-		// skip over filter type byte
-		p++;
-		// skip over line-start
-		p += x * _bpp;
-
-		gpos_t xend = x + width;
-		for(gpos_t cx = x; cx < xend; cx++) {
-			uint32_t col = 0;
-			switch(_bpp) {
-				// RGBA
-				case 4:
-					col = _pixels[p++] << 16;
-					col |= _pixels[p++] << 8;
-					col |= _pixels[p++] << 0;
-					col |= (0xFF - _pixels[p++]) << 24;
-					break;
-
-				// RGB
-				case 3:
-					col = _pixels[p++] << 16;
-					col |= _pixels[p++] << 8;
-					col |= _pixels[p++] << 0;
-					break;
-
-				// grayscale or palette
-				case 1:
-					if(_header.colorType == CT_PALETTE) {
-						size_t idx = _pixels[p++];
-						col = 0;
-						if(idx * 3 + 2 < _paletteSize) {
-							col = _palette[idx * 3] << 16;
-							col |= _palette[idx * 3 + 1] << 8;
-							col |= _palette[idx * 3 + 2] << 0;
-						}
-					}
-					else {
-						col = _pixels[p++];
-						col |= (col << 8) | (col << 16);
+void PNGImage::decodeRow(gpos_t y,uint32_t *row) const {
+	gsize_t w = _header.width;
+	// skip over the previous rows and the filter type byte
+	const uint8_t *p = _pixels + y * ((w * _bpp) + 1) + 1;
+	switch(_bpp) {
+		// RGBA
+		case 4:
+			for(gsize_t x = 0; x < w; ++x, p += 4)
+				row[x] = (p[0] << 16) | (p[1] << 8) | p[2] | ((0xFF - p[3]) << 24);
+			break;
+
+		// RGB
+		case 3:
+			for(gsize_t x = 0; x < w; ++x, p += 3)
+				row[x] = (p[0] << 16) | (p[1] << 8) | p[2];
+			break;
+
+		// grayscale or palette
+		case 1:
+			if(_header.colorType == CT_PALETTE) {
+				for(gsize_t x = 0; x < w; ++x) {
+					size_t idx = *p++;
+					uint32_t col = 0;
+					if(idx * 3 + 2 < _paletteSize) {
+						col = _palette[idx * 3] << 16;
+						col |= _palette[idx * 3 + 1] << 8;
+						col |= _palette[idx * 3 + 2] << 0;
 					}
-					break;
+					row[x] = col;
+				}
 			}
-			_painter->paintPixel(cx,cy,col);
-		}
-
-		// skip over end of line
-		p += (_header.width - width) * _bpp;
+			else {
+				for(gsize_t x = 0; x < w; ++x) {
+					uint32_t col = *p++;
+					row[x] = col | (col << 8) | (col << 16);
+				}
+			}
+			break;
 	}
 }
 
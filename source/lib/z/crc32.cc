@@ -17,33 +17,208 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <sys/endian.h>
 #include <z/crc32.h>
+#include <string.h>
 
 namespace z {
 
 /* source: http://tools.ietf.org/html/rfc1952 */
 
-CRC32::CRC32() {
+static const CRC32::type POLY = 0xedb88320;
+
+bool CRC32::_clmul = false;
+CRC32::type CRC32::_tables[8][256];
+CRC32::type CRC32::_x2n[32];
+CRC32::Initializer CRC32::_initializer;
+
+void CRC32::init() {
 	/* Make the table for a fast CRC. */
 	for(size_t n = 0; n < 256; n++) {
-		ulong c = n;
+		type c = n;
 		for(int k = 0; k < 8; k++) {
 			if(c & 1)
-				c = 0xedb88320L ^ (c >> 1);
+				c = POLY ^ (c >> 1);
 			else
 				c = c >> 1;
 		}
-		_table[n] = c;
+		_tables[0][n] = c;
+	}
+	/* slicing-by-8: _tables[k][n] is the CRC of byte n followed by k zero bytes */
+	for(size_t n = 0; n < 256; n++) {
+		type c = _tables[0][n];
+		for(size_t k = 1; k < 8; k++) {
+			c = _tables[0][c & 0xff] ^ (c >> 8);
+			_tables[k][n] = c;
+		}
 	}
+
+	/* x^1, x^2, x^4, ... modulo the polynomial (bit 31 is x^0) */
+	type p = 1U << 30;
+	_x2n[0] = p;
+	for(size_t n = 1; n < ARRAY_SIZE(_x2n); n++)
+		_x2n[n] = p = multModP(p,p);
+
+#if defined(__x86_64__)
+	uint32_t eax,ebx,ecx,edx;
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+	/* CPUID.01H:ECX.PCLMULQDQ[bit 1] */
+	_clmul = (ecx & (1 << 1)) != 0;
+#endif
 }
 
 CRC32::type CRC32::update(type crc,const void *buf,size_t len) {
 	type c = crc ^ 0xffffffffL;
-	const char *b = reinterpret_cast<const char*>(buf);
+	const uint8_t *b = reinterpret_cast<const uint8_t*>(buf);
 
-	for(size_t n = 0; n < len; n++)
-		c = _table[(c ^ b[n]) & 0xff] ^ (c >> 8);
+#if defined(__x86_64__)
+	if(_clmul && len >= 64) {
+		/* the folding works on 16 byte blocks; the rest is done below */
+		size_t n = len & ~(size_t)15;
+		c = updateCLMul(c,b,n);
+		b += n;
+		len -= n;
+	}
+#endif
+	c = updateSlice8(c,b,len);
 	return c ^ 0xffffffffL;
 }
 
+CRC32::type CRC32::updateBytes(type c,const uint8_t *b,size_t len) {
+	for(size_t n = 0; n < len; n++)
+		c = _tables[0][(c ^ b[n]) & 0xff] ^ (c >> 8);
+	return c;
+}
+
+CRC32::type CRC32::updateSlice8(type c,const uint8_t *b,size_t len) {
+	/* align the buffer, so that we can read it word by word */
+	size_t pre = MIN(len,(sizeof(uint32_t) - ((uintptr_t)b & (sizeof(uint32_t) - 1))) & 3);
+	c = updateBytes(c,b,pre);
+	b += pre;
+	len -= pre;
+
+	while(len >= 8) {
+		uint32_t one,two;
+		memcpy(&one,b,4);
+		memcpy(&two,b + 4,4);
+		one = le32tocpu(one) ^ c;
+		two = le32tocpu(two);
+		c = _tables[7][one & 0xff] ^
+			_tables[6][(one >> 8) & 0xff] ^
+			_tables[5][(one >> 16) & 0xff] ^
+			_tables[4][one >> 24] ^
+			_tables[3][two & 0xff] ^
+			_tables[2][(two >> 8) & 0xff] ^
+			_tables[1][(two >> 16) & 0xff] ^
+			_tables[0][two >> 24];
+		b += 8;
+		len -= 8;
+	}
+	return updateBytes(c,b,len);
+}
+
+#if defined(__x86_64__)
+
+/* see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", Intel, 2009.
+ * We fold 64 bytes per iteration with four independent accumulators, reduce them to 128 bits
+ * and let the table-driven code compute the CRC of the remaining 16 bytes. The constants are
+ * x^(k) mod P for the bit-reflected polynomial, shifted by one. */
+
+typedef long long v2di __attribute__((vector_size(16)));
+
+static inline v2di clmul_lo(v2di a,v2di b) {
+	asm ("pclmulqdq $0x00, %1, %0" : "+x"(a) : "x"(b));
+	return a;
+}
+
+static inline v2di clmul_hi(v2di a,v2di b) {
+	asm ("pclmulqdq $0x11, %1, %0" : "+x"(a) : "x"(b));
+	return a;
+}
+
+static inline v2di load128(const uint8_t *b) {
+	v2di v;
+	memcpy(&v,b,sizeof(v));
+	return v;
+}
+
+static inline v2di fold128(v2di x,v2di k,v2di data) {
+	return clmul_lo(x,k) ^ clmul_hi(x,k) ^ data;
+}
+
+CRC32::type CRC32::updateCLMul(type c,const uint8_t *b,size_t len) {
+	/* x^(4*128+64), x^(4*128) */
+	const v2di k1k2 = {0x0154442bd4LL,0x01c6e41596LL};
+	/* x^(128+64), x^(128) */
+	const v2di k3k4 = {0x01751997d0LL,0x00ccaa009eLL};
+
+	v2di crc = {c,0};
+	v2di x1 = load128(b + 0x00) ^ crc;
+	v2di x2 = load128(b + 0x10);
+	v2di x3 = load128(b + 0x20);
+	v2di x4 = load128(b + 0x30);
+	b += 64;
+	len -= 64;
+
+	while(len >= 64) {
+		x1 = fold128(x1,k1k2,load128(b + 0x00));
+		x2 = fold128(x2,k1k2,load128(b + 0x10));
+		x3 = fold128(x3,k1k2,load128(b + 0x20));
+		x4 = fold128(x4,k1k2,load128(b + 0x30));
+		b += 64;
+		len -= 64;
+	}
+
+	/* fold the four accumulators into one */
+	x1 = fold128(x1,k3k4,x2);
+	x1 = fold128(x1,k3k4,x3);
+	x1 = fold128(x1,k3k4,x4);
+
+	while(len >= 16) {
+		x1 = fold128(x1,k3k4,load128(b));
+		b += 16;
+		len -= 16;
+	}
+
+	/* x1 is congruent to the whole message; the CRC of it, starting with 0, is the result */
+	uint8_t rem[16];
+	memcpy(rem,&x1,sizeof(rem));
+	return updateSlice8(0,rem,sizeof(rem));
+}
+
+#endif
+
+CRC32::type CRC32::multModP(type a,type b) {
+	/* multiply a and b modulo the polynomial; bit 31 is x^0 */
+	type m = 1U << 31;
+	type p = 0;
+	for(;;) {
+		if(a & m) {
+			p ^= b;
+			if((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+	}
+	return p;
+}
+
+CRC32::type CRC32::x2nModP(size_t n,uint k) {
+	/* x^(n * 2^k) modulo the polynomial */
+	type p = 1U << 31;
+	while(n) {
+		if(n & 1)
+			p = multModP(_x2n[k & 31],p);
+		n >>= 1;
+		k++;
+	}
+	return p;
+}
+
+CRC32::type CRC32::combine(type crc1,type crc2,size_t len2) {
+	/* shift crc1 by len2 bytes (8*len2 bits = len2 * 2^3) and add crc2 */
+	return multModP(x2nModP(len2,3),crc1) ^ crc2;
+}
+
 }
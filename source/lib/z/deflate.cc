@@ -19,231 +19,632 @@
 
 #include <sys/endian.h>
 #include <z/deflate.h>
+#include <algorithm>
 
 namespace z {
 
-/* based on http://tools.ietf.org/html/rfc1951 */
+/* based on http://tools.ietf.org/html/rfc1951. the match finder and the level configuration
+ * follow the approach described in the "algorithm.txt" of zlib */
+
+const Deflate::Config Deflate::configs[] = {
+	/* good lazy nice chain */
+	/* 0 */ {0,    0,   0,    0, false},	/* store only */
+	/* 1 */ {4,    4,   8,    4, false},	/* max speed, no lazy matches */
+	/* 2 */ {4,    5,  16,    8, false},
+	/* 3 */ {4,    6,  32,   32, false},
+	/* 4 */ {4,    4,  16,   16, true},	/* lazy matches */
+	/* 5 */ {8,   16,  32,   32, true},
+	/* 6 */ {8,   16, 128,  128, true},
+	/* 7 */ {8,   32, 128,  256, true},
+	/* 8 */ {32, 128, 258, 1024, true},
+	/* 9 */ {32, 258, 258, 4096, true},	/* max compression */
+};
+
+/* ----------------------- *
+ * -- input and matching -- *
+ * ----------------------- */
+
+void Deflate::slide_window() {
+	/* the data of the current block has to stay available for uncompressed blocks */
+	if(_block_start < WSIZE)
+		flush_block(false);
+
+	memcpy(_window,_window + WSIZE,WSIZE);
+	_match_start -= WSIZE;
+	_strstart -= WSIZE;
+	_block_start -= WSIZE;
+
+	for(size_t i = 0; i < HASH_SIZE; ++i)
+		_head[i] = _head[i] >= WSIZE ? _head[i] - WSIZE : NIL;
+	for(size_t i = 0; i < WSIZE; ++i)
+		_prev[i] = _prev[i] >= WSIZE ? _prev[i] - WSIZE : NIL;
+}
 
-/* ---------------------- *
- * -- encode functions -- *
- * ---------------------- */
+void Deflate::fill_window() {
+	do {
+		if(_strstart >= WSIZE + MAX_DIST)
+			slide_window();
+		if(_eof)
+			break;
 
-void Deflate::flush(Data *d) {
-	if(d->bitcount > 0) {
-		d->drain->put(d->tag);
-		d->tag = 0;
-		d->bitcount = 0;
+		size_t more = 2 * WSIZE - _lookahead - _strstart;
+		size_t res = _source->read(_window + _strstart + _lookahead,more);
+		if(res == 0)
+			_eof = true;
+		_lookahead += res;
 	}
+	while(_lookahead < MIN_LOOKAHEAD);
 }
 
-void Deflate::writebit(Data *d,int bit) {
-	assert((bit & ~0x1) == 0);
-	d->tag |= bit << d->bitcount;
-
-	if(++d->bitcount == 8)
-		flush(d);
+uint16_t Deflate::insert_string(size_t pos) {
+	const uint8_t *p = _window + pos;
+	uint32_t val = p[0] | (p[1] << 8) | (p[2] << 16);
+	uint32_t h = (val * 2654435761U) >> (32 - HASH_BITS);
+	uint16_t head = _head[h];
+	_prev[pos & WMASK] = head;
+	_head[h] = pos;
+	return head;
 }
 
-void Deflate::write_bits(Data *d,unsigned int bits,int num) {
-	while(num-- > 0) {
-		writebit(d,bits & 0x1);
-		bits >>= 1;
+size_t Deflate::longest_match(uint16_t cur_match,size_t prev_length) {
+	size_t chain = _config->max_chain;
+	size_t best_len = prev_length;
+	size_t nice = std::min<size_t>(_config->nice_length,_lookahead);
+	size_t maxlen = std::min(MAX_MATCH,_lookahead);
+	size_t limit = _strstart > MAX_DIST ? _strstart - MAX_DIST : NIL;
+	const uint8_t *scan = _window + _strstart;
+
+	/* do not waste too much time if we already have a good match */
+	if(prev_length >= _config->good_length)
+		chain >>= 2;
+
+	do {
+		const uint8_t *match = _window + cur_match;
+
+		/* quickly skip candidates that can't be better than the best one so far. the window
+		 * is padded, so that reading at best_len is always possible */
+		if(match[best_len] != scan[best_len] || match[best_len - 1] != scan[best_len - 1] ||
+				match[0] != scan[0] || match[1] != scan[1])
+			continue;
+
+		size_t len = 2;
+		while(len < maxlen && match[len] == scan[len])
+			len++;
+
+		if(len > best_len) {
+			_match_start = cur_match;
+			best_len = len;
+			if(len >= nice)
+				break;
+		}
 	}
+	while((cur_match = _prev[cur_match & WMASK]) > limit && --chain != 0);
+
+	return std::min(best_len,_lookahead);
 }
 
-void Deflate::write_bits_reverse(Data *d,unsigned int bits,unsigned int num) {
-	while(num-- > 0)
-		writebit(d,(bits >> num) & 0x1);
+void Deflate::deflate_greedy() {
+	while(1) {
+		if(_lookahead < MIN_LOOKAHEAD) {
+			fill_window();
+			if(_lookahead == 0)
+				break;
+		}
+
+		size_t match_length = 0;
+		if(_lookahead >= MIN_MATCH && _config->max_chain > 0) {
+			uint16_t hash_head = insert_string(_strstart);
+			if(hash_head != NIL && _strstart - hash_head <= MAX_DIST)
+				match_length = longest_match(hash_head,MIN_MATCH - 1);
+		}
+
+		bool full;
+		if(match_length >= MIN_MATCH) {
+			full = tally_match(_strstart - _match_start,match_length);
+			_lookahead -= match_length;
+
+			/* insert the strings of short matches; skip them for long ones */
+			if(match_length <= _config->max_lazy && _lookahead >= MIN_MATCH) {
+				while(--match_length > 0)
+					insert_string(++_strstart);
+				_strstart++;
+			}
+			else
+				_strstart += match_length;
+		}
+		else {
+			full = tally_lit(_window[_strstart]);
+			_lookahead--;
+			_strstart++;
+		}
+
+		if(full)
+			flush_block(false);
+	}
 }
 
-void Deflate::write_symbol(Data *d,Tree *t,unsigned int sym) {
-	size_t i;
-	for(i = 0; i < 4; ++i) {
-		if(t->litbase[i] > sym)
-			break;
+void Deflate::deflate_lazy() {
+	size_t match_length = MIN_MATCH - 1;
+	bool match_available = false;
+	while(1) {
+		if(_lookahead < MIN_LOOKAHEAD) {
+			fill_window();
+			if(_lookahead == 0)
+				break;
+		}
+
+		uint16_t hash_head = NIL;
+		if(_lookahead >= MIN_MATCH)
+			hash_head = insert_string(_strstart);
+
+		/* find the longest match, but keep the previous one for the lazy evaluation */
+		size_t prev_length = match_length;
+		size_t prev_match = _match_start;
+		match_length = MIN_MATCH - 1;
+
+		if(hash_head != NIL && prev_length < _config->max_lazy &&
+				_strstart - hash_head <= MAX_DIST) {
+			match_length = longest_match(hash_head,prev_length);
+			/* a match of length 3 that is that far away costs more than 3 literals */
+			if(match_length == MIN_MATCH && _strstart - _match_start > TOO_FAR)
+				match_length = MIN_MATCH - 1;
+		}
+
+		/* if there was a match at the previous position and the current one is not better,
+		 * output the previous match */
+		if(prev_length >= MIN_MATCH && match_length <= prev_length) {
+			size_t max_insert = _strstart + _lookahead - MIN_MATCH;
+			bool full = tally_match(_strstart - 1 - prev_match,prev_length);
+
+			/* insert all strings of the match. strstart - 1 and strstart are already inserted */
+			_lookahead -= prev_length - 1;
+			prev_length -= 2;
+			do {
+				if(++_strstart <= max_insert)
+					insert_string(_strstart);
+			}
+			while(--prev_length != 0);
+			match_available = false;
+			match_length = MIN_MATCH - 1;
+			_strstart++;
+
+			if(full)
+				flush_block(false);
+		}
+		/* there was no match at the previous position; output a single literal */
+		else if(match_available) {
+			if(tally_lit(_window[_strstart - 1]))
+				flush_block(false);
+			_strstart++;
+			_lookahead--;
+		}
+		/* there is no previous match to compare with; wait for the next step */
+		else {
+			match_available = true;
+			_strstart++;
+			_lookahead--;
+		}
 	}
-	assert(i > 0);
-	i--;
 
-	unsigned int num = t->length[i];
-	unsigned int bits = t->codebase[i] + (sym - t->litbase[i]);
-	write_bits_reverse(d,bits,num);
+	if(match_available)
+		tally_lit(_window[_strstart - 1]);
 }
 
-void Deflate::write_int(Data *d,Tree *t,unsigned short *base,unsigned char *bits,unsigned int value,int add) {
-	/* determine code */
-	size_t i;
-	for(i = 0; i < 30; ++i) {
-		if(base[i] > value)
-			break;
+/* ------------------- *
+ * -- symbol buffer -- *
+ * ------------------- */
+
+bool Deflate::tally_lit(uint8_t c) {
+	_lits[_symcount] = c;
+	_dists[_symcount++] = 0;
+	_ltree.freq[c]++;
+	_block_len++;
+	return _symcount == SYM_BUFSIZE;
+}
+
+bool Deflate::tally_match(size_t dist,size_t len) {
+	_lits[_symcount] = len - MIN_MATCH;
+	_dists[_symcount++] = dist;
+	_ltree.freq[257 + _lengthCode[len]]++;
+	_dtree.freq[dist_code(dist - 1)]++;
+	_block_len += len;
+	return _symcount == SYM_BUFSIZE;
+}
+
+/* ------------------- *
+ * -- huffman codes -- *
+ * ------------------- */
+
+void Deflate::build_lengths(const uint32_t *freq,uint8_t *lens,size_t num,size_t maxbits) {
+	uint16_t leaves[L_CODES + 2];
+	uint32_t weight[2 * (L_CODES + 2)];
+	uint16_t parent[2 * (L_CODES + 2)];
+	uint8_t depth[2 * (L_CODES + 2)];
+	uint32_t f[L_CODES + 2];
+
+	size_t n = 0;
+	for(size_t i = 0; i < num; ++i) {
+		lens[i] = 0;
+		f[i] = freq[i];
+		if(f[i])
+			leaves[n++] = i;
 	}
-	assert(i > 0);
-	i--;
-
-	/* write code */
-	write_symbol(d,t,add + i);
-	write_bits(d,value - base[i],bits[i]);
-}
-
-void Deflate::write_symbol_chain(Data *d,Tree *lt,Tree *dt,unsigned int len,unsigned int dist) {
-	write_int(d,lt,length_base,length_bits,len,257);
-	write_int(d,dt,dist_base,dist_bits,dist,0);
-}
-
-/* ----------------------------- *
- * -- block deflate functions -- *
- * ----------------------------- */
-
-void Deflate::deflate_fixed_block(Data *d) {
-	size_t len = d->source->cached();
-	size_t orglen = len;
-	while(len > 0) {
-		unsigned char sym = d->source->peek(0);
-
-		// first, check if we already had the now following byte-sequence
-		int x,maxlen = 0,max = 0;
-		// ensure that we don't look more than 29 bytes back and not past the block-start and our
-		// current position
-		int end = MIN(29,len);
-		int begin = -MIN(29,orglen - len);
-		for(x = begin; x < 0; ++x) {
-			// check how many bytes match
-			int y;
-			for(y = 0; x + y < 0 && y < end; ++y) {
-				if(d->source->peek(x + y) != d->source->peek(y))
-					break;
-			}
-			// if we reached the end, the last one didn't match
-			if(x + y >= 0 || y >= end)
-				y--;
-
-			// the longest so far?
-			if(y > maxlen) {
-				maxlen = y;
-				max = x;
+
+	/* a code needs at least two symbols to be complete. the pseudo symbol is never used */
+	if(n < 2) {
+		size_t sym = n == 1 ? leaves[0] : 0;
+		lens[sym] = 1;
+		lens[sym == 0 ? 1 : 0] = 1;
+		return;
+	}
+
+	while(1) {
+		std::sort(leaves,leaves + n,[&f](uint16_t a,uint16_t b) {
+			return f[a] < f[b] || (f[a] == f[b] && a < b);
+		});
+
+		/* the two-queue algorithm: leaves are sorted, and the internal nodes are created in
+		 * ascending order of their weight */
+		for(size_t i = 0; i < n; ++i)
+			weight[i] = f[leaves[i]];
+		size_t leaf = 0,node = n;
+		for(size_t k = n; k < 2 * n - 1; ++k) {
+			size_t childs[2];
+			for(int c = 0; c < 2; ++c) {
+				if(leaf < n && (node >= k || weight[leaf] <= weight[node]))
+					childs[c] = leaf++;
+				else
+					childs[c] = node++;
 			}
+			weight[k] = weight[childs[0]] + weight[childs[1]];
+			parent[childs[0]] = parent[childs[1]] = k;
 		}
 
-		// the smallest length we can encode is 3
-		if(maxlen >= 3) {
-			write_symbol_chain(d,&sltree,&sdtree,maxlen,-max);
-			x = maxlen;
+		/* parents have higher indices, so that we can determine the depths top-down */
+		size_t maxdepth = 0;
+		depth[2 * n - 2] = 0;
+		for(ssize_t i = 2 * n - 3; i >= 0; --i) {
+			depth[i] = depth[parent[i]] + 1;
+			if(i < (ssize_t)n)
+				maxdepth = std::max<size_t>(maxdepth,depth[i]);
 		}
-		else {
-			// first write the symbol
-			write_symbol(d,&sltree,sym);
 
-			// now check if the symbol is following again at least 3 times
-			for(x = 1; x < end; ++x) {
-				if(d->source->peek(x) != sym)
-					break;
-			}
-			x--;
-			if(x == end)
-				x--;
+		if(maxdepth <= maxbits) {
+			for(size_t i = 0; i < n; ++i)
+				lens[leaves[i]] = depth[i];
+			break;
+		}
 
-			if(x >= 3) {
-				write_symbol_chain(d,&sltree,&sdtree,x,1);
-				x++;
+		/* too long codes: flatten the distribution and try again */
+		for(size_t i = 0; i < n; ++i)
+			f[leaves[i]] = (f[leaves[i]] >> 1) | 1;
+	}
+}
+
+void Deflate::build_codes(const uint8_t *lens,uint16_t *codes,size_t num) {
+	uint16_t count[MAX_BITS + 1] = {0};
+	uint16_t next[MAX_BITS + 1];
+	for(size_t i = 0; i < num; ++i)
+		count[lens[i]]++;
+	count[0] = 0;
+
+	uint16_t code = 0;
+	for(size_t bits = 1; bits <= MAX_BITS; ++bits) {
+		code = (code + count[bits - 1]) << 1;
+		next[bits] = code;
+	}
+
+	/* the codes are written LSB first, so store them reversed */
+	for(size_t i = 0; i < num; ++i) {
+		uint len = lens[i];
+		if(len == 0)
+			continue;
+		uint c = next[len]++, rev = 0;
+		for(uint b = 0; b < len; ++b, c >>= 1)
+			rev = (rev << 1) | (c & 1);
+		codes[i] = rev;
+	}
+}
+
+size_t Deflate::build_cl_syms(const uint8_t *lens,size_t num,CLSym *syms,uint32_t *freq) {
+	size_t count = 0;
+	for(size_t i = 0; i < num; ) {
+		uint8_t cur = lens[i];
+		size_t run = 1;
+		while(i + run < num && lens[i + run] == cur)
+			run++;
+		i += run;
+
+		if(cur == 0) {
+			while(run >= 11) {
+				size_t r = std::min<size_t>(run,138);
+				syms[count++] = CLSym{18,(uint8_t)(r - 11)};
+				run -= r;
+			}
+			if(run >= 3) {
+				syms[count++] = CLSym{17,(uint8_t)(run - 3)};
+				run = 0;
 			}
-			// adjust x to fetch one byte from source
-			else
-				x = 1;
 		}
-
-		// fetch the bytes from source
-		len -= x;
-		while(x-- > 0)
-			d->source->get();
+		else {
+			syms[count++] = CLSym{cur,0};
+			run--;
+			while(run >= 3) {
+				size_t r = std::min<size_t>(run,6);
+				syms[count++] = CLSym{16,(uint8_t)(r - 3)};
+				run -= r;
+			}
+		}
+		while(run-- > 0)
+			syms[count++] = CLSym{cur,0};
 	}
 
-	/* end of block */
-	write_symbol(d,&sltree,256);
+	for(size_t i = 0; i < count; ++i)
+		freq[syms[i].sym]++;
+	return count;
+}
+
+size_t Deflate::data_bits(const Tree &lt,const Tree &dt) const {
+	size_t bits = 0;
+	for(size_t i = 0; i < 256; ++i)
+		bits += lt.freq[i] * lt.len[i];
+	bits += lt.len[256];
+	for(size_t i = 0; i < 29; ++i)
+		bits += lt.freq[257 + i] * (lt.len[257 + i] + length_bits[i]);
+	for(size_t i = 0; i < D_CODES; ++i)
+		bits += dt.freq[i] * (dt.len[i] + dist_bits[i]);
+	return bits;
 }
 
-void Deflate::deflate_uncompressed_block(Data *d) {
-	unsigned int length,invlength;
-	unsigned int i;
+/* ------------ *
+ * -- output -- *
+ * ------------ */
 
-	/* make sure we start next block on a byte boundary */
-	flush(d);
+void Deflate::flush_output() {
+	_drain->write(_out,_outpos);
+	_outpos = 0;
+}
 
-	/* get length */
-	length = d->source->cached();
-	invlength = ~length & 0x0000ffff;
-	assert(length <= 0xffff);
+void Deflate::align_bits() {
+	while(_bitcount > 0) {
+		put_byte(_bitbuf);
+		_bitbuf >>= 8;
+		_bitcount = _bitcount > 8 ? _bitcount - 8 : 0;
+	}
+	_bitbuf = 0;
+}
 
-	length = cputole16(length);
-	invlength = cputole16(invlength);
-	d->drain->put(length & 0xff);
-	d->drain->put(length >> 8);
-	d->drain->put(invlength & 0xff);
-	d->drain->put(invlength >> 8);
+void Deflate::write_stored_block(const uint8_t *data,size_t len,bool last) {
+	do {
+		size_t amount = std::min(len,MAX_STORED);
+		len -= amount;
+
+		write_bits(last && len == 0 ? 1 : 0,1);
+		write_bits(0,2);
+		align_bits();
+
+		put_byte(amount & 0xFF);
+		put_byte(amount >> 8);
+		put_byte(~amount & 0xFF);
+		put_byte((~amount >> 8) & 0xFF);
+		for(size_t i = 0; i < amount; ++i)
+			put_byte(data[i]);
+		data += amount;
+	}
+	while(len > 0);
+}
 
-	/* copy block */
-	for(i = le16tocpu(length); i; --i)
-		d->drain->put(d->source->get());
+void Deflate::write_data(const Tree &lt,const Tree &dt) {
+	for(size_t i = 0; i < _symcount; ++i) {
+		uint dist = _dists[i];
+		uint lc = _lits[i];
+		if(dist == 0)
+			write_bits(lt.code[lc],lt.len[lc]);
+		else {
+			uint code = _lengthCode[lc + MIN_MATCH];
+			write_bits(lt.code[257 + code],lt.len[257 + code]);
+			if(length_bits[code])
+				write_bits(lc + MIN_MATCH - length_base[code],length_bits[code]);
+
+			dist--;
+			code = dist_code(dist);
+			write_bits(dt.code[code],dt.len[code]);
+			if(dist_bits[code])
+				write_bits(dist + 1 - dist_base[code],dist_bits[code]);
+		}
+	}
+	write_bits(lt.code[256],lt.len[256]);
+}
+
+void Deflate::flush_block(bool last) {
+	_ltree.freq[256] = 1;
+
+	/* build the dynamic trees and determine how many bits they'd need */
+	build_lengths(_ltree.freq,_ltree.len,L_CODES,MAX_BITS);
+	build_lengths(_dtree.freq,_dtree.len,D_CODES,MAX_BITS);
+	build_codes(_ltree.len,_ltree.code,L_CODES);
+	build_codes(_dtree.len,_dtree.code,D_CODES);
+
+	size_t hlit = L_CODES;
+	while(hlit > 257 && _ltree.len[hlit - 1] == 0)
+		hlit--;
+	size_t hdist = D_CODES;
+	while(hdist > 1 && _dtree.len[hdist - 1] == 0)
+		hdist--;
+
+	uint8_t lens[L_CODES + D_CODES];
+	memcpy(lens,_ltree.len,hlit);
+	memcpy(lens + hlit,_dtree.len,hdist);
+	CLSym syms[L_CODES + D_CODES];
+	uint32_t blfreq[BL_CODES] = {0};
+	uint8_t bllen[BL_CODES];
+	uint16_t blcode[BL_CODES];
+	size_t nsyms = build_cl_syms(lens,hlit + hdist,syms,blfreq);
+	build_lengths(blfreq,bllen,BL_CODES,MAX_BL_BITS);
+	build_codes(bllen,blcode,BL_CODES);
+
+	size_t hclen = BL_CODES;
+	while(hclen > 4 && bllen[clcidx[hclen - 1]] == 0)
+		hclen--;
+
+	size_t dynbits = 3 + 5 + 5 + 4 + 3 * hclen + data_bits(_ltree,_dtree);
+	for(size_t i = 0; i < BL_CODES; ++i)
+		dynbits += blfreq[i] * bllen[i];
+	dynbits += blfreq[16] * 2 + blfreq[17] * 3 + blfreq[18] * 7;
+
+	/* fixed trees use the same frequencies */
+	memcpy(_fixed_ltree.freq,_ltree.freq,sizeof(_ltree.freq));
+	memcpy(_fixed_dtree.freq,_dtree.freq,sizeof(_dtree.freq));
+	size_t fixedbits = 3 + data_bits(_fixed_ltree,_fixed_dtree);
+
+	size_t chunks = (_block_len + MAX_STORED - 1) / MAX_STORED;
+	size_t storedbits = chunks * (3 + 7 + 32) + _block_len * 8;
+
+	if(_level == NONE || (_block_len > 0 && storedbits <= std::min(dynbits,fixedbits)))
+		write_stored_block(_window + _block_start,_block_len,last);
+	else if(fixedbits <= dynbits) {
+		write_bits(last ? 1 : 0,1);
+		write_bits(1,2);
+		write_data(_fixed_ltree,_fixed_dtree);
+	}
+	else {
+		write_bits(last ? 1 : 0,1);
+		write_bits(2,2);
+		write_bits(hlit - 257,5);
+		write_bits(hdist - 1,5);
+		write_bits(hclen - 4,4);
+		for(size_t i = 0; i < hclen; ++i)
+			write_bits(bllen[clcidx[i]],3);
+		for(size_t i = 0; i < nsyms; ++i) {
+			write_bits(blcode[syms[i].sym],bllen[syms[i].sym]);
+			if(syms[i].sym == 16)
+				write_bits(syms[i].extra,2);
+			else if(syms[i].sym == 17)
+				write_bits(syms[i].extra,3);
+			else if(syms[i].sym == 18)
+				write_bits(syms[i].extra,7);
+		}
+		write_data(_ltree,_dtree);
+	}
+
+	/* start a new block */
+	_block_start += _block_len;
+	_block_len = 0;
+	_symcount = 0;
+	memset(_ltree.freq,0,sizeof(_ltree.freq));
+	memset(_dtree.freq,0,sizeof(_dtree.freq));
 }
 
 /* ---------------------- *
  * -- public functions -- *
  * ---------------------- */
 
-Deflate::Deflate() : DeflateBase() {
-	/* init static length tree */
-	sltree.litbase[0] = 0;
-	sltree.length[0] = 8;
-	sltree.codebase[0] = 0x30;
-
-	sltree.litbase[1] = 144;
-	sltree.length[1] = 9;
-	sltree.codebase[1] = 0x190;
-
-	sltree.litbase[2] = 256;
-	sltree.length[2] = 7;
-	sltree.codebase[2] = 0;
-
-	sltree.litbase[3] = 280;
-	sltree.length[3] = 8;
-	sltree.codebase[3] = 0xC0;
-
-	/* init static distance tree */
-	sdtree.litbase[0] = 0;
-	sdtree.length[0] = 5;
-	sdtree.codebase[0] = 0;
-	// termination
-	sdtree.litbase[1] = 32;
-}
-
-int Deflate::compress(DeflateDrain *drain,DeflateSource *source,int compr) {
-	Data d;
-	d.source = source;
-	d.bitcount = 0;
-	d.tag = 0;
-	d.drain = drain;
-
-	while(source->more() || source->cached() > 0) {
-		/* final block? */
-		writebit(&d,source->more() ? 0 : 1);
-		/* compression type */
-		write_bits(&d,compr,2);
-
-		/* write data */
-		switch(compr) {
-			case NONE:
-				deflate_uncompressed_block(&d);
-				break;
-			case FIXED:
-				deflate_fixed_block(&d);
-				break;
-			case DYN:
-				// TODO deflate_dynamic_block(&d);
-				break;
+Deflate::Deflate()
+	: DeflateBase(), _window(new uint8_t[2 * WSIZE + MAX_MATCH]), _head(new uint16_t[HASH_SIZE]),
+	  _prev(new uint16_t[WSIZE]), _strstart(), _lookahead(), _match_start(), _eof(),
+	  _config(), _level(), _lits(new uint8_t[SYM_BUFSIZE]), _dists(new uint16_t[SYM_BUFSIZE]),
+	  _symcount(), _block_start(), _block_len(), _ltree(), _dtree(), _lengthCode(), _distCode(),
+	  _fixed_ltree(), _fixed_dtree(), _source(), _drain(), _bitbuf(), _bitcount(),
+	  _out(new uint8_t[OUT_BUFSIZE]), _outpos() {
+	/* build the tables to translate lengths and distances to their codes */
+	for(size_t code = 0; code < 28; ++code) {
+		for(size_t i = 0; i < (1U << length_bits[code]); ++i)
+			_lengthCode[length_base[code] + i] = code;
+	}
+	_lengthCode[MAX_MATCH] = 28;
+	for(size_t code = 0; code < D_CODES; ++code) {
+		for(size_t i = 0; i < (1U << dist_bits[code]); ++i) {
+			size_t dist = dist_base[code] - 1 + i;
+			if(dist < 256)
+				_distCode[dist] = code;
+			else
+				_distCode[256 + (dist >> 7)] = code;
 		}
 	}
 
-	flush(&d);
-	return 0;
+	/* build the fixed trees */
+	size_t i = 0;
+	for(; i < 144; ++i)
+		_fixed_ltree.len[i] = 8;
+	for(; i < 256; ++i)
+		_fixed_ltree.len[i] = 9;
+	for(; i < 280; ++i)
+		_fixed_ltree.len[i] = 7;
+	for(; i < L_CODES + 2; ++i)
+		_fixed_ltree.len[i] = 8;
+	build_codes(_fixed_ltree.len,_fixed_ltree.code,L_CODES + 2);
+	for(i = 0; i < D_CODES; ++i)
+		_fixed_dtree.len[i] = 5;
+	build_codes(_fixed_dtree.len,_fixed_dtree.code,D_CODES);
+}
+
+Deflate::~Deflate() {
+	delete[] _out;
+	delete[] _dists;
+	delete[] _lits;
+	delete[] _prev;
+	delete[] _head;
+	delete[] _window;
+}
+
+void Deflate::reset(DeflateDrain *drain,DeflateSource *source,int level) {
+	_source = source;
+	_drain = drain;
+	_level = level;
+	_config = configs + level;
+	_strstart = _lookahead = _match_start = 0;
+	_eof = false;
+	_symcount = _block_start = _block_len = 0;
+	_bitbuf = 0;
+	_bitcount = 0;
+	_outpos = 0;
+	memset(_window,0,2 * WSIZE + MAX_MATCH);
+	memset(_head,0,HASH_SIZE * sizeof(uint16_t));
+	memset(_prev,0,WSIZE * sizeof(uint16_t));
+	memset(_ltree.freq,0,sizeof(_ltree.freq));
+	memset(_dtree.freq,0,sizeof(_dtree.freq));
+}
+
+void Deflate::set_dictionary(const uint8_t *dict,size_t len) {
+	/* matches can't reach further back than MAX_DIST anyway */
+	if(len > MAX_DIST) {
+		dict += len - MAX_DIST;
+		len = MAX_DIST;
+	}
+
+	memcpy(_window,dict,len);
+	for(size_t i = 0; i + MIN_MATCH <= len; ++i)
+		insert_string(i);
+	_strstart = _block_start = len;
+}
+
+int Deflate::compress(DeflateDrain *drain,DeflateSource *source,int level,const void *dict,
+		size_t dictlen,bool last) {
+	if(level < NONE || level > BEST)
+		return FAILED;
+
+	reset(drain,source,level);
+	if(dict && dictlen > 0)
+		set_dictionary(reinterpret_cast<const uint8_t*>(dict),dictlen);
+
+	if(_config->lazy)
+		deflate_lazy();
+	else
+		deflate_greedy();
+
+	flush_block(last);
+	/* an empty stored block brings us to a byte boundary without ending the stream */
+	if(!last)
+		write_stored_block(NULL,0,false);
+	align_bits();
+	flush_output();
+	return OK;
+}
+
+void Deflate::finish(DeflateDrain *drain) {
+	/* a final block with fixed codes that contains just the end-of-block code */
+	static const uint8_t empty[] = {0x03,0x00};
+	drain->write(empty,sizeof(empty));
 }
 
 }
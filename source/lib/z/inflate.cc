@@ -17,7 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
-/* This is a slightly modified version of: */
+/* This started as a slightly modified version of the following. The bit-wise decoding has been
+ * replaced by lookup tables in the style of zlib since then. */
 
 /*
  * tinflate  -  tiny inflate
@@ -57,135 +58,132 @@
 
 namespace z {
 
-/* special ordering of code length codes */
-const unsigned char Inflate::clcidx[] = {
-	16,17,18,0,8,7,9,6,
-	10,5,11,4,12,3,13,2,
-	14,1,15
-};
-
 /* ----------------------- *
  * -- utility functions -- *
  * ----------------------- */
 
-/* build the fixed huffman trees */
-void Inflate::build_fixed_trees(Tree *lt,Tree *dt) {
-	int i;
-
-	/* build fixed length tree */
-	for(i = 0; i < 7; ++i)
-		lt->table[i] = 0;
-
-	lt->table[7] = 24;
-	lt->table[8] = 152;
-	lt->table[9] = 112;
-
-	for(i = 0; i < 24; ++i)
-		lt->trans[i] = 256 + i;
-	for(i = 0; i < 144; ++i)
-		lt->trans[24 + i] = i;
-	for(i = 0; i < 8; ++i)
-		lt->trans[24 + 144 + i] = 280 + i;
-	for(i = 0; i < 112; ++i)
-		lt->trans[24 + 144 + 8 + i] = 144 + i;
-
-	/* build fixed distance tree */
-	for(i = 0; i < 5; ++i)
-		dt->table[i] = 0;
-
-	dt->table[5] = 32;
-
-	for(i = 0; i < 32; ++i)
-		dt->trans[i] = i;
-}
-
-/* given an array of code lengths, build a tree */
-void Inflate::build_tree(Tree *t,const unsigned char *lengths,unsigned int num) {
-	unsigned short offs[16];
-	unsigned int i,sum;
-
-	/* clear code length count table */
-	for(i = 0; i < 16; ++i)
-		t->table[i] = 0;
+/* given an array of code lengths, build the lookup tables */
+template<size_t SIZE>
+int Inflate::build_tree(Tree<SIZE> *t,const unsigned char *lengths,unsigned int num,uint rootbits) {
+	unsigned short count[MAX_BITS + 1];
+	unsigned short next[MAX_BITS + 1];
+	unsigned short codes[288 + 32];
+	unsigned int i,len,maxlen = 0;
+
+	/* count the number of codes for each length */
+	for(i = 0; i <= MAX_BITS; ++i)
+		count[i] = 0;
+	for(i = 0; i < num; ++i) {
+		count[lengths[i]]++;
+		maxlen = std::max<unsigned int>(maxlen,lengths[i]);
+	}
+	count[0] = 0;
+
+	/* reject over-subscribed codes and incomplete ones, except a single code */
+	int left = 1;
+	for(len = 1; len <= MAX_BITS; ++len) {
+		left <<= 1;
+		left -= count[len];
+		if(left < 0)
+			return FAILED;
+	}
+	if(left > 0 && maxlen > 1)
+		return FAILED;
 
-	/* scan symbol lengths,and sum code length counts */
-	for(i = 0; i < num; ++i)
-		t->table[lengths[i]]++;
+	/* determine the canonical codes, reversed because the bits are read LSB first */
+	unsigned short code = 0;
+	for(len = 1; len <= MAX_BITS; ++len) {
+		code = (code + count[len - 1]) << 1;
+		next[len] = code;
+	}
+	next[0] = 0;
+	for(i = 0; i < num; ++i) {
+		unsigned int c = next[lengths[i]]++, rev = 0;
+		for(len = 0; len < lengths[i]; ++len, c >>= 1)
+			rev = (rev << 1) | (c & 1);
+		codes[i] = rev;
+	}
 
-	t->table[0] = 0;
+	/* all entries are invalid by default */
+	t->rootbits = rootbits;
+	size_t rootsize = 1 << rootbits;
+	for(i = 0; i < rootsize; ++i)
+		t->entries[i] = Entry{0,0xFF,0};
 
-	/* compute offset table for distribution sort */
-	for(sum = 0,i = 0; i < 16; ++i) {
-		offs[i] = sum;
-		sum += t->table[i];
+	/* codes that are longer than rootbits go into subtables, whose size is determined by the
+	 * longest code with the same prefix */
+	for(i = 0; i < num; ++i) {
+		if(lengths[i] > rootbits) {
+			Entry *e = t->entries + (codes[i] & (rootsize - 1));
+			e->sub = std::max<uint8_t>(e->sub,lengths[i] - rootbits);
+		}
+	}
+	size_t total = rootsize;
+	for(i = 0; i < rootsize; ++i) {
+		Entry *e = t->entries + i;
+		if(e->sub) {
+			size_t subsize = 1 << e->sub;
+			if(total + subsize > SIZE)
+				return FAILED;
+			e->val = total;
+			for(size_t j = 0; j < subsize; ++j)
+				t->entries[total + j] = Entry{0,0xFF,0};
+			total += subsize;
+		}
 	}
 
-	/* create code->symbol translation table (symbols sorted by code) */
+	/* now fill in the symbols */
 	for(i = 0; i < num; ++i) {
-		if(lengths[i])
-			t->trans[offs[lengths[i]]++] = i;
+		len = lengths[i];
+		if(len == 0)
+			continue;
+
+		Entry sym = {(uint16_t)i,(uint8_t)len,0};
+		if(len <= rootbits) {
+			for(size_t j = codes[i]; j < rootsize; j += 1 << len)
+				t->entries[j] = sym;
+		}
+		else {
+			const Entry *link = t->entries + (codes[i] & (rootsize - 1));
+			for(size_t j = codes[i] >> rootbits; j < (1U << link->sub); j += 1 << (len - rootbits))
+				t->entries[link->val + j] = sym;
+		}
 	}
+	return OK;
 }
 
 /* ---------------------- *
  * -- decode functions -- *
  * ---------------------- */
 
-/* get one bit from source stream */
-int Inflate::getbit(Data *d) {
-	unsigned int bit;
-
-	/* check if tag is empty */
-	if(!d->bitcount--) {
-		/* load next tag */
-		d->tag = d->source->get();
-		d->bitcount = 7;
-	}
-
-	/* shift bit out of tag */
-	bit = d->tag & 0x01;
-	d->tag >>= 1;
-
-	return bit;
-}
-
-/* read a num bit value from a stream and add base */
-unsigned int Inflate::read_bits(Data *d,int num,int base) {
-	unsigned int val = 0;
-
-	/* read num bits */
-	if(num) {
-		unsigned int limit = 1 << (num);
-		unsigned int mask;
-
-		for(mask = 1; mask < limit; mask *= 2)
-			if(getbit(d)) val += mask;
-	}
-
-	return val + base;
-}
-
 /* given a data stream and a tree, decode a symbol */
-int Inflate::decode_symbol(Data *d,Tree *t) {
-	int sum = 0,cur = 0,len = 0;
-
-	/* get more bits while code value is above sum */
-	do {
-		cur = 2 * cur + getbit(d);
-
-		++len;
+template<size_t SIZE>
+int Inflate::decode_symbol(Data *d,const Tree<SIZE> *t) {
+	uint rootmask = (1 << t->rootbits) - 1;
+	while(1) {
+		/* the unknown bits are zero. but since the code is prefix-free, a code that fits into
+		 * the known bits is the right one. thus, we only read another byte if necessary */
+		Entry e = t->entries[d->tag & rootmask];
+		if(e.sub)
+			e = t->entries[e.val + ((d->tag >> t->rootbits) & ((1 << e.sub) - 1))];
+
+		if(EXPECT_TRUE(e.bits <= d->bitcount)) {
+			d->tag >>= e.bits;
+			d->bitcount -= e.bits;
+			return e.val;
+		}
 
-		sum += t->table[len];
-		cur -= t->table[len];
+		/* invalid code */
+		if(d->bitcount >= MAX_BITS)
+			return FAILED;
+		d->tag |= (uint64_t)d->source->get() << d->bitcount;
+		d->bitcount += 8;
 	}
-	while(cur >= 0);
-
-	return t->trans[sum + cur];
 }
 
 /* given a data stream, decode dynamic trees from it */
-void Inflate::decode_trees(Data *d,Tree *lt,Tree *dt) {
-	Tree code_tree;
+int Inflate::decode_trees(Data *d,LTree *lt,DTree *dt) {
+	CLTree code_tree;
 	unsigned char lengths[288 + 32];
 	unsigned int hlit,hdist,hclen;
 	unsigned int i,num,length;
@@ -199,6 +197,9 @@ void Inflate::decode_trees(Data *d,Tree *lt,Tree *dt) {
 	/* get 4 bits HCLEN (4-19) */
 	hclen = read_bits(d,4,4);
 
+	if(hlit > 286 || hdist > 30)
+		return FAILED;
+
 	for(i = 0; i < 19; ++i)
 		lengths[i] = 0;
 
@@ -211,41 +212,53 @@ void Inflate::decode_trees(Data *d,Tree *lt,Tree *dt) {
 	}
 
 	/* build code length tree */
-	build_tree(&code_tree,lengths,19);
+	if(build_tree(&code_tree,lengths,19,CLBITS) != OK)
+		return FAILED;
 
 	/* decode code lengths for the dynamic trees */
 	for(num = 0; num < hlit + hdist;) {
 		int sym = decode_symbol(d,&code_tree);
+		unsigned char val = 0;
 
 		switch(sym) {
 			case 16:
 				/* copy previous code length 3-6 times (read 2 bits) */
-				{
-					unsigned char prev = lengths[num - 1];
-					for(length = read_bits(d,2,3); length; --length)
-						lengths[num++] = prev;
-				}
+				if(num == 0)
+					return FAILED;
+				val = lengths[num - 1];
+				length = read_bits(d,2,3);
 				break;
 			case 17:
 				/* repeat code length 0 for 3-10 times (read 3 bits) */
-				for(length = read_bits(d,3,3); length; --length)
-					lengths[num++] = 0;
+				length = read_bits(d,3,3);
 				break;
 			case 18:
 				/* repeat code length 0 for 11-138 times (read 7 bits) */
-				for(length = read_bits(d,7,11); length; --length)
-					lengths[num++] = 0;
+				length = read_bits(d,7,11);
 				break;
+			case FAILED:
+				return FAILED;
 			default:
 				/* values 0-15 represent the actual code lengths */
-				lengths[num++] = sym;
+				val = sym;
+				length = 1;
 				break;
 		}
+
+		if(num + length > hlit + hdist)
+			return FAILED;
+		while(length-- > 0)
+			lengths[num++] = val;
 	}
 
+	/* the end-of-block code is required */
+	if(lengths[256] == 0)
+		return FAILED;
+
 	/* build dynamic trees */
-	build_tree(lt,lengths,hlit);
-	build_tree(dt,lengths + hlit,hdist);
+	if(build_tree(lt,lengths,hlit,LBITS) != OK)
+		return FAILED;
+	return build_tree(dt,lengths + hlit,hdist,DBITS);
 }
 
 /* ----------------------------- *
@@ -253,34 +266,37 @@ void Inflate::decode_trees(Data *d,Tree *lt,Tree *dt) {
  * ----------------------------- */
 
 /* given a stream and two trees, inflate a block of data */
-int Inflate::inflate_block_data(Data *d,Tree *lt,Tree *dt) {
+int Inflate::inflate_block_data(Data *d,LTree *lt,DTree *dt) {
 	while(1) {
 		int sym = decode_symbol(d,lt);
 
+		if(EXPECT_TRUE(sym < 256)) {
+			if(EXPECT_FALSE(sym == FAILED))
+				return FAILED;
+			d->drain->put(sym);
+			continue;
+		}
+
 		/* check for end of block */
 		if(sym == 256)
 			return OK;
 
-		if(sym < 256)
-			d->drain->put(sym);
-		else {
-			int length,dist,offs;
-			int i;
-
-			sym -= 257;
+		sym -= 257;
+		if(EXPECT_FALSE(sym >= 29))
+			return FAILED;
 
-			/* possibly get more bits from length code */
-			length = read_bits(d,length_bits[sym],length_base[sym]);
+		/* possibly get more bits from length code */
+		unsigned int length = read_bits(d,length_bits[sym],length_base[sym]);
 
-			dist = decode_symbol(d,dt);
+		int dist = decode_symbol(d,dt);
+		if(EXPECT_FALSE(dist < 0 || dist >= 30))
+			return FAILED;
 
-			/* possibly get more bits from distance code */
-			offs = read_bits(d,dist_bits[dist],dist_base[dist]);
+		/* possibly get more bits from distance code */
+		unsigned int offs = read_bits(d,dist_bits[dist],dist_base[dist]);
 
-			/* copy match */
-			for(i = 0; i < length; ++i)
-				d->drain->put(d->drain->get(offs));
-		}
+		/* copy match */
+		d->drain->copy(offs,length);
 	}
 }
 
@@ -289,51 +305,52 @@ int Inflate::inflate_uncompressed_block(Data *d) {
 	unsigned int length,invlength;
 	unsigned int i;
 
+	/* skip to the next byte boundary */
+	read_bits(d,d->bitcount & 7,0);
+
 	/* get length */
-	length = d->source->get();
-	length = length + 256 * d->source->get();
+	length = read_bits(d,16,0);
 
 	/* get one's complement of length */
-	invlength = d->source->get();
-	invlength = invlength + 256 * d->source->get();
+	invlength = read_bits(d,16,0);
 
 	/* check length */
 	if(length != (~invlength & 0x0000ffff))
 		return FAILED;
 
-	/* copy block */
-	for(i = length; i; --i)
+	/* copy the bytes we've already read, if any, and the rest directly from the source */
+	for(i = length; i && d->bitcount; --i)
+		d->drain->put(read_bits(d,8,0));
+	for(; i; --i)
 		d->drain->put(d->source->get());
 
-	/* make sure we start next block on a byte boundary */
-	d->bitcount = 0;
-
 	return OK;
 }
 
-/* inflate a block of data compressed with fixed huffman trees */
-int Inflate::inflate_fixed_block(Data *d) {
-	/* decode block using fixed trees */
-	return inflate_block_data(d,&sltree,&sdtree);
-}
-
-/* inflate a block of data compressed with dynamic huffman trees */
-int Inflate::inflate_dynamic_block(Data *d) {
-	/* decode trees from stream */
-	decode_trees(d,&d->ltree,&d->dtree);
-
-	/* decode block using decoded trees */
-	return inflate_block_data(d,&d->ltree,&d->dtree);
-}
-
 /* ---------------------- *
  * -- public functions -- *
  * ---------------------- */
 
 /* initialize global (static) data */
 Inflate::Inflate() : DeflateBase() {
-	/* build fixed huffman trees */
-	build_fixed_trees(&sltree,&sdtree);
+	unsigned char lengths[288];
+	int i;
+
+	/* build fixed length tree */
+	for(i = 0; i < 144; ++i)
+		lengths[i] = 8;
+	for(; i < 256; ++i)
+		lengths[i] = 9;
+	for(; i < 280; ++i)
+		lengths[i] = 7;
+	for(; i < 288; ++i)
+		lengths[i] = 8;
+	build_tree(&sltree,lengths,288,LBITS);
+
+	/* build fixed distance tree. the codes 30 and 31 are invalid, but make the code complete */
+	for(i = 0; i < 32; ++i)
+		lengths[i] = 5;
+	build_tree(&sdtree,lengths,32,DBITS);
 }
 
 /* inflate stream from source to dest */
@@ -343,6 +360,7 @@ int Inflate::uncompress(InflateDrain *drain,InflateSource *source) {
 
 	/* initialise data */
 	d.source = source;
+	d.tag = 0;
 	d.bitcount = 0;
 
 	d.drain = drain;
@@ -352,7 +370,7 @@ int Inflate::uncompress(InflateDrain *drain,InflateSource *source) {
 		int res;
 
 		/* read final block flag */
-		bfinal = getbit(&d);
+		bfinal = read_bits(&d,1,0);
 
 		/* read block type (2 bits) */
 		btype = read_bits(&d,2,0);
@@ -365,11 +383,13 @@ int Inflate::uncompress(InflateDrain *drain,InflateSource *source) {
 				break;
 			case 1:
 				/* decompress block with fixed huffman trees */
-				res = inflate_fixed_block(&d);
+				res = inflate_block_data(&d,&sltree,&sdtree);
 				break;
 			case 2:
 				/* decompress block with dynamic huffman trees */
-				res = inflate_dynamic_block(&d);
+				res = decode_trees(&d,&d.ltree,&d.dtree);
+				if(res == OK)
+					res = inflate_block_data(&d,&d.ltree,&d.dtree);
 				break;
 			default:
 				return FAILED;
@@ -377,11 +397,11 @@ int Inflate::uncompress(InflateDrain *drain,InflateSource *source) {
 
 		if(res != OK)
 			return FAILED;
-
 	}
 	while(!bfinal);
 
-	return 0;
+	drain->flush();
+	return OK;
 }
 
 }
@@ -21,15 +21,71 @@
 #include <esc/regex/regex.h>
 #include <esc/stream/std.h>
 #include <esc/stream/fstream.h>
+#include <stdlib.h>
+#include <string.h>
 
 using namespace esc;
 
+static const size_t BUF_SIZE	= 256 * 1024;
+
 static void usage(const char *name) {
 	serr << "Usage: " << name << " [-i] <pattern> [<file>]\n";
 	serr << "    -i: match case insensitive\n";
 	exit(EXIT_FAILURE);
 }
 
+/**
+ * Writes all lines of <in> that contain a match of <pattern> to sout. The input is read in large
+ * blocks and each block is searched as a whole, so that we don't need to look at most of the
+ * lines that don't match.
+ */
+static void grep(FStream *in,const Regex::Pattern &pattern,uint flags) {
+	size_t size = BUF_SIZE;
+	char *buf = new char[size];
+	size_t len = 0;
+	bool eof = false;
+	while(!eof && sout.good()) {
+		size_t res = in->read(buf + len,size - len);
+		eof = res == 0;
+		len += res;
+
+		// only search complete lines, unless there is nothing more to come
+		char *end = buf + len;
+		if(!eof) {
+			while(end > buf && end[-1] != '\n')
+				end--;
+			if(end == buf) {
+				// the line doesn't fit into the buffer
+				if(len == size) {
+					char *nbuf = new char[size * 2];
+					memcpy(nbuf,buf,len);
+					delete[] buf;
+					buf = nbuf;
+					size *= 2;
+				}
+				continue;
+			}
+		}
+
+		const char *pos = buf;
+		while(pos < end) {
+			const char *line = Regex::searchLine(pattern,pos,end,flags);
+			if(!line)
+				break;
+			const char *eol = static_cast<const char*>(memchr(line,'\n',end - line));
+			if(!eol)
+				eol = end;
+			sout.write(line,eol - line);
+			sout.write('\n');
+			pos = eol + 1;
+		}
+
+		len -= end - buf;
+		memmove(buf,end,len);
+	}
+	delete[] buf;
+}
+
 int main(int argc,char **argv) {
 	FStream *in = &sin;
 	bool ci = false;
@@ -58,12 +114,7 @@ int main(int argc,char **argv) {
 		flags |= Regex::CASE_INSENSITIVE;
 	Regex::Pattern pattern = Regex::compile(regex);
 
-	std::string line;
-	while(sout.good() && !in->eof()) {
-		in->getline(line);
-		if(Regex::search(pattern,line,flags).matched())
-			sout << line << '\n';
-	}
+	grep(in,pattern,flags);
 	if(in->error())
 		error("Read failed");
 	if(sout.error())
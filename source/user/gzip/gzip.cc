@@ -24,15 +24,165 @@
 #include <esc/vthrow.h>
 #include <sys/common.h>
 #include <sys/endian.h>
+#include <sys/sync.h>
+#include <sys/thread.h>
 #include <z/deflate.h>
 #include <z/gzip.h>
 #include <stdlib.h>
 
 using namespace esc;
 
-static int compr = z::Deflate::FIXED;
+/* the uncompressed size of the blocks that are compressed in parallel */
+static const size_t BLOCK_SIZE		= 128 * 1024;
+/* the amount of preceding data that is used to prime the window */
+static const size_t DICT_SIZE		= 32 * 1024;
+
+static int compr = z::Deflate::DEFAULT;
 static int tostdout = false;
 static int keep = false;
+static int threads = 1;
+
+/**
+ * A block of the input that is compressed by one of the workers. The input starts with the
+ * last DICT_SIZE bytes of the previous block, if there is one.
+ */
+struct Job {
+	explicit Job()
+		: in(new uint8_t[DICT_SIZE + BLOCK_SIZE]), dictlen(), len(),
+		  /* enough for BLOCK_SIZE bytes in stored blocks and the sync marker */
+		  out(new uint8_t[OUT_SIZE]), outlen(), crc(), next() {
+		if(usemcrt(&done,0) < 0)
+			exitmsg("Unable to create semaphore");
+	}
+	~Job() {
+		usemdestr(&done);
+		delete[] out;
+		delete[] in;
+	}
+
+	static const size_t OUT_SIZE = BLOCK_SIZE + BLOCK_SIZE / 8 + 1024;
+
+	uint8_t *in;
+	size_t dictlen;
+	size_t len;
+	uint8_t *out;
+	size_t outlen;
+	uint32_t crc;
+	tUserSem done;
+	Job *next;
+};
+
+/* the queue of jobs that wait for a worker; a wakeup without a job tells the worker to stop */
+static Job *jobsFirst = NULL;
+static Job *jobsLast = NULL;
+static tUserSem jobsLock;
+static tUserSem jobsAvail;
+
+static void pushJob(Job *job) {
+	usemdown(&jobsLock);
+	if(jobsLast)
+		jobsLast->next = job;
+	else
+		jobsFirst = job;
+	jobsLast = job;
+	usemup(&jobsLock);
+	usemup(&jobsAvail);
+}
+
+static Job *popJob() {
+	usemdown(&jobsAvail);
+	usemdown(&jobsLock);
+	Job *job = jobsFirst;
+	if(job) {
+		jobsFirst = job->next;
+		if(!jobsFirst)
+			jobsLast = NULL;
+	}
+	usemup(&jobsLock);
+	return job;
+}
+
+static int worker(A_UNUSED void *arg) {
+	z::Deflate deflate;
+	z::CRC32 crc;
+	while(1) {
+		Job *job = popJob();
+		if(!job)
+			break;
+
+		z::MemDeflateSource src(job->in + job->dictlen,job->len);
+		z::MemDeflateDrain drain(job->out,Job::OUT_SIZE);
+		deflate.compress(&drain,&src,compr,job->in,job->dictlen,false);
+		job->outlen = drain.count();
+		job->crc = crc.get(job->in + job->dictlen,job->len);
+		usemup(&job->done);
+	}
+	return 0;
+}
+
+static size_t readBlock(IStream &is,uint8_t *buf,size_t size) {
+	size_t total = 0;
+	while(total < size) {
+		size_t res = is.read(buf + total,size - total);
+		if(res == 0)
+			break;
+		total += res;
+	}
+	return total;
+}
+
+static bool compressParallel(IStream &is,OStream &out,uint32_t *crc32,uint32_t *orgsize) {
+	/* two jobs per worker, so that the workers don't wait for us while we read and write */
+	size_t count = threads * 2;
+	Job *jobs = new Job[count];
+	Job *prev = NULL;
+	size_t submitted = 0,written = 0;
+	bool eof = false,res = true;
+	*crc32 = 0;
+	*orgsize = 0;
+
+	while(written < submitted || !eof) {
+		/* read the next block, if there is a free job */
+		if(!eof && submitted - written < count) {
+			Job *job = jobs + submitted % count;
+			job->dictlen = 0;
+			if(prev) {
+				job->dictlen = MIN(prev->len + prev->dictlen,DICT_SIZE);
+				memcpy(job->in,prev->in + prev->dictlen + prev->len - job->dictlen,job->dictlen);
+			}
+			job->len = readBlock(is,job->in + job->dictlen,BLOCK_SIZE);
+			job->next = NULL;
+			if(job->len == 0)
+				eof = true;
+			else {
+				pushJob(job);
+				prev = job;
+				submitted++;
+				if(job->len < BLOCK_SIZE)
+					eof = true;
+			}
+			continue;
+		}
+
+		/* otherwise, write the oldest block, which keeps the order */
+		Job *job = jobs + written % count;
+		usemdown(&job->done);
+		if(res) {
+			if(job->outlen > Job::OUT_SIZE || out.write(job->out,job->outlen) != job->outlen)
+				res = false;
+			*crc32 = z::CRC32::combine(*crc32,job->crc,job->len);
+			*orgsize += job->len;
+		}
+		written++;
+	}
+
+	if(res) {
+		z::StreamDeflateDrain drain(out);
+		z::Deflate::finish(&drain);
+	}
+	delete[] jobs;
+	return res;
+}
 
 static void compress(IStream &is,const std::string &filename) {
 	OStream *out = &sout;
@@ -49,20 +199,28 @@ static void compress(IStream &is,const std::string &filename) {
 	z::GZipHeader header(&is == &sin ? NULL : filename.c_str(),NULL,true);
 	header.write(*out);
 
-	z::StreamDeflateSource src(is);
-	z::StreamDeflateDrain drain(*out);
-	z::Deflate deflate;
-	if(deflate.compress(&drain,&src,compr) != 0)
+	bool success;
+	uint32_t crc32,orgsize;
+	if(threads > 1)
+		success = compressParallel(is,*out,&crc32,&orgsize);
+	else {
+		z::StreamDeflateSource src(is);
+		z::StreamDeflateDrain drain(*out);
+		z::Deflate deflate;
+		success = deflate.compress(&drain,&src,compr) == 0;
+		crc32 = src.crc32();
+		orgsize = src.count();
+	}
+
+	if(!success)
 		errmsg(filename << ": compressing failed");
 	else {
-		uint32_t crc32 = src.crc32();
+		crc32 = cputole32(crc32);
+		orgsize = cputole32(orgsize);
 		if(out->write(&crc32,4) != 4)
 			errmsg(filename << ": unable to write CRC32");
-		else {
-			uint32_t orgsize = src.count();
-			if(out->write(&orgsize,4) != 4)
-				errmsg(filename << ": unable to write size of original file");
-		}
+		else if(out->write(&orgsize,4) != 4)
+			errmsg(filename << ": unable to write size of original file");
 	}
 
 	if(!tostdout) {
@@ -73,19 +231,28 @@ static void compress(IStream &is,const std::string &filename) {
 }
 
 static void usage(const char *name) {
-	serr << "Usage: " << name << " [-c] [-k] [<file>...]\n";
+	serr << "Usage: " << name << " [-c] [-k] [-1 ... -9] [-l <level>] [-p <n>] [<file>...]\n";
 	serr << "  -c: write to stdout\n";
 	serr << "  -k: keep the original files, don't delete them\n";
+	serr << "  -1 ... -9: compress faster (-1) or better (-9). the default is -6\n";
+	serr << "  -l <level>: use compression level <level> (0 = no compression)\n";
+	serr << "  -p <n>: compress independent blocks with <n> threads in parallel\n";
 	serr << "  If no file is given or <file> is '-', stdin is compressed to stdout.\n";
 	exit(EXIT_FAILURE);
 }
 
 int main(int argc,char **argv) {
+	int levels[z::Deflate::BEST] = {0};
 	esc::cmdargs args(argc,argv,0);
 	try {
-		args.parse("c l=d k",&tostdout,&compr,&keep);
-		if(args.is_help() ||
-			(compr != z::Deflate::NONE && compr != z::Deflate::FIXED && compr != z::Deflate::DYN))
+		args.parse("c l=d k p=d 1 2 3 4 5 6 7 8 9",&tostdout,&compr,&keep,&threads,
+			levels + 0,levels + 1,levels + 2,levels + 3,levels + 4,
+			levels + 5,levels + 6,levels + 7,levels + 8);
+		for(int i = 0; i < z::Deflate::BEST; ++i) {
+			if(levels[i])
+				compr = i + 1;
+		}
+		if(args.is_help() || compr < z::Deflate::NONE || compr > z::Deflate::BEST || threads < 1)
 			usage(argv[0]);
 	}
 	catch(const esc::cmdargs_error& e) {
@@ -93,6 +260,15 @@ int main(int argc,char **argv) {
 		usage(argv[0]);
 	}
 
+	if(threads > 1) {
+		if(usemcrt(&jobsLock,1) < 0 || usemcrt(&jobsAvail,0) < 0)
+			exitmsg("Unable to create semaphores");
+		for(int i = 0; i < threads; ++i) {
+			if(startthread(worker,NULL) < 0)
+				exitmsg("Unable to start thread");
+		}
+	}
+
 	if(args.get_free().size() == 0 || (args.get_free().size() == 1 && *(args.get_free()[0]) == "-")) {
 		tostdout = true;
 		compress(sin,"stdin");
@@ -108,5 +284,11 @@ int main(int argc,char **argv) {
 			compress(f,**file);
 		}
 	}
+
+	if(threads > 1) {
+		for(int i = 0; i < threads; ++i)
+			usemup(&jobsAvail);
+		join(0);
+	}
 	return 0;
 }
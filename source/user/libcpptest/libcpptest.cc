@@ -29,6 +29,7 @@ extern sTestModule tModStreams;
 extern sTestModule tModFunctional;
 extern sTestModule tModBintree;
 extern sTestModule tModMap;
+extern sTestModule tModUnordered;
 extern sTestModule tModSmartPtr;
 extern sTestModule tModTuple;
 
@@ -41,6 +42,7 @@ int main(void) {
 	test_register(&tModFunctional);
 	test_register(&tModBintree);
 	test_register(&tModMap);
+	test_register(&tModUnordered);
 	test_register(&tModSmartPtr);
 	test_register(&tModTuple);
 	test_start();
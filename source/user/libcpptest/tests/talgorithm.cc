@@ -21,6 +21,7 @@
 #include <sys/test.h>
 #include <algorithm>
 #include <list>
+#include <new>
 #include <stdlib.h>
 #include <vector>
 
@@ -42,6 +43,8 @@ static void test_includes(void);
 static void test_minmax(void);
 static void test_lexcompare(void);
 static void test_sort(void);
+static void test_stable_sort(void);
+static void test_heap(void);
 
 static void check_content(const list<int> &l,size_t count,...) {
 	va_list ap;
@@ -73,6 +76,8 @@ static void test_algo(void) {
 	test_minmax();
 	test_lexcompare();
 	test_sort();
+	test_stable_sort();
+	test_heap();
 }
 
 static void test_find(void) {
@@ -432,3 +437,129 @@ static void test_sort(void) {
 
 	test_caseSucceeded();
 }
+
+static void check_sorted(const vector<int> &v) {
+	for(size_t i = 1; i < v.size(); ++i) {
+		if(v[i - 1] > v[i]) {
+			test_assertFalse(true);
+			break;
+		}
+	}
+}
+
+static void test_sort_patterns(void (*sortfunc)(vector<int>::iterator,vector<int>::iterator)) {
+	const size_t count = 10000;
+	vector<int> v(count);
+
+	/* sorted, reverse sorted, all equal, organ pipe and few distinct values */
+	for(size_t i = 0; i < count; ++i)
+		v[i] = i;
+	sortfunc(v.begin(),v.end());
+	check_sorted(v);
+
+	for(size_t i = 0; i < count; ++i)
+		v[i] = count - i;
+	sortfunc(v.begin(),v.end());
+	check_sorted(v);
+
+	for(size_t i = 0; i < count; ++i)
+		v[i] = 4;
+	sortfunc(v.begin(),v.end());
+	check_sorted(v);
+
+	for(size_t i = 0; i < count; ++i)
+		v[i] = i < count / 2 ? i : count - i;
+	sortfunc(v.begin(),v.end());
+	check_sorted(v);
+
+	for(size_t i = 0; i < count; ++i)
+		v[i] = rand() % 5;
+	sortfunc(v.begin(),v.end());
+	check_sorted(v);
+
+	for(size_t i = 0; i < count; ++i)
+		v[i] = rand();
+	sortfunc(v.begin(),v.end());
+	check_sorted(v);
+}
+
+static void sort_ints(vector<int>::iterator first,vector<int>::iterator last) {
+	std::sort(first,last);
+}
+
+static void stable_sort_ints(vector<int>::iterator first,vector<int>::iterator last) {
+	std::stable_sort(first,last);
+}
+
+struct Item {
+	int key;
+	int pos;
+};
+
+static bool itemCompare(const Item &a,const Item &b) {
+	return a.key < b.key;
+}
+
+/* stable_sort must not require a default-constructor */
+struct Entry {
+	explicit Entry(int k,int p) : key(k), pos(p) {
+	}
+
+	int key;
+	int pos;
+};
+
+static bool entryCompare(const Entry &a,const Entry &b) {
+	return a.key < b.key;
+}
+
+static void test_stable_sort(void) {
+	test_caseStart("Testing stable_sort");
+
+	test_sort_patterns(sort_ints);
+	test_sort_patterns(stable_sort_ints);
+
+	{
+		vector<Item> items(1000);
+		for(size_t i = 0; i < items.size(); ++i) {
+			items[i].key = rand() % 10;
+			items[i].pos = i;
+		}
+		std::stable_sort(items.begin(),items.end(),itemCompare);
+		for(size_t i = 1; i < items.size(); ++i) {
+			test_assertTrue(items[i - 1].key <= items[i].key);
+			if(items[i - 1].key == items[i].key)
+				test_assertTrue(items[i - 1].pos < items[i].pos);
+		}
+	}
+
+	{
+		const size_t count = 1000;
+		Entry *entries = static_cast<Entry*>(malloc(count * sizeof(Entry)));
+		test_assertTrue(entries != NULL);
+		for(size_t i = 0; i < count; ++i)
+			new (entries + i) Entry(rand() % 10,i);
+		std::stable_sort(entries,entries + count,entryCompare);
+		for(size_t i = 1; i < count; ++i) {
+			test_assertTrue(entries[i - 1].key <= entries[i].key);
+			if(entries[i - 1].key == entries[i].key)
+				test_assertTrue(entries[i - 1].pos < entries[i].pos);
+		}
+		free(entries);
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_heap(void) {
+	test_caseStart("Testing make_heap and sort_heap");
+
+	int ints[] = {6,7,3,4,2,1,5,9,8};
+	std::make_heap(ints,ints + ARRAY_SIZE(ints));
+	test_assertInt(ints[0],9);
+	std::sort_heap(ints,ints + ARRAY_SIZE(ints));
+	for(size_t i = 0; i < ARRAY_SIZE(ints); ++i)
+		test_assertInt(ints[i],i + 1);
+
+	test_caseSucceeded();
+}
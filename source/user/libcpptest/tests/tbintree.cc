@@ -314,6 +314,26 @@ static void test_erase(void) {
 	after = heapspace();
 	test_assertTrue(after >= before);
 
+	before = heapspace();
+	{
+		// sorted input used to degenerate the tree to a list; check that rebalancing keeps it intact
+		bintree<int,int> t;
+		for(int i = 0; i < 1000; ++i)
+			t.insert(i,i);
+		for(int i = 998; i >= 0; i -= 2)
+			t.erase(i);
+		test_assertSize(t.size(),500);
+
+		int i = 1;
+		for(it = t.begin(); it != t.end(); ++it, i += 2)
+			test_assertTrue(*it == make_pair(i,i));
+		test_assertInt(i,1001);
+		test_assertTrue(t.lower_bound(4) == t.find(5));
+		test_assertTrue(t.upper_bound(5) == t.find(7));
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
 	before = heapspace();
 	{
 		bintree<int,int> t;
@@ -0,0 +1,209 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/test.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdlib.h>
+#include <string>
+
+using namespace std;
+
+/* forward declarations */
+static void test_unordered(void);
+static void test_insert(void);
+static void test_erase(void);
+static void test_copy(void);
+static void test_set(void);
+
+/* our test-module */
+sTestModule tModUnordered = {
+	"Unordered map and set",
+	&test_unordered
+};
+
+static void test_unordered(void) {
+	test_insert();
+	test_erase();
+	test_copy();
+	test_set();
+}
+
+static void test_insert(void) {
+	size_t before,after;
+	test_caseStart("Testing insert");
+
+	before = heapspace();
+	{
+		unordered_map<int,int> m;
+		test_assertTrue(m.empty());
+		test_assertTrue(m.find(4) == m.end());
+
+		for(int i = 0; i < 1000; ++i)
+			m[i * 16] = i;
+		test_assertSize(m.size(),1000);
+		test_assertTrue(m.load_factor() <= m.max_load_factor());
+		for(int i = 0; i < 1000; ++i)
+			test_assertInt(m.at(i * 16),i);
+		test_assertTrue(m.find(1) == m.end());
+		test_assertSize(m.count(32),1);
+		test_assertSize(m.count(33),0);
+
+		pair<unordered_map<int,int>::iterator,bool> res = m.insert(make_pair(16,4));
+		test_assertFalse(res.second);
+		test_assertInt(res.first->second,1);
+		res = m.insert(make_pair(-1,4));
+		test_assertTrue(res.second);
+		test_assertInt(res.first->second,4);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	before = heapspace();
+	{
+		unordered_map<string,int> m;
+		m["foo"] = 1;
+		m["bar"] = 2;
+		m["foo"]++;
+		test_assertSize(m.size(),2);
+		test_assertInt(m["foo"],2);
+		test_assertInt(m["bar"],2);
+
+		m.reserve(100);
+		size_t buckets = m.bucket_count();
+		for(int i = 0; i < 98; ++i)
+			m[string(i + 1,'x')] = i;
+		test_assertSize(m.bucket_count(),buckets);
+		test_assertSize(m.size(),100);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_erase(void) {
+	size_t before,after;
+	test_caseStart("Testing erase");
+
+	before = heapspace();
+	{
+		unordered_map<int,int> m;
+		for(int i = 0; i < 100; ++i)
+			m[i] = i;
+		for(int i = 0; i < 100; i += 2)
+			test_assertSize(m.erase(i),1);
+		test_assertSize(m.erase(0),0);
+		test_assertSize(m.size(),50);
+		for(int i = 0; i < 100; ++i)
+			test_assertSize(m.count(i),i % 2);
+
+		// erasing during the iteration keeps the other iterators valid
+		size_t visited = 0;
+		for(auto it = m.begin(); it != m.end(); ) {
+			visited++;
+			if(it->first % 3 == 0)
+				m.erase(it++);
+			else
+				++it;
+		}
+		test_assertSize(visited,50);
+		test_assertSize(m.size(),33);
+
+		// reuse the tombstones
+		for(int i = 0; i < 100; ++i)
+			m[i] = i;
+		test_assertSize(m.size(),100);
+
+		m.erase(m.begin(),m.end());
+		test_assertTrue(m.empty());
+		test_assertTrue(m.begin() == m.end());
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
+
+static void test_copy(void) {
+	test_caseStart("Testing copy");
+
+	unordered_map<string,int> m1;
+	m1["foo"] = 1;
+	m1["bar"] = 4;
+	m1["a"] = 12;
+	unordered_map<string,int> m2(m1);
+	test_assertTrue(m1 == m2);
+	m2["a"] = 13;
+	test_assertTrue(m1 != m2);
+	test_assertInt(m1["a"],12);
+
+	for(auto it = m2.begin(); it != m2.end(); ++it) {
+		const string &key = it->first;
+		it->second += key.length();
+	}
+	test_assertInt(m2["foo"],4);
+	test_assertInt(m2["a"],14);
+
+	unordered_map<string,int> m3;
+	m3["test"] = 1;
+	m3 = m1;
+	test_assertTrue(m1 == m3);
+	test_assertSize(m3.count("test"),0);
+
+	m3.clear();
+	test_assertTrue(m3.empty());
+	m3.swap(m1);
+	test_assertTrue(m1.empty());
+	test_assertSize(m3.size(),3);
+
+	test_caseSucceeded();
+}
+
+static void test_set(void) {
+	size_t before,after;
+	test_caseStart("Testing set");
+
+	before = heapspace();
+	{
+		unordered_set<string> s;
+		test_assertTrue(s.insert("foo").second);
+		test_assertTrue(s.insert("bar").second);
+		test_assertFalse(s.insert("foo").second);
+		test_assertSize(s.size(),2);
+		test_assertSize(s.count("foo"),1);
+		test_assertSize(s.count("baz"),0);
+		test_assertSize(s.erase("foo"),1);
+		test_assertSize(s.count("foo"),0);
+		test_assertTrue(*s.begin() == "bar");
+
+		int ints[] = {5,3,5,1,3};
+		unordered_set<int> is(ints,ints + ARRAY_SIZE(ints));
+		test_assertSize(is.size(),3);
+		int sum = 0;
+		for(auto it = is.begin(); it != is.end(); ++it)
+			sum += *it;
+		test_assertInt(sum,9);
+	}
+	after = heapspace();
+	test_assertTrue(after >= before);
+
+	test_caseSucceeded();
+}
@@ -36,6 +36,9 @@ extern sTestModule tModSetjmp;
 extern sTestModule tModString;
 extern sTestModule tModMath;
 extern sTestModule tModQSort;
+extern sTestModule tModFPU;
+extern sTestModule tModFutex;
+extern sTestModule tModSpawn;
 
 int main(void) {
 	if(getuid() != ROOT_UID)
@@ -55,6 +58,9 @@ int main(void) {
 	test_register(&tModString);
 	test_register(&tModMath);
 	test_register(&tModQSort);
+	test_register(&tModFPU);
+	test_register(&tModFutex);
+	test_register(&tModSpawn);
 	test_start();
 	return EXIT_SUCCESS;
 }
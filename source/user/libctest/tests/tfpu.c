@@ -0,0 +1,192 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/test.h>
+#include <sys/thread.h>
+#if defined(__x86__)
+#	include <sys/arch/x86/cpuid.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#define THREAD_COUNT	4
+#define SWITCH_COUNT	50
+
+/* forward declarations */
+static void test_fpu(void);
+static void test_float(void);
+#if defined(__x86__)
+static void test_simd(void);
+#endif
+
+/* our test-module */
+sTestModule tModFPU = {
+	"FPU",
+	&test_fpu
+};
+
+static double floatRes[THREAD_COUNT];
+#if defined(__x86__)
+static bool haveAVX;
+static bool simdRes[THREAD_COUNT];
+#endif
+
+static void test_fpu(void) {
+	test_float();
+#if defined(__x86__)
+	test_simd();
+#endif
+}
+
+static double compute(long no,bool switchThreads) {
+	volatile double x = no + 0.5;
+	for(int i = 0; i < SWITCH_COUNT; ++i) {
+		x = x * 1.25 + i / 3.0;
+		if(switchThreads)
+			yield();
+	}
+	return x;
+}
+
+static int floatThread(void *arg) {
+	long no = (long)arg;
+	floatRes[no] = compute(no,true);
+	return 0;
+}
+
+static void test_float(void) {
+	tid_t tids[THREAD_COUNT];
+	test_caseStart("Floating point state with multiple threads");
+
+	for(long i = 0; i < THREAD_COUNT; ++i) {
+		int res = startthread(floatThread,(void*)i);
+		test_assertTrue(res >= 0);
+		tids[i] = res;
+	}
+	for(size_t i = 0; i < THREAD_COUNT; ++i)
+		join(tids[i]);
+	for(long i = 0; i < THREAD_COUNT; ++i)
+		test_assertTrue(floatRes[i] == compute(i,false));
+
+	test_caseSucceeded();
+}
+
+#if defined(__x86__)
+static int simdThread(void *arg) {
+	long no = (long)arg;
+	uint8_t in[8 * 32] A_ALIGNED(32);
+	uint8_t out[8 * 32] A_ALIGNED(32);
+	for(size_t i = 0; i < sizeof(in); ++i)
+		in[i] = no * 31 + i;
+	memset(out,0,sizeof(out));
+
+	/* put a different pattern in the registers of each thread and let the others run */
+	if(haveAVX) {
+		__asm__ volatile (
+			"vmovdqa   0(%0),%%ymm0\n\t"
+			"vmovdqa  32(%0),%%ymm1\n\t"
+			"vmovdqa  64(%0),%%ymm2\n\t"
+			"vmovdqa  96(%0),%%ymm3\n\t"
+			"vmovdqa 128(%0),%%ymm4\n\t"
+			"vmovdqa 160(%0),%%ymm5\n\t"
+			"vmovdqa 192(%0),%%ymm6\n\t"
+			"vmovdqa 224(%0),%%ymm7\n\t"
+			: : "r"(in) : "memory"
+		);
+	}
+	else {
+		__asm__ volatile (
+			"movdqa   0(%0),%%xmm0\n\t"
+			"movdqa  32(%0),%%xmm1\n\t"
+			"movdqa  64(%0),%%xmm2\n\t"
+			"movdqa  96(%0),%%xmm3\n\t"
+			"movdqa 128(%0),%%xmm4\n\t"
+			"movdqa 160(%0),%%xmm5\n\t"
+			"movdqa 192(%0),%%xmm6\n\t"
+			"movdqa 224(%0),%%xmm7\n\t"
+			: : "r"(in) : "memory"
+		);
+	}
+
+	for(int i = 0; i < SWITCH_COUNT; ++i)
+		yield();
+
+	if(haveAVX) {
+		__asm__ volatile (
+			"vmovdqa %%ymm0,  0(%0)\n\t"
+			"vmovdqa %%ymm1, 32(%0)\n\t"
+			"vmovdqa %%ymm2, 64(%0)\n\t"
+			"vmovdqa %%ymm3, 96(%0)\n\t"
+			"vmovdqa %%ymm4,128(%0)\n\t"
+			"vmovdqa %%ymm5,160(%0)\n\t"
+			"vmovdqa %%ymm6,192(%0)\n\t"
+			"vmovdqa %%ymm7,224(%0)\n\t"
+			"vzeroupper\n\t"
+			: : "r"(out) : "memory"
+		);
+		simdRes[no] = memcmp(in,out,sizeof(in)) == 0;
+	}
+	else {
+		__asm__ volatile (
+			"movdqa %%xmm0,  0(%0)\n\t"
+			"movdqa %%xmm1, 32(%0)\n\t"
+			"movdqa %%xmm2, 64(%0)\n\t"
+			"movdqa %%xmm3, 96(%0)\n\t"
+			"movdqa %%xmm4,128(%0)\n\t"
+			"movdqa %%xmm5,160(%0)\n\t"
+			"movdqa %%xmm6,192(%0)\n\t"
+			"movdqa %%xmm7,224(%0)\n\t"
+			: : "r"(out) : "memory"
+		);
+		simdRes[no] = true;
+		for(size_t i = 0; i < 8; ++i)
+			simdRes[no] &= memcmp(in + i * 32,out + i * 32,16) == 0;
+	}
+	return 0;
+}
+
+static void test_simd(void) {
+	tid_t tids[THREAD_COUNT];
+	uint32_t eax,ebx,ecx,edx;
+	test_caseStart("SSE/AVX registers with multiple threads");
+
+	cpuid(1,0,&eax,&ebx,&ecx,&edx);
+	if(~edx & CPUID1_EDX_SSE2) {
+		test_caseSucceeded();
+		return;
+	}
+	/* the kernel enables AVX via XCR0, if the CPU supports it */
+	haveAVX = (ecx & (CPUID1_ECX_OSXSAVE | CPUID1_ECX_AVX)) ==
+			(CPUID1_ECX_OSXSAVE | CPUID1_ECX_AVX) &&
+		(xgetbv(0) & XCR0_SSE_AVX) == XCR0_SSE_AVX;
+
+	for(long i = 0; i < THREAD_COUNT; ++i) {
+		int res = startthread(simdThread,(void*)i);
+		test_assertTrue(res >= 0);
+		tids[i] = res;
+	}
+	for(size_t i = 0; i < THREAD_COUNT; ++i)
+		join(tids[i]);
+	for(size_t i = 0; i < THREAD_COUNT; ++i)
+		test_assertTrue(simdRes[i]);
+
+	test_caseSucceeded();
+}
+#endif
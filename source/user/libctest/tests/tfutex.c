@@ -0,0 +1,76 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/mman.h>
+#include <sys/sharedinfo.h>
+#include <sys/sync.h>
+#include <sys/test.h>
+#include <errno.h>
+
+/* forward declarations */
+static void test_futex(void);
+static void test_badaddr(void);
+static void test_checkaddr(volatile int *addr);
+
+/* our test-module */
+sTestModule tModFutex = {
+	"Futex",
+	&test_futex
+};
+
+static void test_futex(void) {
+	test_badaddr();
+}
+
+static void test_badaddr(void) {
+	test_caseStart("Testing futexwait() and futexwake() with invalid addresses");
+
+	/* unmapped */
+	test_checkaddr(NULL);
+	volatile int *mem = (volatile int*)mmap(NULL,4096,0,PROT_READ | PROT_WRITE,MAP_PRIVATE,-1,0);
+	test_assertTrue(mem != NULL);
+	if(mem) {
+		test_assertInt(munmap((void*)mem),0);
+		test_checkaddr(mem);
+	}
+
+	/* unaligned */
+	int words[2] = {0,0};
+	test_checkaddr((volatile int*)((char*)words + 1));
+
+	/* in kernel-space */
+	test_checkaddr((volatile int*)~(uintptr_t)(sizeof(int) - 1));
+
+	/* read-only */
+	const sSharedInfo *info = sharedinfo();
+	if(info)
+		test_checkaddr((volatile int*)info);
+
+	/* the valid case still works */
+	test_assertInt(futexwait(words,1,0),-EWOULDBLOCK);
+	test_assertInt(futexwake(words,1),0);
+
+	test_caseSucceeded();
+}
+
+static void test_checkaddr(volatile int *addr) {
+	test_assertInt(futexwait(addr,0,1),-EFAULT);
+	test_assertInt(futexwake(addr,1),-EFAULT);
+}
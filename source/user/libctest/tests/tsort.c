@@ -40,6 +40,10 @@ static int strCompare(const void *a,const void *b) {
 	return strcmp(*(const char**)a,*(const char**)b);
 }
 
+static int arrCompare(const void *a,const void *b) {
+	return strcmp((const char*)a,(const char*)b);
+}
+
 static void test_qsort(void) {
 	test_caseStart("Testing qsort");
 
@@ -108,7 +112,7 @@ static void test_qsort(void) {
 			"m3/m3-15.png",
 			"m3/m3-27.png",
 		};
-		qsort(strs,ARRAY_SIZE(strs),sizeof(int),strCompare);
+		qsort(strs,ARRAY_SIZE(strs),sizeof(strs[0]),strCompare);
 		for(size_t i = 0; i < ARRAY_SIZE(strs); ++i) {
 			const char *sno = strs[i] + SSTRLEN("m3/m3-");
 			int no = atoi(sno);
@@ -116,5 +120,39 @@ static void test_qsort(void) {
 		}
 	}
 
+	{
+		/* patterns that degrade a naive quicksort: sorted, reverse sorted, equal and organ pipe */
+		const size_t count = 10000;
+		int *ints = (int*)malloc(count * sizeof(int));
+		test_assertTrue(ints != NULL);
+		for(int pattern = 0; pattern < 5; ++pattern) {
+			for(size_t i = 0; i < count; ++i) {
+				switch(pattern) {
+					case 0: ints[i] = i; break;
+					case 1: ints[i] = count - i; break;
+					case 2: ints[i] = 4; break;
+					case 3: ints[i] = i < count / 2 ? i : count - i; break;
+					default: ints[i] = rand() % 100000; break;
+				}
+			}
+			qsort(ints,count,sizeof(int),intCompare);
+			for(size_t i = 1; i < count; ++i) {
+				if(ints[i - 1] > ints[i]) {
+					test_assertInt(ints[i - 1],ints[i]);
+					break;
+				}
+			}
+		}
+		free(ints);
+	}
+
+	{
+		/* elements whose size is not a multiple of the word size */
+		char strs[][3] = {"zz","ab","ma","aa","zy","mb","ba"};
+		qsort(strs,ARRAY_SIZE(strs),sizeof(strs[0]),arrCompare);
+		for(size_t i = 1; i < ARRAY_SIZE(strs); ++i)
+			test_assertTrue(strcmp(strs[i - 1],strs[i]) < 0);
+	}
+
 	test_caseSucceeded();
 }
@@ -0,0 +1,76 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/proc.h>
+#include <sys/test.h>
+#include <sys/wait.h>
+#include <errno.h>
+
+/* forward declarations */
+static void test_spawn(void);
+static void test_exitcode(void);
+static void test_notfound(void);
+
+/* our test-module */
+sTestModule tModSpawn = {
+	"Spawn",
+	&test_spawn
+};
+
+static void test_spawn(void) {
+	test_exitcode();
+	test_notfound();
+}
+
+static int spawn_and_wait(const char **args) {
+	int status;
+	int pid = spawn(args[0],args,NULL,NULL,0);
+	test_assertTrue(pid > 0);
+	if(pid <= 0)
+		return -1;
+	test_assertInt(waitpid(pid,&status,0),pid);
+	test_assertTrue(WIFEXITED(status));
+	return WEXITSTATUS(status);
+}
+
+static void test_exitcode(void) {
+	test_caseStart("Testing the exit-code of spawned processes");
+
+	/* the child has to run the program instead of dying right after the exec */
+	const char *okargs[] = {"/bin/sync","/",NULL};
+	test_assertInt(spawn_and_wait(okargs),EXIT_SUCCESS);
+
+	/* sync prints its usage and fails without arguments */
+	const char *failargs[] = {"/bin/sync",NULL};
+	test_assertInt(spawn_and_wait(failargs),EXIT_FAILURE);
+
+	test_caseSucceeded();
+}
+
+static void test_notfound(void) {
+	test_caseStart("Testing spawn of a non-existing program");
+
+	const char *args[] = {"/bin/doesnotexist",NULL};
+	test_assertInt(spawn(args[0],args,NULL,NULL,0),-ENOENT);
+	/* the child has already been collected by spawn */
+	test_assertInt(waitchild(NULL,-1),-ECHILD);
+
+	test_caseSucceeded();
+}
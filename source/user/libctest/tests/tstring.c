@@ -26,6 +26,7 @@
 static void test_string(void);
 static void test_strtold(void);
 static void test_ecvt(void);
+static void test_memops(void);
 
 /* our test-module */
 sTestModule tModString = {
@@ -36,6 +37,7 @@ sTestModule tModString = {
 static void test_string(void) {
 	test_strtold();
 	test_ecvt();
+	test_memops();
 }
 
 static void test_strtold(void) {
@@ -116,3 +118,68 @@ static void test_ecvt(void) {
 
 	test_caseSucceeded();
 }
+
+static void test_memops(void) {
+	static const size_t sizes[] = {
+		0,1,2,3,4,7,8,15,16,17,31,32,33,63,64,65,127,128,129,255,256,1000,2048,4099,
+		512 * 1024 + 3
+	};
+	const size_t max = 512 * 1024 + 3 + 64;
+	test_caseStart("Testing mem*() and strlen() with different sizes and alignments");
+
+	uchar *src = (uchar*)malloc(max);
+	uchar *dst = (uchar*)malloc(max);
+	test_assertTrue(src != NULL && dst != NULL);
+	for(size_t i = 0; i < max; ++i)
+		src[i] = i % 251 + 1;
+
+	for(size_t s = 0; s < ARRAY_SIZE(sizes); ++s) {
+		size_t n = sizes[s];
+		for(size_t off = 0; off < 33; off += n > 4096 ? 11 : 1) {
+			size_t i;
+
+			/* memcpy must not touch the bytes around the destination */
+			memset(dst,0,n + 64);
+			test_assertTrue(memcpy(dst + off,src + 1,n) == dst + off);
+			for(i = 0; i < off && dst[i] == 0; ++i)
+				;
+			for(; i < off + n && dst[i] == src[i - off + 1]; ++i)
+				;
+			for(; i < n + 64 && dst[i] == 0; ++i)
+				;
+			test_assertSize(i,n + 64);
+
+			test_assertInt(memcmp(dst + off,src + 1,n),0);
+			if(n > 0) {
+				dst[off + n - 1]--;
+				test_assertTrue(memcmp(dst + off,src + 1,n) < 0);
+				test_assertTrue(memcmp(src + 1,dst + off,n) > 0);
+			}
+
+			test_assertTrue(memset(dst + off,0xAB,n) == dst + off);
+			for(i = 0; i < off && dst[i] == 0; ++i)
+				;
+			for(; i < off + n && dst[i] == 0xAB; ++i)
+				;
+			for(; i < n + 64 && dst[i] == 0; ++i)
+				;
+			test_assertSize(i,n + 64);
+
+			/* memchr has to find the first occurrence, even behind a null-byte */
+			test_assertTrue(memchr(dst + off,0,n) == NULL);
+			dst[off + n] = 0xCD;
+			test_assertTrue(memchr(dst + off,0xCD,n) == NULL);
+			if(n > 2) {
+				dst[off + n / 2] = 0;
+				dst[off + n - 1] = 0xCD;
+				test_assertTrue(memchr(dst + off,0xCD,n) == dst + off + n - 1);
+				test_assertTrue(memchr(dst + off,0,n) == dst + off + n / 2);
+				test_assertSize(strlen((char*)dst + off),n / 2);
+			}
+		}
+	}
+
+	free(dst);
+	free(src);
+	test_caseSucceeded();
+}
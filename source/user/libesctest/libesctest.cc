@@ -29,6 +29,7 @@ extern sTestModule tModDList;
 extern sTestModule tModTreap;
 extern sTestModule tModStream;
 extern sTestModule tModRegex;
+extern sTestModule tModThreadPool;
 
 int main() {
 	test_register(&tModRBuffer);
@@ -39,6 +40,7 @@ int main() {
 	test_register(&tModTreap);
 	test_register(&tModStream);
 	test_register(&tModRegex);
+	test_register(&tModThreadPool);
 	test_start();
 	return EXIT_SUCCESS;
 }
@@ -22,6 +22,7 @@
 #include <sys/common.h>
 #include <sys/test.h>
 #include <math.h>
+#include <string.h>
 
 using namespace esc;
 
@@ -33,6 +34,8 @@ static void test_charclass();
 static void test_choice();
 static void test_errors();
 static void test_replace();
+static void test_backtrack();
+static void test_lines();
 static void test_regex();
 
 /* our test-module */
@@ -50,6 +53,8 @@ static void test_regex() {
     test_choice();
     test_errors();
     test_replace();
+    test_backtrack();
+    test_lines();
 }
 
 static void test_basic() {
@@ -534,3 +539,69 @@ static void test_replace() {
 
 	test_caseSucceeded();
 }
+
+static void test_backtrack() {
+	test_caseStart("Testing backtracking");
+
+	size_t before = heapspace();
+	{
+		Regex::Pattern pat = Regex::compile("a.*b");
+		test_assertTrue(Regex::matches(pat,"ab"));
+		test_assertTrue(Regex::matches(pat,"axxbxb"));
+		test_assertFalse(Regex::matches(pat,"axxbx"));
+		test_assertStr(Regex::search(pat,"_axbxbx").get(0).c_str(),"axbxb");
+	}
+
+	{
+		Regex::Pattern pat = Regex::compile("^(a+)(a*)a$");
+		Regex::Result res = Regex::search(pat,"aaaa");
+		test_assertTrue(res.matched());
+		test_assertStr(res.get(1).c_str(),"aaa");
+		test_assertStr(res.get(2).c_str(),"");
+	}
+
+	{
+		// exponential for a backtracking matcher
+		Regex::Pattern pat = Regex::compile("^(a?){30}a{30}$");
+		std::string str(30,'a');
+		test_assertTrue(Regex::matches(pat,str));
+		test_assertFalse(Regex::matches(pat,str.substr(1)));
+		test_assertTrue(Regex::search(pat,str).matched());
+	}
+	test_assertSize(heapspace(),before);
+
+	test_caseSucceeded();
+}
+
+static void test_lines() {
+	test_caseStart("Testing line search");
+
+	size_t before = heapspace();
+	{
+		const char *buf = "foo\nbar 12\n\nbaz 3\nerror 4";
+		const char *end = buf + strlen(buf);
+
+		Regex::Pattern pat = Regex::compile("[a-z]+ \\d");
+		const char *line = Regex::searchLine(pat,buf,end);
+		test_assertTrue(line == buf + 4);
+		line = Regex::searchLine(pat,line + 7,end);
+		test_assertTrue(line == buf + 12);
+		line = Regex::searchLine(pat,line + 6,end);
+		test_assertTrue(line == buf + 18);
+		test_assertTrue(Regex::searchLine(pat,line + 7,end) == NULL);
+
+		Regex::Pattern empty = Regex::compile("^$");
+		test_assertTrue(Regex::searchLine(empty,buf,end) == buf + 11);
+
+		Regex::Pattern lit = Regex::compile("^ba[rz]");
+		test_assertTrue(Regex::searchLine(lit,buf,end) == buf + 4);
+		test_assertTrue(Regex::searchLine(lit,buf + 5,end) == buf + 12);
+
+		Regex::Pattern ci = Regex::compile("ERROR");
+		test_assertTrue(Regex::searchLine(ci,buf,end) == NULL);
+		test_assertTrue(Regex::searchLine(ci,buf,end,Regex::CASE_INSENSITIVE) == buf + 18);
+	}
+	test_assertSize(heapspace(),before);
+
+	test_caseSucceeded();
+}
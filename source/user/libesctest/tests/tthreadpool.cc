@@ -0,0 +1,178 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/threadpool.h>
+#include <sys/common.h>
+#include <sys/test.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/* forward declarations */
+static void test_threadpool();
+static void test_futures();
+static void test_for();
+static void test_reduce();
+static void test_nested();
+static void test_errors();
+
+/* our test-module */
+sTestModule tModThreadPool = {
+	"Thread pool",
+	&test_threadpool
+};
+
+static void test_threadpool() {
+	test_futures();
+	test_for();
+	test_reduce();
+	test_nested();
+	test_errors();
+}
+
+static void test_futures() {
+	test_caseStart("Testing futures");
+
+	{
+		esc::ThreadPool pool(3);
+		test_assertSize(pool.workers(),3);
+
+		std::vector<esc::Future<int>*> futures;
+		for(int i = 0; i < 100; ++i)
+			futures.push_back(new esc::Future<int>(pool.async([i] { return i * 2; })));
+		for(int i = 0; i < 100; ++i) {
+			test_assertInt(futures[i]->get(),i * 2);
+			delete futures[i];
+		}
+
+		volatile int value = 0;
+		esc::Future<void> f = pool.async([&value] { value = 42; });
+		f.get();
+		test_assertTrue(f.ready());
+		test_assertInt(value,42);
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_for() {
+	test_caseStart("Testing parallel_for");
+
+	{
+		esc::ThreadPool pool(4);
+		std::vector<int> ints(10000);
+		for(size_t grain = 0; grain < 4; ++grain) {
+			pool.parallel_for(0,ints.size(),[&ints](size_t i) { ints[i]++; },grain);
+			for(size_t i = 0; i < ints.size(); ++i) {
+				if(ints[i] != (int)grain + 1) {
+					test_assertInt(ints[i],grain + 1);
+					break;
+				}
+			}
+		}
+
+		/* empty range */
+		pool.parallel_for(5,5,[&ints](size_t i) { ints[i]++; });
+		test_assertInt(ints[5],4);
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_reduce() {
+	test_caseStart("Testing parallel_reduce");
+
+	{
+		esc::ThreadPool pool(4);
+		ullong sum = pool.parallel_reduce(0,100000,0ULL,
+			[](size_t i) { return (ullong)i; },
+			[](ullong a,ullong b) { return a + b; });
+		test_assertULLInt(sum,100000ULL * 99999 / 2);
+
+		/* the operation does not need to be commutative */
+		std::string str = pool.parallel_reduce(0,260,std::string(),
+			[](size_t i) { return std::string(1,'a' + i % 26); },
+			[](const std::string &a,const std::string &b) { return a + b; },3);
+		test_assertSize(str.length(),260);
+		for(size_t i = 0; i < str.length(); ++i) {
+			if(str[i] != (char)('a' + i % 26)) {
+				test_assertInt(str[i],'a' + i % 26);
+				break;
+			}
+		}
+
+		int res = pool.parallel_reduce(0,0,7,[](size_t i) { return (int)i; },
+			[](int a,int b) { return a + b; });
+		test_assertInt(res,7);
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_nested() {
+	test_caseStart("Testing nested parallelism");
+
+	{
+		esc::ThreadPool pool(2);
+		std::vector<int> counts(50);
+		pool.parallel_for(0,counts.size(),[&pool,&counts](size_t i) {
+			counts[i] = pool.parallel_reduce(0,100,0,
+				[](size_t) { return 1; },
+				[](int a,int b) { return a + b; });
+		},1);
+		for(size_t i = 0; i < counts.size(); ++i)
+			test_assertInt(counts[i],100);
+	}
+
+	test_caseSucceeded();
+}
+
+static void test_errors() {
+	test_caseStart("Testing exceptions");
+
+	{
+		esc::ThreadPool pool(2);
+		bool caught = false;
+		try {
+			pool.parallel_for(0,1000,[](size_t i) {
+				if(i == 777)
+					throw std::runtime_error("failed");
+			});
+		}
+		catch(const esc::default_error &e) {
+			caught = true;
+			test_assertStr(e.what(),"failed");
+		}
+		test_assertTrue(caught);
+
+		esc::Future<int> f = pool.async([]() -> int { throw std::runtime_error("async"); });
+		caught = false;
+		try {
+			f.get();
+		}
+		catch(const esc::default_error &e) {
+			caught = true;
+			test_assertStr(e.what(),"async");
+		}
+		test_assertTrue(caught);
+	}
+
+	test_caseSucceeded();
+}
@@ -0,0 +1,451 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/arch.h>
+#include <sys/cmdargs.h>
+#include <sys/common.h>
+#include <sys/elf.h>
+#include <sys/io.h>
+#include <sys/proc.h>
+#include <sys/profile.h>
+#include <sys/stat.h>
+#include <sys/thread.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/* how often we drain the sample buffers of the kernel while the program runs */
+static const ulong DRAIN_INTERVAL	= 50 * 1000;
+static const size_t DEF_TOP			= 20;
+
+struct Symbol {
+	uintptr_t addr;
+	string name;
+
+	bool operator<(const Symbol &s) const {
+		return addr < s.addr;
+	}
+};
+
+struct Image {
+	vector<Symbol> syms;
+	/* the address of the code in the ELF file */
+	uintptr_t textAddr;
+};
+
+struct Region {
+	uintptr_t start;
+	uintptr_t end;
+	string path;
+	Image *image;
+};
+
+struct Count {
+	Count() : self(), total() {
+	}
+
+	size_t self;
+	size_t total;
+	map<string,size_t> callers;
+};
+
+static void sigHdlr(int sig);
+static int drainThread(void *arg);
+
+static volatile bool done = false;
+static int profFd = -1;
+static int childPid = 0;
+static vector<sProfSample> samples;
+static vector<Region> regions;
+static vector<Symbol> ksyms;
+static map<string,Image*> images;
+
+static void usage(const char *name) {
+	fprintf(stderr,"Usage: %s [-f <freq>] [-g] [-n <count>] <program> [arguments...]\n",name);
+	fprintf(stderr,"    -f <freq>:  take <freq> samples per second (default %d)\n",PROF_DEF_FREQ);
+	fprintf(stderr,"    -g:         print the callers of the functions as well\n");
+	fprintf(stderr,"    -n <count>: print the top <count> functions (default %zu)\n",DEF_TOP);
+	exit(EXIT_FAILURE);
+}
+
+/* the kernel prints addresses in the form xxxx:xxxx */
+static uintptr_t parseAddr(const char *str,const char **end) {
+	uintptr_t addr = 0;
+	for(; *str; ++str) {
+		int c = *str;
+		if(c >= '0' && c <= '9')
+			addr = addr * 16 + c - '0';
+		else if(c >= 'a' && c <= 'f')
+			addr = addr * 16 + c - 'a' + 10;
+		else if(c >= 'A' && c <= 'F')
+			addr = addr * 16 + c - 'A' + 10;
+		else if(c != ':')
+			break;
+	}
+	if(end)
+		*end = str;
+	return addr;
+}
+
+static void command(const char *cmd) {
+	if(write(profFd,cmd,strlen(cmd)) < 0)
+		error("Unable to send '%s' to %s",cmd,PROF_PATH);
+}
+
+static void drain() {
+	sProfSample buf[64];
+	ssize_t res;
+	while((res = read(profFd,buf,sizeof(buf))) > 0) {
+		for(size_t i = 0; i < res / sizeof(sProfSample); ++i) {
+			if(buf[i].pid == childPid)
+				samples.push_back(buf[i]);
+		}
+	}
+}
+
+static void readRegions() {
+	char path[MAX_PATH_LEN];
+	snprintf(path,sizeof(path),"/sys/proc/%d/map",childPid);
+	FILE *f = fopen(path,"r");
+	if(!f)
+		return;
+
+	/* the lines look like "<name> <start>..<end> (<size>K) <flags>" */
+	vector<Region> regs;
+	char line[256];
+	while(fgets(line,sizeof(line),f)) {
+		char *sp = strchr(line,' ');
+		if(!sp)
+			continue;
+		*sp = '\0';
+		const char *end;
+		char *p = sp + 1;
+		while(*p == ' ')
+			p++;
+		Region r;
+		r.start = parseAddr(p,&end);
+		if(strncmp(end,"..",2) != 0)
+			continue;
+		r.end = parseAddr(end + 2,&end) + 1;
+		const char *flags = strchr(end,')');
+		/* we are only interested in code */
+		if(!flags || line[0] != '/' || flags[3] != 'X')
+			continue;
+		r.path = line;
+		r.image = nullptr;
+		regs.push_back(r);
+	}
+	fclose(f);
+
+	/* keep the old regions, if the process is already gone */
+	if(regs.size() > 0)
+		regions = regs;
+}
+
+static int drainThread(A_UNUSED void *arg) {
+	while(!done) {
+		drain();
+		readRegions();
+		usleep(DRAIN_INTERVAL);
+	}
+	return 0;
+}
+
+static void loadKernelSymbols() {
+	FILE *f = fopen("/sys/ksymbols","r");
+	if(!f) {
+		printe("Unable to open /sys/ksymbols");
+		return;
+	}
+
+	char line[256];
+	while(fgets(line,sizeof(line),f)) {
+		/* the lines look like "\t<addr> -> <name>" */
+		char *arrow = strstr(line,"->");
+		if(!arrow)
+			continue;
+		Symbol sym;
+		sym.addr = parseAddr(line + 1,nullptr);
+		char *name = arrow + 3;
+		name[strcspn(name,"\n")] = '\0';
+		sym.name = name;
+		ksyms.push_back(sym);
+	}
+	fclose(f);
+	std::sort(ksyms.begin(),ksyms.end());
+}
+
+static Image *loadImage(const string &path) {
+	Image *img = new Image();
+	vector<Symbol> *syms = &img->syms;
+	img->textAddr = 0;
+	FILE *f = fopen(path.c_str(),"r");
+	if(!f)
+		return img;
+
+	sElfEHeader eheader;
+	if(fread(&eheader,sizeof(eheader),1,f) != 1 || memcmp(eheader.e_ident,ELFMAG,SELFMAG) != 0)
+		goto done;
+
+	/* determine where the code starts, for shared libraries */
+	for(size_t i = 0; i < eheader.e_phnum; ++i) {
+		sElfPHeader pheader;
+		fseek(f,eheader.e_phoff + i * eheader.e_phentsize,SEEK_SET);
+		if(fread(&pheader,sizeof(pheader),1,f) != 1)
+			goto done;
+		if(pheader.p_type == PT_LOAD && (pheader.p_flags & PF_X)) {
+			img->textAddr = pheader.p_vaddr & ~(PAGE_SIZE - 1);
+			break;
+		}
+	}
+
+	{
+		sElfSHeader *sheaders = new sElfSHeader[eheader.e_shnum];
+		fseek(f,eheader.e_shoff,SEEK_SET);
+		if(fread(sheaders,sizeof(sElfSHeader),eheader.e_shnum,f) != eheader.e_shnum) {
+			delete[] sheaders;
+			goto done;
+		}
+
+		/* prefer the full symbol table, but fall back to the dynamic one for stripped files */
+		sElfSHeader *symtab = nullptr;
+		for(size_t i = 0; i < eheader.e_shnum; ++i) {
+			if(sheaders[i].sh_type == SHT_SYMTAB)
+				symtab = sheaders + i;
+			else if(sheaders[i].sh_type == SHT_DYNSYM && !symtab)
+				symtab = sheaders + i;
+		}
+
+		if(symtab && symtab->sh_link < eheader.e_shnum) {
+			sElfSHeader *strtab = sheaders + symtab->sh_link;
+			char *strs = new char[strtab->sh_size + 1];
+			sElfSym *elfsyms = new sElfSym[symtab->sh_size / sizeof(sElfSym)];
+			fseek(f,strtab->sh_offset,SEEK_SET);
+			size_t strsize = fread(strs,1,strtab->sh_size,f);
+			strs[strsize] = '\0';
+			fseek(f,symtab->sh_offset,SEEK_SET);
+			size_t count = fread(elfsyms,sizeof(sElfSym),symtab->sh_size / sizeof(sElfSym),f);
+			for(size_t i = 0; i < count; ++i) {
+				if(ELF32_ST_TYPE(elfsyms[i].st_info) == STT_FUNC && elfsyms[i].st_value != 0 &&
+						elfsyms[i].st_name < strsize) {
+					Symbol sym;
+					sym.addr = elfsyms[i].st_value;
+					sym.name = strs + elfsyms[i].st_name;
+					syms->push_back(sym);
+				}
+			}
+			delete[] elfsyms;
+			delete[] strs;
+		}
+		delete[] sheaders;
+	}
+	std::sort(syms->begin(),syms->end());
+
+done:
+	fclose(f);
+	return img;
+}
+
+static const Symbol *lookup(const vector<Symbol> &syms,uintptr_t addr) {
+	/* find the last symbol that starts at or below <addr> */
+	size_t lo = 0, hi = syms.size();
+	while(lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if(syms[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo > 0 ? &syms[lo - 1] : nullptr;
+}
+
+static string symbolize(uintptr_t pc,bool user) {
+	char buf[64];
+	if(!user) {
+		const Symbol *sym = lookup(ksyms,pc);
+		if(sym)
+			return sym->name + " [kernel]";
+	}
+	else {
+		for(auto r = regions.begin(); r != regions.end(); ++r) {
+			if(pc >= r->start && pc < r->end) {
+				if(!r->image) {
+					auto it = images.find(r->path);
+					if(it == images.end())
+						images[r->path] = loadImage(r->path);
+					r->image = images[r->path];
+				}
+				/* shared libraries are not loaded at the address they have been linked to */
+				const Symbol *sym = lookup(r->image->syms,pc - r->start + r->image->textAddr);
+				if(sym)
+					return sym->name;
+				const char *name = strrchr(r->path.c_str(),'/');
+				snprintf(buf,sizeof(buf),"%s+%#lx",name ? name + 1 : r->path.c_str(),
+					pc - r->start);
+				return buf;
+			}
+		}
+	}
+	snprintf(buf,sizeof(buf),"%p",(void*)pc);
+	return buf;
+}
+
+static void report(size_t top,bool callers) {
+	map<string,Count> counts;
+	for(auto s = samples.begin(); s != samples.end(); ++s) {
+		string names[PROF_MAX_DEPTH];
+		for(size_t i = 0; i < s->depth; ++i) {
+			/* the return addresses point behind the call */
+			uintptr_t pc = i == 0 ? s->pcs[i] : s->pcs[i] - 1;
+			names[i] = symbolize(pc,s->flags & PROF_USER);
+
+			/* count recursive functions only once per sample */
+			bool seen = false;
+			for(size_t j = 0; j < i; ++j) {
+				if(names[j] == names[i]) {
+					seen = true;
+					break;
+				}
+			}
+
+			Count &c = counts[names[i]];
+			if(i == 0)
+				c.self++;
+			if(!seen)
+				c.total++;
+			if(i > 0 && !seen)
+				counts[names[i - 1]].callers[names[i]]++;
+		}
+	}
+
+	vector<pair<string,Count*>> funcs;
+	for(auto it = counts.begin(); it != counts.end(); ++it)
+		funcs.push_back(make_pair(it->first,&it->second));
+	std::sort(funcs.begin(),funcs.end(),[](const pair<string,Count*> &a,const pair<string,Count*> &b) {
+		if(a.second->self != b.second->self)
+			return a.second->self > b.second->self;
+		return a.second->total > b.second->total;
+	});
+
+	size_t total = samples.size();
+	printf("%zu samples of process %d\n\n",total,childPid);
+	if(total == 0)
+		return;
+
+	printf("%7s %7s %8s  %s\n","Self","Total","Samples","Function");
+	for(size_t i = 0; i < funcs.size() && i < top; ++i) {
+		Count *c = funcs[i].second;
+		printf("%6zu%% %6zu%% %8zu  %s\n",c->self * 100 / total,c->total * 100 / total,
+			c->self,funcs[i].first.c_str());
+	}
+
+	if(callers) {
+		printf("\nCallers:\n");
+		for(size_t i = 0; i < funcs.size() && i < top; ++i) {
+			Count *c = funcs[i].second;
+			printf("%s (%zu samples)\n",funcs[i].first.c_str(),c->total);
+			vector<pair<string,size_t>> sorted;
+			for(auto it = c->callers.begin(); it != c->callers.end(); ++it)
+				sorted.push_back(*it);
+			std::sort(sorted.begin(),sorted.end(),
+				[](const pair<string,size_t> &a,const pair<string,size_t> &b) {
+				return a.second > b.second;
+			});
+			for(auto it = sorted.begin(); it != sorted.end(); ++it)
+				printf("    %6zu%%  <- %s\n",it->second * 100 / c->total,it->first.c_str());
+		}
+	}
+}
+
+int main(int argc,char **argv) {
+	uint freq = PROF_DEF_FREQ;
+	size_t top = DEF_TOP;
+	bool callers = false;
+	if(argc < 2 || isHelpCmd(argc,argv))
+		usage(argv[0]);
+
+	int i;
+	for(i = 1; i < argc && argv[i][0] == '-'; ++i) {
+		if(strcmp(argv[i],"-g") == 0)
+			callers = true;
+		else if(strcmp(argv[i],"-f") == 0 && i + 1 < argc)
+			freq = strtoul(argv[++i],NULL,0);
+		else if(strcmp(argv[i],"-n") == 0 && i + 1 < argc)
+			top = strtoul(argv[++i],NULL,0);
+		else
+			usage(argv[0]);
+	}
+	if(i >= argc)
+		usage(argv[0]);
+
+	profFd = open(PROF_PATH,O_RDWR);
+	if(profFd < 0)
+		error("Unable to open %s",PROF_PATH);
+	if(signal(SIGINT,sigHdlr) == SIG_ERR)
+		error("Unable to set sig-handler for signal %d",SIGINT);
+
+	char cmd[32];
+	snprintf(cmd,sizeof(cmd),"start %u",freq);
+	command("reset");
+	command(cmd);
+
+	if((childPid = fork()) == 0) {
+		close(profFd);
+		execvp(argv[i],(const char**)argv + i);
+		error("Exec failed");
+	}
+	else if(childPid < 0)
+		error("Fork failed");
+
+	int tid = startthread(drainThread,NULL);
+	if(tid < 0)
+		error("Unable to start thread");
+
+	sExitState state;
+	int res;
+	while((res = waitchild(&state,childPid)) == -EINTR)
+		;
+	done = true;
+	join(tid);
+
+	command("stop");
+	drain();
+	close(profFd);
+
+	loadKernelSymbols();
+	report(top,callers);
+	return EXIT_SUCCESS;
+}
+
+static void sigHdlr(A_UNUSED int sig) {
+	if(childPid > 0) {
+		/* send SIGINT to the child */
+		if(kill(childPid,SIGINT) < 0)
+			printe("Unable to send signal to %d",childPid);
+	}
+}
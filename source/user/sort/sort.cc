@@ -17,8 +17,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <esc/stream/fstream.h>
 #include <esc/stream/std.h>
 #include <esc/cmdargs.h>
+#include <sys/common.h>
+#include <sys/proc.h>
+#include <sys/thread.h>
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <string>
@@ -27,63 +34,611 @@
 using namespace std;
 using namespace esc;
 
-static bool compareStrs(const string& a,const string& b);
+/* the default amount of memory for the lines of one chunk */
+static const size_t DEF_CHUNK_SIZE		= 4 * 1024 * 1024;
+/* the maximum number of runs that are merged at once */
+static const size_t MAX_FANIN			= 16;
+static const size_t READ_BUF_SIZE		= 64 * 1024;
+
+/**
+ * A line with its key. <str> is always null-terminated.
+ */
+struct Line {
+	const char *str;
+	const char *key;
+	size_t len;
+	size_t keylen;
+	double num;
+};
+
+/* options */
+static int figncase = 0;
+static int freverse = 0;
+static int fnumeric = 0;
+static int funique = 0;
+static char separator = '\0';
+static size_t keyField1 = 0;
+static size_t keyChar1 = 0;
+static size_t keyField2 = 0;
+static size_t keyChar2 = 0;
+static int threads = 1;
+static string tmpdir = "/tmp";
+
 static void usage(const char *name) {
-	serr << "Usage: " << name << " [-r] [-i] [<file>]" << '\n';
+	serr << "Usage: " << name << " [-r] [-i] [-n] [-u] [-t <sep>] [-k <key>] [-p <n>]";
+	serr << " [-S <size>] [-T <dir>] [<file>...]" << '\n';
 	serr << "    -r: reverse; i.e. descending instead of ascending" << '\n';
 	serr << "    -i: ignore case" << '\n';
+	serr << "    -n: compare the keys numerically" << '\n';
+	serr << "    -u: print only the first of a sequence of lines with equal keys" << '\n';
+	serr << "    -t <sep>: use <sep> as field separator instead of blank-to-nonblank transitions" << '\n';
+	serr << "    -k <f1>[.<c1>][,<f2>[.<c2>]]: use the fields <f1> .. <f2> as key" << '\n';
+	serr << "    -p <n>: sort with <n> threads" << '\n';
+	serr << "    -S <size>: the memory to use for lines, before sorted runs are written to disk" << '\n';
+	serr << "    -T <dir>: the directory for temporary files (/tmp by default)" << '\n';
 	exit(EXIT_FAILURE);
 }
 
-static int figncase = 0;
-static int freverse = 0;
+/* --------------------------------- keys --------------------------------- */
+
+static const char *fieldStart(const char *s,const char *end,size_t field) {
+	for(size_t i = 1; i < field && s < end; ++i) {
+		if(separator) {
+			s = (const char*)memchr(s,separator,end - s);
+			if(!s)
+				return end;
+			s++;
+		}
+		else {
+			/* leading blanks belong to the field */
+			while(s < end && isblank(*s))
+				s++;
+			while(s < end && !isblank(*s))
+				s++;
+		}
+	}
+	return s;
+}
+
+static const char *fieldEnd(const char *s,const char *end) {
+	if(separator) {
+		const char *e = (const char*)memchr(s,separator,end - s);
+		return e ? e : end;
+	}
+	while(s < end && isblank(*s))
+		s++;
+	while(s < end && !isblank(*s))
+		s++;
+	return s;
+}
+
+static double parseNumber(const char *s,const char *end) {
+	while(s < end && isblank(*s))
+		s++;
+	bool neg = false;
+	if(s < end && (*s == '-' || *s == '+'))
+		neg = *s++ == '-';
+	double val = 0;
+	for(; s < end && isdigit(*s); ++s)
+		val = val * 10 + (*s - '0');
+	if(s < end && *s == '.') {
+		double div = 10;
+		for(++s; s < end && isdigit(*s); ++s) {
+			val += (*s - '0') / div;
+			div *= 10;
+		}
+	}
+	return neg ? -val : val;
+}
+
+static void setKey(Line &line) {
+	const char *end = line.str + line.len;
+	const char *kbegin = line.str;
+	const char *kend = end;
+	if(keyField1) {
+		kbegin = fieldStart(line.str,end,keyField1);
+		if(keyChar1 > 1)
+			kbegin = MIN(kbegin + keyChar1 - 1,end);
+		if(keyField2) {
+			kend = fieldStart(line.str,end,keyField2);
+			if(keyChar2)
+				kend = MIN(kend + keyChar2,end);
+			else
+				kend = fieldEnd(kend,end);
+		}
+	}
+	line.key = kbegin;
+	line.keylen = kend > kbegin ? kend - kbegin : 0;
+	line.num = fnumeric ? parseNumber(kbegin,kbegin + line.keylen) : 0;
+}
+
+static int compareBytes(const char *a,size_t alen,const char *b,size_t blen) {
+	int res;
+	size_t len = MIN(alen,blen);
+	if(figncase) {
+		res = 0;
+		for(size_t i = 0; res == 0 && i < len; ++i)
+			res = tolower((uchar)a[i]) - tolower((uchar)b[i]);
+	}
+	else
+		res = memcmp(a,b,len);
+	if(res == 0)
+		res = alen < blen ? -1 : (alen > blen ? 1 : 0);
+	return res;
+}
+
+static int compareKeys(const Line &a,const Line &b) {
+	int res;
+	if(fnumeric)
+		res = a.num < b.num ? -1 : (a.num > b.num ? 1 : 0);
+	else
+		res = compareBytes(a.key,a.keylen,b.key,b.keylen);
+	return freverse ? -res : res;
+}
+
+static int compareLines(const Line &a,const Line &b) {
+	int res = compareKeys(a,b);
+	/* as a last resort, compare the whole lines to get a deterministic order. with -u, lines
+	 * with equal keys are considered equal */
+	if(res == 0 && !funique && (fnumeric || keyField1)) {
+		res = compareBytes(a.str,a.len,b.str,b.len);
+		if(freverse)
+			res = -res;
+	}
+	return res;
+}
+
+static bool lessLines(const Line &a,const Line &b) {
+	return compareLines(a,b) < 0;
+}
+
+/* -------------------------------- input --------------------------------- */
+
+/**
+ * Reads lines blockwise from a stream. Lines that span two blocks are collected in a string.
+ */
+class LineReader {
+public:
+	explicit LineReader(IStream *in)
+		: _in(in), _buf(new char[READ_BUF_SIZE]), _pos(), _end(), _eof(), _long() {
+	}
+	~LineReader() {
+		delete[] _buf;
+	}
+
+	LineReader(const LineReader&) = delete;
+	LineReader &operator=(const LineReader&) = delete;
+
+	/**
+	 * Reads the next line, without the newline. The returned pointer stays valid until the next
+	 * call and is null-terminated.
+	 *
+	 * @param len will be set to the length of the line
+	 * @return the line or NULL on EOF
+	 */
+	const char *next(size_t *len) {
+		_long.clear();
+		while(1) {
+			if(_pos == _end) {
+				if(_eof || !fill()) {
+					if(_long.empty())
+						return NULL;
+					*len = _long.length();
+					return _long.c_str();
+				}
+			}
+
+			char *nl = (char*)memchr(_buf + _pos,'\n',_end - _pos);
+			if(nl) {
+				char *line = _buf + _pos;
+				*nl = '\0';
+				_pos = nl + 1 - _buf;
+				if(_long.empty()) {
+					*len = nl - line;
+					return line;
+				}
+				_long.append(line,nl - line);
+				*len = _long.length();
+				return _long.c_str();
+			}
+
+			_long.append(_buf + _pos,_end - _pos);
+			_pos = _end;
+		}
+	}
+
+private:
+	bool fill() {
+		/* keep space for the null-termination of the last line */
+		size_t res = _in->read(_buf,READ_BUF_SIZE - 1);
+		_pos = 0;
+		_end = res;
+		if(res == 0)
+			_eof = true;
+		return res > 0;
+	}
+
+	IStream *_in;
+	char *_buf;
+	size_t _pos;
+	size_t _end;
+	bool _eof;
+	string _long;
+};
+
+/**
+ * Stores the lines of one run in an arena instead of a string per line.
+ */
+class Chunk {
+public:
+	explicit Chunk(size_t size)
+		: _arena(new char[size]), _size(size), _used(), lines() {
+	}
+	~Chunk() {
+		delete[] _arena;
+	}
+
+	Chunk(const Chunk&) = delete;
+	Chunk &operator=(const Chunk&) = delete;
+
+	bool empty() const {
+		return lines.empty();
+	}
+
+	/**
+	 * Adds the given line, if there is enough space
+	 *
+	 * @return true if it has been added
+	 */
+	bool add(const char *str,size_t len) {
+		if(_used + len + 1 > _size) {
+			if(!empty())
+				return false;
+			/* a single line that doesn't fit; the arena is empty, so we can replace it */
+			delete[] _arena;
+			_size = len + 1;
+			_arena = new char[_size];
+		}
+
+		Line line;
+		line.str = _arena + _used;
+		line.len = len;
+		memcpy(_arena + _used,str,len);
+		_arena[_used + len] = '\0';
+		_used += len + 1;
+		setKey(line);
+		lines.push_back(line);
+		return true;
+	}
+
+	void clear() {
+		_used = 0;
+		lines.clear();
+	}
+
+private:
+	char *_arena;
+	size_t _size;
+	size_t _used;
+
+public:
+	vector<Line> lines;
+};
+
+/* --------------------------- parallel sorting --------------------------- */
+
+struct SortJob {
+	Line *begin;
+	Line *end;
+};
+
+static int sortThread(void *arg) {
+	SortJob *job = (SortJob*)arg;
+	/* with -u, we print the first line of equal ones, so that the order has to be kept */
+	if(funique)
+		std::stable_sort(job->begin,job->end,lessLines);
+	else
+		std::sort(job->begin,job->end,lessLines);
+	return 0;
+}
+
+/**
+ * Sorts the lines of <chunk> in <threads> parts. The parts are merged afterwards.
+ *
+ * @return the sorted parts
+ */
+static vector<SortJob> sortChunk(Chunk &chunk) {
+	size_t count = chunk.lines.size();
+	size_t parts = MAX(1,MIN((size_t)threads,count / 1024));
+	vector<SortJob> jobs(parts);
+	vector<int> tids(parts);
+	Line *lines = &chunk.lines[0];
+	for(size_t i = 0; i < parts; ++i) {
+		jobs[i].begin = lines + (count * i) / parts;
+		jobs[i].end = lines + (count * (i + 1)) / parts;
+		/* the first part is sorted by ourself */
+		tids[i] = i > 0 ? startthread(sortThread,&jobs[i]) : -1;
+		if(i > 0 && tids[i] < 0)
+			sortThread(&jobs[i]);
+	}
+
+	sortThread(&jobs[0]);
+	for(size_t i = 1; i < parts; ++i) {
+		if(tids[i] >= 0)
+			join(tids[i]);
+	}
+	return jobs;
+}
+
+/* ------------------------------- merging -------------------------------- */
+
+/**
+ * A sorted sequence of lines, either in memory or in a file.
+ */
+class Source {
+public:
+	explicit Source() : cur(), index() {
+	}
+	virtual ~Source() {
+	}
+
+	/**
+	 * Moves to the next line.
+	 *
+	 * @return false if there is none
+	 */
+	virtual bool next() = 0;
+
+	Line cur;
+	/* the position in the input, which decides between equal lines */
+	size_t index;
+};
+
+class MemSource : public Source {
+public:
+	explicit MemSource(const SortJob &job) : Source(), _pos(job.begin), _end(job.end) {
+	}
+
+	virtual bool next() {
+		if(_pos == _end)
+			return false;
+		cur = *_pos++;
+		return true;
+	}
+
+private:
+	Line *_pos;
+	Line *_end;
+};
+
+class FileSource : public Source {
+public:
+	explicit FileSource(const string &path) : Source(), _file(path.c_str(),"r"), _reader(&_file) {
+		if(!_file)
+			exitmsg("Unable to open '" << path << "' for reading");
+	}
+
+	virtual bool next() {
+		cur.str = _reader.next(&cur.len);
+		if(!cur.str)
+			return false;
+		setKey(cur);
+		return true;
+	}
+
+private:
+	FStream _file;
+	LineReader _reader;
+};
+
+/**
+ * Writes lines and drops duplicates if requested.
+ */
+class Writer {
+public:
+	explicit Writer(OStream *out) : _out(out), _last(), _haveLast() {
+	}
+
+	void put(const Line &line) {
+		if(funique) {
+			if(_haveLast && compareKeys(_lastLine,line) == 0)
+				return;
+			_last.assign(line.str,line.len);
+			_lastLine = line;
+			_lastLine.str = _last.c_str();
+			setKey(_lastLine);
+			_haveLast = true;
+		}
+
+		_out->write(line.str,line.len);
+		_out->write('\n');
+		if(_out->bad())
+			exitmsg("Write failed");
+	}
+
+private:
+	OStream *_out;
+	string _last;
+	Line _lastLine;
+	bool _haveLast;
+};
+
+static bool sourceGreater(const Source *a,const Source *b) {
+	int res = compareLines(a->cur,b->cur);
+	return res > 0 || (res == 0 && a->index > b->index);
+}
+
+/**
+ * Merges the given sources with a min-heap into <out>.
+ */
+static void merge(vector<Source*> &sources,Writer &out) {
+	vector<Source*> heap;
+	for(size_t i = 0; i < sources.size(); ++i) {
+		sources[i]->index = i;
+		if(sources[i]->next())
+			heap.push_back(sources[i]);
+	}
+	std::make_heap(heap.begin(),heap.end(),sourceGreater);
+
+	while(!heap.empty()) {
+		std::pop_heap(heap.begin(),heap.end(),sourceGreater);
+		Source *top = heap.back();
+		out.put(top->cur);
+		if(top->next())
+			std::push_heap(heap.begin(),heap.end(),sourceGreater);
+		else
+			heap.pop_back();
+	}
+}
+
+/* ------------------------------ the runs -------------------------------- */
+
+static vector<string> runs;
+/* the runs that are written by the current merge pass */
+static vector<string> merged;
+
+/**
+ * Removes all runs that still exist. Registered with atexit, so that exitmsg doesn't leave them
+ * behind.
+ */
+static void removeRuns(A_UNUSED void *dummy) {
+	for(auto it = runs.begin(); it != runs.end(); ++it)
+		unlink(it->c_str());
+	for(auto it = merged.begin(); it != merged.end(); ++it)
+		unlink(it->c_str());
+}
+
+static string tmpName() {
+	static size_t no = 0;
+	char name[64];
+	snprintf(name,sizeof(name),"/sort.%d.%zu",getpid(),no++);
+	return tmpdir + name;
+}
+
+static void writeChunk(Chunk &chunk,Writer &out) {
+	vector<SortJob> parts = sortChunk(chunk);
+	vector<Source*> sources;
+	for(auto it = parts.begin(); it != parts.end(); ++it)
+		sources.push_back(new MemSource(*it));
+	merge(sources,out);
+	for(auto it = sources.begin(); it != sources.end(); ++it)
+		delete *it;
+}
+
+static void spill(Chunk &chunk) {
+	string name = tmpName();
+	FStream f(name.c_str(),"w");
+	if(!f)
+		exitmsg("Unable to open '" << name << "' for writing");
+	runs.push_back(name);
+	Writer w(&f);
+	writeChunk(chunk,w);
+	chunk.clear();
+}
+
+static void mergeRuns(size_t first,size_t count,Writer &out) {
+	vector<Source*> sources;
+	for(size_t i = first; i < first + count; ++i)
+		sources.push_back(new FileSource(runs[i]));
+	merge(sources,out);
+	for(size_t i = 0; i < count; ++i) {
+		delete sources[i];
+		unlink(runs[first + i].c_str());
+	}
+}
+
+static void readInput(IStream *in,Chunk &chunk) {
+	LineReader reader(in);
+	const char *line;
+	size_t len;
+	while((line = reader.next(&len))) {
+		if(!chunk.add(line,len)) {
+			spill(chunk);
+			chunk.add(line,len);
+		}
+	}
+}
+
+static void parseKey(const string &spec) {
+	const char *s = spec.c_str();
+	char *end;
+	keyField1 = strtoul(s,&end,10);
+	if(*end == '.')
+		keyChar1 = strtoul(end + 1,&end,10);
+	if(*end == ',') {
+		keyField2 = strtoul(end + 1,&end,10);
+		if(*end == '.')
+			keyChar2 = strtoul(end + 1,&end,10);
+		if(keyField2 == 0)
+			throw esc::cmdargs_error("Invalid key: the field numbers start at 1");
+	}
+	if(*end != '\0' || keyField1 == 0)
+		throw esc::cmdargs_error("Invalid key: " + spec);
+}
 
 int main(int argc,char *argv[]) {
-	FStream *in = &sin;
+	string key;
+	uint chunkSize = DEF_CHUNK_SIZE;
 
-	esc::cmdargs args(argc,argv,esc::cmdargs::MAX1_FREE);
+	esc::cmdargs args(argc,argv,0);
 	try {
-		args.parse("r i",&freverse,&figncase);
-		if(args.is_help())
+		args.parse("r i n u t=c k=s p=d S=k T=s",&freverse,&figncase,&fnumeric,&funique,
+			&separator,&key,&threads,&chunkSize,&tmpdir);
+		if(args.is_help() || threads < 1 || chunkSize == 0)
 			usage(argv[0]);
+		if(!key.empty())
+			parseKey(key);
 	}
 	catch(const esc::cmdargs_error& e) {
 		errmsg("Invalid arguments: " << e.what());
 		usage(argv[0]);
 	}
 
-	// use arg?
-	if(!args.get_free().empty()) {
-		in = new FStream((args.get_free()[0])->c_str(),"r");
-		if(!in->good())
-			exitmsg("Open failed");
-	}
+	atexit(removeRuns);
 
-	// read lines
-	string line;
-	vector<string> lines;
-	while(in->getline(line))
-		lines.push_back(line);
+	Chunk chunk(chunkSize);
+	if(args.get_free().empty())
+		readInput(&sin,chunk);
+	else {
+		for(auto it = args.get_free().begin(); it != args.get_free().end(); ++it) {
+			if(**it == "-")
+				readInput(&sin,chunk);
+			else {
+				FStream f((*it)->c_str(),"r");
+				if(!f)
+					exitmsg("Unable to open '" << **it << "' for reading");
+				readInput(&f,chunk);
+			}
+		}
+	}
 
-	// close if it has been opened
-	if(in != &sin)
-		delete in;
+	Writer out(&sout);
+	if(runs.empty()) {
+		/* everything fits into memory */
+		if(!chunk.empty())
+			writeChunk(chunk,out);
+	}
+	else {
+		if(!chunk.empty())
+			spill(chunk);
 
-	// sort and print
-	sort(lines.begin(),lines.end(),compareStrs);
-	for(auto it = lines.begin(); it != lines.end(); ++it) {
-		sout << *it << '\n';
-		if(sout.bad())
-			exitmsg("Write failed");
+		/* merge the runs in multiple passes, if there are too many. the merged runs replace the
+		 * original ones at their position to keep the input order */
+		while(runs.size() > MAX_FANIN) {
+			for(size_t first = 0; first < runs.size(); first += MAX_FANIN) {
+				string name = tmpName();
+				FStream f(name.c_str(),"w");
+				if(!f)
+					exitmsg("Unable to open '" << name << "' for writing");
+				merged.push_back(name);
+				Writer w(&f);
+				mergeRuns(first,MIN(MAX_FANIN,runs.size() - first),w);
+			}
+			runs.swap(merged);
+			merged.clear();
+		}
+		mergeRuns(0,runs.size(),out);
+		runs.clear();
 	}
 	return EXIT_SUCCESS;
 }
-
-static bool compareStrs(const string& a,const string& b) {
-	bool res;
-	if(figncase)
-		res = strcasecmp(a.c_str(),b.c_str()) < 0;
-	else
-		res = a < b;
-	return freverse ? !res : res;
-}
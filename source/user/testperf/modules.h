@@ -19,9 +19,14 @@
 
 #include <sys/common.h>
 
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
 extern int mod_getpid(int,char**);
 extern int mod_yield(int,char**);
 extern int mod_fork(int,char**);
+extern int mod_spawn(int,char**);
 extern int mod_startthread(int,char**);
 extern int mod_file(int,char**);
 extern int mod_mmap(int,char**);
@@ -36,3 +41,12 @@ extern int mod_chgsize(int,char**);
 extern int mod_pagefault(int,char**);
 extern int mod_heap(int,char**);
 extern int mod_stdio(int,char**);
+extern int mod_deflate(int,char**);
+extern int mod_sort(int,char**);
+extern int mod_sleep(int,char**);
+extern int mod_threadpool(int,char**);
+extern int mod_time(int,char**);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,163 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/time.h>
+#include <z/deflate.h>
+#include <z/inflate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modules.h"
+
+static const size_t CORPUS_SIZE		= 1024 * 1024;
+
+static const char *words[] = {
+	"the","of","and","to","in","is","that","for","it","as","with","was","on","be","at","by",
+	"this","had","not","are","but","from","or","have","an","they","which","one","you","were",
+	"kernel","process","thread","memory","page","driver","file","system","message","device",
+};
+
+static void gen_text(uint8_t *buf,size_t size) {
+	uint seed = 1;
+	for(size_t i = 0; i < size; ) {
+		seed = seed * 1103515245 + 12345;
+		const char *w = words[(seed >> 16) % ARRAY_SIZE(words)];
+		while(*w && i < size)
+			buf[i++] = *w++;
+		if(i < size)
+			buf[i++] = (seed >> 8) % 13 == 0 ? '\n' : ' ';
+	}
+}
+
+static void gen_binary(uint8_t *buf,size_t size) {
+	uint seed = 1;
+	uint32_t *words = reinterpret_cast<uint32_t*>(buf);
+	for(size_t i = 0; i < size / sizeof(uint32_t); ++i) {
+		seed = seed * 1103515245 + 12345;
+		// mostly small, increasing values like in tables and executables
+		words[i] = (i & ~0xFUL) + ((seed >> 16) & 0x3);
+	}
+}
+
+static void gen_random(uint8_t *buf,size_t size) {
+	uint seed = 1;
+	for(size_t i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+}
+
+static void test(const char *name,const uint8_t *data,size_t size) {
+	// the ratio and the throughput are relative to the size
+	if(size == 0) {
+		printf("%s is empty\n",name);
+		return;
+	}
+
+	uint8_t *compr = (uint8_t*)malloc(size + size / 8 + 1024);
+	uint8_t *uncompr = (uint8_t*)malloc(size);
+	if(!compr || !uncompr) {
+		printf("Not enough memory\n");
+		free(uncompr);
+		free(compr);
+		return;
+	}
+
+	printf("%s (%zu bytes):\n",name,size);
+	z::Deflate deflate;
+	for(int level = z::Deflate::NONE; level <= z::Deflate::BEST; ++level) {
+		z::MemDeflateSource src(data,size);
+		z::MemDeflateDrain drain(compr,size + size / 8 + 1024);
+		uint64_t start = rdtsc();
+		deflate.compress(&drain,&src,level);
+		uint64_t ctime = tsctotime(rdtsc() - start);
+
+		z::MemInflateSource isrc(compr,drain.count());
+		z::MemInflateDrain idrain(uncompr,size);
+		z::Inflate inflate;
+		start = rdtsc();
+		int res = inflate.uncompress(&idrain,&isrc);
+		uint64_t utime = tsctotime(rdtsc() - start);
+		bool ok = res == 0 && memcmp(data,uncompr,size) == 0;
+
+		printf("  level %d: %7zu bytes (%3zu.%02zu%%), deflate %4Lu MB/s, inflate %4Lu MB/s%s\n",
+			level,drain.count(),(drain.count() * 100) / size,((drain.count() * 10000) / size) % 100,
+			size / MAX(ctime,1),size / MAX(utime,1),ok ? "" : " FAILED");
+	}
+
+	free(uncompr);
+	free(compr);
+}
+
+static void test_file(const char *path) {
+	FILE *f = fopen(path,"r");
+	if(!f) {
+		printf("Unable to open '%s'\n",path);
+		return;
+	}
+
+	size_t size = 0,total = CORPUS_SIZE;
+	uint8_t *buf = (uint8_t*)malloc(total);
+	size_t res;
+	while(buf && (res = fread(buf + size,1,total - size,f)) > 0) {
+		size += res;
+		if(size == total) {
+			total *= 2;
+			uint8_t *nbuf = (uint8_t*)realloc(buf,total);
+			if(!nbuf)
+				free(buf);
+			buf = nbuf;
+		}
+	}
+	fclose(f);
+
+	if(!buf) {
+		printf("Not enough memory\n");
+		return;
+	}
+	test(path,buf,size);
+	free(buf);
+}
+
+int mod_deflate(int argc,char *argv[]) {
+	// use the given files as corpus or generate one
+	if(argc > 2) {
+		for(int i = 2; i < argc; ++i)
+			test_file(argv[i]);
+		return 0;
+	}
+
+	uint8_t *buf = (uint8_t*)malloc(CORPUS_SIZE);
+	if(!buf) {
+		printf("Not enough memory\n");
+		return 1;
+	}
+	gen_text(buf,CORPUS_SIZE);
+	test("text",buf,CORPUS_SIZE);
+	gen_binary(buf,CORPUS_SIZE);
+	test("binary",buf,CORPUS_SIZE);
+	gen_random(buf,CORPUS_SIZE);
+	test("random",buf,CORPUS_SIZE);
+	memset(buf,0,CORPUS_SIZE);
+	test("zeros",buf,CORPUS_SIZE);
+	free(buf);
+	return 0;
+}
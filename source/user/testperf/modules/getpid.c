@@ -19,6 +19,7 @@
 
 #include <sys/common.h>
 #include <sys/proc.h>
+#include <sys/syscalls.h>
 #include <sys/time.h>
 #include <stdio.h>
 
@@ -26,6 +27,32 @@
 
 #define SYSC_COUNT		100000
 
+#if defined(__x86__)
+/* performs getpid via the interrupt-gate (used for acknowledging signals), which goes through the
+ * generic interrupt-handler, to compare it with syscall/sysenter */
+static long getpid_intgate(void) {
+	long res;
+#	if defined(__x86_64__)
+	ulong err;
+	__asm__ volatile (
+		"int	%3"
+		: "=a"(res), "=d"(err)
+		: "D"(SYSCALL_PID), "i"(ASM_IRQ_ACKSIG)
+		: "memory"
+	);
+#	else
+	ulong err;
+	__asm__ volatile (
+		"int	%3"
+		: "=a"(res), "=D"(err)
+		: "a"(SYSCALL_PID), "i"(ASM_IRQ_ACKSIG)
+		: "memory"
+	);
+#	endif
+	return err ? (long)err : res;
+}
+#endif
+
 int mod_getpid(A_UNUSED int argc,A_UNUSED char *argv[]) {
 	uint64_t start = rdtsc();
 	int i;
@@ -33,5 +60,13 @@ int mod_getpid(A_UNUSED int argc,A_UNUSED char *argv[]) {
 		getpid();
 	uint64_t end = rdtsc();
 	printf("getpid(): %Lu cycles/call\n",(end - start) / SYSC_COUNT);
+
+#if defined(__x86__)
+	start = rdtsc();
+	for(i = 0; i < SYSC_COUNT; ++i)
+		getpid_intgate();
+	end = rdtsc();
+	printf("getpid() via int: %Lu cycles/call\n",(end - start) / SYSC_COUNT);
+#endif
 	return 0;
 }
@@ -52,6 +52,19 @@ static void run_test(ulong ident,fLock lockFunc,fUnlock unlockFunc) {
 
 static int sem1;
 static int sem2;
+static tUserSem usem1;
+static tUserSem usem2;
+static ulong counter;
+
+static int usem_down(A_UNUSED int id) {
+	usemdown(&usem1);
+	return 0;
+}
+
+static int usem_up(A_UNUSED int id) {
+	usemup(&usem1);
+	return 0;
+}
 
 static int thread_pingpong(A_UNUSED void *arg) {
 	uint64_t start,end;
@@ -69,6 +82,35 @@ static int thread_pingpong(A_UNUSED void *arg) {
 	return 0;
 }
 
+static int thread_upingpong(void *arg) {
+	uint64_t start,end;
+	tUserSem *s1 = arg ? &usem1 : &usem2;
+	tUserSem *s2 = arg ? &usem2 : &usem1;
+	start = rdtsc();
+	for(int i = 0; i < TEST_COUNT; ++i) {
+		usemdown(s1);
+		usemup(s2);
+	}
+	end = rdtsc();
+	printf("[%3d] %Lu cycles/pingpong\n",gettid(),(end - start) / TEST_COUNT);
+	return 0;
+}
+
+static int thread_contended(A_UNUSED void *arg) {
+	uint64_t start,end;
+	start = rdtsc();
+	for(int i = 0; i < TEST_COUNT; ++i) {
+		usemdown(&usem1);
+		counter++;
+		usemup(&usem1);
+	}
+	end = rdtsc();
+	usemdown(&usem1);
+	printf("[%3d] %Lu cycles/iteration\n",gettid(),(end - start) / TEST_COUNT);
+	usemup(&usem1);
+	return 0;
+}
+
 int mod_locks(A_UNUSED int argc,A_UNUSED char *argv[]) {
 	printf("Local Semaphores...\n");
 	fflush(stdout);
@@ -105,5 +147,46 @@ int mod_locks(A_UNUSED int argc,A_UNUSED char *argv[]) {
 	join(0);
 	semdestr(sem2);
 	semdestr(sem1);
+
+	printf("User semaphores...\n");
+	fflush(stdout);
+	if(usemcrt(&usem1,1) < 0) {
+		printe("Unable to create usem");
+		return 1;
+	}
+	run_test(0,usem_down,usem_up);
+	usemdestr(&usem1);
+
+	printf("User semaphore pingpong...\n");
+	fflush(stdout);
+	if(usemcrt(&usem1,1) < 0 || usemcrt(&usem2,0) < 0) {
+		printe("Unable to create usems");
+		return 1;
+	}
+	if(startthread(thread_upingpong,(void*)0) < 0 || startthread(thread_upingpong,(void*)1) < 0) {
+		printe("Unable to start thread");
+		return 1;
+	}
+	join(0);
+	usemdestr(&usem2);
+	usemdestr(&usem1);
+
+	printf("Contended user semaphore...\n");
+	fflush(stdout);
+	counter = 0;
+	if(usemcrt(&usem1,1) < 0) {
+		printe("Unable to create usem");
+		return 1;
+	}
+	for(int i = 0; i < 4; ++i) {
+		if(startthread(thread_contended,NULL) < 0) {
+			printe("Unable to start thread");
+			return 1;
+		}
+	}
+	join(0);
+	if(counter != 4 * TEST_COUNT)
+		printe("Counter is %lu, expected %d",counter,4 * TEST_COUNT);
+	usemdestr(&usem1);
 	return 0;
 }
@@ -30,48 +30,76 @@ typedef void (*memop_func)(void *a,void *b,size_t len);
 
 static void do_test(const char *name,memop_func func);
 
+/* prevent that the compiler considers the calls as dead code */
+static volatile size_t sink;
+
 static void memcpy_func(void *a,void *b,size_t len) {
 	memcpy(a,(const void*)b,len);
 }
 static void memset_func(void *a,A_UNUSED void *b,size_t len) {
 	memset(a,0,len);
 }
+static void memchr_func(void *a,A_UNUSED void *b,size_t len) {
+	sink = (size_t)memchr(a,1,len);
+}
+static void strlen_func(void *a,A_UNUSED void *b,A_UNUSED size_t len) {
+	/* prepare() puts the null-byte behind the <len> bytes */
+	sink = strlen((const char*)a);
+}
+static void memcmp_func(void *a,void *b,size_t len) {
+	sink = memcmp(a,b,len);
+}
 
-static const size_t AREA_SIZE   = 4096;
-static const uint TEST_COUNT    = 10000;
+static const size_t MAX_SIZE	= 1024 * 1024;
+/* we transfer about that many bytes per size to get stable results */
+static const size_t TOTAL_BYTES	= 64 * 1024 * 1024;
+static const uint MIN_COUNT		= 1000;
 
 int mod_memops(A_UNUSED int argc,A_UNUSED char *argv[]) {
 	do_test("memcpy", memcpy_func);
 	do_test("memset", memset_func);
+	do_test("memchr", memchr_func);
+	do_test("strlen", strlen_func);
+	do_test("memcmp", memcmp_func);
 	return 0;
 }
 
-static void do_test(const char *name,memop_func func) {
-	void *mem = malloc(AREA_SIZE);
-	void *buf = malloc(AREA_SIZE);
+static void prepare(char *mem,char *buf,size_t len,bool unaligned) {
+	/* no matches for memchr, but equal contents for memcmp */
+	memset(mem,0xFF,MAX_SIZE + 1);
+	memset(buf,0xFF,MAX_SIZE + 1);
+	mem[len + unaligned] = '\0';
+}
 
-	{
-		uint64_t total = 0;
-		for(uint i = 0; i < TEST_COUNT; ++i) {
-			uint64_t start = rdtsc();
-			func(buf, mem, AREA_SIZE);
-			total += rdtsc() - start;
-		}
-		printf("Aligned %s with %zu bytes: %Lu cycles/call, %Lu MB/s\n",
-				name,AREA_SIZE,total / TEST_COUNT,
-				(AREA_SIZE * TEST_COUNT) / tsctotime(total));
+static void do_test(const char *name,memop_func func) {
+	char *mem = (char*)malloc(MAX_SIZE + 1);
+	char *buf = (char*)malloc(MAX_SIZE + 1);
+	if(!mem || !buf) {
+		printf("Not enough memory\n");
+		free(buf);
+		free(mem);
+		return;
 	}
 
-	{
-		uint64_t total = 0;
-		for(uint i = 0; i < TEST_COUNT; ++i) {
+	printf("%s:\n",name);
+	for(size_t size = 1; size <= MAX_SIZE; size *= 4) {
+		uint count = MAX(MIN_COUNT,TOTAL_BYTES / size);
+		for(int unaligned = 0; unaligned < 2; ++unaligned) {
+			/* the last size leaves no room for the unaligned variant */
+			size_t len = size - (unaligned && size == MAX_SIZE);
+			prepare(mem,buf,len,unaligned);
+
 			uint64_t start = rdtsc();
-			func((char*)buf + 1,(char*)mem + 1,AREA_SIZE - 2);
-			total += rdtsc() - start;
+			for(uint i = 0; i < count; ++i)
+				func(mem + unaligned,buf + unaligned,len);
+			uint64_t total = rdtsc() - start;
+
+			uint64_t time = tsctotime(total);
+			time = MAX(1,time);
+			printf("  %-9s %7zu bytes: %8Lu cycles/call, %6Lu MB/s\n",
+					unaligned ? "unaligned" : "aligned",len,total / count,
+					((uint64_t)len * count) / time);
 		}
-		printf("Unaligned %s with %zu bytes: %Lu cycles/call, %Lu MB/s\n",
-				name,AREA_SIZE,total / TEST_COUNT,
-				(AREA_SIZE * TEST_COUNT) / tsctotime(total));
 	}
 
 	free(buf);
@@ -0,0 +1,49 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/thread.h>
+#include <sys/time.h>
+#include <stdio.h>
+
+#include "../modules.h"
+
+#define SLEEP_COUNT		20
+
+static void test_sleep(ulong usecs) {
+	uint64_t min = ~0ULL,max = 0,total = 0;
+	for(int i = 0; i < SLEEP_COUNT; ++i) {
+		uint64_t start = rdtsc();
+		usleep(usecs);
+		uint64_t end = rdtsc();
+		uint64_t time = tsctotime(end - start);
+		min = MIN(min,time);
+		max = MAX(max,time);
+		total += time;
+	}
+	printf("usleep(%6lu): avg=%8Lu us, min=%8Lu us, max=%8Lu us\n",
+		usecs,total / SLEEP_COUNT,min,max);
+}
+
+int mod_sleep(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	static const ulong times[] = {0,10,50,100,500,1000,5000,20000};
+	for(size_t i = 0; i < ARRAY_SIZE(times); ++i)
+		test_sleep(times[i]);
+	return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <sys/common.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modules.h"
+
+static const size_t COUNT		= 256 * 1024;
+
+enum Pattern {
+	RANDOM,
+	SORTED,
+	REVERSE,
+	EQUAL,
+	ORGANPIPE,
+	FEW,
+};
+
+static const char *patterns[] = {
+	"random","sorted","reverse","equal","organpipe","few distinct"
+};
+
+static void generate(int *ints,size_t count,int pattern) {
+	uint seed = 1;
+	for(size_t i = 0; i < count; ++i) {
+		seed = seed * 1103515245 + 12345;
+		switch(pattern) {
+			case RANDOM:	ints[i] = seed >> 1; break;
+			case SORTED:	ints[i] = i; break;
+			case REVERSE:	ints[i] = count - i; break;
+			case EQUAL:		ints[i] = 42; break;
+			case ORGANPIPE:	ints[i] = i < count / 2 ? i : count - i; break;
+			default:		ints[i] = (seed >> 16) % 16; break;
+		}
+	}
+}
+
+static int intCompare(const void *a,const void *b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static bool check(const int *ints,size_t count) {
+	for(size_t i = 1; i < count; ++i) {
+		if(ints[i - 1] > ints[i])
+			return false;
+	}
+	return true;
+}
+
+int mod_sort(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	int *ints = (int*)malloc(COUNT * sizeof(int));
+	if(!ints) {
+		printf("Not enough memory\n");
+		return 1;
+	}
+
+	printf("Sorting %zu ints:\n",COUNT);
+	for(size_t p = 0; p < ARRAY_SIZE(patterns); ++p) {
+		generate(ints,COUNT,p);
+		uint64_t start = rdtsc();
+		qsort(ints,COUNT,sizeof(int),intCompare);
+		uint64_t qtime = tsctotime(rdtsc() - start);
+		bool qok = check(ints,COUNT);
+
+		generate(ints,COUNT,p);
+		start = rdtsc();
+		std::sort(ints,ints + COUNT);
+		uint64_t stime = tsctotime(rdtsc() - start);
+		bool sok = check(ints,COUNT);
+
+		generate(ints,COUNT,p);
+		start = rdtsc();
+		std::stable_sort(ints,ints + COUNT);
+		uint64_t sstime = tsctotime(rdtsc() - start);
+		bool ssok = check(ints,COUNT);
+
+		printf("  %-12s: qsort %6Lu us%s, std::sort %6Lu us%s, std::stable_sort %6Lu us%s\n",
+			patterns[p],qtime,qok ? "" : " FAILED",stime,sok ? "" : " FAILED",
+			sstime,ssok ? "" : " FAILED");
+	}
+
+	free(ints);
+	return 0;
+}
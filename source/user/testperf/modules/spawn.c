@@ -0,0 +1,87 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/proc.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../modules.h"
+
+#define TEST_COUNT		200
+#define BIG_SIZE		(8 * 1024 * 1024)
+
+static const char *progArgs[] = {"/bin/sleep","0",NULL};
+
+static void forkexec(const char *name) {
+	size_t i;
+	uint64_t total = 0;
+	for(i = 0; i < TEST_COUNT; ++i) {
+		uint64_t start = rdtsc();
+		int pid = fork();
+		if(pid == 0) {
+			execv(progArgs[0],progArgs);
+			exit(EXIT_FAILURE);
+		}
+		else if(pid < 0) {
+			printe("fork failed");
+			return;
+		}
+		waitchild(NULL,-1);
+		total += rdtsc() - start;
+	}
+	printf("fork+exec (%s): %Lu cycles/call\n",name,total / TEST_COUNT);
+}
+
+static void spawnexec(const char *name) {
+	size_t i;
+	uint64_t total = 0;
+	for(i = 0; i < TEST_COUNT; ++i) {
+		uint64_t start = rdtsc();
+		int pid = spawn(progArgs[0],progArgs,(const char**)environ,NULL,0);
+		if(pid < 0) {
+			printe("spawn failed");
+			return;
+		}
+		waitchild(NULL,-1);
+		total += rdtsc() - start;
+	}
+	printf("spawn     (%s): %Lu cycles/call\n",name,total / TEST_COUNT);
+}
+
+int mod_spawn(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	forkexec("small");
+	spawnexec("small");
+	fflush(stdout);
+
+	/* the cost of fork grows with the address-space of the parent, whereas spawn's doesn't */
+	char *mem = (char*)malloc(BIG_SIZE);
+	if(!mem) {
+		printe("Unable to allocate memory");
+		return EXIT_FAILURE;
+	}
+	memset(mem,0,BIG_SIZE);
+	forkexec("big  ");
+	spawnexec("big  ");
+	free(mem);
+	return EXIT_SUCCESS;
+}
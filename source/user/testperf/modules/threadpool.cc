@@ -0,0 +1,108 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <esc/threadpool.h>
+#include <sys/common.h>
+#include <sys/conf.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../modules.h"
+
+static const size_t COUNT		= 1024 * 1024;
+static const size_t TASK_COUNT	= 10000;
+static const int ROUNDS			= 32;
+
+static uint work(size_t i) {
+	uint x = i + 1;
+	for(int r = 0; r < ROUNDS; ++r)
+		x = x * 1103515245 + 12345;
+	return x >> 16;
+}
+
+static uint64_t benchFor(esc::ThreadPool &pool,uint *ints) {
+	uint64_t start = rdtsc();
+	pool.parallel_for(0,COUNT,[ints](size_t i) {
+		ints[i] = work(i);
+	});
+	return tsctotime(rdtsc() - start);
+}
+
+static uint64_t benchReduce(esc::ThreadPool &pool,ullong *sum) {
+	uint64_t start = rdtsc();
+	*sum = pool.parallel_reduce(0,COUNT,0ULL,
+		[](size_t i) { return (ullong)work(i); },
+		[](ullong a,ullong b) { return a + b; });
+	return tsctotime(rdtsc() - start);
+}
+
+static uint64_t benchTasks(esc::ThreadPool &pool) {
+	uint64_t start = rdtsc();
+	pool.parallel_for(0,TASK_COUNT,[](size_t) {},1);
+	return (rdtsc() - start) / TASK_COUNT;
+}
+
+int mod_threadpool(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	uint *ints = (uint*)malloc(COUNT * sizeof(uint));
+	if(!ints) {
+		printf("Not enough memory\n");
+		return 1;
+	}
+
+	ullong expected = 0;
+	for(size_t i = 0; i < COUNT; ++i)
+		expected += work(i);
+
+	long cpus = sysconf(CONF_CPU_COUNT);
+	size_t maxWorkers = MAX(cpus,1) * 2;
+	uint64_t forBase = 0, reduceBase = 0;
+	printf("Processing %zu elements with %d rounds each:\n",COUNT,ROUNDS);
+	for(size_t workers = 1; workers <= maxWorkers; workers *= 2) {
+		esc::ThreadPool pool(workers);
+		/* warm up, i.e. let all workers start and fault in the memory */
+		benchFor(pool,ints);
+
+		uint64_t fortime = benchFor(pool,ints);
+		bool forok = true;
+		for(size_t i = 0; i < COUNT; ++i) {
+			if(ints[i] != work(i)) {
+				forok = false;
+				break;
+			}
+		}
+
+		ullong sum;
+		uint64_t redtime = benchReduce(pool,&sum);
+		uint64_t taskcycles = benchTasks(pool);
+
+		if(workers == 1) {
+			forBase = fortime;
+			reduceBase = redtime;
+		}
+		printf("  %2zu workers: parallel_for %7Lu us (%3Lu%%)%s, parallel_reduce %7Lu us (%3Lu%%)%s,"
+			" %6Lu cycles/task\n",
+			workers,fortime,forBase * 100 / MAX(fortime,1),forok ? "" : " FAILED",
+			redtime,reduceBase * 100 / MAX(redtime,1),sum == expected ? "" : " FAILED",
+			taskcycles);
+	}
+
+	free(ints);
+	return 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/common.h>
+#include <sys/conf.h>
+#include <sys/syscalls.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../modules.h"
+
+#define CALL_COUNT		100000
+
+int mod_time(A_UNUSED int argc,A_UNUSED char *argv[]) {
+	struct timeval tv;
+	struct timespec ts;
+	int i;
+
+	uint64_t start = rdtsc();
+	for(i = 0; i < CALL_COUNT; ++i)
+		gettimeofday(&tv);
+	uint64_t end = rdtsc();
+	printf("gettimeofday(): %Lu cycles/call\n",(end - start) / CALL_COUNT);
+
+	start = rdtsc();
+	for(i = 0; i < CALL_COUNT; ++i)
+		syscall1(SYSCALL_GETTOD,(ulong)&tv);
+	end = rdtsc();
+	printf("gettimeofday() via syscall: %Lu cycles/call\n",(end - start) / CALL_COUNT);
+
+	start = rdtsc();
+	for(i = 0; i < CALL_COUNT; ++i)
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+	end = rdtsc();
+	printf("clock_gettime(): %Lu cycles/call\n",(end - start) / CALL_COUNT);
+
+	start = rdtsc();
+	for(i = 0; i < CALL_COUNT; ++i)
+		sysconf(CONF_CPU_COUNT);
+	end = rdtsc();
+	printf("sysconf(): %Lu cycles/call\n",(end - start) / CALL_COUNT);
+
+	start = rdtsc();
+	for(i = 0; i < CALL_COUNT; ++i)
+		syscall1(SYSCALL_GETCONF,CONF_CPU_COUNT);
+	end = rdtsc();
+	printf("sysconf() via syscall: %Lu cycles/call\n",(end - start) / CALL_COUNT);
+	return 0;
+}
@@ -37,6 +37,7 @@ static sTestModule modules[] = {
 	{"getpid",		mod_getpid},
 	{"yield",		mod_yield},
 	{"fork",		mod_fork},
+	{"spawn",		mod_spawn},
 	{"startthread",	mod_startthread},
 	{"file",		mod_file},
 	{"mmap",		mod_mmap},
@@ -51,6 +52,11 @@ static sTestModule modules[] = {
 	{"pagefault",	mod_pagefault},
 	{"heap",		mod_heap},
 	{"stdio",		mod_stdio},
+	{"deflate",		mod_deflate},
+	{"sort",		mod_sort},
+	{"sleep",		mod_sleep},
+	{"threadpool",	mod_threadpool},
+	{"time",		mod_time},
 };
 
 int main(int argc,char *argv[]) {
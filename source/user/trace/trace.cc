@@ -0,0 +1,330 @@
+/**
+ * $Id$
+ * Copyright (C) 2008 - 2014 Nils Asmussen
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <sys/cmdargs.h>
+#include <sys/common.h>
+#include <sys/io.h>
+#include <sys/proc.h>
+#include <sys/syscalls.h>
+#include <sys/thread.h>
+#include <sys/time.h>
+#include <sys/trace.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/* how often we drain the trace buffers of the kernel while the program runs */
+static const ulong DRAIN_INTERVAL	= 20 * 1000;
+
+static const char *sysNames[] = {
+	"pid","ppid","debugchar","fork","exit","open","close","read","crtdev","chgsize",
+	"mapphys","write","yield","dupfd","redirfd","setsigh","acksig","sendsig","exec","fcntl",
+	"init","sleep","seek","stat","startthread","gettid","send","receive","getcycles","syncfs",
+	"link","unlink","mkdir","rmdir","mount","unmount","waitchild","tell","getconf","getwork",
+	"join","fstat","mmap","mprotect","munmap","mattr","getuid","setuid","geteuid","seteuid",
+	"getgid","setgid","getegid","setegid","chmod","chown","getgroups","setgroups","isingroup",
+	"alarm","tsctotime","semcrt","semop","semdestroy","sendrecv","sharefile","cancel","creatsibl",
+	"getconfstr","clonems","joinms","mlock","mlockall","semcrtirq","bindto","rename","gettod",
+	"utime","truncate","futexwait","futexwake","usleep","spawn",
+#ifdef __x86__
+	"reqioports","relioports",
+#else
+	"debug",
+#endif
+};
+static_assert(ARRAY_SIZE(sysNames) == SYSCALL_COUNT,"sysNames is out of date");
+
+static const char *evNames[] = {
+	"sys-enter","sys-exit","msg-send","msg-recv","sched","pf-enter","pf-exit","irq-enter","irq-exit"
+};
+static_assert(ARRAY_SIZE(evNames) == TRACE_EVENT_COUNT,"evNames is out of date");
+
+/* the cycles spent in a syscall, split up by the reason */
+struct Breakdown {
+	Breakdown() : total(), blocked(), pagefaults(), irqs(), msgs() {
+	}
+
+	void add(const Breakdown &b) {
+		total += b.total;
+		blocked += b.blocked;
+		pagefaults += b.pagefaults;
+		irqs += b.irqs;
+		msgs += b.msgs;
+	}
+
+	uint64_t total;
+	uint64_t blocked;
+	uint64_t pagefaults;
+	uint64_t irqs;
+	size_t msgs;
+};
+
+struct SyscallStats {
+	SyscallStats() : calls(), max(), sum() {
+	}
+
+	size_t calls;
+	uint64_t max;
+	Breakdown sum;
+};
+
+/* the state of a thread while we walk through the records */
+struct ThreadState {
+	ThreadState() : sysNo(-1), sysStart(), offStart(), pfStart(), irqStart(), cur() {
+	}
+
+	long sysNo;
+	uint64_t sysStart;
+	uint64_t offStart;
+	uint64_t pfStart;
+	uint64_t irqStart;
+	Breakdown cur;
+};
+
+static void sigHdlr(int sig);
+static int drainThread(void *arg);
+
+static volatile bool done = false;
+static int traceFd = -1;
+static int childPid = 0;
+static vector<sTraceRecord> records;
+
+static void usage(const char *name) {
+	fprintf(stderr,"Usage: %s [-e <mask>] [-r] <program> [arguments...]\n",name);
+	fprintf(stderr,"    -e <mask>: record only the events in <mask> (default %#x)\n",TRACE_ALL);
+	fprintf(stderr,"    -r:        print the raw records as well\n");
+	exit(EXIT_FAILURE);
+}
+
+static void command(const char *cmd) {
+	if(write(traceFd,cmd,strlen(cmd)) < 0)
+		error("Unable to send '%s' to %s",cmd,TRACE_PATH);
+}
+
+static void drain() {
+	sTraceRecord buf[128];
+	ssize_t res;
+	while((res = read(traceFd,buf,sizeof(buf))) > 0)
+		records.insert(records.end(),buf,buf + res / sizeof(sTraceRecord));
+}
+
+static int drainThread(A_UNUSED void *arg) {
+	while(!done) {
+		drain();
+		usleep(DRAIN_INTERVAL);
+	}
+	return 0;
+}
+
+static bool tscCompare(const sTraceRecord &a,const sTraceRecord &b) {
+	return a.tsc < b.tsc;
+}
+
+static void printRaw() {
+	uint64_t first = records.size() > 0 ? records[0].tsc : 0;
+	for(auto r = records.begin(); r != records.end(); ++r) {
+		printf("%12Lu %2u %3u:%-3u %-9s %#lx %#lx\n",r->tsc - first,r->cpu,r->pid,r->tid,
+			r->event < TRACE_EVENT_COUNT ? evNames[r->event] : "??",r->arg1,r->arg2);
+	}
+}
+
+static uint percent(uint64_t part,uint64_t total) {
+	return total ? part * 100 / total : 0;
+}
+
+static void printLine(const char *name,size_t calls,uint64_t max,const Breakdown &b) {
+	uint64_t cpu = b.total - MIN(b.total,b.blocked + b.pagefaults + b.irqs);
+	printf("%-12s %8zu %10Lu %10Lu %5u%% %5u%% %5u%% %5u%% %8zu\n",
+		name,calls,tsctotime(b.total / calls),tsctotime(max),
+		percent(cpu,b.total),percent(b.blocked,b.total),percent(b.pagefaults,b.total),
+		percent(b.irqs,b.total),b.msgs / calls);
+}
+
+static void report() {
+	map<tid_t,ThreadState> threads;
+	map<long,SyscallStats> stats;
+	size_t userPFs = 0;
+	uint64_t userPFTime = 0;
+
+	for(auto r = records.begin(); r != records.end(); ++r) {
+		/* for thread switches, the record belongs to the old thread */
+		if(r->event == TRACE_SCHED) {
+			if(r->pid == childPid)
+				threads[r->tid].offStart = r->tsc;
+			if((pid_t)r->arg2 == childPid) {
+				ThreadState &ts = threads[r->arg1];
+				if(ts.sysNo != -1 && ts.offStart)
+					ts.cur.blocked += r->tsc - ts.offStart;
+				ts.offStart = 0;
+			}
+			continue;
+		}
+		if(r->pid != childPid)
+			continue;
+
+		ThreadState &ts = threads[r->tid];
+		switch(r->event) {
+			case TRACE_SYSCALL_ENTER:
+				ts.sysNo = r->arg1;
+				ts.sysStart = r->tsc;
+				ts.cur = Breakdown();
+				break;
+
+			case TRACE_SYSCALL_EXIT:
+				/* we might have missed the entry */
+				if(ts.sysNo == (long)r->arg1) {
+					SyscallStats &s = stats[ts.sysNo];
+					ts.cur.total = r->tsc - ts.sysStart;
+					s.calls++;
+					s.max = MAX(s.max,ts.cur.total);
+					s.sum.add(ts.cur);
+				}
+				ts.sysNo = -1;
+				break;
+
+			case TRACE_MSG_SEND:
+			case TRACE_MSG_RECEIVE:
+				ts.cur.msgs++;
+				break;
+
+			case TRACE_PF_ENTER:
+				ts.pfStart = r->tsc;
+				break;
+
+			case TRACE_PF_EXIT:
+				if(ts.pfStart) {
+					if(ts.sysNo != -1)
+						ts.cur.pagefaults += r->tsc - ts.pfStart;
+					else {
+						userPFs++;
+						userPFTime += r->tsc - ts.pfStart;
+					}
+				}
+				ts.pfStart = 0;
+				break;
+
+			case TRACE_IRQ_ENTER:
+				ts.irqStart = r->tsc;
+				break;
+
+			case TRACE_IRQ_EXIT:
+				if(ts.irqStart && ts.sysNo != -1)
+					ts.cur.irqs += r->tsc - ts.irqStart;
+				ts.irqStart = 0;
+				break;
+		}
+	}
+
+	printf("%-12s %8s %10s %10s %6s %6s %6s %6s %8s\n",
+		"syscall","calls","avg(us)","max(us)","cpu","block","pf","irq","msgs");
+	size_t calls = 0;
+	uint64_t max = 0;
+	Breakdown all;
+	for(auto it = stats.begin(); it != stats.end(); ++it) {
+		const char *name = it->first < SYSCALL_COUNT ? sysNames[it->first] : "??";
+		printLine(name,it->second.calls,it->second.max,it->second.sum);
+		calls += it->second.calls;
+		max = MAX(max,it->second.max);
+		all.add(it->second.sum);
+	}
+	if(calls > 0)
+		printLine("total",calls,max,all);
+	printf("\n%zu page faults outside of syscalls (%Lu us)\n",userPFs,tsctotime(userPFTime));
+}
+
+int main(int argc,char **argv) {
+	uint mask = TRACE_ALL;
+	bool raw = false;
+	if(argc < 2 || isHelpCmd(argc,argv))
+		usage(argv[0]);
+
+	int i;
+	for(i = 1; i < argc && argv[i][0] == '-'; ++i) {
+		if(strcmp(argv[i],"-r") == 0)
+			raw = true;
+		else if(strcmp(argv[i],"-e") == 0 && i + 1 < argc)
+			mask = strtoul(argv[++i],NULL,0);
+		else
+			usage(argv[0]);
+	}
+	if(i >= argc)
+		usage(argv[0]);
+
+	traceFd = open(TRACE_PATH,O_RDWR);
+	if(traceFd < 0)
+		error("Unable to open %s",TRACE_PATH);
+	if(signal(SIGINT,sigHdlr) == SIG_ERR)
+		error("Unable to set sig-handler for signal %d",SIGINT);
+
+	command("stop");
+	command("reset");
+
+	if((childPid = fork()) == 0) {
+		/* enable the tracing here to not miss the beginning of the program */
+		char cmd[32];
+		snprintf(cmd,sizeof(cmd),"pid %d",getpid());
+		command(cmd);
+		snprintf(cmd,sizeof(cmd),"start %#x",mask);
+		command(cmd);
+		close(traceFd);
+		execvp(argv[i],(const char**)argv + i);
+		error("Exec failed");
+	}
+	else if(childPid < 0)
+		error("Fork failed");
+
+	int tid = startthread(drainThread,NULL);
+	if(tid < 0)
+		error("Unable to start thread");
+
+	sExitState state;
+	int res;
+	while((res = waitchild(&state,childPid)) == -EINTR)
+		;
+	done = true;
+	join(tid);
+
+	command("stop");
+	drain();
+	command("pid");
+	close(traceFd);
+
+	/* the records are only ordered per CPU */
+	std::sort(records.begin(),records.end(),tscCompare);
+	if(raw)
+		printRaw();
+	report();
+	return EXIT_SUCCESS;
+}
+
+static void sigHdlr(A_UNUSED int sig) {
+	if(childPid > 0) {
+		/* send SIGINT to the child */
+		if(kill(childPid,SIGINT) < 0)
+			printe("Unable to send signal to %d",childPid);
+	}
+}